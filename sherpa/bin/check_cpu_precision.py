@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+# Copyright (c)  2024  Xiaomi Corporation
+
+"""
+Compare the speed and the transcripts of an offline model running on CPU
+in float32 against the reduced-precision modes:
+
+  - int8: Linear layers of the encoder, decoder, and joiner are quantized
+          with int8 dynamic quantization when the model is loaded
+          (--use-int8).
+  - bf16: The encoder is run under bfloat16 autocast (--use-bf16).
+
+Usage:
+
+./sherpa/bin/check_cpu_precision.py \
+  --nn-model ./icefall-asr-librispeech-pruned-transducer-stateless8-2022-12-02/exp/cpu_jit-torch-1.10.pt \
+  --tokens ./icefall-asr-librispeech-pruned-transducer-stateless8-2022-12-02/data/lang_bpe_500/tokens.txt \
+  --decoding-method modified_beam_search \
+  ./icefall-asr-librispeech-pruned-transducer-stateless8-2022-12-02/test_wavs/1089-134686-0001.wav \
+  ./icefall-asr-librispeech-pruned-transducer-stateless8-2022-12-02/test_wavs/1221-135766-0001.wav \
+  ./icefall-asr-librispeech-pruned-transducer-stateless8-2022-12-02/test_wavs/1221-135766-0002.wav
+"""  # noqa
+import argparse
+import logging
+import time
+from typing import List, Tuple
+
+import torch
+import torchaudio
+
+import sherpa
+
+
+def get_parser():
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.ArgumentDefaultsHelpFormatter
+    )
+
+    parser.add_argument(
+        "--nn-model",
+        type=str,
+        required=True,
+        help="Path to the torchscript model",
+    )
+
+    parser.add_argument(
+        "--tokens",
+        type=str,
+        required=True,
+        help="Path to tokens.txt",
+    )
+
+    parser.add_argument(
+        "--decoding-method",
+        type=str,
+        default="greedy_search",
+        help="greedy_search, modified_beam_search, or fast_beam_search",
+    )
+
+    parser.add_argument(
+        "--sample-rate",
+        type=int,
+        default=16000,
+        help="Sample rate of the model",
+    )
+
+    parser.add_argument(
+        "--feat-dim",
+        type=int,
+        default=80,
+        help="Feature dimension of the model",
+    )
+
+    parser.add_argument(
+        "--num-threads",
+        type=int,
+        default=1,
+        help="Number of threads for PyTorch",
+    )
+
+    parser.add_argument(
+        "--num-runs",
+        type=int,
+        default=3,
+        help="Number of times to decode the sound files for timing",
+    )
+
+    parser.add_argument(
+        "sound_files",
+        type=str,
+        nargs="+",
+        help="The input sound file(s) to decode",
+    )
+
+    return parser
+
+
+def read_sound_files(
+    filenames: List[str], expected_sample_rate: float
+) -> List[torch.Tensor]:
+    ans = []
+    for f in filenames:
+        wave, sample_rate = torchaudio.load(f)
+        if sample_rate != expected_sample_rate:
+            wave = torchaudio.functional.resample(
+                wave,
+                orig_freq=sample_rate,
+                new_freq=expected_sample_rate,
+            )
+        ans.append(wave[0].contiguous())
+    return ans
+
+
+def create_recognizer(
+    args, use_int8: bool, use_bf16: bool
+) -> sherpa.OfflineRecognizer:
+    feat_config = sherpa.FeatureConfig()
+    feat_config.fbank_opts.frame_opts.samp_freq = args.sample_rate
+    feat_config.fbank_opts.mel_opts.num_bins = args.feat_dim
+    feat_config.fbank_opts.mel_opts.high_freq = -400
+    feat_config.fbank_opts.frame_opts.dither = 0
+
+    config = sherpa.OfflineRecognizerConfig(
+        nn_model=args.nn_model,
+        tokens=args.tokens,
+        use_gpu=False,
+        feat_config=feat_config,
+        decoding_method=args.decoding_method,
+    )
+    config.use_int8 = use_int8
+    config.use_bf16 = use_bf16
+
+    return sherpa.OfflineRecognizer(config)
+
+
+def decode(
+    recognizer: sherpa.OfflineRecognizer,
+    samples: List[torch.Tensor],
+    num_runs: int,
+) -> Tuple[List[str], float]:
+    """Return the transcripts and the average time in seconds."""
+    elapsed = 0
+    for _ in range(num_runs):
+        streams = []
+        for s in samples:
+            stream = recognizer.create_stream()
+            stream.accept_samples(s)
+            streams.append(stream)
+
+        start = time.time()
+        recognizer.decode_streams(streams)
+        elapsed += time.time() - start
+
+    return [s.result.text for s in streams], elapsed / num_runs
+
+
+def main():
+    args = get_parser().parse_args()
+    logging.info(vars(args))
+
+    torch.set_num_threads(args.num_threads)
+    torch.set_num_interop_threads(args.num_threads)
+
+    samples = read_sound_files(args.sound_files, args.sample_rate)
+    duration = sum(s.numel() for s in samples) / args.sample_rate
+
+    modes = [
+        ("float32", False, False),
+        ("int8", True, False),
+        ("bf16", False, True),
+    ]
+
+    transcripts = dict()
+    elapsed = dict()
+    for name, use_int8, use_bf16 in modes:
+        recognizer = create_recognizer(args, use_int8, use_bf16)
+        transcripts[name], elapsed[name] = decode(
+            recognizer, samples, args.num_runs
+        )
+        logging.info(
+            f"{name}: {elapsed[name]:.3f} s, "
+            f"RTF: {elapsed[name] / duration:.3f}"
+        )
+
+    for name, _, _ in modes[1:]:
+        speedup = elapsed["float32"] / elapsed[name]
+        num_diff = 0
+        for f, ref, hyp in zip(
+            args.sound_files, transcripts["float32"], transcripts[name]
+        ):
+            if ref != hyp:
+                num_diff += 1
+                logging.info(f"{name}, {f}:\n  float32: {ref}\n  {name}: {hyp}")
+        logging.info(
+            f"{name}: speedup {speedup:.2f}x, "
+            f"{num_diff}/{len(samples)} transcripts differ from float32"
+        )
+
+
+if __name__ == "__main__":
+    formatter = "%(asctime)s %(levelname)s [%(filename)s:%(lineno)d] %(message)s"  # noqa
+    logging.basicConfig(format=formatter, level=logging.INFO)
+
+    main()
@@ -0,0 +1,264 @@
+// sherpa/cpp_api/audio-segmenter.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/cpp_api/audio-segmenter.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "sherpa/cpp_api/parse-options.h"
+#include "sherpa/csrc/fbank-features.h"
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+void LongFormConfig::Register(ParseOptions *po) {
+  po->Register("long-form-max-segment-duration", &max_segment_duration,
+               "Used only for long-form decoding. Maximum duration in "
+               "seconds of a segment. Longer speech is split at the "
+               "longest pause in it.");
+
+  po->Register("long-form-min-silence-duration", &min_silence_duration,
+               "Used only for long-form decoding. Speech separated by "
+               "non-speech shorter than this number of seconds is kept in "
+               "the same segment.");
+
+  po->Register("long-form-max-merge-silence-duration",
+               &max_merge_silence_duration,
+               "Used only for long-form decoding. Adjacent segments are "
+               "merged if the non-speech between them is not longer than "
+               "this number of seconds and the result is not longer than "
+               "--long-form-max-segment-duration. Use 0 to disable it.");
+
+  po->Register("long-form-energy-threshold", &energy_threshold,
+               "Used only for long-form decoding. A frame is considered as "
+               "speech if the average of its log mel filterbank energies "
+               "is larger than this value. Its unit is the same as the one "
+               "of --vad-energy-threshold.");
+
+  po->Register("long-form-padding", &padding,
+               "Used only for long-form decoding. Number of seconds of audio "
+               "added to both sides of a segment.");
+
+  po->Register("long-form-batch-size", &batch_size,
+               "Used only for long-form decoding. Number of segments to "
+               "decode at a time.");
+}
+
+void LongFormConfig::Validate() const {
+  SHERPA_CHECK_GT(max_segment_duration, 0);
+  SHERPA_CHECK_GE(min_silence_duration, 0);
+  SHERPA_CHECK_GE(max_merge_silence_duration, 0);
+  SHERPA_CHECK_GE(padding, 0);
+  SHERPA_CHECK_LT(2 * padding, max_segment_duration)
+      << "--long-form-padding is too large";
+  SHERPA_CHECK_GT(batch_size, 0);
+}
+
+std::string LongFormConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "LongFormConfig(";
+  os << "max_segment_duration=" << max_segment_duration << ", ";
+  os << "min_silence_duration=" << min_silence_duration << ", ";
+  os << "max_merge_silence_duration=" << max_merge_silence_duration << ", ";
+  os << "energy_threshold=" << energy_threshold << ", ";
+  os << "padding=" << padding << ", ";
+  os << "batch_size=" << batch_size << ")";
+
+  return os.str();
+}
+
+// Return the middle of the longest non-speech run in is_speech[begin:end].
+// Return end if all frames in it are speech.
+static int32_t FindCut(const std::vector<bool> &is_speech, int32_t begin,
+                       int32_t end) {
+  int32_t best = end;
+  int32_t best_len = 0;
+  for (int32_t i = begin; i < end;) {
+    if (is_speech[i]) {
+      ++i;
+      continue;
+    }
+
+    int32_t start = i;
+    while (i < end && !is_speech[i]) {
+      ++i;
+    }
+
+    if (i - start > best_len) {
+      best_len = i - start;
+      best = (start + i) / 2;
+    }
+  }
+
+  return best;
+}
+
+// Options for computing the features used to detect speech. Frame i
+// starts at sample i * frame_shift, so we use snip_edges.
+static kaldifeat::FbankOptions GetVadFbankOptions(
+    const FeatureConfig &feat_config) {
+  kaldifeat::FbankOptions opts = feat_config.fbank_opts;
+  opts.frame_opts.dither = 0;
+  opts.frame_opts.snip_edges = true;
+  opts.device = torch::Device(torch::kCPU);
+  return opts;
+}
+
+static EnergyVadConfig GetEnergyVadConfig(const LongFormConfig &config) {
+  EnergyVadConfig vad_config;
+  vad_config.energy_threshold = config.energy_threshold;
+  return vad_config;
+}
+
+AudioSegmenter::AudioSegmenter(const LongFormConfig &config,
+                               const FeatureConfig &feat_config)
+    : config_(config),
+      sample_rate_(feat_config.fbank_opts.frame_opts.samp_freq),
+      fbank_(GetVadFbankOptions(feat_config)),
+      energy_vad_(GetEnergyVadConfig(config)) {
+  const auto &frame_opts = feat_config.fbank_opts.frame_opts;
+  frame_length_ = sample_rate_ * frame_opts.frame_length_ms / 1000;
+  frame_shift_ = sample_rate_ * frame_opts.frame_shift_ms / 1000;
+  SHERPA_CHECK_GT(frame_shift_, 0);
+}
+
+torch::Tensor AudioSegmenter::GetFeatures(const torch::Tensor &samples) const {
+  int32_t num_samples = samples.numel();
+
+  // Features are computed in blocks of this number of frames, i.e.,
+  // 10 minutes, so that memory usage does not grow with the audio length
+  int32_t block_size = 60000;
+
+  std::vector<torch::Tensor> features;
+  for (int32_t start = 0; start + frame_length_ <= num_samples;
+       start += block_size * frame_shift_) {
+    int32_t end = std::min(
+        start + (block_size - 1) * frame_shift_ + frame_length_, num_samples);
+    features.push_back(
+        ComputeFeatures(fbank_, {samples.slice(0, start, end)})[0]);
+  }
+
+  return torch::cat(features, /*dim*/ 0);
+}
+
+std::vector<AudioSegment> AudioSegmenter::Segment(
+    const torch::Tensor &samples, const FrameVad *vad /*= nullptr*/) const {
+  SHERPA_CHECK_EQ(samples.dim(), 1) << samples.sizes();
+
+  int32_t num_samples = samples.numel();
+  int32_t num_frames = (num_samples + frame_shift_ - 1) / frame_shift_;
+  if (num_frames == 0) {
+    return {};
+  }
+
+  if (!vad) {
+    vad = &energy_vad_;
+  }
+
+  // Pad zeros so that the last frame is complete
+  int32_t pad = (num_frames - 1) * frame_shift_ + frame_length_ - num_samples;
+  torch::Tensor x = torch::constant_pad_nd(samples, {0, pad}, 0);
+
+  torch::Tensor flags = vad->DetectSpeech(GetFeatures(x))
+                            .to(torch::kCPU, torch::kBool)
+                            .contiguous();
+
+  // Frames missing from the end of flags are considered as non-speech
+  std::vector<bool> is_speech(num_frames, false);
+  const bool *p = flags.data_ptr<bool>();
+  int32_t n = std::min<int32_t>(flags.numel(), num_frames);
+  for (int32_t i = 0; i != n; ++i) {
+    is_speech[i] = p[i];
+  }
+
+  // All of the following are in frames
+  int32_t min_silence = config_.min_silence_duration * sample_rate_ /
+                        frame_shift_;
+  int32_t max_merge_silence =
+      config_.max_merge_silence_duration * sample_rate_ / frame_shift_;
+  int32_t padding = config_.padding * sample_rate_ / frame_shift_;
+  int32_t max_len = config_.max_segment_duration * sample_rate_ /
+                    frame_shift_;
+  // It has to be at least 2 so that a split always makes progress
+  max_len = std::max(max_len - 2 * padding, 2);
+
+  // (1) Find speech regions. Pauses shorter than min_silence are kept
+  // inside a region.
+  std::vector<AudioSegment> regions;
+  for (int32_t i = 0; i < num_frames;) {
+    if (!is_speech[i]) {
+      ++i;
+      continue;
+    }
+
+    int32_t start = i;
+    while (i < num_frames && is_speech[i]) {
+      ++i;
+    }
+
+    if (!regions.empty() && start - regions.back().end < min_silence) {
+      regions.back().end = i;
+    } else {
+      regions.push_back({start, i});
+    }
+  }
+
+  // (2) Split regions longer than max_len. We cut at the longest pause in
+  // the second half of the allowed length so that pieces are not too short.
+  std::vector<AudioSegment> pieces;
+  for (const auto &r : regions) {
+    int32_t start = r.start;
+    while (r.end - start > max_len) {
+      int32_t cut = FindCut(is_speech, start + max_len / 2, start + max_len);
+      pieces.push_back({start, cut});
+      start = cut;
+    }
+    pieces.push_back({start, r.end});
+  }
+
+  // (3) Merge adjacent pieces if the gap between them is not longer than
+  // max_merge_silence and the result, including padding, is not longer
+  // than max_segment_duration. Fewer and longer segments give the model
+  // more context and fewer boundaries to stitch, but we don't want to
+  // decode long silences.
+  std::vector<AudioSegment> merged;
+  for (const auto &s : pieces) {
+    if (!merged.empty() && s.start - merged.back().end <= max_merge_silence &&
+        s.end - merged.back().start <= max_len) {
+      merged.back().end = s.end;
+    } else {
+      merged.push_back(s);
+    }
+  }
+
+  // (4) Add padding. A segment does not extend past the middle of the gap
+  // to its neighbors. Segments shorter than a frame are dropped since no
+  // features can be computed from them.
+  std::vector<AudioSegment> ans;
+  ans.reserve(merged.size());
+  int32_t num_segments = merged.size();
+  for (int32_t i = 0; i != num_segments; ++i) {
+    int32_t left = i > 0 ? (merged[i - 1].end + merged[i].start) / 2 : 0;
+    int32_t right = i + 1 < num_segments
+                        ? (merged[i].end + merged[i + 1].start) / 2
+                        : num_frames;
+
+    int32_t start = std::max(merged[i].start - padding, left);
+    int32_t end = std::min(merged[i].end + padding, right);
+
+    start *= frame_shift_;
+    end = std::min(end * frame_shift_, num_samples);
+    if (end - start < frame_length_) {
+      continue;
+    }
+
+    ans.push_back({start, end});
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa
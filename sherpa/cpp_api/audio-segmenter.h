@@ -0,0 +1,113 @@
+// sherpa/cpp_api/audio-segmenter.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CPP_API_AUDIO_SEGMENTER_H_
+#define SHERPA_CPP_API_AUDIO_SEGMENTER_H_
+
+#include <string>
+#include <vector>
+
+#include "kaldifeat/csrc/feature-fbank.h"
+#include "sherpa/cpp_api/energy-vad.h"
+#include "sherpa/cpp_api/feature-config.h"
+#include "torch/script.h"
+
+namespace sherpa {
+
+class ParseOptions;
+
+// Configuration for decoding long-form audio, e.g., recordings that are
+// hours long. The audio is split at silences into segments that are
+// decoded in batches and the results are stitched back together.
+struct LongFormConfig {
+  // Maximum duration in seconds of a segment, excluding padding.
+  // Speech longer than it is split at the longest pause or, if there is
+  // no pause, at this duration.
+  float max_segment_duration = 30;
+
+  // Speech separated by non-speech shorter than this number of seconds
+  // is kept in the same segment.
+  float min_silence_duration = 0.3;
+
+  // Adjacent segments are merged into one if the non-speech between them
+  // is not longer than this number of seconds and the result is not
+  // longer than max_segment_duration. Merging gives the model more
+  // context. Use 0 to disable it.
+  float max_merge_silence_duration = 1;
+
+  // A frame is considered as speech if the average of its log mel
+  // filterbank energies is larger than this value. It has the same
+  // meaning as EnergyVadConfig::energy_threshold, i.e., it is for
+  // samples normalized to the range [-1, 1], and is used only by the
+  // built-in EnergyVad.
+  float energy_threshold = -10;
+
+  // Number of seconds of audio added to both sides of a segment.
+  // It does not extend into neighboring segments.
+  float padding = 0.1;
+
+  // Number of segments to decode at a time. Segments from all
+  // recordings are sorted by length before they are batched.
+  int32_t batch_size = 16;
+
+  void Register(ParseOptions *po);
+
+  void Validate() const;
+
+  std::string ToString() const;
+};
+
+// A segment [start, end) in samples
+struct AudioSegment {
+  int32_t start;
+  int32_t end;
+};
+
+class AudioSegmenter {
+ public:
+  /**
+   * @param config  Configuration for the segmenter.
+   * @param feat_config  Speech is detected from the log mel filterbank
+   *                     features computed with its options. Its sample
+   *                     rate is the sample rate of the input audio.
+   */
+  AudioSegmenter(const LongFormConfig &config,
+                 const FeatureConfig &feat_config);
+
+  /** Split audio samples into segments at silences.
+   *
+   * @param samples  A 1-D float tensor containing audio samples normalized
+   *                 to the range [-1, 1].
+   * @param vad  If not null, it is used to detect speech. Otherwise,
+   *             an EnergyVad is used. Feature frame i starts at sample
+   *             i * frame_shift.
+   *
+   * @return Return segments sorted by their start sample. They do not
+   *         overlap. Audio without speech is not covered by any segment.
+   *         Segments shorter than a frame are dropped since no features
+   *         can be computed from them.
+   */
+  std::vector<AudioSegment> Segment(const torch::Tensor &samples,
+                                    const FrameVad *vad = nullptr) const;
+
+  const LongFormConfig &GetConfig() const { return config_; }
+  float GetSampleRate() const { return sample_rate_; }
+
+ private:
+  // Return log mel filterbank features of the given samples. Frame i
+  // starts at sample i * frame_shift_.
+  torch::Tensor GetFeatures(const torch::Tensor &samples) const;
+
+ private:
+  LongFormConfig config_;
+  float sample_rate_;
+  mutable kaldifeat::Fbank fbank_;
+  EnergyVad energy_vad_;
+
+  int32_t frame_length_;  // in samples
+  int32_t frame_shift_;   // in samples
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_AUDIO_SEGMENTER_H_
@@ -18,9 +18,9 @@
 #include "sherpa/cpp_api/offline-recognizer.h"
 
 #include "kaldi_native_io/csrc/kaldi-table.h"
-#include "kaldi_native_io/csrc/text-utils.h"
-#include "kaldi_native_io/csrc/wave-reader.h"
+#include "sherpa/cpp_api/bin/offline-scp-pipeline.h"
 #include "sherpa/cpp_api/parse-options.h"
+#include "sherpa/csrc/fbank-features.h"
 #include "sherpa/csrc/log.h"
 #include "torch/script.h"
 
@@ -48,10 +48,31 @@ Usage:
     --tokens=/path/to/tokens.txt \
     --use-gpu=false \
     --use-wav-scp=true \
+    --num-workers=4 \
+    --share-models=true \
     scp:wav.scp \
     ark,scp,t:results.ark,results.scp
 
-(4) Decode feats.scp
+  Utterances are read ahead of time by a reader thread, sorted by length,
+  and decoded in batches of --batch-size by --num-workers threads, each with
+  its own recognizer. Results are written in the input order. Progress is
+  reported every --progress-interval seconds.
+
+(4) Decode long recordings, e.g., hours long, by splitting them at silences
+
+  sherpa-offline \
+    --nn-model=/path/to/cpu_jit.pt \
+    --tokens=/path/to/tokens.txt \
+    --use-gpu=false \
+    --long-form=true \
+    --long-form-max-segment-duration=30 \
+    --long-form-batch-size=16 \
+    foo.wav \
+    bar.wav
+
+  It also works with --use-wav-scp=true.
+
+(5) Decode feats.scp
 
   sherpa-offline \
     --nn-model=/path/to/cpu_jit.pt \
@@ -90,12 +111,15 @@ int main(int argc, char *argv[]) {
   float expected_sample_rate = 16000;
   bool use_wav_scp = false;    // true to use wav.scp as input
   bool use_feats_scp = false;  // true to use feats.scp as input
-  int32_t batch_size = 10;
+  bool long_form = false;
 
   sherpa::ParseOptions po(kUsageMessage);
   sherpa::OfflineRecognizerConfig config;
   config.Register(&po);
 
+  sherpa::OfflineScpPipelineConfig pipeline_config;
+  pipeline_config.Register(&po);
+
   po.Register("use-wav-scp", &use_wav_scp,
               "If true, user should provide two arguments: "
               "scp:wav.scp ark,scp,t:results.ark,results.scp");
@@ -104,9 +128,11 @@ int main(int argc, char *argv[]) {
               "If true, user should provide two arguments: "
               "scp:feats.scp ark,scp,t:results.ark,results.scp");
 
-  po.Register("batch-size", &batch_size,
-              "Used only when --use-wav-scp=true or --use-feats-scp=true. "
-              "It specifies the batch size to use for decoding");
+  po.Register("long-form", &long_form,
+              "true to split the input audio at silences and decode the "
+              "segments in batches. Useful for long recordings. See also "
+              "--long-form-max-segment-duration and --long-form-batch-size. "
+              "It cannot be used with --use-feats-scp=true.");
 
   po.Read(argc, argv);
 
@@ -116,6 +142,12 @@ int main(int argc, char *argv[]) {
   }
 
   config.Validate();
+  pipeline_config.Validate();
+
+  if (long_form && use_feats_scp) {
+    SHERPA_LOG(FATAL) << "--long-form requires audio samples. It cannot be "
+                      << "used with --use-feats-scp=true";
+  }
 
   SHERPA_CHECK_EQ(config.feat_config.fbank_opts.frame_opts.samp_freq,
                   expected_sample_rate)
@@ -123,13 +155,12 @@ int main(int argc, char *argv[]) {
       << "We don't support resample yet";
 
   SHERPA_LOG(INFO) << config.ToString();
-  sherpa::OfflineRecognizer recognizer(config);
 
-  if (use_wav_scp) {
+  if (use_wav_scp || use_feats_scp) {
     SHERPA_CHECK_EQ(po.NumArgs(), 2)
         << "Please use something like:\n"
         << "scp:wav.scp ark,scp,t:results.scp,results.ark\n"
-        << "if you provide --use-wav-scp=true";
+        << "if you provide --use-wav-scp=true or --use-feats-scp=true";
 
     if (kaldiio::ClassifyRspecifier(po.GetArg(1), nullptr, nullptr) ==
         kaldiio::kNoRspecifier) {
@@ -143,146 +174,32 @@ int main(int argc, char *argv[]) {
                         << po.GetArg(2);
     }
 
-    SHERPA_CHECK_GT(batch_size, 0);
-
-    kaldiio::TableWriter<kaldiio::TokenVectorHolder> writer(po.GetArg(2));
-
-    kaldiio::SequentialTableReader<kaldiio::WaveHolder> wav_reader(
-        po.GetArg(1));
-
-    std::vector<std::string> keys;
-    std::vector<torch::Tensor> values;
-    std::vector<std::unique_ptr<sherpa::OfflineStream>> ss;
-    std::vector<sherpa::OfflineStream *> p_ss;
-    for (; !wav_reader.Done(); wav_reader.Next()) {
-      keys.push_back(wav_reader.Key());
-      auto &wave_data = wav_reader.Value();
-      if (wave_data.SampFreq() != expected_sample_rate) {
-        SHERPA_LOG(FATAL) << wav_reader.Key()
-                          << "is expected to have sample rate "
-                          << expected_sample_rate << ". Given "
-                          << wave_data.SampFreq();
-      }
-      auto &d = wave_data.Data();
-
-      if (d.NumRows() > 1) {
-        SHERPA_LOG(WARNING)
-            << "Only the first channel from " << wav_reader.Key() << " is used";
-      }
-
-      auto tensor = torch::from_blob(const_cast<float *>(d.RowData(0)),
-                                     {d.NumCols()}, torch::kFloat) /
-                    32768;
-      auto s = recognizer.CreateStream();
-      s->AcceptSamples(tensor.data_ptr<float>(), tensor.numel());
-      ss.push_back(std::move(s));
-      p_ss.push_back(ss.back().get());
-
-      if (static_cast<int32_t>(keys.size()) >= batch_size) {
-        // now for recognition
-        recognizer.DecodeStreams(p_ss.data(), p_ss.size());
-
-        for (size_t i = 0; i != keys.size(); ++i) {
-          std::vector<std::string> words;
-          kaldiio::SplitStringToVector(ss[i]->GetResult().text, " ", true,
-                                       &words);
-          writer.Write(keys[i], words);
-        }
-        keys.clear();
-        ss.clear();
-        p_ss.clear();
-      }
-    }
-
-    if (!keys.empty()) {
-      recognizer.DecodeStreams(p_ss.data(), p_ss.size());
-      for (size_t i = 0; i != keys.size(); ++i) {
-        std::vector<std::string> words;
-        kaldiio::SplitStringToVector(ss[i]->GetResult().text, " ", true,
-                                     &words);
-        writer.Write(keys[i], words);
-      }
-      keys.clear();
-      ss.clear();
-      p_ss.clear();
-    }
+    pipeline_config.long_form = long_form;
+    sherpa::OfflineScpPipeline pipeline(pipeline_config, config);
+    pipeline.Run(po.GetArg(1), po.GetArg(2), use_feats_scp);
 
     return 0;
   }
 
-  if (use_feats_scp) {
-    SHERPA_CHECK_EQ(po.NumArgs(), 2)
-        << "Please use something like:\n"
-        << "scp:feats.scp ark,scp,t:results.scp,results.ark\n"
-        << "if you provide --use-feats-scp=true";
-
-    SHERPA_CHECK_EQ(po.NumArgs(), 2)
-        << "Please use something like:\n"
-        << "scp:feats.scp ark,scp,t:results.scp,results.ark\n"
-        << "if you provide --use-feats-scp=true";
-
-    if (kaldiio::ClassifyRspecifier(po.GetArg(1), nullptr, nullptr) ==
-        kaldiio::kNoRspecifier) {
-      SHERPA_LOG(FATAL) << "Please provide an rspecifier. Current value is: "
-                        << po.GetArg(1);
-    }
+  sherpa::OfflineRecognizer recognizer(config);
 
-    if (kaldiio::ClassifyWspecifier(po.GetArg(2), nullptr, nullptr, nullptr) ==
-        kaldiio::kNoWspecifier) {
-      SHERPA_LOG(FATAL) << "Please provide a wspecifier. Current value is: "
-                        << po.GetArg(2);
+  if (long_form) {
+    std::vector<torch::Tensor> samples;
+    for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+      samples.push_back(
+          sherpa::ReadWave(po.GetArg(i), expected_sample_rate).first);
     }
 
-    SHERPA_CHECK_GT(batch_size, 0);
-
-    kaldiio::TableWriter<kaldiio::TokenVectorHolder> writer(po.GetArg(2));
-
-    kaldiio::SequentialTableReader<
-        kaldiio::KaldiObjectHolder<kaldiio::Matrix<float>>>
-        feature_reader(po.GetArg(1));
-    std::vector<std::string> keys;
-    std::vector<torch::Tensor> values;
-    std::vector<std::unique_ptr<sherpa::OfflineStream>> ss;
-    std::vector<sherpa::OfflineStream *> p_ss;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      keys.push_back(feature_reader.Key());
-      auto &d = feature_reader.Value();
-      auto tensor = torch::from_blob(const_cast<float *>(d.Data()),
-                                     {d.NumRows(), d.NumCols()}, torch::kFloat);
-      auto s = recognizer.CreateStream();
-      s->AcceptFeatures(tensor.data_ptr<float>(), tensor.size(0),
-                        tensor.size(1));
-      ss.push_back(std::move(s));
-      p_ss.push_back(ss.back().get());
-
-      if (static_cast<int32_t>(keys.size()) >= batch_size) {
-        recognizer.DecodeStreams(p_ss.data(), p_ss.size());
-
-        for (size_t i = 0; i != keys.size(); ++i) {
-          std::vector<std::string> words;
-          kaldiio::SplitStringToVector(ss[i]->GetResult().text, " ", true,
-                                       &words);
-          writer.Write(keys[i], words);
-        }
-        keys.clear();
-        ss.clear();
-        p_ss.clear();
-      }
-    }
+    auto results = recognizer.DecodeLongForm(samples);
 
-    if (!keys.empty()) {
-      recognizer.DecodeStreams(p_ss.data(), p_ss.size());
-      for (size_t i = 0; i != keys.size(); ++i) {
-        std::vector<std::string> words;
-        kaldiio::SplitStringToVector(ss[i]->GetResult().text, " ", true,
-                                     &words);
-        writer.Write(keys[i], words);
-      }
-      keys.clear();
-      ss.clear();
-      p_ss.clear();
+    std::ostringstream os;
+    for (int32_t i = 0; i < po.NumArgs(); ++i) {
+      os << "filename: " << po.GetArg(i + 1) << "\n"
+         << "result: " << results[i].text << "\n"
+         << results[i].AsJsonString() << "\n\n";
     }
 
+    SHERPA_LOG(INFO) << "\n" << os.str();
     return 0;
   }
 
@@ -0,0 +1,386 @@
+// sherpa/cpp_api/bin/offline-scp-pipeline.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/cpp_api/bin/offline-scp-pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "kaldi_native_io/csrc/kaldi-table.h"
+#include "kaldi_native_io/csrc/text-utils.h"
+#include "kaldi_native_io/csrc/wave-reader.h"
+#include "sherpa/csrc/log.h"
+#include "sherpa/csrc/timer.h"
+
+namespace sherpa {
+
+void OfflineScpPipelineConfig::Register(ParseOptions *po) {
+  po->Register("batch-size", &batch_size,
+               "Used only when --use-wav-scp=true or --use-feats-scp=true. "
+               "It specifies the batch size to use for decoding");
+
+  po->Register("num-workers", &num_workers,
+               "Used only when --use-wav-scp=true or --use-feats-scp=true. "
+               "Number of threads for decoding. Each thread has its own "
+               "recognizer. Use --share-models=true so that they share a "
+               "single copy of the model.");
+
+  po->Register("sort-window", &sort_window,
+               "Used only when --use-wav-scp=true or --use-feats-scp=true. "
+               "Utterances are sorted by length in groups of this number of "
+               "batches before they are decoded. A larger value gives less "
+               "padding but uses more memory.");
+
+  po->Register("progress-interval", &progress_interval,
+               "Used only when --use-wav-scp=true or --use-feats-scp=true. "
+               "Number of seconds between two progress reports. "
+               "0 to disable it.");
+}
+
+void OfflineScpPipelineConfig::Validate() const {
+  SHERPA_CHECK_GT(batch_size, 0);
+  SHERPA_CHECK_GT(num_workers, 0);
+  SHERPA_CHECK_GT(sort_window, 0);
+  SHERPA_CHECK_GE(progress_interval, 0);
+}
+
+namespace {
+
+// A queue whose Push() blocks if it is full and whose Pop() blocks if it is
+// empty. After Close() is called, Pop() returns false once it is empty.
+template <typename T>
+class BlockingQueue {
+ public:
+  explicit BlockingQueue(int32_t capacity) : capacity_(capacity) {}
+
+  void Push(T t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() {
+      return static_cast<int32_t>(queue_.size()) < capacity_;
+    });
+    queue_.push_back(std::move(t));
+    not_empty_.notify_one();
+  }
+
+  bool Pop(T *t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return !queue_.empty() || closed_; });
+    if (queue_.empty()) {
+      return false;
+    }
+
+    *t = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  int32_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> queue_;
+  bool closed_ = false;
+};
+
+struct Utterance {
+  int32_t index;  // position in the input
+  std::string key;
+
+  // 1-D audio samples normalized to [-1, 1] or 2-D features of shape
+  // (num_frames, feature_dim)
+  torch::Tensor data;
+
+  float duration;  // in seconds
+};
+
+struct Result {
+  int32_t index;
+  std::string key;
+  std::string text;
+  float duration;  // in seconds
+};
+
+using Batch = std::vector<Utterance>;
+
+}  // namespace
+
+class OfflineScpPipeline::Impl {
+ public:
+  Impl(const OfflineScpPipelineConfig &config,
+       const OfflineRecognizerConfig &recognizer_config)
+      : config_(config),
+        sample_rate_(recognizer_config.feat_config.fbank_opts.frame_opts
+                         .samp_freq),
+        frame_shift_(recognizer_config.feat_config.fbank_opts.frame_opts
+                         .frame_shift_ms /
+                     1000),
+        utterances_(config.batch_size * config.sort_window * 2),
+        batches_(config.num_workers * 2),
+        results_(config.batch_size * config.num_workers * 4) {
+    for (int32_t i = 0; i != config.num_workers; ++i) {
+      recognizers_.push_back(
+          std::make_unique<OfflineRecognizer>(recognizer_config));
+    }
+  }
+
+  void Run(const std::string &rspecifier, const std::string &wspecifier,
+           bool use_feats) {
+    SHERPA_CHECK(!(use_feats && config_.long_form))
+        << "long_form requires audio samples";
+
+    kaldiio::TableWriter<kaldiio::TokenVectorHolder> writer(wspecifier);
+
+    Timer timer;
+
+    std::thread reader([this, rspecifier, use_feats]() {
+      if (use_feats) {
+        ReadFeatures(rspecifier);
+      } else {
+        ReadWaves(rspecifier);
+      }
+      utterances_.Close();
+    });
+
+    std::thread batcher([this]() {
+      MakeBatches();
+      batches_.Close();
+    });
+
+    std::atomic<int32_t> num_running{config_.num_workers};
+    std::vector<std::thread> workers;
+    for (int32_t i = 0; i != config_.num_workers; ++i) {
+      workers.emplace_back([this, i, use_feats, &num_running]() {
+        Decode(recognizers_[i].get(), use_feats);
+        if (--num_running == 0) {
+          results_.Close();
+        }
+      });
+    }
+
+    // Results are written in the input order
+    std::map<int32_t, Result> pending;
+    int32_t next_index = 0;
+    int32_t num_done = 0;
+    double audio_duration = 0;
+    double last_report = 0;
+
+    Result r;
+    while (results_.Pop(&r)) {
+      pending.emplace(r.index, std::move(r));
+
+      for (auto it = pending.find(next_index); it != pending.end();
+           it = pending.find(next_index)) {
+        std::vector<std::string> words;
+        kaldiio::SplitStringToVector(it->second.text, " ", true, &words);
+        writer.Write(it->second.key, words);
+
+        ++num_done;
+        audio_duration += it->second.duration;
+        pending.erase(it);
+        ++next_index;
+      }
+
+      double elapsed = timer.Elapsed();
+      if (config_.progress_interval > 0 &&
+          elapsed - last_report >= config_.progress_interval) {
+        last_report = elapsed;
+        Report(num_done, audio_duration, elapsed);
+      }
+    }
+
+    reader.join();
+    batcher.join();
+    for (auto &w : workers) {
+      w.join();
+    }
+
+    SHERPA_CHECK(pending.empty());
+
+    SHERPA_LOG(INFO) << "Done!";
+    Report(num_done, audio_duration, timer.Elapsed());
+  }
+
+ private:
+  void ReadWaves(const std::string &rspecifier) {
+    kaldiio::SequentialTableReader<kaldiio::WaveHolder> wav_reader(rspecifier);
+
+    int32_t index = 0;
+    for (; !wav_reader.Done(); wav_reader.Next()) {
+      const auto &wave_data = wav_reader.Value();
+      if (wave_data.SampFreq() != sample_rate_) {
+        SHERPA_LOG(FATAL) << wav_reader.Key()
+                          << "is expected to have sample rate "
+                          << sample_rate_ << ". Given "
+                          << wave_data.SampFreq();
+      }
+      const auto &d = wave_data.Data();
+
+      if (d.NumRows() > 1) {
+        SHERPA_LOG(WARNING)
+            << "Only the first channel from " << wav_reader.Key() << " is used";
+      }
+
+      // The division creates a copy, so it is safe to read the next wave
+      torch::Tensor samples =
+          torch::from_blob(const_cast<float *>(d.RowData(0)), {d.NumCols()},
+                           torch::kFloat) /
+          32768;
+
+      float duration = d.NumCols() / sample_rate_;
+      utterances_.Push({index++, wav_reader.Key(), samples, duration});
+    }
+  }
+
+  void ReadFeatures(const std::string &rspecifier) {
+    kaldiio::SequentialTableReader<
+        kaldiio::KaldiObjectHolder<kaldiio::Matrix<float>>>
+        feature_reader(rspecifier);
+
+    int32_t index = 0;
+    for (; !feature_reader.Done(); feature_reader.Next()) {
+      const auto &d = feature_reader.Value();
+      torch::Tensor features =
+          torch::from_blob(const_cast<float *>(d.Data()),
+                           {d.NumRows(), d.NumCols()}, torch::kFloat)
+              .clone();
+
+      float duration = d.NumRows() * frame_shift_;
+      utterances_.Push({index++, feature_reader.Key(), features, duration});
+    }
+  }
+
+  // Sort utterances by length in groups of sort_window batches and split
+  // each group into batches
+  void MakeBatches() {
+    int32_t window = config_.batch_size * config_.sort_window;
+
+    std::vector<Utterance> group;
+    Utterance u;
+    bool done = false;
+    while (!done) {
+      group.clear();
+      while (static_cast<int32_t>(group.size()) < window) {
+        if (!utterances_.Pop(&u)) {
+          done = true;
+          break;
+        }
+        group.push_back(std::move(u));
+      }
+
+      std::stable_sort(group.begin(), group.end(),
+                       [](const Utterance &a, const Utterance &b) {
+                         return a.data.size(0) > b.data.size(0);
+                       });
+
+      int32_t n = group.size();
+      for (int32_t start = 0; start < n; start += config_.batch_size) {
+        int32_t end = std::min(start + config_.batch_size, n);
+        batches_.Push(Batch(std::make_move_iterator(group.begin() + start),
+                            std::make_move_iterator(group.begin() + end)));
+      }
+    }
+  }
+
+  void Decode(OfflineRecognizer *recognizer, bool use_feats) {
+    Batch batch;
+    while (batches_.Pop(&batch)) {
+      int32_t size = batch.size();
+
+      std::vector<std::string> texts(size);
+      if (config_.long_form && !use_feats) {
+        std::vector<torch::Tensor> samples(size);
+        for (int32_t i = 0; i != size; ++i) {
+          samples[i] = batch[i].data;
+        }
+
+        auto results = recognizer->DecodeLongForm(samples);
+        for (int32_t i = 0; i != size; ++i) {
+          texts[i] = std::move(results[i].text);
+        }
+      } else {
+        std::vector<std::unique_ptr<OfflineStream>> ss(size);
+        std::vector<OfflineStream *> p_ss(size);
+        std::vector<const float *> p_samples(size);
+        std::vector<int32_t> samples_length(size);
+        for (int32_t i = 0; i != size; ++i) {
+          const torch::Tensor &t = batch[i].data;
+          ss[i] = recognizer->CreateStream();
+          p_ss[i] = ss[i].get();
+
+          if (use_feats) {
+            ss[i]->AcceptFeatures(t.data_ptr<float>(), t.size(0), t.size(1));
+          } else {
+            p_samples[i] = t.data_ptr<float>();
+            samples_length[i] = t.numel();
+          }
+        }
+
+        if (!use_feats) {
+          OfflineStream::AcceptSamples(p_ss.data(), p_samples.data(),
+                                       samples_length.data(), size);
+        }
+
+        recognizer->DecodeStreams(p_ss.data(), size);
+
+        for (int32_t i = 0; i != size; ++i) {
+          texts[i] = ss[i]->GetResult().text;
+        }
+      }
+
+      for (int32_t i = 0; i != size; ++i) {
+        results_.Push({batch[i].index, std::move(batch[i].key),
+                       std::move(texts[i]), batch[i].duration});
+      }
+    }
+  }
+
+  void Report(int32_t num_done, double audio_duration, double elapsed) const {
+    SHERPA_LOG(INFO) << "Decoded " << num_done << " utterances, "
+                     << audio_duration << " s of audio in " << elapsed
+                     << " s. Utterances per second: "
+                     << num_done / std::max(elapsed, 1e-6)
+                     << ", RTF: " << elapsed / std::max(audio_duration, 1e-6);
+  }
+
+ private:
+  OfflineScpPipelineConfig config_;
+  float sample_rate_;
+  float frame_shift_;  // in seconds
+
+  std::vector<std::unique_ptr<OfflineRecognizer>> recognizers_;
+
+  BlockingQueue<Utterance> utterances_;
+  BlockingQueue<Batch> batches_;
+  BlockingQueue<Result> results_;
+};
+
+OfflineScpPipeline::OfflineScpPipeline(
+    const OfflineScpPipelineConfig &config,
+    const OfflineRecognizerConfig &recognizer_config)
+    : impl_(std::make_unique<Impl>(config, recognizer_config)) {}
+
+OfflineScpPipeline::~OfflineScpPipeline() = default;
+
+void OfflineScpPipeline::Run(const std::string &rspecifier,
+                             const std::string &wspecifier, bool use_feats) {
+  impl_->Run(rspecifier, wspecifier, use_feats);
+}
+
+}  // namespace sherpa
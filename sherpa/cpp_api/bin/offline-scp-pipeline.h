@@ -0,0 +1,77 @@
+// sherpa/cpp_api/bin/offline-scp-pipeline.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CPP_API_BIN_OFFLINE_SCP_PIPELINE_H_
+#define SHERPA_CPP_API_BIN_OFFLINE_SCP_PIPELINE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa/cpp_api/offline-recognizer.h"
+#include "sherpa/cpp_api/parse-options.h"
+
+namespace sherpa {
+
+struct OfflineScpPipelineConfig {
+  // Number of utterances to decode at a time
+  int32_t batch_size = 10;
+
+  // Number of threads for decoding. Each has its own recognizer.
+  int32_t num_workers = 1;
+
+  // Utterances are sorted by length in groups of this number of batches
+  // before they are split into batches. A larger value gives less padding
+  // but uses more memory.
+  int32_t sort_window = 8;
+
+  // Number of seconds between two progress reports. 0 to disable it.
+  float progress_interval = 10;
+
+  // true to decode each utterance with OfflineRecognizer::DecodeLongForm()
+  bool long_form = false;
+
+  void Register(ParseOptions *po);
+  void Validate() const;
+};
+
+/** Decode utterances from a wav.scp or a feats.scp in a pipeline.
+ *
+ * A reader thread reads utterances ahead of time into a bounded queue.
+ * A batcher thread sorts them by length and groups them into batches.
+ * Each worker thread computes features and decodes a batch with its own
+ * recognizer. Results are written in the input order by the calling
+ * thread, which also reports progress and throughput.
+ */
+class OfflineScpPipeline {
+ public:
+  /**
+   * @param config  Configuration for the pipeline.
+   * @param recognizer_config  It is used to create a recognizer for each
+   *                           worker. Use share_models=true so that they
+   *                           share a single copy of the model.
+   */
+  OfflineScpPipeline(const OfflineScpPipelineConfig &config,
+                     const OfflineRecognizerConfig &recognizer_config);
+
+  ~OfflineScpPipeline();
+
+  /** Decode all utterances from the given rspecifier.
+   *
+   * @param rspecifier  E.g., scp:wav.scp or scp:feats.scp
+   * @param wspecifier  E.g., ark,scp,t:results.ark,results.scp
+   * @param use_feats  true if rspecifier contains features. false if it
+   *                   contains waves. It must be false if
+   *                   config.long_form is true.
+   */
+  void Run(const std::string &rspecifier, const std::string &wspecifier,
+           bool use_feats);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_BIN_OFFLINE_SCP_PIPELINE_H_
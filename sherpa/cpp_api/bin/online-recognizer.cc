@@ -19,6 +19,14 @@
 #include "sherpa/cpp_api/online-recognizer.h"
 
 #include <algorithm>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "kaldi_native_io/csrc/kaldi-table.h"
 #include "kaldi_native_io/csrc/text-utils.h"
@@ -84,14 +92,209 @@ To use fast_beam_search with an LG, use
     --tokens=/path/to/tokens.txt \
     --use-gpu=false \
     --use-wav-scp=true \
+    --num-streams=32 \
+    --latency-file=latency.txt \
     scp:wav.scp \
     ark,scp,t:result.ark,result.scp
 
+  Utterances are fed chunk by chunk, i.e., --chunk-seconds at a time.
+  Up to --num-streams utterances are decoded concurrently in batches.
+
 See
 https://k2-fsa.github.io/sherpa/sherpa/pretrained_models/online_transducer.html
 for more details.
 )";
 
+namespace {
+
+// An utterance from wav.scp being decoded with simulated streaming
+struct Utterance {
+  int32_t index = 0;  // position in wav.scp
+  std::string key;
+  torch::Tensor wave;
+  int32_t num_fed = 0;  // number of samples fed to the stream
+  bool input_finished = false;
+  std::unique_ptr<sherpa::OnlineStream> s;
+
+  // When the last chunk, excluding tail padding, is fed
+  std::chrono::steady_clock::time_point input_end_time;
+};
+
+}  // namespace
+
+/** Decode utterances from wav.scp with simulated streaming.
+ *
+ * Up to num_streams utterances are decoded concurrently. In each step, a
+ * chunk is fed to each of them and all ready streams are decoded in a
+ * batch until none is ready. A finished utterance is replaced by the next
+ * one from wav_reader. Results are written in the order of wav_reader.
+ *
+ * @param latency_os If not null, latencies of utterances are written to it.
+ */
+static void DecodeWavScp(
+    sherpa::OnlineRecognizer *recognizer,
+    kaldiio::SequentialTableReader<kaldiio::WaveHolder> *wav_reader,
+    kaldiio::TableWriter<kaldiio::TokenVectorHolder> *writer,
+    int32_t num_streams, float chunk_seconds,
+    const torch::Tensor &tail_padding, std::ostream *latency_os) {
+  float sample_rate =
+      recognizer->GetConfig().feat_config.fbank_opts.frame_opts.samp_freq;
+  int32_t chunk = std::max<int32_t>(1, chunk_seconds * sample_rate);
+
+  std::list<Utterance> active;
+  std::vector<sherpa::OnlineStream *> ready;
+  std::vector<double> latencies;
+  double total_duration = 0;
+  int32_t num_decoded = 0;
+  int32_t num_read = 0;
+
+  // Results of finished utterances that cannot be written yet because
+  // an earlier utterance is still being decoded. Indexed by Utterance::index
+  std::map<int32_t, std::pair<std::string, std::vector<std::string>>> pending;
+  int32_t num_written = 0;
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  for (;;) {
+    // Admit new utterances
+    while (static_cast<int32_t>(active.size()) < num_streams &&
+           !wav_reader->Done()) {
+      const auto &wave_data = wav_reader->Value();
+      if (wave_data.SampFreq() != sample_rate) {
+        SHERPA_LOG(FATAL) << wav_reader->Key()
+                          << "is expected to have sample rate "
+                          << sample_rate << ". Given "
+                          << wave_data.SampFreq();
+      }
+
+      const auto &d = wave_data.Data();
+      if (d.NumRows() > 1) {
+        SHERPA_LOG(WARNING) << "Only the first channel from "
+                            << wav_reader->Key() << " is used";
+      }
+
+      Utterance u;
+      u.index = num_read++;
+      u.key = wav_reader->Key();
+      // The division creates a copy, so it is safe to read the next wave
+      u.wave = torch::from_blob(const_cast<float *>(d.RowData(0)),
+                                {d.NumCols()}, torch::kFloat) /
+               32768;
+      u.s = recognizer->CreateStream();
+      active.push_back(std::move(u));
+
+      wav_reader->Next();
+    }
+
+    if (active.empty()) {
+      break;
+    }
+
+    // Feed a chunk to each utterance
+    for (auto &u : active) {
+      if (u.input_finished) {
+        continue;
+      }
+
+      int32_t num_samples = u.wave.numel();
+      int32_t end = std::min(u.num_fed + chunk, num_samples);
+      u.s->AcceptWaveform(sample_rate, u.wave.slice(0, u.num_fed, end));
+      u.num_fed = end;
+
+      if (u.num_fed == num_samples) {
+        u.input_end_time = std::chrono::steady_clock::now();
+        u.s->AcceptWaveform(sample_rate, tail_padding);
+        u.s->InputFinished();
+        u.input_finished = true;
+      }
+    }
+
+    // Decode until no stream is ready
+    for (;;) {
+      ready.clear();
+      for (auto &u : active) {
+        if (recognizer->IsReady(u.s.get())) {
+          ready.push_back(u.s.get());
+        }
+      }
+
+      if (ready.empty()) {
+        break;
+      }
+
+      recognizer->DecodeStreams(ready.data(), ready.size());
+    }
+
+    // Collect results of finished utterances
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = active.begin(); it != active.end();) {
+      if (!it->input_finished) {
+        ++it;
+        continue;
+      }
+
+      auto result = recognizer->GetResult(it->s.get());
+
+      std::vector<std::string> words;
+      kaldiio::SplitStringToVector(result.text, " ", true, &words);
+      pending.emplace(it->index, std::make_pair(it->key, std::move(words)));
+
+      float duration = it->wave.numel() / sample_rate;
+      double latency =
+          std::chrono::duration<double>(now - it->input_end_time).count();
+
+      SHERPA_LOG(INFO) << "\n"
+                       << num_decoded++ << ": " << it->key
+                       << "\nresult: " << result.text
+                       << "\nlatency: " << latency << " s";
+
+      if (latency_os) {
+        *latency_os << it->key << " " << duration << " " << latency << "\n";
+      }
+
+      latencies.push_back(latency);
+      total_duration += duration;
+
+      it = active.erase(it);
+    }
+
+    // Write results in the order of wav.scp
+    while (!pending.empty() && pending.begin()->first == num_written) {
+      const auto &p = pending.begin()->second;
+      writer->Write(p.first, p.second);
+      pending.erase(pending.begin());
+      ++num_written;
+    }
+  }
+
+  if (latencies.empty()) {
+    return;
+  }
+
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](float p) {
+    int32_t i = p * (latencies.size() - 1);
+    return latencies[i];
+  };
+
+  double sum = 0;
+  for (auto l : latencies) {
+    sum += l;
+  }
+
+  SHERPA_LOG(INFO) << "Decoded " << latencies.size() << " utterances, "
+                   << total_duration << " s of audio in " << elapsed
+                   << " s. RTF: " << elapsed / total_duration
+                   << "\nLatency (s): average " << sum / latencies.size()
+                   << ", p50 " << percentile(0.5) << ", p90 "
+                   << percentile(0.9) << ", p99 " << percentile(0.99)
+                   << ", max " << latencies.back();
+}
+
 int32_t main(int32_t argc, char *argv[]) {
   // see
   // https://pytorch.org/docs/stable/notes/cpu_threading_torchscript_inference.html
@@ -110,6 +313,10 @@ int32_t main(int32_t argc, char *argv[]) {
   // Number of seconds for tail padding
   float padding_seconds = 0.8;
 
+  int32_t num_streams = 1;
+  float chunk_seconds = 0.2;
+  std::string latency_file;
+
   sherpa::ParseOptions po(kUsageMessage);
 
   po.Register("use-wav-scp", &use_wav_scp,
@@ -119,6 +326,23 @@ int32_t main(int32_t argc, char *argv[]) {
   po.Register("padding-seconds", &padding_seconds,
               "Number of seconds for tail padding.");
 
+  po.Register("num-streams", &num_streams,
+              "Used only when --use-wav-scp=true. Number of utterances to "
+              "decode concurrently. Each is fed chunk by chunk and all "
+              "ready streams are decoded in a batch. A new utterance is "
+              "started as soon as one finishes.");
+
+  po.Register("chunk-seconds", &chunk_seconds,
+              "Used only when --use-wav-scp=true. Number of seconds of audio "
+              "fed to a stream at a time.");
+
+  po.Register("latency-file", &latency_file,
+              "Used only when --use-wav-scp=true. If not empty, the latency "
+              "of each utterance is written to this file. Each line "
+              "contains: key, duration of the utterance in seconds, and "
+              "number of seconds from feeding its last chunk to getting "
+              "its final result.");
+
   sherpa::OnlineRecognizerConfig config;
   config.Register(&po);
 
@@ -138,6 +362,8 @@ int32_t main(int32_t argc, char *argv[]) {
   SHERPA_CHECK_GE(po.NumArgs(), 1);
 
   SHERPA_CHECK_GE(padding_seconds, 0);
+  SHERPA_CHECK_GT(num_streams, 0);
+  SHERPA_CHECK_GT(chunk_seconds, 0);
 
   SHERPA_LOG(INFO) << "decoding method: " << config.decoding_method;
 
@@ -169,42 +395,17 @@ int32_t main(int32_t argc, char *argv[]) {
     kaldiio::SequentialTableReader<kaldiio::WaveHolder> wav_reader(
         po.GetArg(1));
 
-    int32_t num_decoded = 0;
-    for (; !wav_reader.Done(); wav_reader.Next()) {
-      std::string key = wav_reader.Key();
-      SHERPA_LOG(INFO) << "\n" << num_decoded++ << ": decoding " << key;
-      auto &wave_data = wav_reader.Value();
-      if (wave_data.SampFreq() != expected_sample_rate) {
-        SHERPA_LOG(FATAL) << wav_reader.Key()
-                          << "is expected to have sample rate "
-                          << expected_sample_rate << ". Given "
-                          << wave_data.SampFreq();
-      }
-      auto &d = wave_data.Data();
-      if (d.NumRows() > 1) {
-        SHERPA_LOG(WARNING)
-            << "Only the first channel from " << wav_reader.Key() << " is used";
+    std::ofstream latency_os;
+    if (!latency_file.empty()) {
+      latency_os.open(latency_file);
+      if (!latency_os) {
+        SHERPA_LOG(FATAL) << "Failed to open " << latency_file;
       }
-
-      auto tensor = torch::from_blob(const_cast<float *>(d.RowData(0)),
-                                     {d.NumCols()}, torch::kFloat) /
-                    32768;
-      auto s = recognizer.CreateStream();
-      s->AcceptWaveform(expected_sample_rate, tensor);
-      s->AcceptWaveform(expected_sample_rate, tail_padding);
-      s->InputFinished();
-
-      while (recognizer.IsReady(s.get())) {
-        recognizer.DecodeStream(s.get());
-      }
-      auto result = recognizer.GetResult(s.get());
-
-      SHERPA_LOG(INFO) << "\nresult: " << result.text;
-
-      std::vector<std::string> words;
-      kaldiio::SplitStringToVector(result.text, " ", true, &words);
-      writer.Write(key, words);
     }
+
+    DecodeWavScp(&recognizer, &wav_reader, &writer, num_streams,
+                 chunk_seconds, tail_padding,
+                 latency_os.is_open() ? &latency_os : nullptr);
   } else {
     int32_t num_waves = po.NumArgs();
     if (num_waves == 1) {
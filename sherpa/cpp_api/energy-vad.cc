@@ -0,0 +1,57 @@
+// sherpa/cpp_api/energy-vad.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/cpp_api/energy-vad.h"
+
+#include <cmath>
+#include <string>
+
+#include "sherpa/cpp_api/parse-options.h"
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+void EnergyVadConfig::Register(ParseOptions *po) {
+  po->Register("vad-energy-threshold", &energy_threshold,
+               "Used only when --use-vad is true. A frame is considered as "
+               "speech if the average of its log mel filterbank energies "
+               "is larger than this value. It is for samples normalized to "
+               "[-1, 1] even if --normalize-samples is false.");
+
+  po->Register("vad-min-silence-duration", &min_silence_duration,
+               "Used only when --use-vad is true. A chunk without speech is "
+               "skipped only if it is preceded by at least this number of "
+               "seconds of non-speech.");
+}
+
+void EnergyVadConfig::Validate() const {
+  SHERPA_CHECK_GE(min_silence_duration, 0);
+}
+
+std::string EnergyVadConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "EnergyVadConfig(";
+  os << "energy_threshold=" << energy_threshold << ", ";
+  os << "min_silence_duration=" << min_silence_duration << ")";
+
+  return os.str();
+}
+
+EnergyVad::EnergyVad(const EnergyVadConfig &config,
+                     bool normalize_samples /*= true*/)
+    : config_(config), threshold_(config.energy_threshold) {
+  if (!normalize_samples) {
+    // Samples are scaled by 32767, so the power spectrum and hence the
+    // mel filterbank energies are scaled by 32767^2
+    threshold_ += 2 * std::log(32767.0f);
+  }
+}
+
+torch::Tensor EnergyVad::DetectSpeech(const torch::Tensor &features) const {
+  // energy is of shape (num_frames,)
+  torch::Tensor energy = features.mean(/*dim*/ 1);
+  return energy > threshold_;
+}
+
+}  // namespace sherpa
@@ -0,0 +1,88 @@
+// sherpa/cpp_api/energy-vad.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CPP_API_ENERGY_VAD_H_
+#define SHERPA_CPP_API_ENERGY_VAD_H_
+
+#include <string>
+
+#include "torch/script.h"
+
+namespace sherpa {
+
+class ParseOptions;
+
+// A lightweight voice activity detector based on the log mel filterbank
+// energy. It is used by OnlineRecognizer to skip the encoder for chunks
+// that contain only silence and by AudioSegmenter to find speech in
+// long-form audio.
+struct EnergyVadConfig {
+  // A frame is considered as speech if the average of its log mel
+  // filterbank energies is larger than this value.
+  //
+  // Note: It is for audio samples normalized to the range [-1, 1]. If
+  // features are computed with normalize_samples=false, EnergyVad adds
+  // 2 * log(32767), i.e., about 20.8, to it so that the same value can
+  // be used in both cases.
+  float energy_threshold = -10;
+
+  // A chunk without speech is skipped only if there have been at least
+  // this number of seconds of non-speech before it. It keeps the encoder
+  // running for a short while after speech ends so that trailing tokens
+  // are still decoded.
+  float min_silence_duration = 0.5;
+
+  void Register(ParseOptions *po);
+
+  void Validate() const;
+
+  std::string ToString() const;
+};
+
+// Interface of voice activity detectors that classify each feature frame.
+// It is used by OnlineRecognizer to skip chunks without speech and by
+// AudioSegmenter to split long-form audio.
+class FrameVad {
+ public:
+  virtual ~FrameVad() = default;
+
+  /** Detect speech in each frame of the given features.
+   *
+   * @param features A 2-D tensor of shape (num_frames, feature_dim)
+   *                 containing log mel filterbank features.
+   *
+   * @return Return a 1-D tensor of shape (num_frames,) and dtype
+   *         torch::kBool. Its i-th entry is true if frame i contains speech.
+   */
+  virtual torch::Tensor DetectSpeech(const torch::Tensor &features) const = 0;
+
+  /** Return true if any frame of the given features contains speech. */
+  bool IsSpeech(const torch::Tensor &features) const {
+    return DetectSpeech(features).any().item<bool>();
+  }
+};
+
+class EnergyVad : public FrameVad {
+ public:
+  /**
+   * @param config  Configuration of the VAD.
+   * @param normalize_samples  FeatureConfig::normalize_samples of the
+   *                           features passed to DetectSpeech().
+   */
+  explicit EnergyVad(const EnergyVadConfig &config,
+                     bool normalize_samples = true);
+
+  torch::Tensor DetectSpeech(const torch::Tensor &features) const override;
+
+  const EnergyVadConfig &GetConfig() const { return config_; }
+
+ private:
+  EnergyVadConfig config_;
+
+  // config_.energy_threshold converted to the scale of the features
+  float threshold_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_ENERGY_VAD_H_
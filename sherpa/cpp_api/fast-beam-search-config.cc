@@ -19,6 +19,12 @@ void FastBeamSearchConfig::Register(ParseOptions *po) {
                "in transducer decoding");
 
   po->Register("beam", &beam, "Beam used in fast_beam_search");
+
+  po->Register("traceback-interval", &traceback_interval,
+               "Used only for fast_beam_search in streaming decoding. "
+               "Partial results are updated from the lattice once every "
+               "this number of chunks. The lattice is always used at "
+               "endpoints and at the end of the input.");
 }
 
 void FastBeamSearchConfig::Validate() const {
@@ -27,6 +33,7 @@ void FastBeamSearchConfig::Validate() const {
   }
   SHERPA_CHECK_GE(ngram_lm_scale, 0);
   SHERPA_CHECK_GT(beam, 0);
+  SHERPA_CHECK_GT(traceback_interval, 0);
 }
 
 std::string FastBeamSearchConfig::ToString() const {
@@ -38,7 +45,8 @@ std::string FastBeamSearchConfig::ToString() const {
   os << "beam=" << beam << ", ";
   os << "max_states=" << max_states << ", ";
   os << "max_contexts=" << max_contexts << ", ";
-  os << "allow_partial=" << (allow_partial ? "True" : "False") << ")";
+  os << "allow_partial=" << (allow_partial ? "True" : "False") << ", ";
+  os << "traceback_interval=" << traceback_interval << ")";
 
   return os.str();
 }
@@ -27,6 +27,14 @@ struct FastBeamSearchConfig {
   int32_t max_contexts = 8;
   bool allow_partial = false;
 
+  // Used only in streaming decoding. Partial results are updated from the
+  // lattice once every this number of chunks. The lattice is always used
+  // at endpoints and at the end of the input. A larger value reduces the
+  // per-chunk cost for long segments at the expense of partial results
+  // and endpoints lagging behind by up to this number of chunks.
+  // Endpoints are checked only on chunks whose lattice has been used.
+  int32_t traceback_interval = 1;
+
   void Register(ParseOptions *po);
 
   void Validate() const;
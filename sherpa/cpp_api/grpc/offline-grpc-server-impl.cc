@@ -0,0 +1,442 @@
+// sherpa/cpp_api/grpc/offline-grpc-server-impl.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/cpp_api/grpc/offline-grpc-server-impl.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grpcpp/ext/proto_server_reflection_plugin.h"
+#include "grpcpp/health_check_service_interface.h"
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+namespace {
+
+// A call of OfflineASR.Recognize
+class RecognizeCall : public OfflineGrpcCall {
+ public:
+  RecognizeCall(OfflineGrpcServer *server, grpc::ServerCompletionQueue *cq)
+      : server_(server), cq_(cq), responder_(&ctx_) {
+    server_->GetService().RequestRecognize(&ctx_, &request_, &responder_, cq_,
+                                           cq_, this);
+  }
+
+  void Proceed(bool ok) override {
+    if (!ok || state_ == State::kFinish) {
+      // Either the server is shutting down or the call is finished
+      delete this;
+      return;
+    }
+
+    // Wait for the next call
+    new RecognizeCall(server_, cq_);
+
+    state_ = State::kFinish;
+    reqid = request_.reqid();
+    deadline = ctx_.deadline();
+
+    grpc::Status status = server_->CheckSampleRate(request_.sample_rate());
+    if (status.ok() && static_cast<int64_t>(request_.audio_data().size()) >
+                           server_->GetMaxAudioBytes()) {
+      status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                            "The utterance is too long");
+    }
+
+    if (status.ok()) {
+      status = server_->CheckAudioData(request_.audio_data());
+    }
+
+    if (!status.ok()) {
+      responder_.FinishWithError(status, this);
+      return;
+    }
+
+    audio_data = std::move(*request_.mutable_audio_data());
+    server_->GetDecoder().Push(this);
+  }
+
+  void Finish(const Response &response, const grpc::Status &status) override {
+    if (status.ok()) {
+      responder_.Finish(response, status, this);
+    } else {
+      responder_.FinishWithError(status, this);
+    }
+  }
+
+ private:
+  enum class State {
+    kRequest,  // waiting for a call
+    kFinish,   // waiting for the call to finish
+  };
+
+  OfflineGrpcServer *server_;        // not owned
+  grpc::ServerCompletionQueue *cq_;  // not owned
+  grpc::ServerContext ctx_;
+  OfflineRequest request_;
+  grpc::ServerAsyncResponseWriter<Response> responder_;
+  State state_ = State::kRequest;
+};
+
+// A call of OfflineASR.RecognizeStream
+class RecognizeStreamCall : public OfflineGrpcCall {
+ public:
+  RecognizeStreamCall(OfflineGrpcServer *server,
+                      grpc::ServerCompletionQueue *cq)
+      : server_(server), cq_(cq), reader_(&ctx_) {
+    server_->GetService().RequestRecognizeStream(&ctx_, &reader_, cq_, cq_,
+                                                 this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequest:
+        if (!ok) {
+          // The server is shutting down
+          delete this;
+          return;
+        }
+
+        // Wait for the next call
+        new RecognizeStreamCall(server_, cq_);
+
+        deadline = ctx_.deadline();
+        state_ = State::kRead;
+        reader_.Read(&request_, this);
+        break;
+      case State::kRead:
+        if (ok) {
+          OnRead();
+        } else {
+          // The client has sent all requests
+          OnReadDone();
+        }
+        break;
+      case State::kFinish:
+        delete this;
+        break;
+    }
+  }
+
+  void Finish(const Response &response, const grpc::Status &status) override {
+    if (status.ok()) {
+      reader_.Finish(response, status, this);
+    } else {
+      reader_.FinishWithError(status, this);
+    }
+  }
+
+ private:
+  void OnRead() {
+    if (reqid.empty()) {
+      reqid = request_.reqid();
+    }
+
+    grpc::Status status = server_->CheckSampleRate(request_.sample_rate());
+    if (status.ok() && static_cast<int64_t>(audio_data.size() +
+                                            request_.audio_data().size()) >
+                           server_->GetMaxAudioBytes()) {
+      status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                            "The utterance is too long");
+    }
+
+    if (!status.ok()) {
+      state_ = State::kFinish;
+      reader_.FinishWithError(status, this);
+      return;
+    }
+
+    audio_data.append(request_.audio_data());
+    reader_.Read(&request_, this);
+  }
+
+  void OnReadDone() {
+    state_ = State::kFinish;
+
+    grpc::Status status = server_->CheckAudioData(audio_data);
+    if (!status.ok()) {
+      reader_.FinishWithError(status, this);
+      return;
+    }
+
+    server_->GetDecoder().Push(this);
+  }
+
+ private:
+  enum class State {
+    kRequest,  // waiting for a call
+    kRead,     // waiting for a request
+    kFinish,   // waiting for the call to finish
+  };
+
+  OfflineGrpcServer *server_;        // not owned
+  grpc::ServerCompletionQueue *cq_;  // not owned
+  grpc::ServerContext ctx_;
+  OfflineRequest request_;
+  grpc::ServerAsyncReader<Response, OfflineRequest> reader_;
+  State state_ = State::kRequest;
+};
+
+}  // namespace
+
+grpc::Status CheckAudioData(const std::string &audio_data,
+                            int32_t frame_length) {
+  if (audio_data.size() % sizeof(int16_t) != 0) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "audio_data must contain 16-bit PCM samples. Its "
+                        "size in bytes must be even");
+  }
+
+  int64_t num_samples = audio_data.size() / sizeof(int16_t);
+  if (num_samples < std::max(frame_length, 1)) {
+    std::ostringstream os;
+    os << "audio_data is too short. Expected at least "
+       << std::max(frame_length, 1) << " samples. Given " << num_samples;
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, os.str());
+  }
+
+  return grpc::Status::OK;
+}
+
+void OfflineGrpcDecoderConfig::Register(ParseOptions *po) {
+  recognizer_config.Register(po);
+
+  po->Register("max-batch-size", &max_batch_size,
+               "Max number of calls to decode in a batch.");
+
+  po->Register("max-wait-ms", &max_wait_ms,
+               "Max number of milliseconds to wait for more calls before "
+               "decoding a batch that has fewer than --max-batch-size calls. "
+               "A larger value gives larger batches at the cost of latency.");
+
+  po->Register("max-utterance-length", &max_utterance_length,
+               "Max utterance length in seconds. Longer utterances are "
+               "rejected.");
+}
+
+void OfflineGrpcDecoderConfig::Validate() const {
+  recognizer_config.Validate();
+
+  SHERPA_CHECK_GT(max_batch_size, 0);
+  SHERPA_CHECK_GE(max_wait_ms, 0);
+  SHERPA_CHECK_GT(max_utterance_length, 0);
+}
+
+OfflineGrpcDecoder::OfflineGrpcDecoder(const OfflineGrpcDecoderConfig &config,
+                                       asio::io_context &io_work)
+    : config_(config),
+      io_work_(io_work),
+      timer_(io_work),
+      recognizer_(config.recognizer_config) {}
+
+void OfflineGrpcDecoder::Push(OfflineGrpcCall *call) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  call->enqueue_time = std::chrono::steady_clock::now();
+  calls_.push_back(call);
+
+  int32_t n = calls_.size();
+  if (n == config_.max_batch_size) {
+    asio::post(io_work_, [this]() { Decode(); });
+  } else if (n == 1) {
+    ScheduleDecodeLocked(std::chrono::milliseconds(config_.max_wait_ms));
+  }
+}
+
+void OfflineGrpcDecoder::ScheduleDecodeLocked(
+    std::chrono::steady_clock::duration delay) {
+  // It cancels the pending wait, if any
+  timer_.expires_after(delay);
+  timer_.async_wait([this](const asio::error_code &ec) {
+    if (!ec) {
+      Decode();
+    }
+  });
+}
+
+void OfflineGrpcDecoder::Decode() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (calls_.empty()) {
+    return;
+  }
+
+  auto max_wait = std::chrono::milliseconds(config_.max_wait_ms);
+  auto now = std::chrono::steady_clock::now();
+
+  int32_t size = calls_.size();
+  if (size < config_.max_batch_size) {
+    auto elapsed = now - calls_.front()->enqueue_time;
+    if (elapsed < max_wait) {
+      // Wait for more calls
+      ScheduleDecodeLocked(max_wait - elapsed);
+      return;
+    }
+  }
+
+  size = std::min(size, config_.max_batch_size);
+  std::vector<OfflineGrpcCall *> calls(calls_.begin(), calls_.begin() + size);
+  calls_.erase(calls_.begin(), calls_.begin() + size);
+
+  if (static_cast<int32_t>(calls_.size()) >= config_.max_batch_size) {
+    // Let other threads decode the next batch
+    asio::post(io_work_, [this]() { Decode(); });
+  } else if (!calls_.empty()) {
+    ScheduleDecodeLocked(max_wait - (now - calls_.front()->enqueue_time));
+  }
+
+  lock.unlock();
+
+  // Calls whose deadline has passed are not decoded, since their clients
+  // won't receive the results
+  auto wall_now = std::chrono::system_clock::now();
+  std::vector<OfflineGrpcCall *> valid_calls;
+  std::vector<std::vector<float>> samples;
+  for (auto call : calls) {
+    if (call->deadline < wall_now) {
+      call->Finish(Response(),
+                   grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                                "Deadline exceeded before decoding"));
+      continue;
+    }
+
+    auto pcm_data = reinterpret_cast<const int16_t *>(call->audio_data.data());
+    int32_t num_samples = call->audio_data.size() / sizeof(int16_t);
+    std::vector<float> s(num_samples);
+    for (int32_t i = 0; i != num_samples; ++i) {
+      s[i] = pcm_data[i] / 32768.;
+    }
+    call->audio_data = std::string();
+
+    samples.push_back(std::move(s));
+    valid_calls.push_back(call);
+  }
+
+  if (valid_calls.empty()) {
+    return;
+  }
+
+  size = valid_calls.size();
+  std::vector<std::unique_ptr<OfflineStream>> ss(size);
+  std::vector<OfflineStream *> p_ss(size);
+  std::vector<const float *> p_samples(size);
+  std::vector<int32_t> samples_length(size);
+  for (int32_t i = 0; i != size; ++i) {
+    ss[i] = recognizer_.CreateStream();
+    p_ss[i] = ss[i].get();
+    p_samples[i] = samples[i].data();
+    samples_length[i] = samples[i].size();
+  }
+
+  // Features of all streams are computed at once
+  OfflineStream::AcceptSamples(p_ss.data(), p_samples.data(),
+                               samples_length.data(), size);
+  samples.clear();
+
+  // Note: DecodeStreams is thread-safe
+  recognizer_.DecodeStreams(p_ss.data(), p_ss.size());
+
+  for (size_t i = 0; i != valid_calls.size(); ++i) {
+    auto result = ss[i]->GetResult();
+
+    Response response;
+    response.set_status(Response::ok);
+    response.set_type(Response::final_result);
+    Response_OneBest *one_best = response.add_nbest();
+    one_best->set_sentence(result.text);
+
+    SHERPA_LOG(INFO) << "reqid:" << valid_calls[i]->reqid
+                     << " Decode result:" << result.AsJsonString();
+
+    valid_calls[i]->Finish(response, grpc::Status::OK);
+  }
+}
+
+OfflineGrpcServer::OfflineGrpcServer(asio::io_context &io_work,
+                                     const OfflineGrpcDecoderConfig &config)
+    : decoder_(config, io_work) {
+  const auto &frame_opts =
+      config.recognizer_config.feat_config.fbank_opts.frame_opts;
+  float sample_rate = frame_opts.samp_freq;
+  max_audio_bytes_ = static_cast<int64_t>(config.max_utterance_length *
+                                          sample_rate) *
+                     sizeof(int16_t);
+  frame_length_ = sample_rate * frame_opts.frame_length_ms / 1000;
+}
+
+OfflineGrpcServer::~OfflineGrpcServer() {
+  if (server_) {
+    server_->Shutdown();
+  }
+
+  for (auto &cq : cqs_) {
+    cq->Shutdown();
+  }
+
+  for (auto &t : io_threads_) {
+    t.join();
+  }
+}
+
+void OfflineGrpcServer::Run(uint16_t port, int32_t num_io_threads) {
+  SHERPA_CHECK_GT(num_io_threads, 0);
+
+  grpc::EnableDefaultHealthCheckService(true);
+  grpc::reflection::InitProtoReflectionServerBuilderPlugin();
+
+  grpc::ServerBuilder builder;
+  std::string address("0.0.0.0:" + std::to_string(port));
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service_);
+
+  // Leave some room for the other fields of a request
+  builder.SetMaxReceiveMessageSize(max_audio_bytes_ + 1024);
+
+  for (int32_t i = 0; i != num_io_threads; ++i) {
+    cqs_.push_back(builder.AddCompletionQueue());
+  }
+
+  server_ = builder.BuildAndStart();
+  if (!server_) {
+    SHERPA_LOG(FATAL) << "Failed to listen on " << address;
+  }
+
+  for (auto &cq : cqs_) {
+    // They delete themselves when their calls are finished
+    new RecognizeCall(this, cq.get());
+    new RecognizeStreamCall(this, cq.get());
+
+    io_threads_.emplace_back(
+        [this, cq = cq.get()]() { PollCompletionQueue(cq); });
+  }
+}
+
+void OfflineGrpcServer::Wait() { server_->Wait(); }
+
+grpc::Status OfflineGrpcServer::CheckSampleRate(int32_t sample_rate) const {
+  int32_t expected_sample_rate = decoder_.GetConfig()
+                                     .recognizer_config.feat_config.fbank_opts
+                                     .frame_opts.samp_freq;
+  if (sample_rate != 0 && sample_rate != expected_sample_rate) {
+    std::ostringstream os;
+    os << "Expected sample rate " << expected_sample_rate << ". Given "
+       << sample_rate;
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, os.str());
+  }
+
+  return grpc::Status::OK;
+}
+
+void OfflineGrpcServer::PollCompletionQueue(grpc::ServerCompletionQueue *cq) {
+  void *tag = nullptr;
+  bool ok = false;
+  while (cq->Next(&tag, &ok)) {
+    static_cast<OfflineGrpcCall *>(tag)->Proceed(ok);
+  }
+}
+
+}  // namespace sherpa
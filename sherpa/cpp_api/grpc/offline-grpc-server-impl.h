@@ -0,0 +1,162 @@
+// sherpa/cpp_api/grpc/offline-grpc-server-impl.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#ifndef SHERPA_CPP_API_GRPC_OFFLINE_GRPC_SERVER_IMPL_H_
+#define SHERPA_CPP_API_GRPC_OFFLINE_GRPC_SERVER_IMPL_H_
+
+#include <chrono>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "asio.hpp"
+#include "grpcpp/grpcpp.h"
+#include "sherpa/cpp_api/grpc/sherpa.grpc.pb.h"
+#include "sherpa/cpp_api/offline-recognizer.h"
+#include "sherpa/cpp_api/parse-options.h"
+
+namespace sherpa {
+
+class OfflineGrpcServer;
+
+// Base class of OfflineASR calls.
+//
+// Pointers to it are used as tags of asynchronous operations. Each call has
+// at most one operation in progress at any time.
+class OfflineGrpcCall {
+ public:
+  virtual ~OfflineGrpcCall() = default;
+
+  // Handle the completion event of the current operation. It is invoked by
+  // the thread polling the completion queue.
+  virtual void Proceed(bool ok) = 0;
+
+  // Send the response to the client and finish the call. It is invoked by
+  // the decoding threads. If status is not OK, response is not sent.
+  virtual void Finish(const Response &response, const grpc::Status &status) = 0;
+
+  std::string reqid;
+
+  // Received audio samples in 16-bit PCM
+  std::string audio_data;
+
+  // The call fails if it is not decoded before this time point
+  std::chrono::system_clock::time_point deadline;
+
+  // When the call is put into the queue of the decoder
+  std::chrono::steady_clock::time_point enqueue_time;
+};
+
+// Check the audio_data of a call before it is decoded. It must contain
+// 16-bit PCM samples and at least frame_length samples so that at least one
+// feature frame can be computed.
+// Return an INVALID_ARGUMENT status if it does not.
+grpc::Status CheckAudioData(const std::string &audio_data,
+                            int32_t frame_length);
+
+struct OfflineGrpcDecoderConfig {
+  OfflineRecognizerConfig recognizer_config;
+
+  int32_t max_batch_size = 5;
+
+  // A batch is decoded once it contains max_batch_size calls or once its
+  // first call has waited for this number of milliseconds
+  int32_t max_wait_ms = 5;
+
+  float max_utterance_length = 300;  // seconds
+
+  void Register(ParseOptions *po);
+  void Validate() const;
+};
+
+class OfflineGrpcDecoder {
+ public:
+  /**
+   * @param config Configuraion for the decoder.
+   * @param io_work The thread pool for decoding.
+   */
+  OfflineGrpcDecoder(const OfflineGrpcDecoderConfig &config,
+                     asio::io_context &io_work);  // NOLINT
+
+  /** Insert a call whose audio samples have been received to the queue
+   * for decoding. It is thread-safe.
+   */
+  void Push(OfflineGrpcCall *call);
+
+  const OfflineGrpcDecoderConfig &GetConfig() const { return config_; }
+
+ private:
+  /** It is called by one of the work threads.
+   */
+  void Decode();
+
+  // Schedule a call to Decode() after the given delay.
+  // Must be called with mutex_ locked.
+  void ScheduleDecodeLocked(std::chrono::steady_clock::duration delay);
+
+ private:
+  OfflineGrpcDecoderConfig config_;
+  asio::io_context &io_work_;
+
+  // It protects calls_ and timer_
+  std::mutex mutex_;
+  std::deque<OfflineGrpcCall *> calls_;
+  asio::steady_timer timer_;
+
+  OfflineRecognizer recognizer_;
+};
+
+class OfflineGrpcServer {
+ public:
+  OfflineGrpcServer(asio::io_context &io_work,  // NOLINT
+                    const OfflineGrpcDecoderConfig &config);
+
+  ~OfflineGrpcServer();
+
+  /** Start the server. It returns immediately.
+   *
+   * @param port  The port to listen on.
+   * @param num_io_threads  Number of threads polling completion queues.
+   *                        Each thread has its own completion queue.
+   */
+  void Run(uint16_t port, int32_t num_io_threads);
+
+  // Block until the server is shut down
+  void Wait();
+
+  OfflineASR::AsyncService &GetService() { return service_; }
+  OfflineGrpcDecoder &GetDecoder() { return decoder_; }
+
+  // Maximum number of bytes of audio_data of a call
+  int64_t GetMaxAudioBytes() const { return max_audio_bytes_; }
+
+  // Check the sample rate of a request.
+  // Return an error status if it does not match the model.
+  grpc::Status CheckSampleRate(int32_t sample_rate) const;
+
+  // Check the received audio_data of a call. See CheckAudioData() above.
+  grpc::Status CheckAudioData(const std::string &audio_data) const {
+    return sherpa::CheckAudioData(audio_data, frame_length_);
+  }
+
+ private:
+  void PollCompletionQueue(grpc::ServerCompletionQueue *cq);
+
+ private:
+  OfflineGrpcDecoder decoder_;
+  int64_t max_audio_bytes_;
+  int32_t frame_length_;  // in samples
+
+  OfflineASR::AsyncService service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+  std::vector<std::thread> io_threads_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_GRPC_OFFLINE_GRPC_SERVER_IMPL_H_
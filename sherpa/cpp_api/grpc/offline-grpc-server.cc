@@ -0,0 +1,110 @@
+// sherpa/cpp_api/grpc/offline-grpc-server.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "asio.hpp"
+#include "sherpa/cpp_api/grpc/offline-grpc-server-impl.h"
+#include "sherpa/csrc/log.h"
+#include "torch/all.h"
+
+static constexpr const char *kUsageMessage = R"(
+Non-streaming automatic speech recognition with sherpa using grpc.
+
+It provides the service OfflineASR defined in sherpa.proto. Concurrent
+calls are decoded in batches.
+
+Usage:
+
+sherpa-offline-grpc-server --help
+
+sherpa-offline-grpc-server \
+  --use-gpu=false \
+  --port=6006 \
+  --num-work-threads=5 \
+  --max-batch-size=10 \
+  --max-wait-ms=5 \
+  --nn-model=/path/to/cpu.jit \
+  --tokens=/path/to/tokens.txt \
+  --decoding-method=greedy_search
+
+Since server reflection is enabled, you can test it with grpcurl, e.g.,
+
+grpcurl -plaintext -d '{"reqid": "1", "audio_data": "<base64 of 16-bit PCM>"}' \
+  localhost:6006 sherpa.OfflineASR/Recognize
+)";
+
+int32_t main(int32_t argc, char *argv[]) {
+  torch::set_num_threads(1);
+  torch::set_num_interop_threads(1);
+  sherpa::InferenceMode no_grad;
+
+  torch::jit::getExecutorMode() = false;
+  torch::jit::getProfilingMode() = false;
+  torch::jit::setGraphExecutorOptimize(false);
+
+  sherpa::ParseOptions po(kUsageMessage);
+
+  sherpa::OfflineGrpcDecoderConfig config;
+
+  // the server will listen on this port
+  int32_t port = 6006;
+
+  // number of threads polling the completion queues of gRPC
+  int32_t num_io_threads = 1;
+
+  // size of the thread pool for neural network computation and decoding
+  int32_t num_work_threads = 5;
+
+  po.Register("num-io-threads", &num_io_threads,
+              "Number of threads to handle gRPC calls. Each of them polls "
+              "its own completion queue.");
+
+  po.Register("num-work-threads", &num_work_threads,
+              "Number of threads to use for neural network "
+              "computation and decoding.");
+
+  po.Register("port", &port, "The port on which the server will listen.");
+
+  config.Register(&po);
+
+  if (argc == 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() != 0) {
+    SHERPA_LOG(ERROR) << "Unrecognized positional arguments!";
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  config.Validate();
+
+  asio::io_context io_work;  // for neural network and decoding
+
+  sherpa::OfflineGrpcServer server(io_work, config);
+  server.Run(port, num_io_threads);
+  SHERPA_LOG(INFO) << "Listening on: " << port << "\n";
+
+  SHERPA_LOG(INFO) << "Number of work threads: " << num_work_threads << "\n";
+  // give some work to do for the io_work pool
+  auto work_guard = asio::make_work_guard(io_work);
+
+  std::vector<std::thread> work_threads;
+  for (int32_t i = 0; i < num_work_threads; ++i) {
+    work_threads.emplace_back([&io_work]() { io_work.run(); });
+  }
+
+  server.Wait();
+
+  for (auto &t : work_threads) {
+    t.join();
+  }
+
+  return 0;
+}
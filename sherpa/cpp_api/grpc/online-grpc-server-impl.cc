@@ -4,14 +4,14 @@
 //                2023  y00281951
 
 #include "sherpa/cpp_api/grpc/online-grpc-server-impl.h"
-#include "sherpa/csrc/log.h"
 
-#define SHERPA_SLEEP_TIME          100
-#define SHERPA_SLEEP_ROUND_MAX     3000
+#include <utility>
+
+#include "grpcpp/ext/proto_server_reflection_plugin.h"
+#include "grpcpp/health_check_service_interface.h"
+#include "sherpa/csrc/log.h"
 
 namespace sherpa {
-using grpc::ServerContext;
-using grpc::ServerReaderWriter;
 
 void OnlineGrpcDecoderConfig::Register(ParseOptions *po) {
   recognizer_config.Register(po);
@@ -48,40 +48,9 @@ OnlineGrpcDecoder::OnlineGrpcDecoder(OnlineGrpcServer *server)
   recognizer_ = std::make_unique<OnlineRecognizer>(config_.recognizer_config);
 }
 
-void OnlineGrpcDecoder::SerializeResult(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
-  auto result = recognizer_->GetResult(c->s.get());
-  c->response->clear_nbest();
-  Response_OneBest* one_best = c->response->add_nbest();
-  one_best->set_sentence(result.text);
-}
-
-void OnlineGrpcDecoder::OnPartialResult(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
-  if (!c->finish_flag) {
-    c->response->set_status(Response::ok);
-    c->response->set_type(Response::partial_result);
-    c->stream->Write(*c->response);
-  }
-}
-
-void OnlineGrpcDecoder::OnFinalResult(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
-  if (!c->finish_flag) {
-    c->response->set_status(Response::ok);
-    c->response->set_type(Response::final_result);
-    c->stream->Write(*c->response);
-  }
-}
-
-void OnlineGrpcDecoder::OnSpeechEnd(std::shared_ptr<Connection> c) {
-  std::lock_guard<std::mutex> lock(c->mutex);
-  if (!c->finish_flag) {
-    c->response->set_status(Response::ok);
-    c->response->set_type(Response::speech_end);
-    c->stream->Write(*c->response);
-  }
-  c->finish_flag = true;
+void OnlineGrpcDecoder::AddConnection(std::shared_ptr<Connection> c) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connections_.insert({c->reqid, c});
 }
 
 void OnlineGrpcDecoder::AcceptWaveform(std::shared_ptr<Connection> c) {
@@ -207,92 +176,312 @@ void OnlineGrpcDecoder::Decode() {
   lock.lock();
 
   for (auto c : c_vec) {
-    auto result = recognizer_->GetResult(c->s.get());
-    SerializeResult(c);
+    OnlineStream *s = c->s.get();
+    auto result = recognizer_->GetResult(s);
+
+    Response response;
+    response.set_status(Response::ok);
+    Response_OneBest *one_best = response.add_nbest();
+    one_best->set_sentence(result.text);
+
+    // An endpoint also gives a final result, but the client may continue
+    // to send audio samples, so we keep decoding the stream.
+    bool end_of_input =
+        !recognizer_->IsReady(s) && s->IsLastFrame(s->NumFramesReady() - 1);
+
+    // The responses are sent by the gRPC threads. We don't wait for them.
     if (!result.is_final) {
-      OnPartialResult(c);
+      response.set_type(Response::partial_result);
+      c->Write(response, /*is_last*/ false);
+    } else if (!end_of_input) {
+      response.set_type(Response::final_result);
+      c->Write(response, /*is_last*/ false);
     } else {
-      OnFinalResult(c);
+      response.set_type(Response::final_result);
+      c->Write(response, /*is_last*/ false);
+
+      Response speech_end;
+      speech_end.set_status(Response::ok);
+      speech_end.set_type(Response::speech_end);
+      c->Write(speech_end, /*is_last*/ true);
+
       connections_.erase(c->reqid);
-      OnSpeechEnd(c);
     }
     SHERPA_LOG(INFO) << "Decode result:" << result.AsJsonString();
     active_.erase(c->reqid);
   }
 }
 
-OnlineGrpcServer::OnlineGrpcServer(
-    asio::io_context &io_work,
-    const OnlineGrpcServerConfig &config)
-    : config_(config),
-      io_work_(io_work),
-      decoder_(this) {}
 
-void OnlineGrpcServer::Run() {
-  decoder_.Run();
+Connection::Connection(OnlineGrpcServer *server,
+                       grpc::ServerCompletionQueue *cq)
+    : server_(server), cq_(cq), stream_(&ctx_) {}
+
+void Connection::Start() {
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  self_ = shared_from_this();
+
+  // It must be called before the call starts. The tag is returned only
+  // if the call is started, see OnRequest().
+  ctx_.AsyncNotifyWhenDone(&done_tag_);
+
+  ++num_pending_ops_;
+  server_->GetService().RequestRecognize(&ctx_, &stream_, cq_, cq_,
+                                         &request_tag_);
 }
 
-bool OnlineGrpcServer::Contains(const std::string& reqid) const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return connections_.count(reqid);
+void Connection::Proceed(Op op, bool ok) {
+  switch (op) {
+    case Op::kRequest:
+      OnRequest(ok);
+      break;
+    case Op::kRead:
+      OnRead(ok);
+      break;
+    case Op::kWrite:
+      OnWrite(ok);
+      break;
+    case Op::kFinish:
+      break;
+    case Op::kDone:
+      OnDone();
+      break;
+  }
+
+  std::shared_ptr<Connection> self;
+  {
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    --num_pending_ops_;
+    if (num_pending_ops_ == 0) {
+      // Destroy it after unlocking the mutex
+      self = std::move(self_);
+    }
+  }
 }
 
-Status OnlineGrpcServer::Recognize(ServerContext* context,
-                             ServerReaderWriter<Response, Request>* stream) {
+void Connection::OnRequest(bool ok) {
+  if (!ok) {
+    // The server is shutting down
+    return;
+  }
+
+  // Wait for the next call
+  std::make_shared<Connection>(server_, cq_)->Start();
+
   SHERPA_LOG(INFO) << "Get Recognize request";
-  std::shared_ptr<OnlineStream> s = decoder_.recognizer_->CreateStream();
-  auto c = std::make_shared<Connection> (
-              std::make_shared<ServerReaderWriter<Response, Request>>(*stream),
-              std::make_shared<Request>(),
-              std::make_shared<Response>(),
-              s);
-  int32_t sleep_cnt = 0;
-
-  float sample_rate = decoder_.config_.recognizer_config.
-                      feat_config.fbank_opts.frame_opts.samp_freq;
-
-  while (stream->Read(c->request.get())) {
-    if (!c->start_flag) {
-      c->start_flag = true;
-      c->reqid = c->request->decode_config().reqid();
-
-      mutex_.lock();
-      connections_.insert(c->reqid);
-      mutex_.unlock();
-
-      decoder_.mutex_.lock();
-      decoder_.connections_.insert({c->reqid, c});
-      decoder_.mutex_.unlock();
-    } else {
-      const int16_t* pcm_data =
-           reinterpret_cast<const int16_t*>(c->request->audio_data().c_str());
-      int32_t num_samples =
-                          c->request->audio_data().length() / sizeof(int16_t);
-      SHERPA_LOG(INFO) << c->reqid << "Received "
-                       << num_samples << " samples";
-      torch::Tensor samples = torch::from_blob(const_cast<int16_t *>(pcm_data),
-                                      {num_samples},
-                                      torch::kShort).to(torch::kFloat) / 32768;
-      c->samples.push_back(samples);
-      decoder_.AcceptWaveform(c);
+  s = server_->GetDecoder().recognizer_->CreateStream();
+  last_active = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  // for done_tag_
+  ++num_pending_ops_;
+
+  ++num_pending_ops_;
+  stream_.Read(&request_, &read_tag_);
+}
+
+void Connection::OnRead(bool ok) {
+  auto &decoder = server_->GetDecoder();
+  if (!ok) {
+    // The client has finished sending audio samples or the call has
+    // been cancelled
+    if (started_) {
+      {
+        std::lock_guard<std::mutex> lock(call_mutex_);
+        reads_done_ = true;
+      }
+
+      asio::post(server_->GetWorkContext(),
+                 [&decoder, c = shared_from_this()]() {
+                   decoder.InputFinished(c);
+                 });
+      return;
     }
+
+    // The client has half-closed the call before sending the decode
+    // config. Finish the call so that done_tag_ is returned.
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    if (!finishing_) {
+      finishing_ = true;
+      ++num_pending_ops_;
+      stream_.Finish(
+          Status(grpc::StatusCode::INVALID_ARGUMENT, "no decode config"),
+          &finish_tag_);
+    }
+    return;
   }
-  decoder_.InputFinished(c);
 
-  while (!c->finish_flag) {
-    std::this_thread::sleep_for(
-          std::chrono::milliseconds(static_cast<int32_t>(SHERPA_SLEEP_TIME)));
-    if (sleep_cnt++ > SHERPA_SLEEP_ROUND_MAX) {
-      c->finish_flag = true;
-      break;
+  last_active = std::chrono::steady_clock::now();
+
+  if (!started_) {
+    started_ = true;
+    reqid = request_.decode_config().reqid();
+    server_->AddConnection(shared_from_this());
+  } else {
+    const int16_t *pcm_data =
+        reinterpret_cast<const int16_t *>(request_.audio_data().c_str());
+    int32_t num_samples = request_.audio_data().length() / sizeof(int16_t);
+    SHERPA_LOG(INFO) << reqid << "Received " << num_samples << " samples";
+
+    // to(torch::kFloat) makes a copy, so it does not reference request_
+    torch::Tensor t = torch::from_blob(const_cast<int16_t *>(pcm_data),
+                                       {num_samples}, torch::kShort)
+                          .to(torch::kFloat) /
+                      32768;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      samples.push_back(t);
     }
+
+    // Compute features in the work threads so that this thread can
+    // handle other calls
+    asio::post(server_->GetWorkContext(),
+               [&decoder, c = shared_from_this()]() {
+                 decoder.AcceptWaveform(c);
+               });
   }
 
-  mutex_.lock();
-  connections_.erase(c->reqid);
-  mutex_.unlock();
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  ++num_pending_ops_;
+  stream_.Read(&request_, &read_tag_);
+}
+
+void Connection::OnWrite(bool ok) {
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  writing_ = false;
+  if (!ok) {
+    // The call is broken, e.g., cancelled by the client
+    finishing_ = true;
+    pending_responses_.clear();
+    return;
+  }
 
-  SHERPA_LOG(INFO) << "reqid:" << c->reqid << " Connection close";
-  return Status::OK;
+  WriteNextLocked();
 }
+
+void Connection::OnDone() {
+  if (started_) {
+    server_->RemoveConnection(reqid);
+  }
+
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  finishing_ = true;
+  pending_responses_.clear();
+
+  SHERPA_LOG(INFO) << "reqid:" << reqid << " Connection close"
+                   << (ctx_.IsCancelled() ? " (cancelled)" : "");
+}
+
+void Connection::Write(const Response &response, bool is_last) {
+  std::lock_guard<std::mutex> lock(call_mutex_);
+  if (finishing_ || has_last_) {
+    return;
+  }
+
+  pending_responses_.push_back(response);
+  has_last_ = is_last;
+
+  WriteNextLocked();
+}
+
+void Connection::WriteNextLocked() {
+  if (writing_ || finishing_) {
+    return;
+  }
+
+  if (!pending_responses_.empty()) {
+    response_ = std::move(pending_responses_.front());
+    pending_responses_.pop_front();
+
+    writing_ = true;
+    ++num_pending_ops_;
+    stream_.Write(response_, &write_tag_);
+  } else if (has_last_ && reads_done_) {
+    // All responses have been sent and the client has half-closed the
+    // call. Finish it right away so that the client gets the final result
+    // without delay.
+    finishing_ = true;
+    ++num_pending_ops_;
+    stream_.Finish(Status::OK, &finish_tag_);
+  }
+}
+
+OnlineGrpcServer::OnlineGrpcServer(asio::io_context &io_work,
+                                   const OnlineGrpcServerConfig &config)
+    : config_(config), io_work_(io_work), decoder_(this) {}
+
+OnlineGrpcServer::~OnlineGrpcServer() {
+  if (server_) {
+    server_->Shutdown();
+  }
+
+  for (auto &cq : cqs_) {
+    cq->Shutdown();
+  }
+
+  for (auto &t : io_threads_) {
+    t.join();
+  }
+}
+
+void OnlineGrpcServer::Run(uint16_t port, int32_t num_io_threads) {
+  SHERPA_CHECK_GT(num_io_threads, 0);
+
+  grpc::EnableDefaultHealthCheckService(true);
+  grpc::reflection::InitProtoReflectionServerBuilderPlugin();
+
+  grpc::ServerBuilder builder;
+  std::string address("0.0.0.0:" + std::to_string(port));
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service_);
+
+  for (int32_t i = 0; i != num_io_threads; ++i) {
+    cqs_.push_back(builder.AddCompletionQueue());
+  }
+
+  server_ = builder.BuildAndStart();
+  if (!server_) {
+    SHERPA_LOG(FATAL) << "Failed to listen on " << address;
+  }
+
+  decoder_.Run();
+
+  for (auto &cq : cqs_) {
+    std::make_shared<Connection>(this, cq.get())->Start();
+
+    io_threads_.emplace_back(
+        [this, cq = cq.get()]() { PollCompletionQueue(cq); });
+  }
+}
+
+void OnlineGrpcServer::Wait() { server_->Wait(); }
+
+void OnlineGrpcServer::PollCompletionQueue(grpc::ServerCompletionQueue *cq) {
+  void *tag = nullptr;
+  bool ok = false;
+  while (cq->Next(&tag, &ok)) {
+    auto t = static_cast<Connection::Tag *>(tag);
+    t->c->Proceed(t->op, ok);
+  }
+}
+
+bool OnlineGrpcServer::Contains(const std::string &reqid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return connections_.count(reqid);
+}
+
+void OnlineGrpcServer::AddConnection(std::shared_ptr<Connection> c) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.insert(c->reqid);
+  }
+
+  decoder_.AddConnection(c);
+}
+
+void OnlineGrpcServer::RemoveConnection(const std::string &reqid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connections_.erase(reqid);
+}
+
 }  // namespace sherpa
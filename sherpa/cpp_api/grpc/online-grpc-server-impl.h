@@ -11,26 +11,69 @@
 #include <memory>
 #include <mutex>  // NOLINT
 #include <set>
-#include <vector>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "asio.hpp"
+#include "grpcpp/grpcpp.h"
+#include "sherpa/cpp_api/grpc/sherpa.grpc.pb.h"
 #include "sherpa/cpp_api/online-recognizer.h"
 #include "sherpa/cpp_api/online-stream.h"
 #include "sherpa/cpp_api/parse-options.h"
-#include "sherpa/cpp_api/grpc/sherpa.grpc.pb.h"
 
 namespace sherpa {
 using grpc::ServerContext;
-using grpc::ServerReaderWriter;
 using grpc::Status;
 
-struct Connection {
-  // handle to the connection. We can use it to send messages to the client
+class OnlineGrpcServer;
+
+// State of a Recognize call.
+//
+// Reads and writes are asynchronous. Their completion events are delivered
+// to a completion queue, whose polling thread passes them to Proceed().
+// Results are written by the decoding threads via Write(), so no thread
+// is blocked waiting for a call.
+class Connection : public std::enable_shared_from_this<Connection> {
+ public:
+  enum class Op {
+    kRequest,  // a new call arrives
+    kRead,     // a request is read
+    kWrite,    // a response is written
+    kFinish,   // the call is finished by us
+    kDone,     // the call is done, e.g., finished or cancelled
+  };
+
+  // We pass pointers to Tag objects as tags of asynchronous operations
+  struct Tag {
+    Connection *c;
+    Op op;
+  };
+
+  /**
+   * @param server  Not owned.
+   * @param cq  Completion queue of this call. Not owned.
+   */
+  Connection(OnlineGrpcServer *server, grpc::ServerCompletionQueue *cq);
+
+  // Wait for a new Recognize call. It keeps itself alive until all its
+  // operations are completed.
+  void Start();
+
+  // Handle a completion event of the given operation. It is invoked by the
+  // thread polling the completion queue.
+  void Proceed(Op op, bool ok);
+
+  /** Send a response to the client. It can be called by any thread.
+   *
+   * @param response  The response to send.
+   * @param is_last  true if it is the last response. The call is finished
+   *                 after all pending responses have been sent and all
+   *                 requests have been read.
+   */
+  void Write(const Response &response, bool is_last);
+
   std::string reqid;
-  std::shared_ptr<ServerReaderWriter<Response, Request>> stream;
-  std::shared_ptr<Request> request;
-  std::shared_ptr<Response> response;
   std::shared_ptr<OnlineStream> s;
 
   // The last time we received a message from the client
@@ -46,19 +89,49 @@ struct Connection {
   // and invoke work threads to compute features
   std::deque<torch::Tensor> samples;
 
-  bool start_flag = false;       // first time read request flag
-  bool finish_flag = false;      // connection finish flag
-
-  Connection() = default;
-  Connection(std::shared_ptr<ServerReaderWriter<Response, Request>> stream,
-             std::shared_ptr<Request> request,
-             std::shared_ptr<Response> response,
-             std::shared_ptr<OnlineStream> s)
-             : stream(stream),
-               request(request),
-               response(response),
-               s(s),
-               last_active(std::chrono::steady_clock::now()) {}
+ private:
+  void OnRequest(bool ok);
+  void OnRead(bool ok);
+  void OnWrite(bool ok);
+  void OnDone();
+
+  // Start writing the next pending response or finish the call if there
+  // are no more responses. Must be called with call_mutex_ locked.
+  void WriteNextLocked();
+
+ private:
+  OnlineGrpcServer *server_;         // not owned
+  grpc::ServerCompletionQueue *cq_;  // not owned
+  ServerContext ctx_;
+  grpc::ServerAsyncReaderWriter<Response, Request> stream_;
+  Request request_;
+
+  Tag request_tag_{this, Op::kRequest};
+  Tag read_tag_{this, Op::kRead};
+  Tag write_tag_{this, Op::kWrite};
+  Tag finish_tag_{this, Op::kFinish};
+  Tag done_tag_{this, Op::kDone};
+
+  // It protects the members below
+  std::mutex call_mutex_;
+
+  std::deque<Response> pending_responses_;
+
+  // The response that is being written. It has to be kept alive
+  // until the write is completed.
+  Response response_;
+
+  bool started_ = false;  // true after reading the decode config
+  bool writing_ = false;  // true if a write is in progress
+  bool has_last_ = false;  // true if the last response has been queued
+  bool reads_done_ = false;  // true if no more requests can be read
+  bool finishing_ = false;  // true if no more writes can be started
+
+  // Number of operations that have not been completed
+  int32_t num_pending_ops_ = 0;
+
+  // It keeps this object alive while num_pending_ops_ is positive
+  std::shared_ptr<Connection> self_;
 };
 
 struct OnlineGrpcDecoderConfig {
@@ -75,8 +148,6 @@ struct OnlineGrpcDecoderConfig {
   void Validate() const;
 };
 
-class OnlineGrpcServer;
-
 class OnlineGrpcDecoder {
  public:
   /**
@@ -84,6 +155,8 @@ class OnlineGrpcDecoder {
    */
   explicit OnlineGrpcDecoder(OnlineGrpcServer *server);
 
+  void AddConnection(std::shared_ptr<Connection> c);
+
   // Compute features for a stream given audio samples
   void AcceptWaveform(std::shared_ptr<Connection> c);
 
@@ -93,17 +166,11 @@ class OnlineGrpcDecoder {
   void Run();
 
   OnlineGrpcDecoderConfig config_;
-  std::map<std::string, std::shared_ptr<Connection>> connections_;
   std::unique_ptr<OnlineRecognizer> recognizer_;
-  // It protects `connections_`, `ready_connections_`, and `active_`
-  std::mutex mutex_;
 
  private:
   void ProcessConnections(const asio::error_code &ec);
-  void SerializeResult(std::shared_ptr<Connection> c);
-  void OnPartialResult(std::shared_ptr<Connection> c);
-  void OnFinalResult(std::shared_ptr<Connection> c);
-  void OnSpeechEnd(std::shared_ptr<Connection> c);
+
   /** It is called by one of the worker thread.
    */
   void Decode();
@@ -112,6 +179,11 @@ class OnlineGrpcDecoder {
   OnlineGrpcServer *server_;  // not owned
   asio::steady_timer timer_;
 
+  // It protects `connections_`, `ready_connections_`, and `active_`
+  std::mutex mutex_;
+
+  std::map<std::string, std::shared_ptr<Connection>> connections_;
+
   // Whenever a connection has enough feature frames for decoding, we put
   // it in this queue
   std::deque<std::shared_ptr<Connection>> ready_connections_;
@@ -128,25 +200,52 @@ struct OnlineGrpcServerConfig {
   void Validate() const;
 };
 
-class OnlineGrpcServer final : public ASR::Service {
+class OnlineGrpcServer {
  public:
   OnlineGrpcServer(asio::io_context &io_work,  // NOLINT
                    const OnlineGrpcServerConfig &config);
-  Status Recognize(ServerContext* context,
-                   ServerReaderWriter<Response, Request>* reader) override;
-  void Run();
+
+  ~OnlineGrpcServer();
+
+  /** Start the server. It returns immediately.
+   *
+   * @param port  The port to listen on.
+   * @param num_io_threads  Number of threads polling completion queues.
+   *                        Each thread has its own completion queue.
+   */
+  void Run(uint16_t port, int32_t num_io_threads);
+
+  // Block until the server is shut down
+  void Wait();
 
   const OnlineGrpcServerConfig &GetConfig() const { return config_; }
-  bool Contains(const std::string& reqid) const;
+  bool Contains(const std::string &reqid) const;
   asio::io_context &GetWorkContext() { return io_work_; }
-  std::set<std::string> connections_;
+  OnlineGrpcDecoder &GetDecoder() { return decoder_; }
+  ASR::AsyncService &GetService() { return service_; }
+
+  // Called when the decode config of a call is received
+  void AddConnection(std::shared_ptr<Connection> c);
+
+  // Called when a call is done
+  void RemoveConnection(const std::string &reqid);
+
+ private:
+  void PollCompletionQueue(grpc::ServerCompletionQueue *cq);
 
  private:
   OnlineGrpcServerConfig config_;
   asio::io_context &io_work_;
   OnlineGrpcDecoder decoder_;
 
+  ASR::AsyncService service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+  std::vector<std::thread> io_threads_;
+
   mutable std::mutex mutex_;
+
+  std::set<std::string> connections_;
 };
 
 }  // namespace sherpa
@@ -3,16 +3,10 @@
 //                2023  y00281951
 
 #include "asio.hpp"
-#include "grpcpp/ext/proto_server_reflection_plugin.h"
-#include "grpcpp/grpcpp.h"
-#include "grpcpp/health_check_service_interface.h"
 #include "sherpa/cpp_api/grpc/online-grpc-server-impl.h"
 #include "sherpa/csrc/log.h"
 #include "torch/all.h"
 
-using grpc::Server;
-using grpc::ServerBuilder;
-
 static constexpr const char *kUsageMessage = R"(
 Automatic speech recognition with sherpa using grpc.
 
@@ -28,6 +22,9 @@ sherpa-online-grpc-server \
   --tokens=/path/to/tokens.txt \
   --decoding-method=greedy_search \
   --log-file=./log.txt
+
+--num-workers is deprecated and will be removed in the next release.
+Please use --num-io-threads instead.
 )";
 
 int32_t main(int32_t argc, char *argv[]) {
@@ -49,7 +46,22 @@ int32_t main(int32_t argc, char *argv[]) {
   // size of the thread pool for neural network computation and decoding
   int32_t num_work_threads = 5;
 
-  int32_t num_workers = 1;
+  // number of threads polling the completion queues of gRPC.
+  // It does not depend on the number of concurrent streams.
+  int32_t num_io_threads = 1;
+
+  // Deprecated alias of num_io_threads. It set the number of completion
+  // queues of the synchronous server.
+  int32_t num_workers = 0;
+
+  po.Register("num-io-threads", &num_io_threads,
+              "Number of threads to handle gRPC calls. Each of them polls "
+              "its own completion queue. A thread can serve any number "
+              "of streams.");
+
+  po.Register("num-workers", &num_workers,
+              "Deprecated. Use --num-io-threads instead. If positive, it "
+              "overrides --num-io-threads.");
 
   po.Register("num-work-threads", &num_work_threads,
               "Number of threads to use for neural network "
@@ -74,10 +86,17 @@ int32_t main(int32_t argc, char *argv[]) {
 
   config.Validate();
 
+  if (num_workers > 0) {
+    SHERPA_LOG(WARNING) << "--num-workers is deprecated. Please use "
+                        << "--num-io-threads=" << num_workers << " instead";
+    num_io_threads = num_workers;
+  }
+
   asio::io_context io_work;  // for neural network and decoding
 
-  sherpa::OnlineGrpcServer service(io_work, config);
-  service.Run();
+  sherpa::OnlineGrpcServer server(io_work, config);
+  server.Run(port, num_io_threads);
+  SHERPA_LOG(INFO) << "Listening on: " << port << "\n";
 
   SHERPA_LOG(INFO) << "Number of work threads: " << num_work_threads << "\n";
   // give some work to do for the io_work pool
@@ -88,21 +107,11 @@ int32_t main(int32_t argc, char *argv[]) {
     work_threads.emplace_back([&io_work]() { io_work.run(); });
   }
 
-  grpc::EnableDefaultHealthCheckService(true);
-  grpc::reflection::InitProtoReflectionServerBuilderPlugin();
-  ServerBuilder builder;
-  std::string address("0.0.0.0:" + std::to_string(port));
-  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
-  builder.RegisterService(&service);
-  builder.SetSyncServerOption(ServerBuilder::SyncServerOption::NUM_CQS,
-                              num_workers);
-  std::unique_ptr<Server> server(builder.BuildAndStart());
-  SHERPA_LOG(INFO) << "Listening on: " << port << "\n";
+  server.Wait();
 
   for (auto &t : work_threads) {
     t.join();
   }
 
-  server->Wait();
   return 0;
 }
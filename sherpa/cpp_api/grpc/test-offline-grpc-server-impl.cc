@@ -0,0 +1,42 @@
+// sherpa/cpp_api/grpc/test-offline-grpc-server-impl.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "sherpa/cpp_api/grpc/offline-grpc-server-impl.h"
+
+namespace sherpa {
+
+TEST(OfflineGrpcServer, CheckAudioData) {
+  // 25 ms at 16 kHz
+  int32_t frame_length = 400;
+
+  // empty
+  grpc::Status status = CheckAudioData("", frame_length);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+  // odd number of bytes
+  status = CheckAudioData(std::string(2 * frame_length + 1, '\0'),
+                          frame_length);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+  // shorter than one frame
+  status = CheckAudioData(std::string(2 * (frame_length - 1), '\0'),
+                          frame_length);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+  // a single byte
+  status = CheckAudioData(std::string(1, '\0'), frame_length);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+  // exactly one frame
+  status = CheckAudioData(std::string(2 * frame_length, '\0'), frame_length);
+  EXPECT_TRUE(status.ok()) << status.error_message();
+
+  status = CheckAudioData(std::string(2 * 16000, '\0'), frame_length);
+  EXPECT_TRUE(status.ok()) << status.error_message();
+}
+
+}  // namespace sherpa
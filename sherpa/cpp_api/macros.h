@@ -19,6 +19,25 @@
 #ifndef SHERPA_CPP_API_MACROS_H_
 #define SHERPA_CPP_API_MACROS_H_
 
+#include "torch/script.h"
+
+#if SHERPA_TORCH_VERSION_MAJOR > 1 || \
+    (SHERPA_TORCH_VERSION_MAJOR == 1 && SHERPA_TORCH_VERSION_MINOR >= 10)
+#include "ATen/autocast_mode.h"
+#define SHERPA_HAS_CPU_AUTOCAST 1
+#else
+#define SHERPA_HAS_CPU_AUTOCAST 0
+#endif
+
+// torch >= 2.4 takes the device type in the autocast functions and
+// deprecates the CPU specific ones.
+#if SHERPA_TORCH_VERSION_MAJOR > 2 || \
+    (SHERPA_TORCH_VERSION_MAJOR == 2 && SHERPA_TORCH_VERSION_MINOR >= 4)
+#define SHERPA_HAS_DEVICE_AUTOCAST 1
+#else
+#define SHERPA_HAS_DEVICE_AUTOCAST 0
+#endif
+
 namespace sherpa {
 
 #if SHERPA_TORCH_VERSION_MAJOR > 1 || \
@@ -28,6 +47,59 @@ using InferenceMode = torch::InferenceMode;
 using InferenceMode = torch::NoGradGuard;
 #endif
 
+// Run operators on CPU under bfloat16 autocast in the scope of this object.
+// It does nothing if enabled is false.
+class CpuAutocastBf16 {
+ public:
+  explicit CpuAutocastBf16(bool enabled) : enabled_(enabled) {
+    if (!enabled_) {
+      return;
+    }
+#if SHERPA_HAS_DEVICE_AUTOCAST
+    prev_enabled_ = at::autocast::is_autocast_enabled(at::kCPU);
+    prev_dtype_ = at::autocast::get_autocast_dtype(at::kCPU);
+    at::autocast::set_autocast_enabled(at::kCPU, true);
+    at::autocast::set_autocast_dtype(at::kCPU, at::kBFloat16);
+    at::autocast::increment_nesting();
+#elif SHERPA_HAS_CPU_AUTOCAST
+    prev_enabled_ = at::autocast::is_cpu_enabled();
+    prev_dtype_ = at::autocast::get_autocast_cpu_dtype();
+    at::autocast::set_cpu_enabled(true);
+    at::autocast::set_autocast_cpu_dtype(at::kBFloat16);
+    at::autocast::increment_nesting();
+#endif
+  }
+
+  ~CpuAutocastBf16() {
+    if (!enabled_) {
+      return;
+    }
+#if SHERPA_HAS_CPU_AUTOCAST
+    if (at::autocast::decrement_nesting() == 0) {
+      at::autocast::clear_cache();
+    }
+#endif
+
+#if SHERPA_HAS_DEVICE_AUTOCAST
+    at::autocast::set_autocast_enabled(at::kCPU, prev_enabled_);
+    at::autocast::set_autocast_dtype(at::kCPU, prev_dtype_);
+#elif SHERPA_HAS_CPU_AUTOCAST
+    at::autocast::set_cpu_enabled(prev_enabled_);
+    at::autocast::set_autocast_cpu_dtype(prev_dtype_);
+#endif
+  }
+
+  CpuAutocastBf16(const CpuAutocastBf16 &) = delete;
+  CpuAutocastBf16 &operator=(const CpuAutocastBf16 &) = delete;
+
+ private:
+  bool enabled_;
+#if SHERPA_HAS_CPU_AUTOCAST
+  bool prev_enabled_ = false;
+  at::ScalarType prev_dtype_ = at::kBFloat16;
+#endif
+};
+
 }  // namespace sherpa
 
 #endif  // SHERPA_CPP_API_MACROS_H_
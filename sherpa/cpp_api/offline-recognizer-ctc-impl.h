@@ -5,22 +5,29 @@
 #ifndef SHERPA_CPP_API_OFFLINE_RECOGNIZER_CTC_IMPL_H_
 #define SHERPA_CPP_API_OFFLINE_RECOGNIZER_CTC_IMPL_H_
 
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "sherpa/cpp_api/feature-config.h"
 #include "sherpa/cpp_api/offline-recognizer-impl.h"
+#include "sherpa/csrc/context-graph-cache.h"
 #include "sherpa/csrc/log.h"
+#include "sherpa/csrc/model-registry.h"
 #include "sherpa/csrc/offline-conformer-ctc-model.h"
 #include "sherpa/csrc/offline-ctc-decoder.h"
 #include "sherpa/csrc/offline-ctc-model.h"
 #include "sherpa/csrc/offline-ctc-one-best-decoder.h"
+#include "sherpa/csrc/offline-ctc-prefix-beam-search-decoder.h"
 #include "sherpa/csrc/offline-nemo-enc-dec-ctc-model-bpe.h"
 #include "sherpa/csrc/offline-wav2vec2-ctc-model.h"
 #include "sherpa/csrc/offline-wenet-conformer-ctc-model.h"
+#include "sherpa/csrc/pad-sequence.h"
 #include "sherpa/csrc/symbol-table.h"
+#include "sherpa/csrc/timer.h"
 
 namespace sherpa {
 
@@ -52,37 +59,70 @@ static OfflineRecognitionResult Convert(const OfflineCtcDecoderResult &src,
 
 class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
  public:
-  explicit OfflineRecognizerCtcImpl(const OfflineRecognizerConfig &config)
+  /**
+   * @param m  The model loaded from config.nn_model by torch::jit::load()
+   *           on the device given by config.use_gpu.
+   */
+  OfflineRecognizerCtcImpl(const OfflineRecognizerConfig &config,
+                           torch::jit::Module m)
       : config_(config),
-        symbol_table_(config.tokens),
         fbank_(config.feat_config.fbank_opts),
-        device_(torch::kCPU) {
+        device_(torch::kCPU),
+        context_graphs_(config.context_score) {
+    Timer total_timer;
     config.ctc_decoder_config.Validate();
 
     if (config.use_gpu) {
       device_ = torch::Device("cuda:0");
     }
 
-    torch::jit::Module m = torch::jit::load(config.nn_model, torch::kCPU);
+    // Tokens and HLG do not depend on the model, so we load them in
+    // parallel with the model construction and the warm-up.
+    auto tokens = std::async(std::launch::async, [&config]() {
+      Timer timer;
+      auto sym = LoadSymbolTable(config.tokens, config.share_models);
+      return std::make_pair(std::move(sym), timer.Elapsed());
+    });
+
+    std::future<std::pair<k2::FsaClassPtr, double>> hlg;
+    if (!config.ctc_decoder_config.hlg.empty()) {
+      hlg = std::async(std::launch::async, [this, &config]() {
+        Timer timer;
+        const auto &ctc_config = config.ctc_decoder_config;
+        auto g = LoadDecodingGraph(ctc_config.hlg, device_,
+                                   ctc_config.lm_scale, config.share_models);
+        return std::make_pair(g, timer.Elapsed());
+      });
+    }
+
+    Timer timer;
+    double tokens_time = 0;
+
     // We currently support: icefall, wenet, torchaudio.
     std::string class_name = m.type()->name()->name();
     if (class_name == "ASRModel") {
       // this one is from wenet, see
       // https://github.com/wenet-e2e/wenet/blob/main/wenet/transformer/asr_model.py#L42
-      model_ = std::make_unique<OfflineWenetConformerCtcModel>(config.nn_model,
+      model_ = std::make_unique<OfflineWenetConformerCtcModel>(std::move(m),
                                                                device_);
     } else if (class_name == "Conformer") {
       // this one is from icefall, see
       // https://github.com/k2-fsa/icefall/blob/master/egs/librispeech/ASR/conformer_ctc/conformer.py#L27
       model_ =
-          std::make_unique<OfflineConformerCtcModel>(config.nn_model, device_);
+          std::make_unique<OfflineConformerCtcModel>(std::move(m), device_);
     } else if (class_name == "Wav2Vec2Model") {
       // This one is from torchaudio
       // https://github.com/pytorch/audio/blob/main/torchaudio/models/wav2vec2/model.py#L11
       model_ =
-          std::make_unique<OfflineWav2Vec2CtcModel>(config.nn_model, device_);
+          std::make_unique<OfflineWav2Vec2CtcModel>(std::move(m), device_);
       config_.feat_config.return_waveform = true;
-      symbol_table_.Replace(symbol_table_["|"], " ", "|");
+      std::shared_ptr<const SymbolTable> sym;
+      std::tie(sym, tokens_time) = tokens.get();
+
+      // Copy it since the symbol table may be shared
+      auto symbol_table = std::make_shared<SymbolTable>(*sym);
+      symbol_table->Replace((*symbol_table)["|"], " ", "|");
+      symbol_table_ = std::move(symbol_table);
       // See Section 4.2 of
       // https://arxiv.org/pdf/2006.11477.pdf
       config_.feat_config.fbank_opts.frame_opts.frame_shift_ms = 20;
@@ -92,15 +132,15 @@ class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
       // See
       // https://github.com/NVIDIA/NeMo/blob/main/nemo/collections/asr/models/ctc_bpe_models.py#L34
       //
-      model_ = std::make_unique<OfflineNeMoEncDecCTCModelBPE>(config.nn_model,
-                                                              device_);
+      model_ =
+          std::make_unique<OfflineNeMoEncDecCTCModelBPE>(std::move(m), device_);
     } else if (class_name == "EncDecCTCModel") {
       // This one is from NeMo
       // See
       // https://github.com/NVIDIA/NeMo/blob/main/nemo/collections/asr/models/ctc_models.py#L41
       //
       model_ =
-          std::make_unique<OfflineNeMoEncDecCTCModel>(config.nn_model, device_);
+          std::make_unique<OfflineNeMoEncDecCTCModel>(std::move(m), device_);
     } else {
       std::ostringstream os;
       os << "Support only models from icefall, wenet, torchaudio, and NeMo\n"
@@ -125,14 +165,84 @@ class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
       TORCH_CHECK(false, os.str());
     }
 
+    double model_time = timer.Elapsed();
+
+    if (config.freeze_model) {
+      SHERPA_LOG(WARNING) << "--freeze-model supports only transducer models. "
+                          << "Ignore it for " << class_name;
+    }
+
+    if (config.frame_bucket_size > 0) {
+      int32_t bucket_size = config.frame_bucket_size;
+      if (config_.feat_config.return_waveform) {
+        // The input contains samples instead of feature frames
+        const auto &frame_opts = config_.feat_config.fbank_opts.frame_opts;
+        bucket_size *= frame_opts.samp_freq * frame_opts.frame_shift_ms / 1000;
+      }
+      frame_bucketizer_ = std::make_unique<ShapeBucketizer>(bucket_size);
+    }
+
+    timer.Reset();
     WarmUp();
+    double warmup_time = timer.Elapsed();
 
-    decoder_ = std::make_unique<OfflineCtcOneBestDecoder>(
-        config.ctc_decoder_config, device_, model_->VocabSize());
+    if (tokens.valid()) {
+      std::tie(symbol_table_, tokens_time) = tokens.get();
+    }
+
+    k2::FsaClassPtr hlg_graph;
+    double hlg_time = 0;
+    if (hlg.valid()) {
+      std::tie(hlg_graph, hlg_time) = hlg.get();
+    }
+
+    if (config.decoding_method == "prefix_beam_search") {
+      if (hlg_graph) {
+        SHERPA_LOG(FATAL) << "prefix_beam_search does not support --hlg. "
+                          << "Please use greedy_search for HLG decoding";
+      }
+      decoder_ = std::make_unique<OfflineCtcPrefixBeamSearchDecoder>(
+          config.num_active_paths, config.ctc_decoder_config.top_k);
+    } else {
+      decoder_ = std::make_unique<OfflineCtcOneBestDecoder>(
+          config.ctc_decoder_config, device_, model_->VocabSize(), hlg_graph);
+    }
+
+    if (!config.warmup_config.batch_sizes.empty()) {
+      timer.Reset();
+      RunWarmUpProfile(config.warmup_config,
+                       fbank_.GetFrameOptions().samp_freq);
+      warmup_time += timer.Elapsed();
+    }
+
+    SHERPA_LOG(INFO) << "Startup time (seconds). model init: " << model_time
+                     << ", tokens: " << tokens_time << ", HLG: " << hlg_time
+                     << ", warm-up: " << warmup_time
+                     << ", total: " << total_timer.Elapsed();
   }
 
   std::unique_ptr<OfflineStream> CreateStream() override {
-    return std::make_unique<OfflineStream>(&fbank_, config_.feat_config);
+    return std::make_unique<OfflineStream>(&fbank_, config_.feat_config,
+                                           context_graphs_.Get({}));
+  }
+
+  // Hotwords are used only by prefix_beam_search. Other decoding methods
+  // ignore the context graph of a stream.
+  std::unique_ptr<OfflineStream> CreateStream(
+      const std::vector<std::vector<int32_t>> &context_list) override {
+    return std::make_unique<OfflineStream>(&fbank_, config_.feat_config,
+                                           context_graphs_.Get(context_list));
+  }
+
+  void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &context_list) override {
+    context_graphs_.SetDefault(context_list);
+  }
+
+  void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove) override {
+    context_graphs_.UpdateDefault(add, remove);
   }
 
   void DecodeStreams(OfflineStream **ss, int32_t n) override {
@@ -152,14 +262,19 @@ class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
     //
     // If return_waveform is true, features_vec contains 1-D tensors of shape
     // (num_samples,). In this case, we use 0 as the padding value.
-    auto features = torch::nn::utils::rnn::pad_sequence(
-        features_vec, /*batch_first*/ true,
-        /*padding_value*/ return_waveform_ ? 0 : -23.025850929940457f);
+    auto features =
+        PadSequence(features_vec, config_.feat_config.return_waveform,
+                    frame_bucketizer_.get());
 
     auto features_length = torch::tensor(features_length_vec);
 
-    torch::IValue ivalue = model_->Forward(features, features_length);
-    torch::Tensor log_prob = model_->GetLogSoftmaxOut(ivalue);
+    torch::IValue ivalue;
+    {
+      CpuAutocastBf16 autocast(config_.use_bf16);
+      ivalue = model_->Forward(features, features_length);
+    }
+    torch::Tensor log_prob =
+        model_->GetLogSoftmaxOut(ivalue).to(torch::kFloat);
     torch::Tensor log_prob_len = model_->GetLogSoftmaxOutLength(ivalue);
     if (!log_prob_len.defined()) {
       log_prob_len =
@@ -167,11 +282,11 @@ class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
       log_prob_len = log_prob_len.to(log_prob.device());
     }
 
-    auto results =
-        decoder_->Decode(log_prob, log_prob_len, model_->SubsamplingFactor());
+    auto results = decoder_->Decode(log_prob, log_prob_len,
+                                    model_->SubsamplingFactor(), ss, n);
     for (int32_t i = 0; i != n; ++i) {
       ss[i]->SetResult(
-          Convert(results[i], symbol_table_,
+          Convert(results[i], *symbol_table_,
                   config_.feat_config.fbank_opts.frame_opts.frame_shift_ms,
                   model_->SubsamplingFactor()));
     }
@@ -191,18 +306,19 @@ class OfflineRecognizerCtcImpl : public OfflineRecognizerImpl {
     features = features.to(device_);
     features_length = features_length.to(device_);
 
+    CpuAutocastBf16 autocast(config_.use_bf16);
     model_->WarmUp(features, features_length);
     SHERPA_LOG(INFO) << "WarmUp ended";
   }
 
  private:
   OfflineRecognizerConfig config_;
-  SymbolTable symbol_table_;
+  std::shared_ptr<const SymbolTable> symbol_table_;
   std::unique_ptr<OfflineCtcModel> model_;
   std::unique_ptr<OfflineCtcDecoder> decoder_;
   kaldifeat::Fbank fbank_;
   torch::Device device_;
-  bool return_waveform_ = false;
+  ContextGraphCache context_graphs_;
 };
 
 }  // namespace sherpa
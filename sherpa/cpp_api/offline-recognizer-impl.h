@@ -6,10 +6,14 @@
 #define SHERPA_CPP_API_OFFLINE_RECOGNIZER_IMPL_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "sherpa/cpp_api/offline-recognizer.h"
 #include "sherpa/csrc/log.h"
+#include "sherpa/csrc/shape-bucketizer.h"
+#include "sherpa/csrc/timer.h"
+#include "torch/script.h"
 
 namespace sherpa {
 
@@ -21,11 +25,77 @@ class OfflineRecognizerImpl {
 
   virtual std::unique_ptr<OfflineStream> CreateStream(
       const std::vector<std::vector<int32_t>> &context_list) {
-    SHERPA_LOG(FATAL) << "Only transducer models support contextual biasing.";
+    SHERPA_LOG(FATAL) << "Only transducer and CTC models support contextual "
+                      << "biasing.";
     return nullptr;  // just to make compiler happy
   }
 
+  virtual void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &context_list) {
+    SHERPA_LOG(FATAL) << "Only transducer and CTC models support contextual "
+                      << "biasing.";
+  }
+
+  virtual void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove) {
+    SHERPA_LOG(FATAL) << "Only transducer and CTC models support contextual "
+                      << "biasing.";
+  }
+
   virtual void DecodeStreams(OfflineStream **ss, int32_t n) = 0;
+
+  BucketStats GetBucketStats() const {
+    return frame_bucketizer_ ? frame_bucketizer_->GetStats() : BucketStats{};
+  }
+
+ protected:
+  /** Run each pair of batch size and duration from the given warm-up
+   * profile through CreateStream() and DecodeStreams(). The bucket
+   * statistics are cleared afterwards so that they cover only real inputs.
+   *
+   * @param config  The warm-up profile.
+   * @param sample_rate  Sample rate of the random input.
+   * @param tag  It is prepended to the log of each shape.
+   */
+  void RunWarmUpProfile(const WarmUpConfig &config, float sample_rate,
+                        const std::string &tag = "") {
+    std::vector<int32_t> batch_sizes = config.GetBatchSizes();
+    std::vector<float> durations = config.GetDurations();
+
+    for (auto batch_size : batch_sizes) {
+      for (auto duration : durations) {
+        Timer timer;
+        int32_t num_samples = duration * sample_rate;
+
+        std::vector<std::unique_ptr<OfflineStream>> streams(batch_size);
+        std::vector<OfflineStream *> ss(batch_size);
+        for (int32_t i = 0; i != batch_size; ++i) {
+          // We use noise instead of silence so that non-blank tokens
+          // are decoded
+          torch::Tensor samples =
+              torch::rand({num_samples}, torch::kFloat) - 0.5;
+
+          streams[i] = CreateStream();
+          streams[i]->AcceptSamples(samples.data_ptr<float>(), num_samples);
+          ss[i] = streams[i].get();
+        }
+
+        DecodeStreams(ss.data(), batch_size);
+
+        SHERPA_LOG(INFO) << "WarmUp " << tag << "batch_size: " << batch_size
+                         << ", duration: " << duration
+                         << " s, time: " << timer.Elapsed() << " s";
+      }
+    }
+
+    if (frame_bucketizer_) {
+      frame_bucketizer_->ResetStats();
+    }
+  }
+
+  // Not null only if config.frame_bucket_size is positive
+  std::unique_ptr<ShapeBucketizer> frame_bucketizer_;
 };
 
 }  // namespace sherpa
@@ -5,22 +5,28 @@
 #ifndef SHERPA_CPP_API_OFFLINE_RECOGNIZER_TRANSDUCER_IMPL_H_
 #define SHERPA_CPP_API_OFFLINE_RECOGNIZER_TRANSDUCER_IMPL_H_
 
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "sherpa/cpp_api/feature-config.h"
 #include "sherpa/cpp_api/offline-recognizer-impl.h"
 #include "sherpa/csrc/byte_util.h"
-#include "sherpa/csrc/context-graph.h"
+#include "sherpa/csrc/context-graph-cache.h"
+#include "sherpa/csrc/model-registry.h"
+#include "sherpa/csrc/module-optimizer.h"
 #include "sherpa/csrc/offline-conformer-transducer-model.h"
 #include "sherpa/csrc/offline-transducer-decoder.h"
 #include "sherpa/csrc/offline-transducer-fast-beam-search-decoder.h"
 #include "sherpa/csrc/offline-transducer-greedy-search-decoder.h"
 #include "sherpa/csrc/offline-transducer-model.h"
 #include "sherpa/csrc/offline-transducer-modified-beam-search-decoder.h"
+#include "sherpa/csrc/pad-sequence.h"
 #include "sherpa/csrc/symbol-table.h"
+#include "sherpa/csrc/timer.h"
 
 namespace sherpa {
 
@@ -57,19 +63,81 @@ static OfflineRecognitionResult Convert(
 
 class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
  public:
-  explicit OfflineRecognizerTransducerImpl(
-      const OfflineRecognizerConfig &config)
+  /**
+   * @param m  The model loaded from config.nn_model by torch::jit::load()
+   *           on the device given by config.use_gpu, or the module from
+   *           optimizer->LoadCache().
+   * @param optimizer  If not null, it optimizes the model for inference.
+   *                   It is not null if and only if config.freeze_model is
+   *                   true.
+   */
+  OfflineRecognizerTransducerImpl(const OfflineRecognizerConfig &config,
+                                  torch::jit::Module m,
+                                  std::unique_ptr<ModuleOptimizer> optimizer)
       : config_(config),
-        symbol_table_(config.tokens),
         fbank_(config.feat_config.fbank_opts),
-        device_(torch::kCPU) {
+        device_(torch::kCPU),
+        context_graphs_(config.context_score) {
+    Timer total_timer;
     if (config.use_gpu) {
       device_ = torch::Device("cuda:0");
     }
-    model_ = std::make_unique<OfflineConformerTransducerModel>(config.nn_model,
+
+    if (config.decoding_method == "fast_beam_search") {
+      config.fast_beam_search_config.Validate();
+    }
+
+    // Tokens and LG do not depend on the model, so we load them in
+    // parallel with the model construction and the warm-up.
+    auto tokens = std::async(std::launch::async, [&config]() {
+      Timer timer;
+      auto sym = LoadSymbolTable(config.tokens, config.share_models);
+      return std::make_pair(std::move(sym), timer.Elapsed());
+    });
+
+    std::future<std::pair<k2::FsaClassPtr, double>> lg;
+    if (config.decoding_method == "fast_beam_search" &&
+        !config.fast_beam_search_config.lg.empty()) {
+      lg = std::async(std::launch::async, [this, &config]() {
+        Timer timer;
+        const auto &fbs_config = config.fast_beam_search_config;
+        auto g = LoadDecodingGraph(fbs_config.lg, device_,
+                                   fbs_config.ngram_lm_scale,
+                                   config.share_models);
+        return std::make_pair(g, timer.Elapsed());
+      });
+    }
+
+    if (config.frame_bucket_size > 0) {
+      frame_bucketizer_ =
+          std::make_unique<ShapeBucketizer>(config.frame_bucket_size);
+    }
+
+    Timer timer;
+    model_ = std::make_unique<OfflineConformerTransducerModel>(std::move(m),
                                                                device_);
+    double model_time = timer.Elapsed();
+
+    double freeze_time = 0;
+    if (optimizer) {
+      timer.Reset();
+      model_->OptimizeForInference(optimizer.get());
+      optimizer->SaveCache();
+      freeze_time = timer.Elapsed();
+    }
 
+    timer.Reset();
     WarmUp();
+    double warmup_time = timer.Elapsed();
+
+    double tokens_time;
+    std::tie(symbol_table_, tokens_time) = tokens.get();
+
+    k2::FsaClassPtr lg_graph;
+    double lg_time = 0;
+    if (lg.valid()) {
+      std::tie(lg_graph, lg_time) = lg.get();
+    }
 
     if (config.decoding_method == "greedy_search") {
       decoder_ =
@@ -78,29 +146,44 @@ class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
       decoder_ = std::make_unique<OfflineTransducerModifiedBeamSearchDecoder>(
           model_.get(), config.num_active_paths, config.temperature);
     } else if (config.decoding_method == "fast_beam_search") {
-      config.fast_beam_search_config.Validate();
-
       decoder_ = std::make_unique<OfflineTransducerFastBeamSearchDecoder>(
-          model_.get(), config.fast_beam_search_config);
+          model_.get(), config.fast_beam_search_config, lg_graph);
     } else {
       TORCH_CHECK(false,
                   "Unsupported decoding method: ", config.decoding_method);
     }
+
+    timer.Reset();
+    WarmUpWithProfile();
+    warmup_time += timer.Elapsed();
+
+    SHERPA_LOG(INFO) << "Startup time (seconds). model init: " << model_time
+                     << ", tokens: " << tokens_time << ", LG: " << lg_time
+                     << ", freeze: " << freeze_time
+                     << ", warm-up: " << warmup_time
+                     << ", total: " << total_timer.Elapsed();
   }
 
   std::unique_ptr<OfflineStream> CreateStream() override {
-    return std::make_unique<OfflineStream>(&fbank_, config_.feat_config);
+    return std::make_unique<OfflineStream>(&fbank_, config_.feat_config,
+                                           context_graphs_.Get({}));
   }
 
   std::unique_ptr<OfflineStream> CreateStream(
       const std::vector<std::vector<int32_t>> &context_list) override {
-    // We create context_graph at this level, because we might have default
-    // context_graph(will be added later if needed) that belongs to the whole
-    // model rather than each stream.
-    auto context_graph =
-        std::make_shared<ContextGraph>(context_list, config_.context_score);
     return std::make_unique<OfflineStream>(&fbank_, config_.feat_config,
-                                           context_graph);
+                                           context_graphs_.Get(context_list));
+  }
+
+  void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &context_list) override {
+    context_graphs_.SetDefault(context_list);
+  }
+
+  void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove) override {
+    context_graphs_.UpdateDefault(add, remove);
   }
 
   void DecodeStreams(OfflineStream **ss, int32_t n) override {
@@ -117,9 +200,8 @@ class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
       features_length_vec[i] = f.size(0);
     }
 
-    auto features = torch::nn::utils::rnn::pad_sequence(
-                        features_vec, /*batch_first*/ true,
-                        /*padding_value*/ -23.025850929940457f)
+    auto features = PadSequence(features_vec, /*return_waveform*/ false,
+                                frame_bucketizer_.get())
                         .to(device_);
 
     auto features_length = torch::tensor(features_length_vec).to(device_);
@@ -127,8 +209,12 @@ class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
     torch::Tensor encoder_out;
     torch::Tensor encoder_out_length;
 
-    std::tie(encoder_out, encoder_out_length) =
-        model_->RunEncoder(features, features_length);
+    {
+      CpuAutocastBf16 autocast(config_.use_bf16);
+      std::tie(encoder_out, encoder_out_length) =
+          model_->RunEncoder(features, features_length);
+    }
+    encoder_out = encoder_out.to(torch::kFloat);
     encoder_out_length = encoder_out_length.cpu();
 
     OfflineStream **streams = has_context_graph ? ss : nullptr;
@@ -138,7 +224,7 @@ class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
 
     for (int32_t i = 0; i != n; ++i) {
       auto ans =
-          Convert(results[i], symbol_table_,
+          Convert(results[i], *symbol_table_,
                   config_.feat_config.fbank_opts.frame_opts.frame_shift_ms,
                   model_->SubsamplingFactor(), config_.use_bbpe);
 
@@ -160,17 +246,46 @@ class OfflineRecognizerTransducerImpl : public OfflineRecognizerImpl {
     features = features.to(device_);
     features_length = features_length.to(device_);
 
+    CpuAutocastBf16 autocast(config_.use_bf16);
     model_->WarmUp(features, features_length);
     SHERPA_LOG(INFO) << "WarmUp ended";
   }
 
+  // Run the shapes from config_.warmup_config through the full decoding
+  // path. For modified_beam_search, each value of num_active_paths from
+  // the profile uses a temporary decoder.
+  void WarmUpWithProfile() {
+    const auto &warmup_config = config_.warmup_config;
+    if (warmup_config.batch_sizes.empty()) {
+      return;
+    }
+
+    float sample_rate = fbank_.GetFrameOptions().samp_freq;
+    std::vector<int32_t> num_active_paths = warmup_config.GetNumActivePaths();
+    if (config_.decoding_method != "modified_beam_search" ||
+        num_active_paths.empty()) {
+      RunWarmUpProfile(warmup_config, sample_rate);
+      return;
+    }
+
+    auto decoder = std::move(decoder_);
+    for (auto n : num_active_paths) {
+      decoder_ = std::make_unique<OfflineTransducerModifiedBeamSearchDecoder>(
+          model_.get(), n, config_.temperature);
+      RunWarmUpProfile(warmup_config, sample_rate,
+                       "num_active_paths: " + std::to_string(n) + ", ");
+    }
+    decoder_ = std::move(decoder);
+  }
+
  private:
   OfflineRecognizerConfig config_;
-  SymbolTable symbol_table_;
+  std::shared_ptr<const SymbolTable> symbol_table_;
   std::unique_ptr<OfflineTransducerModel> model_;
   std::unique_ptr<OfflineTransducerDecoder> decoder_;
   kaldifeat::Fbank fbank_;
   torch::Device device_;
+  ContextGraphCache context_graphs_;
 };
 
 }  // namespace sherpa
@@ -4,7 +4,12 @@
 
 #include "sherpa/cpp_api/offline-recognizer.h"
 
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "sherpa/cpp_api/feature-config.h"
 #include "sherpa/cpp_api/offline-recognizer-ctc-impl.h"
@@ -12,6 +17,9 @@
 #include "sherpa/cpp_api/offline-recognizer-transducer-impl.h"
 #include "sherpa/csrc/file-utils.h"
 #include "sherpa/csrc/log.h"
+#include "sherpa/csrc/model-registry.h"
+#include "sherpa/csrc/module-optimizer.h"
+#include "sherpa/csrc/timer.h"
 #include "torch/script.h"
 
 namespace sherpa {
@@ -57,6 +65,11 @@ void OfflineCtcDecoderConfig::Register(ParseOptions *po) {
       "in that it will try not to exceed that but may "
       "not always succeed. You can use a very large "
       "number if no constraint is needed. ");
+
+  po->Register("top-k", &top_k,
+               "Used only when --decoding-method is prefix_beam_search. "
+               "Only the top-k tokens of each frame are used to extend "
+               "the prefixes.");
 }
 
 void OfflineCtcDecoderConfig::Validate() const {
@@ -68,6 +81,7 @@ void OfflineCtcDecoderConfig::Validate() const {
   SHERPA_CHECK_GT(output_beam, 0);
   SHERPA_CHECK_GE(min_active_states, 0);
   SHERPA_CHECK_GE(max_active_states, 0);
+  SHERPA_CHECK_GT(top_k, 0);
 }
 
 std::string OfflineCtcDecoderConfig::ToString() const {
@@ -80,7 +94,8 @@ std::string OfflineCtcDecoderConfig::ToString() const {
   os << "search_beam=" << search_beam << ", ";
   os << "output_beam=" << output_beam << ", ";
   os << "min_active_states=" << min_active_states << ", ";
-  os << "max_active_states=" << max_active_states << ")";
+  os << "max_active_states=" << max_active_states << ", ";
+  os << "top_k=" << top_k << ")";
 
   return os.str();
 }
@@ -89,6 +104,8 @@ void OfflineRecognizerConfig::Register(ParseOptions *po) {
   ctc_decoder_config.Register(po);
   feat_config.Register(po);
   fast_beam_search_config.Register(po);
+  warmup_config.Register(po);
+  long_form_config.Register(po);
 
   po->Register("nn-model", &nn_model, "Path to the torchscript model");
 
@@ -101,14 +118,18 @@ void OfflineRecognizerConfig::Register(ParseOptions *po) {
 
   po->Register("decoding-method", &decoding_method,
                "Decoding method to use. Possible values are: greedy_search, "
-               "modified_beam_search, and fast_beam_search");
+               "modified_beam_search, fast_beam_search, and "
+               "prefix_beam_search. prefix_beam_search is for CTC models "
+               "only.");
 
   po->Register("num-active-paths", &num_active_paths,
-               "Number of active paths for modified_beam_search. "
-               "Used only when --decoding-method is modified_beam_search");
+               "Number of active paths for modified_beam_search and "
+               "prefix_beam_search. Used only when --decoding-method is "
+               "modified_beam_search or prefix_beam_search");
   po->Register("context-score", &context_score,
                "The bonus score for each token in context word/phrase. "
-               "Used only when decoding_method is modified_beam_search");
+               "Used only when decoding_method is modified_beam_search or "
+               "prefix_beam_search");
 
   po->Register("use-bbpe", &use_bbpe,
                "true if the model to use is trained with byte level bpe, "
@@ -120,6 +141,37 @@ void OfflineRecognizerConfig::Register(ParseOptions *po) {
   po->Register("temperature", &temperature,
                "Softmax temperature,. "
                "Used only when decoding_method is modified_beam_search.");
+
+  po->Register("use-bf16", &use_bf16,
+               "true to run the encoder under bfloat16 autocast. "
+               "Supported only on CPU. It is faster on CPUs with native "
+               "bfloat16 support, e.g., with AVX512-BF16 or AMX.");
+
+  po->Register("use-int8", &use_int8,
+               "true to quantize the Linear layers of the model to int8 "
+               "after loading it. Weights are quantized ahead of time and "
+               "activations on the fly. Supported only on CPU. Other layers, "
+               "e.g., LSTM, are kept in float32.");
+
+  po->Register("freeze-model", &freeze_model,
+               "true to freeze the encoder, decoder, and joiner and optimize "
+               "them for inference. It requires PyTorch >= 1.10. Supported "
+               "only by transducer models.");
+
+  po->Register("model-cache-dir", &model_cache_dir,
+               "An existing directory to cache frozen models. The cache key "
+               "contains the hash of the model files, the PyTorch version, "
+               "and the CPU features. Used only when --freeze-model is true.");
+
+  po->Register("frame-bucket-size", &frame_bucket_size,
+               "If positive, the number of frames of a batch is padded to a "
+               "multiple of it so that the encoder sees only a few distinct "
+               "input shapes.");
+
+  po->Register("share-models", &share_models,
+               "true to share models, decoding graphs, and tokens with other "
+               "recognizers in the same process that use the same files. "
+               "Models frozen by --freeze-model are not shared.");
 }
 
 void OfflineRecognizerConfig::Validate() const {
@@ -137,17 +189,42 @@ void OfflineRecognizerConfig::Validate() const {
   // used only for transducer models. We should skip it for CTC models
   if (decoding_method != "greedy_search" &&
       decoding_method != "modified_beam_search" &&
-      decoding_method != "fast_beam_search") {
+      decoding_method != "fast_beam_search" &&
+      decoding_method != "prefix_beam_search") {
     SHERPA_LOG(FATAL)
         << "Unsupported decoding method: " << decoding_method
         << ". Supported values are: greedy_search, modified_beam_search, "
-        << "and fast_beam_search.";
+        << "fast_beam_search, and prefix_beam_search.";
   }
 
   // TODO(fangjun): Create a class ModifiedBeamSearchConfig
-  if (decoding_method == "modified_beam_search") {
+  if (decoding_method == "modified_beam_search" ||
+      decoding_method == "prefix_beam_search") {
     SHERPA_CHECK_GT(num_active_paths, 0);
   }
+
+  if (use_bf16) {
+    if (use_gpu) {
+      SHERPA_LOG(FATAL) << "--use-bf16 supports only CPU";
+    }
+#if !SHERPA_HAS_CPU_AUTOCAST
+    SHERPA_LOG(FATAL) << "--use-bf16 requires PyTorch >= 1.10";
+#endif
+  }
+
+  if (use_int8 && use_gpu) {
+    SHERPA_LOG(FATAL) << "--use-int8 supports only CPU";
+  }
+
+  if (!model_cache_dir.empty() && !freeze_model) {
+    SHERPA_LOG(WARNING) << "Ignore --model-cache-dir since --freeze-model is "
+                        << "false";
+  }
+
+  warmup_config.Validate();
+  long_form_config.Validate();
+
+  SHERPA_CHECK_GE(frame_bucket_size, 0);
 }
 
 std::string OfflineRecognizerConfig::ToString() const {
@@ -156,6 +233,8 @@ std::string OfflineRecognizerConfig::ToString() const {
   os << "OfflineRecognizerConfig(";
   os << "ctc_decoder_config=" << ctc_decoder_config.ToString() << ", ";
   os << "feat_config=" << feat_config.ToString() << ", ";
+  os << "warmup_config=" << warmup_config.ToString() << ", ";
+  os << "long_form_config=" << long_form_config.ToString() << ", ";
   os << "nn_model=\"" << nn_model << "\", ";
   os << "tokens=\"" << tokens << "\", ";
   os << "use_gpu=" << (use_gpu ? "True" : "False") << ", ";
@@ -163,7 +242,13 @@ std::string OfflineRecognizerConfig::ToString() const {
   os << "num_active_paths=" << num_active_paths << ", ";
   os << "context_score=" << context_score << ", ";
   os << "use_bbpe=" << (use_bbpe ? "True" : "False") << ", ";
-  os << "temperature=" << temperature << ")";
+  os << "temperature=" << temperature << ", ";
+  os << "use_bf16=" << (use_bf16 ? "True" : "False") << ", ";
+  os << "use_int8=" << (use_int8 ? "True" : "False") << ", ";
+  os << "freeze_model=" << (freeze_model ? "True" : "False") << ", ";
+  os << "model_cache_dir=\"" << model_cache_dir << "\", ";
+  os << "frame_bucket_size=" << frame_bucket_size << ", ";
+  os << "share_models=" << (share_models ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -177,17 +262,44 @@ std::ostream &operator<<(std::ostream &os,
 OfflineRecognizer::~OfflineRecognizer() = default;
 
 OfflineRecognizer::OfflineRecognizer(const OfflineRecognizerConfig &config) {
-  if (!config.nn_model.empty()) {
-    torch::jit::Module m = torch::jit::load(config.nn_model, torch::kCPU);
-    if (!m.hasattr("joiner")) {
-      // CTC models do not have a joint network
-      impl_ = std::make_unique<OfflineRecognizerCtcImpl>(config);
-      return;
-    }
+  torch::Device device(torch::kCPU);
+  if (config.use_gpu) {
+    device = torch::Device("cuda:0");
+  }
+
+  // If the model has been frozen by an earlier run, it is loaded from
+  // the cache instead of config.nn_model.
+  std::unique_ptr<ModuleOptimizer> optimizer;
+  torch::jit::Module m;
+  bool from_cache = false;
+  if (config.freeze_model) {
+    optimizer = std::make_unique<ModuleOptimizer>(
+        std::vector<std::string>{config.nn_model}, config.model_cache_dir,
+        device, config.use_int8);
+    from_cache = optimizer->LoadCache(&m);
+  }
+
+  // The model is loaded only once and is passed to the implementation
+  if (!from_cache) {
+    Timer timer;
+    m = LoadModule(config.nn_model, device, config.share_models,
+                   config.use_int8);
+    SHERPA_LOG(INFO) << "Loaded " << config.nn_model << " in "
+                     << timer.Elapsed() << " seconds";
+  }
+
+  segmenter_ = std::make_unique<AudioSegmenter>(config.long_form_config,
+                                                config.feat_config);
+
+  if (!m.hasattr("joiner")) {
+    // CTC models do not have a joint network
+    impl_ = std::make_unique<OfflineRecognizerCtcImpl>(config, std::move(m));
+    return;
   }
 
   // default to transducer
-  impl_ = std::make_unique<OfflineRecognizerTransducerImpl>(config);
+  impl_ = std::make_unique<OfflineRecognizerTransducerImpl>(
+      config, std::move(m), std::move(optimizer));
 }
 
 std::unique_ptr<OfflineStream> OfflineRecognizer::CreateStream() {
@@ -199,8 +311,129 @@ std::unique_ptr<OfflineStream> OfflineRecognizer::CreateStream(
   return impl_->CreateStream(context_list);
 }
 
+void OfflineRecognizer::SetDefaultContextList(
+    const std::vector<std::vector<int32_t>> &context_list) {
+  impl_->SetDefaultContextList(context_list);
+}
+
+void OfflineRecognizer::UpdateDefaultContextList(
+    const std::vector<std::vector<int32_t>> &add,
+    const std::vector<std::vector<int32_t>> &remove) {
+  impl_->UpdateDefaultContextList(add, remove);
+}
+
 void OfflineRecognizer::DecodeStreams(OfflineStream **ss, int32_t n) {
   impl_->DecodeStreams(ss, n);
 }
 
+// Append s to text. A space is inserted between them if both sides of the
+// boundary are ASCII, e.g., English words.
+static void AppendText(const std::string &s, std::string *text) {
+  if (s.empty()) {
+    return;
+  }
+
+  if (!text->empty()) {
+    unsigned char last = text->back();
+    unsigned char first = s.front();
+    if (last < 0x80 && first < 0x80 && !std::isspace(last) &&
+        !std::isspace(first)) {
+      text->push_back(' ');
+    }
+  }
+
+  text->append(s);
+}
+
+std::vector<OfflineRecognitionResult> OfflineRecognizer::DecodeLongForm(
+    const std::vector<torch::Tensor> &samples,
+    const FrameVad *vad /*= nullptr*/) {
+  struct Item {
+    int32_t index;  // index into samples
+    AudioSegment segment;
+  };
+
+  std::vector<torch::Tensor> inputs;
+  inputs.reserve(samples.size());
+
+  std::vector<Item> items;
+  int32_t num_recordings = samples.size();
+  for (int32_t i = 0; i != num_recordings; ++i) {
+    inputs.push_back(samples[i].to(torch::kCPU, torch::kFloat).contiguous());
+    for (const auto &s : segmenter_->Segment(inputs.back(), vad)) {
+      items.push_back({i, s});
+    }
+  }
+
+  // Sort by length so that segments in a batch need little padding
+  std::stable_sort(items.begin(), items.end(),
+                   [](const Item &a, const Item &b) {
+                     return a.segment.end - a.segment.start >
+                            b.segment.end - b.segment.start;
+                   });
+
+  std::vector<OfflineRecognitionResult> segment_results(items.size());
+  int32_t num_items = items.size();
+  int32_t batch_size = segmenter_->GetConfig().batch_size;
+  for (int32_t start = 0; start < num_items; start += batch_size) {
+    int32_t end = std::min(start + batch_size, num_items);
+
+    std::vector<std::unique_ptr<OfflineStream>> streams;
+    std::vector<OfflineStream *> ss;
+    std::vector<const float *> p_samples;
+    std::vector<int32_t> samples_length;
+    for (int32_t k = start; k != end; ++k) {
+      const auto &seg = items[k].segment;
+
+      streams.push_back(CreateStream());
+      ss.push_back(streams.back().get());
+      p_samples.push_back(inputs[items[k].index].data_ptr<float>() +
+                          seg.start);
+      samples_length.push_back(seg.end - seg.start);
+    }
+
+    // It does not modify the input samples
+    OfflineStream::AcceptSamples(ss.data(), p_samples.data(),
+                                 samples_length.data(), ss.size());
+
+    DecodeStreams(ss.data(), ss.size());
+
+    for (int32_t k = start; k != end; ++k) {
+      segment_results[k] = streams[k - start]->GetResult();
+    }
+  }
+
+  // Put the segments of each recording back in time order
+  std::vector<std::vector<int32_t>> order(num_recordings);
+  for (int32_t k = 0; k != num_items; ++k) {
+    order[items[k].index].push_back(k);
+  }
+
+  float sample_rate = segmenter_->GetSampleRate();
+  std::vector<OfflineRecognitionResult> ans(num_recordings);
+  for (int32_t i = 0; i != num_recordings; ++i) {
+    std::sort(order[i].begin(), order[i].end(), [&items](int32_t a, int32_t b) {
+      return items[a].segment.start < items[b].segment.start;
+    });
+
+    auto &r = ans[i];
+    for (int32_t k : order[i]) {
+      const auto &s = segment_results[k];
+      float offset = items[k].segment.start / sample_rate;
+
+      AppendText(s.text, &r.text);
+      r.tokens.insert(r.tokens.end(), s.tokens.begin(), s.tokens.end());
+      for (float t : s.timestamps) {
+        r.timestamps.push_back(t + offset);
+      }
+    }
+  }
+
+  return ans;
+}
+
+BucketStats OfflineRecognizer::GetBucketStats() const {
+  return impl_->GetBucketStats();
+}
+
 }  // namespace sherpa
@@ -9,10 +9,13 @@
 #include <string>
 #include <vector>
 
+#include "sherpa/cpp_api/audio-segmenter.h"
 #include "sherpa/cpp_api/fast-beam-search-config.h"
 #include "sherpa/cpp_api/feature-config.h"
 #include "sherpa/cpp_api/macros.h"
 #include "sherpa/cpp_api/offline-stream.h"
+#include "sherpa/cpp_api/warm-up-config.h"
+#include "sherpa/csrc/shape-bucketizer.h"
 
 namespace sherpa {
 
@@ -20,6 +23,9 @@ struct OfflineCtcDecoderConfig {
   // Used only for decoding with a CTC topology
   // true to use a modified CTC topology.
   // false to use a standard CTC topology.
+  //
+  // Note: Without an HLG, the one best path is found by greedy search,
+  // which gives the same result for both topologies.
   bool modified = true;
 
   // Used only for HLG decoding
@@ -31,6 +37,10 @@ struct OfflineCtcDecoderConfig {
   int32_t min_active_states = 30;
   int32_t max_active_states = 10000;
 
+  // Used only for prefix_beam_search. Only the top_k tokens of each
+  // frame are used to extend the prefixes.
+  int32_t top_k = 10;
+
   void Register(ParseOptions *po);
   void Validate() const;
   std::string ToString() const;
@@ -45,6 +55,11 @@ struct OfflineRecognizerConfig {
 
   FastBeamSearchConfig fast_beam_search_config;
 
+  WarmUpConfig warmup_config;
+
+  /// Used only by OfflineRecognizer::DecodeLongForm()
+  LongFormConfig long_form_config;
+
   /// Path to the torchscript model
   std::string nn_model;
 
@@ -62,10 +77,11 @@ struct OfflineRecognizerConfig {
 
   std::string decoding_method = "greedy_search";
 
-  /// used only for modified_beam_search
+  /// used only for modified_beam_search and prefix_beam_search.
+  /// prefix_beam_search is for CTC models only.
   int32_t num_active_paths = 4;
 
-  /// used only for modified_beam_search
+  /// used only for modified_beam_search and prefix_beam_search
   float context_score = 1.5;
 
   // True if the model used is trained with byte level bpe.
@@ -74,6 +90,30 @@ struct OfflineRecognizerConfig {
   // temperature for the softmax in the joiner
   float temperature = 1.0;
 
+  /// true to run the encoder under bfloat16 autocast. Supported only on CPU.
+  bool use_bf16 = false;
+
+  /// true to quantize the Linear layers of the model to int8 with dynamic
+  /// quantization after loading it. Supported only on CPU.
+  bool use_int8 = false;
+
+  /// true to freeze the encoder, decoder, and joiner with
+  /// torch::jit::freeze() and optimize them for inference.
+  bool freeze_model = false;
+
+  /// If not empty, frozen models are saved to this directory and
+  /// loaded from it in later runs. Used only when freeze_model is true.
+  std::string model_cache_dir;
+
+  /// If positive, the number of frames of a batch is padded to a multiple
+  /// of it, so that the encoder sees only a few distinct input shapes.
+  int32_t frame_bucket_size = 0;
+
+  /// true to get models, decoding graphs, and tokens from a process-wide
+  /// registry so that recognizers created with the same files share a
+  /// single copy of them. Frozen models (see freeze_model) are not shared.
+  bool share_models = false;
+
   void Register(ParseOptions *po);
 
   void Validate() const;
@@ -96,10 +136,33 @@ class OfflineRecognizer {
   /// Create a stream for decoding.
   std::unique_ptr<OfflineStream> CreateStream();
 
-  /// Create a stream with contextual-biasing lists.
+  /// Create a stream with contextual-biasing lists. For CTC models, they
+  /// are used only with decoding_method prefix_beam_search.
   std::unique_ptr<OfflineStream> CreateStream(
       const std::vector<std::vector<int32_t>> &context_list);
 
+  /** Set contextual-biasing phrases that are added to the phrases of all
+   * streams created afterwards, including streams created by
+   * CreateStream() without phrases. Pass an empty list to remove them.
+   *
+   * Streams with the same phrases share a single ContextGraph.
+   */
+  void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &context_list);
+
+  /** Add and remove default phrases. See SetDefaultContextList().
+   *
+   * The current default graph is patched instead of being rebuilt, so it
+   * is cheap to apply small changes to a large list. Streams created
+   * before keep using the previous graph.
+   *
+   * @param add  Phrases to add.
+   * @param remove  Phrases to remove. A phrase in both lists is kept.
+   */
+  void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove);
+
   /** Decode a single stream
    *
    * @param s The stream to decode.
@@ -116,8 +179,36 @@ class OfflineRecognizer {
    */
   void DecodeStreams(OfflineStream **ss, int32_t n);
 
+  /** Decode long-form audio, e.g., recordings that are hours long.
+   *
+   * Each recording is split at silences into segments no longer than
+   * config.long_form_config.max_segment_duration. Segments from all
+   * recordings are sorted by length and decoded in batches, so memory
+   * usage does not depend on the length of a recording. Results of the
+   * segments of a recording are concatenated in time order.
+   *
+   * @param samples  Audio samples of the recordings. Each is a 1-D float
+   *                 tensor normalized to the range [-1, 1]. Its sample
+   *                 rate should match the one from the feature extractor.
+   * @param vad  If not null, it is used to find speech from log mel
+   *             filterbank features. Otherwise, an EnergyVad is used.
+   *
+   * @return Return the results of the recordings. Timestamps are relative
+   *         to the start of each recording.
+   */
+  std::vector<OfflineRecognitionResult> DecodeLongForm(
+      const std::vector<torch::Tensor> &samples,
+      const FrameVad *vad = nullptr);
+
+  /** Return statistics about how often each frame bucket is used.
+   * All fields are 0 if config.frame_bucket_size is 0. Batches from
+   * the warm-up profile are not counted.
+   */
+  BucketStats GetBucketStats() const;
+
  private:
   std::unique_ptr<OfflineRecognizerImpl> impl_;
+  std::unique_ptr<AudioSegmenter> segmenter_;
 };
 
 }  // namespace sherpa
@@ -75,6 +75,22 @@ class OfflineStream {
    */
   void AcceptSamples(const float *samples, int32_t n);
 
+  /** Accept audio samples for a list of streams.
+   *
+   * It is equivalent to calling ss[i]->AcceptSamples(samples[i], n[i]) for
+   * each stream, except that features of all streams are computed in a
+   * single batch and that the input samples are not modified.
+   *
+   * @param ss  Pointer to an array of streams. They should be created by
+   *            the same recognizer.
+   * @param samples  samples[i] contains audio samples for ss[i]. They should
+   *                 be normalized to the range [-1, 1].
+   * @param n  n[i] is the number of audio samples in samples[i].
+   * @param num_streams  Number of streams.
+   */
+  static void AcceptSamples(OfflineStream **ss, const float *const *samples,
+                            const int32_t *n, int32_t num_streams);
+
   /** Create a stream from features.
    *
    * @param feature Pointer to the 2-D feature matrix of shape
@@ -4,14 +4,22 @@
 
 #include "sherpa/cpp_api/online-recognizer.h"
 
+#include <future>  // NOLINT
 #include <locale>
 #include <memory>
+#include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 #include "sherpa/csrc/byte_util.h"
+#include "sherpa/csrc/compress-state.h"
+#include "sherpa/csrc/context-graph-cache.h"
 #include "sherpa/csrc/file-utils.h"
 #include "sherpa/csrc/log.h"
+#include "sherpa/csrc/model-registry.h"
+#include "sherpa/csrc/module-optimizer.h"
 #include "sherpa/csrc/online-conformer-transducer-model.h"
 #include "sherpa/csrc/online-conv-emformer-transducer-model.h"
 #include "sherpa/csrc/online-emformer-transducer-model.h"
@@ -24,6 +32,8 @@
 #include "sherpa/csrc/online-zipformer-transducer-model.h"
 #include "sherpa/csrc/online-zipformer2-transducer-model.h"
 #include "sherpa/csrc/symbol-table.h"
+#include "sherpa/csrc/text-utils.h"
+#include "sherpa/csrc/timer.h"
 
 namespace sherpa {
 
@@ -57,7 +67,9 @@ std::string OnlineRecognitionResult::AsJsonString() const {
 void OnlineRecognizerConfig::Register(ParseOptions *po) {
   feat_config.Register(po);
   endpoint_config.Register(po);
+  vad_config.Register(po);
   fast_beam_search_config.Register(po);
+  warmup_config.Register(po);
 
   po->Register("nn-model", &nn_model, "Path to the torchscript model");
 
@@ -81,6 +93,11 @@ void OnlineRecognizerConfig::Register(ParseOptions *po) {
                "true to enable Endpoint, false to disable Endpoint, "
                "default is false.\n");
 
+  po->Register("use-vad", &use_vad,
+               "true to skip the encoder and the search for chunks that "
+               "contain only silence according to an energy-based VAD. "
+               "Used only for greedy_search and modified_beam_search.");
+
   po->Register("decoding-method", &decoding_method,
                "Decoding method to use. Possible values are: greedy_search, "
                "modified_beam_search, and fast_beam_search. "
@@ -125,6 +142,53 @@ void OnlineRecognizerConfig::Register(ParseOptions *po) {
   po->Register("temperature", &temperature,
                "Softmax temperature,. "
                "Used only when decoding_method is modified_beam_search.");
+
+  po->Register("blank-skip-threshold", &blank_skip_threshold,
+               "If larger than 0, frames with blank probability larger than "
+               "this value are decoded to blanks without running the joiner. "
+               "The blank probability is from the CTC head of the model. "
+               "It is ignored if the model has no CTC head. "
+               "A value close to 1, e.g., 0.95, is recommended. "
+               "Used only for greedy_search and modified_beam_search.");
+
+  po->Register("encoder-state-dtype", &encoder_state_dtype,
+               "dtype of the encoder states kept in each stream while it "
+               "is not being decoded. Possible values are: float32, float16, "
+               "bfloat16, int8. Use a value other than float32 to reduce "
+               "the memory used by each stream. int8 uses a per-tensor scale "
+               "and is supported only on CPU.");
+
+  po->Register("use-bf16", &use_bf16,
+               "true to run the encoder under bfloat16 autocast. "
+               "Supported only on CPU. It is faster on CPUs with native "
+               "bfloat16 support, e.g., with AVX512-BF16 or AMX.");
+
+  po->Register("use-int8", &use_int8,
+               "true to quantize the Linear layers of the model to int8 "
+               "after loading it. Weights are quantized ahead of time and "
+               "activations on the fly. Supported only on CPU. Other layers, "
+               "e.g., LSTM, are kept in float32.");
+
+  po->Register("freeze-model", &freeze_model,
+               "true to freeze the encoder, decoder, and joiner and optimize "
+               "them for inference. It requires PyTorch >= 1.10. Supported "
+               "only by transducer models.");
+
+  po->Register("model-cache-dir", &model_cache_dir,
+               "An existing directory to cache frozen models. The cache key "
+               "contains the hash of the model files, the PyTorch version, "
+               "and the CPU features. Used only when --freeze-model is true.");
+
+  po->Register("batch-buckets", &batch_buckets,
+               "Comma separated batch sizes, e.g., 1,2,4,8,16,32. If not "
+               "empty, streams to decode are padded with dummy streams up "
+               "to the nearest batch size from it so that the encoder sees "
+               "only a few distinct batch sizes.");
+
+  po->Register("share-models", &share_models,
+               "true to share models, decoding graphs, and tokens with other "
+               "recognizers in the same process that use the same files. "
+               "Models frozen by --freeze-model are not shared.");
 }
 
 void OnlineRecognizerConfig::Validate() const {
@@ -163,6 +227,50 @@ void OnlineRecognizerConfig::Validate() const {
   if (decoding_method == "modified_beam_search") {
     SHERPA_CHECK_GT(num_active_paths, 0);
   }
+
+  if (!IsValidStateDtype(encoder_state_dtype)) {
+    SHERPA_LOG(FATAL) << "Unsupported encoder state dtype: "
+                      << encoder_state_dtype
+                      << ". Supported values are: float32, float16, "
+                      << "bfloat16, int8.";
+  }
+
+  if (use_bf16) {
+    if (use_gpu) {
+      SHERPA_LOG(FATAL) << "--use-bf16 supports only CPU";
+    }
+#if !SHERPA_HAS_CPU_AUTOCAST
+    SHERPA_LOG(FATAL) << "--use-bf16 requires PyTorch >= 1.10";
+#endif
+  }
+
+  if (use_int8 && use_gpu) {
+    SHERPA_LOG(FATAL) << "--use-int8 supports only CPU";
+  }
+
+  if (!model_cache_dir.empty() && !freeze_model) {
+    SHERPA_LOG(WARNING) << "Ignore --model-cache-dir since --freeze-model is "
+                        << "false";
+  }
+
+  if (encoder_state_dtype == "int8" && use_gpu) {
+    SHERPA_LOG(FATAL) << "--encoder-state-dtype=int8 supports only CPU";
+  }
+
+  SHERPA_CHECK_GE(blank_skip_threshold, 0);
+  SHERPA_CHECK_LE(blank_skip_threshold, 1);
+
+  if (use_vad) {
+    if (decoding_method == "fast_beam_search") {
+      SHERPA_LOG(FATAL) << "--use-vad does not support fast_beam_search";
+    }
+    vad_config.Validate();
+  }
+
+  warmup_config.Validate();
+
+  // It aborts on invalid values
+  SplitToPositiveNumbers<int32_t>(batch_buckets, "batch-buckets");
 }
 
 std::string OnlineRecognizerConfig::ToString() const {
@@ -170,8 +278,10 @@ std::string OnlineRecognizerConfig::ToString() const {
   os << "OnlineRecognizerConfig(";
   os << "feat_config=" << feat_config.ToString() << ", ";
   os << "endpoint_config=" << endpoint_config.ToString() << ", ";
+  os << "vad_config=" << vad_config.ToString() << ", ";
   os << "fast_beam_search_config=" << fast_beam_search_config.ToString()
      << ", ";
+  os << "warmup_config=" << warmup_config.ToString() << ", ";
   os << "nn_model=\"" << nn_model << "\", ";
   os << "tokens=\"" << tokens << "\", ";
   os << "encoder_model=\"" << encoder_model << "\", ";
@@ -179,6 +289,7 @@ std::string OnlineRecognizerConfig::ToString() const {
   os << "joiner_model=\"" << joiner_model << "\", ";
   os << "use_gpu=" << (use_gpu ? "True" : "False") << "\", ";
   os << "use_endpoint=" << (use_endpoint ? "True" : "False") << "\", ";
+  os << "use_vad=" << (use_vad ? "True" : "False") << ", ";
   os << "decoding_method=\"" << decoding_method << "\", ";
   os << "num_active_paths=" << num_active_paths << ", ";
   os << "context_score=" << context_score << ", ";
@@ -186,7 +297,15 @@ std::string OnlineRecognizerConfig::ToString() const {
   os << "right_context=" << right_context << ", ";
   os << "chunk_size=" << chunk_size << ", ";
   os << "use_bbpe=" << (use_bbpe ? "True" : "False") << ", ";
-  os << "temperature=" << temperature << ")";
+  os << "temperature=" << temperature << ", ";
+  os << "blank_skip_threshold=" << blank_skip_threshold << ", ";
+  os << "encoder_state_dtype=\"" << encoder_state_dtype << "\", ";
+  os << "use_bf16=" << (use_bf16 ? "True" : "False") << ", ";
+  os << "use_int8=" << (use_int8 ? "True" : "False") << ", ";
+  os << "freeze_model=" << (freeze_model ? "True" : "False") << ", ";
+  os << "model_cache_dir=\"" << model_cache_dir << "\", ";
+  os << "batch_buckets=\"" << batch_buckets << "\", ";
+  os << "share_models=" << (share_models ? "True" : "False") << ")";
   return os.str();
 }
 
@@ -226,34 +345,115 @@ class OnlineRecognizer::OnlineRecognizerImpl {
  public:
   explicit OnlineRecognizerImpl(const OnlineRecognizerConfig &config)
       : config_(config),
-        symbol_table_(config.tokens),
-        endpoint_(std::make_unique<Endpoint>(config.endpoint_config)) {
+        context_graphs_(config.context_score),
+        endpoint_(std::make_unique<Endpoint>(config.endpoint_config)),
+        compress_state_(config.encoder_state_dtype != "float32") {
+    Timer total_timer;
     if (config.use_gpu) {
       device_ = torch::Device("cuda:0");
     }
 
+    if (config.use_vad) {
+      vad_ = std::make_unique<EnergyVad>(config.vad_config,
+                                         config.feat_config.normalize_samples);
+    }
+
+    if (!config.batch_buckets.empty()) {
+      batch_bucketizer_ = std::make_unique<ShapeBucketizer>(
+          SplitToPositiveNumbers<int32_t>(config.batch_buckets,
+                                          "batch-buckets"));
+    }
+
+    // Files that do not depend on each other are loaded in parallel.
+    // Each file is read only once.
+    Timer timer;
+    auto tokens = std::async(std::launch::async, [&config]() {
+      Timer timer;
+      auto sym = LoadSymbolTable(config.tokens, config.share_models);
+      return std::make_pair(std::move(sym), timer.Elapsed());
+    });
+
+    if (config.decoding_method == "fast_beam_search") {
+      config.fast_beam_search_config.Validate();
+    }
+
+    std::future<std::pair<k2::FsaClassPtr, double>> lg;
+    if (config.decoding_method == "fast_beam_search" &&
+        !config.fast_beam_search_config.lg.empty()) {
+      lg = std::async(std::launch::async, [this, &config]() {
+        Timer timer;
+        const auto &fbs_config = config.fast_beam_search_config;
+        auto g = LoadDecodingGraph(fbs_config.lg, device_,
+                                   fbs_config.ngram_lm_scale,
+                                   config.share_models);
+        return std::make_pair(g, timer.Elapsed());
+      });
+    }
+
+    // If the model has been frozen by an earlier run, it is loaded from
+    // the cache instead of the model files.
+    std::unique_ptr<ModuleOptimizer> optimizer;
+    torch::jit::Module cached;
+    bool from_cache = false;
+    if (config.freeze_model) {
+      std::vector<std::string> filenames;
+      if (config.nn_model.empty()) {
+        filenames = {config.encoder_model, config.decoder_model,
+                     config.joiner_model};
+      } else {
+        filenames = {config.nn_model};
+      }
+      optimizer = std::make_unique<ModuleOptimizer>(
+          filenames, config.model_cache_dir, device_, config.use_int8);
+      from_cache = optimizer->LoadCache(&cached);
+    }
+
     std::string class_name;
     if (config.nn_model.empty()) {
       // for torch.jit.trace
-      torch::jit::Module encoder =
-          torch::jit::load(config.encoder_model, torch::kCPU);
+      auto load = [this, &config](const std::string &filename) {
+        return std::async(std::launch::async, [this, &config, filename]() {
+          return LoadModule(filename, device_, config.share_models,
+                            config.use_int8);
+        });
+      };
+
+      torch::jit::Module encoder;
+      torch::jit::Module decoder;
+      torch::jit::Module joiner;
+      if (from_cache) {
+        encoder = cached.attr("encoder").toModule();
+        decoder = cached.attr("decoder").toModule();
+        joiner = cached.attr("joiner").toModule();
+      } else {
+        auto encoder_future = load(config.encoder_model);
+        auto decoder_future = load(config.decoder_model);
+        auto joiner_future = load(config.joiner_model);
+
+        encoder = encoder_future.get();
+        decoder = decoder_future.get();
+        joiner = joiner_future.get();
+      }
       class_name = encoder.type()->name()->name();
 
       if (class_name == "RNN") {
         // For OnlineLstmTransducerModel
         model_ = std::make_unique<OnlineLstmTransducerModel>(
-            config.encoder_model, config.decoder_model, config.joiner_model,
+            std::move(encoder), std::move(decoder), std::move(joiner),
             device_);
       } else if (class_name == "Zipformer") {
         // For OnlineZipformerTransducerModel
         // model generated by torch.jit.trace()
 
         model_ = std::make_unique<OnlineZipformerTransducerModel>(
-            config_.encoder_model, config.decoder_model, config.joiner_model,
+            std::move(encoder), std::move(decoder), std::move(joiner),
             device_);
       }
     } else {
-      torch::jit::Module m = torch::jit::load(config.nn_model, torch::kCPU);
+      torch::jit::Module m =
+          from_cache ? cached
+                     : LoadModule(config.nn_model, device_,
+                                  config.share_models, config.use_int8);
       auto encoder = m.attr("encoder").toModule();
       class_name = encoder.type()->name()->name();
 
@@ -261,11 +461,11 @@ class OnlineRecognizer::OnlineRecognizerImpl {
         if (encoder.find_method("infer")) {
           // Emformer from torchaudio
           model_ = std::make_unique<OnlineConvEmformerTransducerModel>(
-              config.nn_model, device_);
+              std::move(m), device_);
         } else {
           // ConvEmformer from icefall
           model_ = std::make_unique<OnlineEmformerTransducerModel>(
-              config.nn_model, device_);
+              std::move(m), device_);
         }
       } else if (class_name == "Conformer") {
         int32_t left_context = config.left_context;
@@ -276,19 +476,20 @@ class OnlineRecognizer::OnlineRecognizerImpl {
         SHERPA_CHECK_GT(chunk_size, 0);
 
         model_ = std::make_unique<OnlineConformerTransducerModel>(
-            config.nn_model, left_context, right_context, chunk_size, device_);
+            std::move(m), left_context, right_context, chunk_size, device_);
       } else if (class_name == "Zipformer") {
         // For OnlineZipformerTransducerModel
         // model generated by torch.jit.script()
         model_ = std::make_unique<OnlineZipformerTransducerModel>(
-            config.nn_model, device_);
+            std::move(m), device_);
       } else if (class_name == "StreamingEncoderModel") {
         // For OnlineZipformer2TransducerModel
         // model generated by torch.jit.script()
         model_ = std::make_unique<OnlineZipformer2TransducerModel>(
-            config.nn_model, device_);
+            std::move(m), device_);
       }
     }
+    double model_time = timer.Elapsed();
 
     if (!model_) {
       std::ostringstream os;
@@ -310,23 +511,59 @@ class OnlineRecognizer::OnlineRecognizerImpl {
       SHERPA_LOG(FATAL) << os.str();
     }
 
+    double freeze_time = 0;
+    if (optimizer) {
+      timer.Reset();
+      model_->OptimizeForInference(optimizer.get());
+      optimizer->SaveCache();
+      freeze_time = timer.Elapsed();
+    }
+
+    timer.Reset();
     WarmUp();
+    double warmup_time = timer.Elapsed();
+
+    double tokens_time;
+    std::tie(symbol_table_, tokens_time) = tokens.get();
+
+    k2::FsaClassPtr lg_graph;
+    double lg_time = 0;
+    if (lg.valid()) {
+      std::tie(lg_graph, lg_time) = lg.get();
+    }
+
+    if (config.blank_skip_threshold > 0 && !model_->HasCtcOutput() &&
+        (config.decoding_method == "greedy_search" ||
+         config.decoding_method == "modified_beam_search")) {
+      SHERPA_LOG(WARNING) << "The model has no CTC head. Ignore "
+                             "--blank-skip-threshold for "
+                          << config.decoding_method;
+    }
 
     if (config.decoding_method == "greedy_search") {
-      decoder_ =
-          std::make_unique<OnlineTransducerGreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<OnlineTransducerGreedySearchDecoder>(
+          model_.get(), config.blank_skip_threshold);
     } else if (config.decoding_method == "modified_beam_search") {
       decoder_ = std::make_unique<OnlineTransducerModifiedBeamSearchDecoder>(
-          model_.get(), config.num_active_paths, config.temperature);
+          model_.get(), config.num_active_paths, config.temperature,
+          config.blank_skip_threshold);
     } else if (config.decoding_method == "fast_beam_search") {
-      config.fast_beam_search_config.Validate();
-
       decoder_ = std::make_unique<OnlineTransducerFastBeamSearchDecoder>(
-          model_.get(), config.fast_beam_search_config);
+          model_.get(), config.fast_beam_search_config, lg_graph);
     } else {
       TORCH_CHECK(false,
                   "Unsupported decoding method: ", config.decoding_method);
     }
+
+    timer.Reset();
+    WarmUpWithProfile();
+    warmup_time += timer.Elapsed();
+
+    SHERPA_LOG(INFO) << "Startup time (seconds). model: " << model_time
+                     << ", tokens: " << tokens_time << ", LG: " << lg_time
+                     << ", freeze: " << freeze_time
+                     << ", warm-up: " << warmup_time
+                     << ", total: " << total_timer.Elapsed();
   }
 
   void InitOnlineStream(OnlineStream *stream) const {
@@ -343,28 +580,30 @@ class OnlineRecognizer::OnlineRecognizerImpl {
     stream->SetResult(r);
 
     auto state = model_->GetEncoderInitStates();
-    stream->SetState(state);
+    stream->SetState(CompressState(state, config_.encoder_state_dtype));
   }
 
-  std::unique_ptr<OnlineStream> CreateStream() {
-    auto s = std::make_unique<OnlineStream>(config_.feat_config);
-    InitOnlineStream(s.get());
-    return s;
-  }
+  std::unique_ptr<OnlineStream> CreateStream() { return CreateStream({}); }
 
   std::unique_ptr<OnlineStream> CreateStream(
       const std::vector<std::vector<int32_t>> &contexts) {
-    // We create context_graph at this level, because we might have default
-    // context_graph(will be added later if needed) that belongs to the whole
-    // model rather than each stream.
-    auto context_graph =
-        std::make_shared<ContextGraph>(contexts, config_.context_score);
     auto s = std::make_unique<OnlineStream>(config_.feat_config,
-                                            context_graph);
+                                            context_graphs_.Get(contexts));
     InitOnlineStream(s.get());
     return s;
   }
 
+  void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &contexts) {
+    context_graphs_.SetDefault(contexts);
+  }
+
+  void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove) {
+    context_graphs_.UpdateDefault(add, remove);
+  }
+
   bool IsReady(OnlineStream *s) {
     // TODO(fangjun): Pass chunk_size to OnlineStream on creation
     int32_t chunk_size = model_->ChunkSize();
@@ -380,16 +619,23 @@ class OnlineRecognizer::OnlineRecognizerImpl {
     int32_t chunk_size = model_->ChunkSize();
     int32_t chunk_shift = model_->ChunkShift();
 
-    std::vector<torch::Tensor> all_features(n);
-    std::vector<torch::IValue> all_states(n);
-    std::vector<int32_t> all_processed_frames(n);
-    std::vector<OnlineTransducerDecoderResult> all_results(n);
+    std::vector<torch::Tensor> all_features;
+    std::vector<torch::IValue> all_states;
+    std::vector<int32_t> all_processed_frames;
+    std::vector<OnlineTransducerDecoderResult> all_results;
+    // Streams whose current chunk is not skipped by the VAD
+    std::vector<OnlineStream *> active_streams;
+
+    all_features.reserve(n);
+    all_states.reserve(n);
+    all_processed_frames.reserve(n);
+    all_results.reserve(n);
+    active_streams.reserve(n);
+
     bool has_context_graph = false;
     for (int32_t i = 0; i != n; ++i) {
       OnlineStream *s = ss[i];
 
-      if (!has_context_graph && s->GetContextGraph()) has_context_graph = true;
-
       SHERPA_CHECK(IsReady(s));
       int32_t num_processed_frames = s->GetNumProcessedFrames();
 
@@ -400,17 +646,49 @@ class OnlineRecognizer::OnlineRecognizerImpl {
 
       torch::Tensor features = torch::cat(features_vec, /*dim*/ 0);
 
-      all_features[i] = std::move(features);
-      all_states[i] = s->GetState();
-      all_processed_frames[i] = num_processed_frames;
-      all_results[i] = s->GetResult();
+      if (vad_ && IsSilence(s, features)) {
+        SkipChunk(s);
+        continue;
+      }
+
+      if (!has_context_graph && s->GetContextGraph()) has_context_graph = true;
+
+      all_features.push_back(std::move(features));
+      if (compress_state_) {
+        all_states.push_back(DecompressState(s->GetState()));
+      } else {
+        all_states.push_back(s->GetState());
+      }
+      all_processed_frames.push_back(num_processed_frames);
+      all_results.push_back(s->GetResult());
+      active_streams.push_back(s);
     }  // for (int32_t i = 0; i != n; ++i) {
 
+    if (active_streams.empty()) {
+      return;
+    }
+
+    ss = active_streams.data();
+    n = active_streams.size();
+
+    // Pad the batch with copies of the last stream so that the encoder
+    // sees only the batch sizes from config_.batch_buckets.
+    // Outputs of the padded entries are discarded.
+    int32_t batch_size = n;
+    if (batch_bucketizer_) {
+      batch_size = batch_bucketizer_->Bucketize(n);
+      for (int32_t i = n; i != batch_size; ++i) {
+        all_features.push_back(all_features.back());
+        all_states.push_back(all_states.back());
+        all_processed_frames.push_back(all_processed_frames.back());
+      }
+    }
+
     auto batched_features = torch::stack(all_features, /*dim*/ 0);
     batched_features = batched_features.to(device);
 
     torch::Tensor features_length =
-        torch::full({n}, chunk_size, torch::kLong).to(device);
+        torch::full({batch_size}, chunk_size, torch::kLong).to(device);
 
     torch::IValue stacked_states = model_->StackStates(all_states);
     torch::Tensor processed_frames =
@@ -420,8 +698,23 @@ class OnlineRecognizer::OnlineRecognizerImpl {
     torch::Tensor encoder_out_lens;
     torch::IValue next_states;
 
-    std::tie(encoder_out, encoder_out_lens, next_states) = model_->RunEncoder(
-        batched_features, features_length, processed_frames, stacked_states);
+    {
+      CpuAutocastBf16 autocast(config_.use_bf16);
+      std::tie(encoder_out, encoder_out_lens, next_states) =
+          model_->RunEncoder(batched_features, features_length,
+                             processed_frames, stacked_states);
+    }
+
+    if (config_.use_bf16) {
+      // The decoder and the joiner run in float32. States are also
+      // kept in float32 so that they can be stacked with new streams.
+      encoder_out = encoder_out.to(torch::kFloat);
+      next_states = DecompressState(next_states);
+    }
+
+    if (batch_size != n) {
+      encoder_out = encoder_out.narrow(/*dim*/ 0, /*start*/ 0, /*length*/ n);
+    }
 
     if (has_context_graph) {
       decoder_->Decode(encoder_out, ss, n, &all_results);
@@ -436,7 +729,12 @@ class OnlineRecognizer::OnlineRecognizerImpl {
       OnlineStream *s = ss[i];
       all_results[i].num_processed_frames += chunk_shift;
       s->SetResult(all_results[i]);
-      s->SetState(std::move(unstacked_states[i]));
+      if (compress_state_) {
+        s->SetState(CompressState(unstacked_states[i],
+                                  config_.encoder_state_dtype));
+      } else {
+        s->SetState(std::move(unstacked_states[i]));
+      }
       s->GetNumProcessedFrames() += chunk_shift;  // TODO(fangjun): Remove it
     }
   }
@@ -444,17 +742,31 @@ class OnlineRecognizer::OnlineRecognizerImpl {
   OnlineRecognitionResult GetResult(OnlineStream *s) {
     auto r = s->GetResult();  // we use a copy here as we will change it below
 
-    // Caution: FinalizeResult should be invoked before StripLeadingBlanks.
-    bool is_endpoint = config_.use_endpoint && IsEndpoint(s);
+    // fast_beam_search traces back the lattice only once every
+    // traceback_interval chunks. Endpoints are checked only on those
+    // chunks so that num_trailing_blanks is up to date and we don't
+    // trace back the lattice of each stream here.
+    //
+    // Other decoding methods set num_trailing_blanks only in
+    // StripLeadingBlanks() below, so the stream keeps the value from the
+    // previous call.
+    bool is_endpoint = false;
+    if (config_.use_endpoint && r.num_pending_chunks == 0) {
+      if (config_.decoding_method == "fast_beam_search") {
+        s->GetNumTrailingBlankFrames() = r.num_trailing_blanks;
+      }
+      is_endpoint = IsEndpoint(s);
+    }
     bool is_final = !IsReady(s) && s->IsLastFrame(s->NumFramesReady() - 1);
 
+    // Caution: FinalizeResult should be invoked before StripLeadingBlanks.
     if (is_endpoint || is_final) {
       decoder_->FinalizeResult(s, &r);
     }
 
     decoder_->StripLeadingBlanks(&r);
 
-    auto ans = Convert(r, symbol_table_,
+    auto ans = Convert(r, *symbol_table_,
                        config_.feat_config.fbank_opts.frame_opts.frame_shift_ms,
                        model_->SubsamplingFactor(), config_.use_bbpe);
 
@@ -493,7 +805,47 @@ class OnlineRecognizer::OnlineRecognizerImpl {
 
   const OnlineRecognizerConfig &GetConfig() const { return config_; }
 
+  BucketStats GetBucketStats() const {
+    return batch_bucketizer_ ? batch_bucketizer_->GetStats() : BucketStats{};
+  }
+
  private:
+  // Return true if the given chunk of the stream can be skipped, i.e.,
+  // the chunk contains no speech and it is preceded by at least
+  // vad_config.min_silence_duration seconds of non-speech.
+  //
+  // @param s The stream.
+  // @param features A 2-D tensor of shape (chunk_size, feature_dim)
+  //                 containing the features of the current chunk.
+  bool IsSilence(OnlineStream *s, const torch::Tensor &features) const {
+    if (vad_->IsSpeech(features)) {
+      s->GetNumNonSpeechFrames() = 0;
+      return false;
+    }
+
+    const auto &frame_opts = config_.feat_config.fbank_opts.frame_opts;
+    int32_t min_silence_frames = config_.vad_config.min_silence_duration *
+                                 1000 / frame_opts.frame_shift_ms;
+
+    bool ans = s->GetNumNonSpeechFrames() >= min_silence_frames;
+    s->GetNumNonSpeechFrames() += model_->ChunkShift();
+    return ans;
+  }
+
+  // Advance the stream by one chunk without running the encoder.
+  // The skipped frames are treated as blanks so that endpointing and
+  // timestamps still work.
+  void SkipChunk(OnlineStream *s) const {
+    int32_t chunk_shift = model_->ChunkShift();
+
+    auto r = s->GetResult();
+    decoder_->SkipFrames(chunk_shift / model_->SubsamplingFactor(), &r);
+    r.num_processed_frames += chunk_shift;
+    s->SetResult(r);
+
+    s->GetNumProcessedFrames() += chunk_shift;
+  }
+
   void WarmUp() {
     SHERPA_LOG(INFO) << "WarmUp begins";
     torch::Tensor features =
@@ -503,7 +855,10 @@ class OnlineRecognizer::OnlineRecognizerImpl {
     torch::Tensor features_length =
         torch::full({features.size(0)}, model_->ChunkSize(), torch::kLong)
             .to(device_);
-    model_->WarmUp(features, features_length);
+    {
+      CpuAutocastBf16 autocast(config_.use_bf16);
+      model_->WarmUp(features, features_length);
+    }
 
 #if 0
     // We don't use the following code since we want to set `model_->vocab_size`
@@ -521,13 +876,108 @@ class OnlineRecognizer::OnlineRecognizerImpl {
     SHERPA_LOG(INFO) << "WarmUp ended";
   }
 
+  // Run the shapes from config_.warmup_config through the full decoding
+  // path, i.e., feature extraction, the encoder, and the decoder.
+  // For modified_beam_search, each value of num_active_paths from the
+  // profile uses a temporary decoder. The bucket statistics are cleared
+  // afterwards so that they cover only real inputs.
+  void WarmUpWithProfile() {
+    const auto &warmup_config = config_.warmup_config;
+    std::vector<int32_t> batch_sizes = warmup_config.GetBatchSizes();
+    if (batch_sizes.empty()) {
+      return;
+    }
+
+    std::vector<float> durations = warmup_config.GetDurations();
+    std::vector<int32_t> num_active_paths;
+    if (config_.decoding_method == "modified_beam_search") {
+      num_active_paths = warmup_config.GetNumActivePaths();
+    }
+
+    if (num_active_paths.empty()) {
+      // 0 means to use the decoder from the recognizer config
+      num_active_paths.push_back(0);
+    }
+
+    float sample_rate = config_.feat_config.fbank_opts.frame_opts.samp_freq;
+
+    auto decoder = std::move(decoder_);
+    for (auto n : num_active_paths) {
+      std::string tag;
+      if (n == 0) {
+        decoder_ = std::move(decoder);
+      } else {
+        decoder_ = std::make_unique<OnlineTransducerModifiedBeamSearchDecoder>(
+            model_.get(), n, config_.temperature,
+            config_.blank_skip_threshold);
+        tag = "num_active_paths: " + std::to_string(n) + ", ";
+      }
+
+      for (auto batch_size : batch_sizes) {
+        for (auto duration : durations) {
+          Timer timer;
+          int32_t num_samples = duration * sample_rate;
+
+          std::vector<std::unique_ptr<OnlineStream>> streams(batch_size);
+          for (auto &s : streams) {
+            // We use noise instead of silence so that non-blank tokens are
+            // decoded and the chunks are not skipped by the VAD
+            torch::Tensor samples =
+                torch::rand({num_samples}, torch::kFloat) - 0.5;
+
+            s = CreateStream();
+            s->AcceptWaveform(sample_rate, samples);
+            s->InputFinished();
+          }
+
+          std::vector<OnlineStream *> ready_streams;
+          while (true) {
+            ready_streams.clear();
+            for (auto &s : streams) {
+              if (IsReady(s.get())) {
+                ready_streams.push_back(s.get());
+              }
+            }
+
+            if (ready_streams.empty()) {
+              break;
+            }
+            DecodeStreams(ready_streams.data(), ready_streams.size());
+          }
+
+          SHERPA_LOG(INFO) << "WarmUp " << tag << "batch_size: " << batch_size
+                           << ", duration: " << duration
+                           << " s, time: " << timer.Elapsed() << " s";
+        }
+      }
+
+      if (n == 0) {
+        decoder = std::move(decoder_);
+      }
+    }
+    decoder_ = std::move(decoder);
+
+    if (batch_bucketizer_) {
+      batch_bucketizer_->ResetStats();
+    }
+  }
+
  private:
   OnlineRecognizerConfig config_;
+  ContextGraphCache context_graphs_;
   torch::Device device_{"cpu"};
   std::unique_ptr<OnlineTransducerModel> model_;
   std::unique_ptr<OnlineTransducerDecoder> decoder_;
-  SymbolTable symbol_table_;
+  std::shared_ptr<const SymbolTable> symbol_table_;
   std::unique_ptr<Endpoint> endpoint_;
+  std::unique_ptr<EnergyVad> vad_;  // Not null only if config_.use_vad
+
+  // Not null only if config_.batch_buckets is not empty
+  std::unique_ptr<ShapeBucketizer> batch_bucketizer_;
+
+  // true if encoder states are kept in streams with a dtype
+  // other than float32
+  bool compress_state_ = false;
 };
 
 OnlineRecognizer::OnlineRecognizer(const OnlineRecognizerConfig &config)
@@ -544,6 +994,17 @@ std::unique_ptr<OnlineStream> OnlineRecognizer::CreateStream(
   return impl_->CreateStream(contexts_list);
 }
 
+void OnlineRecognizer::SetDefaultContextList(
+    const std::vector<std::vector<int32_t>> &context_list) {
+  impl_->SetDefaultContextList(context_list);
+}
+
+void OnlineRecognizer::UpdateDefaultContextList(
+    const std::vector<std::vector<int32_t>> &add,
+    const std::vector<std::vector<int32_t>> &remove) {
+  impl_->UpdateDefaultContextList(add, remove);
+}
+
 bool OnlineRecognizer::IsReady(OnlineStream *s) { return impl_->IsReady(s); }
 
 bool OnlineRecognizer::IsEndpoint(OnlineStream *s) {
@@ -559,6 +1020,10 @@ OnlineRecognitionResult OnlineRecognizer::GetResult(OnlineStream *s) {
   return impl_->GetResult(s);
 }
 
+BucketStats OnlineRecognizer::GetBucketStats() const {
+  return impl_->GetBucketStats();
+}
+
 const OnlineRecognizerConfig &OnlineRecognizer::GetConfig() const {
   return impl_->GetConfig();
 }
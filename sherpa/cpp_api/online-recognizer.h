@@ -10,10 +10,13 @@
 #include <vector>
 
 #include "sherpa/cpp_api/endpoint.h"
+#include "sherpa/cpp_api/energy-vad.h"
 #include "sherpa/cpp_api/fast-beam-search-config.h"
 #include "sherpa/cpp_api/feature-config.h"
 #include "sherpa/cpp_api/macros.h"
 #include "sherpa/cpp_api/online-stream.h"
+#include "sherpa/cpp_api/warm-up-config.h"
+#include "sherpa/csrc/shape-bucketizer.h"
 
 namespace sherpa {
 
@@ -23,8 +26,12 @@ struct OnlineRecognizerConfig {
 
   EndpointConfig endpoint_config;
 
+  EnergyVadConfig vad_config;
+
   FastBeamSearchConfig fast_beam_search_config;
 
+  WarmUpConfig warmup_config;
+
   /// Path to the torchscript model
   std::string nn_model;
 
@@ -47,6 +54,10 @@ struct OnlineRecognizerConfig {
 
   bool use_endpoint = false;
 
+  /// true to skip the encoder for chunks without speech.
+  /// Used only for greedy_search and modified_beam_search.
+  bool use_vad = false;
+
   std::string decoding_method = "greedy_search";
 
   /// used only for modified_beam_search
@@ -76,6 +87,45 @@ struct OnlineRecognizerConfig {
   // temperature for the softmax in the joiner
   float temperature = 1.0;
 
+  // If larger than 0, encoder output frames whose blank probability is
+  // larger than this value are not sent to the joiner and are decoded
+  // to blanks. Used only for greedy_search and modified_beam_search.
+  //
+  // The blank probability is computed by the CTC head of the model. This
+  // option is ignored if the model has no CTC head.
+  float blank_skip_threshold = 0;
+
+  // dtype of the encoder states kept in a stream between two chunks.
+  // Possible values are: float32, float16, bfloat16, int8.
+  // States are converted back to float32 before they are stacked.
+  std::string encoder_state_dtype = "float32";
+
+  /// true to run the encoder under bfloat16 autocast. Supported only on CPU.
+  bool use_bf16 = false;
+
+  /// true to quantize the Linear layers of the model to int8 with dynamic
+  /// quantization after loading it. Supported only on CPU.
+  bool use_int8 = false;
+
+  /// true to freeze the encoder, decoder, and joiner with
+  /// torch::jit::freeze() and optimize them for inference.
+  bool freeze_model = false;
+
+  /// If not empty, frozen models are saved to this directory and
+  /// loaded from it in later runs. Used only when freeze_model is true.
+  std::string model_cache_dir;
+
+  /// Comma separated batch sizes, e.g., "1,2,4,8,16,32". If not empty,
+  /// the streams passed to DecodeStreams() are padded with dummy streams
+  /// up to the nearest batch size from it. Outputs of the dummy streams
+  /// are discarded.
+  std::string batch_buckets;
+
+  /// true to get models, decoding graphs, and tokens from a process-wide
+  /// registry so that recognizers created with the same files share a
+  /// single copy of them. Frozen models (see freeze_model) are not shared.
+  bool share_models = false;
+
   void Register(ParseOptions *po);
 
   void Validate() const;
@@ -103,6 +153,28 @@ class OnlineRecognizer {
   std::unique_ptr<OnlineStream> CreateStream(
       const std::vector<std::vector<int32_t>> &context_list);
 
+  /** Set context phrases that are added to the phrases of all streams
+   * created afterwards, including streams created by CreateStream()
+   * without phrases. Pass an empty list to remove them.
+   *
+   * Streams with the same phrases share a single ContextGraph.
+   */
+  void SetDefaultContextList(
+      const std::vector<std::vector<int32_t>> &context_list);
+
+  /** Add and remove default phrases. See SetDefaultContextList().
+   *
+   * The current default graph is patched instead of being rebuilt, so it
+   * is cheap to apply small changes to a large list. Streams created
+   * before keep using the previous graph.
+   *
+   * @param add  Phrases to add.
+   * @param remove  Phrases to remove. A phrase in both lists is kept.
+   */
+  void UpdateDefaultContextList(
+      const std::vector<std::vector<int32_t>> &add,
+      const std::vector<std::vector<int32_t>> &remove);
+
   /**
    * Return true if the given stream has enough frames for decoding.
    * Return false otherwise
@@ -130,6 +202,12 @@ class OnlineRecognizer {
 
   OnlineRecognitionResult GetResult(OnlineStream *s);
 
+  /** Return statistics about how often each batch bucket is used.
+   * All fields are 0 if config.batch_buckets is empty. Batches from
+   * the warm-up profile are not counted.
+   */
+  BucketStats GetBucketStats() const;
+
  private:
   class OnlineRecognizerImpl;
   std::unique_ptr<OnlineRecognizerImpl> impl_;
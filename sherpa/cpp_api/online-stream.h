@@ -93,6 +93,9 @@ class OnlineStream {
   void InputFinished();
 
   /**Get a frame by its index.
+   *
+   * Frames before GetNumProcessedFrames() are discarded when this function
+   * is called, so `frame` must not be less than GetNumProcessedFrames().
    *
    * @param frame  The frame number. It starts from 0.
    *
@@ -147,6 +150,36 @@ class OnlineStream {
   // Return Starting frame of this segment.
   int32_t &GetStartFrame();
 
+  // Used only when VAD is enabled in the recognizer.
+  //
+  // Return a reference to the number of consecutive non-speech frames
+  // (before subsampling) seen so far.
+  int32_t &GetNumNonSpeechFrames();
+
+  // Return the number of bytes used by the feature frames that are not
+  // discarded yet, the encoder state, and the decoder output of this stream.
+  int64_t MemoryFootprint() const;
+
+  /** Save the state of this stream into a binary blob.
+   *
+   * It includes the encoder state, the decoding result, the feature frames
+   * not processed yet, the samples buffered for feature extraction and
+   * resampling, and various counters. The context graph itself is not
+   * saved; only the positions of the hypotheses in it are.
+   *
+   * It is not supported for fast_beam_search.
+   */
+  std::string Serialize() const;
+
+  /** Restore the state saved by Serialize().
+   *
+   * It should be called on a new stream created by a recognizer with the
+   * same config and model as the one that created the saved stream.
+   * If the saved stream has a context graph, this stream must be created
+   * with the same contexts.
+   */
+  void Deserialize(const std::string &blob);
+
  private:
   class OnlineStreamImpl;
   std::unique_ptr<OnlineStreamImpl> impl_;
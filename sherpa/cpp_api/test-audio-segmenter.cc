@@ -0,0 +1,123 @@
+// sherpa/cpp_api/test-audio-segmenter.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/cpp_api/audio-segmenter.h"
+#include "sherpa/csrc/log.h"
+
+// It marks only the given frame as speech
+class OneFrameVad : public sherpa::FrameVad {
+ public:
+  explicit OneFrameVad(int32_t frame) : frame_(frame) {}
+
+  torch::Tensor DetectSpeech(const torch::Tensor &features) const override {
+    torch::Tensor ans = torch::zeros({features.size(0)}, torch::kBool);
+    ans[frame_] = true;
+    return ans;
+  }
+
+ private:
+  int32_t frame_;
+};
+
+int main() {
+  sherpa::FeatureConfig feat_config;
+  feat_config.fbank_opts.frame_opts.samp_freq = 16000;
+  float sample_rate = feat_config.fbank_opts.frame_opts.samp_freq;
+
+  sherpa::LongFormConfig config;
+  config.max_segment_duration = 10;
+  config.padding = 0;
+
+  sherpa::AudioSegmenter segmenter(config, feat_config);
+
+  {
+    std::cout << "===test silence===\n";
+    int32_t n = 5 * sample_rate;
+    torch::Tensor samples = torch::zeros({n});
+    auto segments = segmenter.Segment(samples);
+    SHERPA_CHECK(segments.empty());
+  }
+
+  {
+    std::cout << "===test speech separated by a long pause===\n";
+    // 4 s speech, 8 s silence, 4 s speech
+    int32_t n1 = 4 * sample_rate;
+    int32_t n2 = 8 * sample_rate;
+    torch::Tensor speech = torch::rand({n1}) - 0.5;
+    torch::Tensor silence = torch::zeros({n2});
+    torch::Tensor samples = torch::cat({speech, silence, speech});
+
+    auto segments = segmenter.Segment(samples);
+    for (const auto &s : segments) {
+      std::cout << s.start / sample_rate << " " << s.end / sample_rate << "\n";
+    }
+    SHERPA_CHECK_EQ(segments.size(), 2u);
+    SHERPA_CHECK_EQ(segments[0].start, 0);
+    SHERPA_CHECK_EQ(segments[1].end, samples.numel());
+  }
+
+  {
+    std::cout << "===test merging speech separated by short pauses===\n";
+    // 3 s speech, 0.6 s silence, 1 s speech, 5 s silence, 1 s speech.
+    // Only the first two are merged since the second pause is longer
+    // than max_merge_silence_duration.
+    int32_t n1 = 3 * sample_rate;
+    int32_t n2 = 1 * sample_rate;
+    int32_t n3 = 0.6 * sample_rate;
+    int32_t n4 = 5 * sample_rate;
+    torch::Tensor speech1 = torch::rand({n1}) - 0.5;
+    torch::Tensor speech2 = torch::rand({n2}) - 0.5;
+    torch::Tensor short_pause = torch::zeros({n3});
+    torch::Tensor long_pause = torch::zeros({n4});
+    torch::Tensor samples =
+        torch::cat({speech1, short_pause, speech2, long_pause, speech2});
+
+    auto segments = segmenter.Segment(samples);
+    for (const auto &s : segments) {
+      std::cout << s.start / sample_rate << " " << s.end / sample_rate << "\n";
+    }
+    SHERPA_CHECK_EQ(segments.size(), 2u);
+    SHERPA_CHECK_EQ(segments[0].start, 0);
+    SHERPA_CHECK_GE(segments[0].end, 4.6 * sample_rate);
+    SHERPA_CHECK_LT(segments[0].end, 5 * sample_rate);
+    SHERPA_CHECK_GT(segments[1].start, 9 * sample_rate);
+  }
+
+  {
+    std::cout << "===test long speech===\n";
+    // 25 s speech with a pause at 8 s
+    int32_t n = 25 * sample_rate;
+    torch::Tensor samples = torch::rand({n}) - 0.5;
+    samples.slice(0, 8 * sample_rate, 8.2 * sample_rate).zero_();
+
+    auto segments = segmenter.Segment(samples);
+    int32_t max_len = config.max_segment_duration * sample_rate;
+    int32_t expected_start = 0;
+    for (const auto &s : segments) {
+      std::cout << s.start / sample_rate << " " << s.end / sample_rate << "\n";
+      SHERPA_CHECK_EQ(s.start, expected_start);
+      SHERPA_CHECK_LE(s.end - s.start, max_len);
+      expected_start = s.end;
+    }
+    SHERPA_CHECK_EQ(expected_start, samples.numel());
+
+    // The first segment is cut at the pause
+    SHERPA_CHECK_GT(segments[0].end, 8 * sample_rate);
+    SHERPA_CHECK_LT(segments[0].end, 8.2 * sample_rate);
+  }
+
+  {
+    std::cout << "===test a segment shorter than a frame===\n";
+    // A single speech frame gives a segment of 160 samples, which is
+    // shorter than the 400 samples of a frame
+    int32_t n = 2 * sample_rate;
+    torch::Tensor samples = torch::rand({n}) - 0.5;
+
+    OneFrameVad vad(100);
+    auto segments = segmenter.Segment(samples, &vad);
+    SHERPA_CHECK(segments.empty());
+  }
+
+  return 0;
+}
@@ -32,6 +32,34 @@ int main(int argc, char *argv[]) {
     std::cout << s.GetResult().text << "\n";
   }
 
+  {
+    std::cout << "===test from samples of a batch===\n";
+    sherpa::FeatureConfig config;
+    config.fbank_opts.frame_opts.dither = 0;
+    kaldifeat::Fbank fbank(config.fbank_opts);
+
+    torch::Tensor samples1 = torch::rand({16000}, torch::kFloat);
+    torch::Tensor samples2 = torch::rand({8000}, torch::kFloat);
+
+    sherpa::OfflineStream s1(&fbank, config);
+    sherpa::OfflineStream s2(&fbank, config);
+    sherpa::OfflineStream *ss[2] = {&s1, &s2};
+    const float *p[2] = {samples1.data_ptr<float>(),
+                         samples2.data_ptr<float>()};
+    int32_t n[2] = {16000, 8000};
+    sherpa::OfflineStream::AcceptSamples(ss, p, n, 2);
+
+    sherpa::OfflineStream s3(&fbank, config);
+    s3.AcceptSamples(samples2.data_ptr<float>(), samples2.numel());
+
+    std::cout << "f1.sizes(): " << s1.GetFeatures().sizes() << "\n";
+    std::cout << "f2.sizes(): " << s2.GetFeatures().sizes() << "\n";
+    if (!torch::allclose(s2.GetFeatures(), s3.GetFeatures())) {
+      std::cerr << "Features from a batch differ from those of a stream\n";
+      return -1;
+    }
+  }
+
   {
     std::cout << "===test from features===\n";
     torch::Tensor features = torch::rand(
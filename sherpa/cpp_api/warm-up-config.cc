@@ -0,0 +1,71 @@
+// sherpa/cpp_api/warm-up-config.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/cpp_api/warm-up-config.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sherpa/cpp_api/parse-options.h"
+#include "sherpa/csrc/log.h"
+#include "sherpa/csrc/text-utils.h"
+
+namespace sherpa {
+
+void WarmUpConfig::Register(ParseOptions *po) {
+  po->Register("warmup-batch-sizes", &batch_sizes,
+               "Comma separated batch sizes for warm-up, e.g., 1,8,16,32. "
+               "Each of them is combined with each value of "
+               "--warmup-durations and run through the full decoding path "
+               "before the recognizer is used. If empty, only a single "
+               "chunk or utterance is used for warm-up.");
+
+  po->Register("warmup-durations", &durations,
+               "Comma separated utterance durations in seconds for warm-up, "
+               "e.g., 2,10,20. Used only when --warmup-batch-sizes is not "
+               "empty.");
+
+  po->Register("warmup-num-active-paths", &num_active_paths,
+               "Used only for modified_beam_search when "
+               "--warmup-batch-sizes is not empty. Comma separated values "
+               "of num_active_paths for warm-up, e.g., 1,4. If empty, "
+               "--num-active-paths is used.");
+}
+
+void WarmUpConfig::Validate() const {
+  // The following functions abort on invalid values
+  GetBatchSizes();
+
+  if (!batch_sizes.empty() && GetDurations().empty()) {
+    SHERPA_LOG(FATAL) << "Please provide --warmup-durations";
+  }
+
+  GetNumActivePaths();
+}
+
+std::string WarmUpConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "WarmUpConfig(";
+  os << "batch_sizes=\"" << batch_sizes << "\", ";
+  os << "durations=\"" << durations << "\", ";
+  os << "num_active_paths=\"" << num_active_paths << "\")";
+
+  return os.str();
+}
+
+std::vector<int32_t> WarmUpConfig::GetBatchSizes() const {
+  return SplitToPositiveNumbers<int32_t>(batch_sizes, "warmup-batch-sizes");
+}
+
+std::vector<float> WarmUpConfig::GetDurations() const {
+  return SplitToPositiveNumbers<float>(durations, "warmup-durations");
+}
+
+std::vector<int32_t> WarmUpConfig::GetNumActivePaths() const {
+  return SplitToPositiveNumbers<int32_t>(num_active_paths,
+                                         "warmup-num-active-paths");
+}
+
+}  // namespace sherpa
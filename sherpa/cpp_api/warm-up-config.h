@@ -0,0 +1,45 @@
+// sherpa/cpp_api/warm-up-config.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CPP_API_WARM_UP_CONFIG_H_
+#define SHERPA_CPP_API_WARM_UP_CONFIG_H_
+
+#include <string>
+#include <vector>
+
+namespace sherpa {
+
+class ParseOptions;
+
+// A warm-up profile. When a recognizer is created, each combination of
+// batch size, duration, and number of active paths is run through the full
+// decoding path so that TorchScript graphs are specialized before the first
+// request arrives.
+struct WarmUpConfig {
+  // Comma separated batch sizes, e.g., "1,8,16,32".
+  // If empty, only the default warm-up with a single chunk or utterance
+  // is run.
+  std::string batch_sizes;
+
+  // Comma separated utterance durations in seconds, e.g., "2,10,20".
+  std::string durations = "2";
+
+  // Used only for modified_beam_search. Comma separated values of
+  // num_active_paths, e.g., "1,4". If empty, the value from the recognizer
+  // config is used.
+  std::string num_active_paths;
+
+  void Register(ParseOptions *po);
+
+  void Validate() const;
+
+  std::string ToString() const;
+
+  std::vector<int32_t> GetBatchSizes() const;
+  std::vector<float> GetDurations() const;
+  std::vector<int32_t> GetNumActivePaths() const;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_WARM_UP_CONFIG_H_
@@ -5,6 +5,7 @@
 #include "sherpa/cpp_api/websocket/offline-websocket-server-impl.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -29,6 +30,25 @@ void OfflineWebsocketDecoderConfig::Register(ParseOptions *po) {
       "Max utterance length in seconds. If we receive an utterance "
       "longer than this value, we will reject the connection. "
       "If you have enough memory, you can select a large value for it.");
+
+  po->Register(
+      "max-batch-frames", &max_batch_frames,
+      "If positive, the number of feature frames of a batch after padding, "
+      "i.e., batch size x number of frames of the longest utterance in it, "
+      "does not exceed this value, unless the batch contains only one "
+      "utterance. Utterances of similar lengths are batched together. "
+      "It bounds the memory usage of a batch.");
+
+  po->Register("max-padding-ratio", &max_padding_ratio,
+               "Max ratio of padding frames to all frames of a batch. "
+               "Utterances that would exceed it are left for later "
+               "batches. 1 means no limit.");
+
+  po->Register("max-wait-ms", &max_wait_ms,
+               "If positive, a batch that is not full is decoded only after "
+               "its oldest utterance has waited for this number of "
+               "milliseconds, so that more utterances of similar lengths "
+               "can be batched together.");
 }
 
 void OfflineWebsocketDecoderConfig::Validate() const {
@@ -37,15 +57,119 @@ void OfflineWebsocketDecoderConfig::Validate() const {
   SHERPA_CHECK_GT(max_batch_size, 0);
 
   SHERPA_CHECK_GT(max_utterance_length, 0);
+
+  SHERPA_CHECK_GE(max_batch_frames, 0);
+
+  SHERPA_CHECK_GE(max_padding_ratio, 0);
+  SHERPA_CHECK_LE(max_padding_ratio, 1);
+
+  SHERPA_CHECK_GE(max_wait_ms, 0);
 }
 
 OfflineWebsocketDecoder::OfflineWebsocketDecoder(
     const OfflineWebsocketDecoderConfig &config, OfflineWebsocketServer *server)
-    : config_(config), server_(server), recognizer_(config.recognizer_config) {}
+    : config_(config),
+      timer_(server->GetWorkContext()),
+      server_(server),
+      recognizer_(config.recognizer_config) {
+  const auto &frame_opts = config.recognizer_config.feat_config.fbank_opts
+                               .frame_opts;
+  frame_shift_samples_ = std::max<int32_t>(
+      1, frame_opts.samp_freq * frame_opts.frame_shift_ms / 1000);
+}
 
 void OfflineWebsocketDecoder::Push(connection_hdl hdl, ConnectionDataPtr d) {
+  int32_t num_samples = d->expected_byte_size / sizeof(float);
+  int32_t num_frames = num_samples / frame_shift_samples_;
+
   std::lock_guard<std::mutex> lock(mutex_);
-  streams_.push_back({hdl, d});
+  streams_.push_back({hdl, d, num_frames, std::chrono::steady_clock::now()});
+}
+
+bool OfflineWebsocketDecoder::ShouldWaitLocked() const {
+  if (config_.max_wait_ms <= 0 ||
+      static_cast<int32_t>(streams_.size()) >= config_.max_batch_size) {
+    return false;
+  }
+
+  if (config_.max_batch_frames > 0) {
+    int64_t total_frames = 0;
+    for (const auto &item : streams_) {
+      total_frames += item.num_frames;
+    }
+
+    if (total_frames >= config_.max_batch_frames) {
+      // More items won't fit into the batch
+      return false;
+    }
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() -
+                 streams_.front().enqueue_time;
+  return elapsed < std::chrono::milliseconds(config_.max_wait_ms);
+}
+
+std::vector<int32_t> OfflineWebsocketDecoder::SelectBatchLocked() const {
+  int32_t n = streams_.size();
+  int32_t seed_frames = streams_.front().num_frames;
+
+  std::vector<int32_t> candidates;
+  candidates.reserve(n - 1);
+  for (int32_t i = 1; i != n; ++i) {
+    candidates.push_back(i);
+  }
+
+  // Items closer to the oldest one in length come first. For items of the
+  // same distance, older items come first.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [this, seed_frames](int32_t a, int32_t b) {
+                     return std::abs(streams_[a].num_frames - seed_frames) <
+                            std::abs(streams_[b].num_frames - seed_frames);
+                   });
+
+  std::vector<int32_t> selected = {0};
+  int32_t max_frames = seed_frames;
+  int64_t total_frames = seed_frames;
+
+  for (auto i : candidates) {
+    if (static_cast<int32_t>(selected.size()) >= config_.max_batch_size) {
+      break;
+    }
+
+    int32_t num_frames = streams_[i].num_frames;
+    int64_t new_max_frames = std::max(max_frames, num_frames);
+    int64_t padded_frames = new_max_frames * (selected.size() + 1);
+    int64_t new_total_frames = total_frames + num_frames;
+
+    if (config_.max_batch_frames > 0 &&
+        padded_frames > config_.max_batch_frames) {
+      continue;
+    }
+
+    if (padded_frames > 0 &&
+        1 - static_cast<float>(new_total_frames) / padded_frames >
+            config_.max_padding_ratio) {
+      continue;
+    }
+
+    selected.push_back(i);
+    max_frames = new_max_frames;
+    total_frames = new_total_frames;
+  }
+
+  std::sort(selected.begin(), selected.end());
+  return selected;
+}
+
+void OfflineWebsocketDecoder::ScheduleDecodeLocked(
+    std::chrono::steady_clock::duration delay) {
+  // It cancels the pending wait, if any
+  timer_.expires_after(delay);
+  timer_.async_wait([this](const asio::error_code &ec) {
+    if (!ec) {
+      Decode();
+    }
+  });
 }
 
 void OfflineWebsocketDecoder::Decode() {
@@ -54,8 +178,16 @@ void OfflineWebsocketDecoder::Decode() {
     return;
   }
 
-  int32_t size =
-      std::min(static_cast<int32_t>(streams_.size()), config_.max_batch_size);
+  if (ShouldWaitLocked()) {
+    auto elapsed = std::chrono::steady_clock::now() -
+                   streams_.front().enqueue_time;
+    ScheduleDecodeLocked(std::chrono::milliseconds(config_.max_wait_ms) -
+                         elapsed);
+    return;
+  }
+
+  std::vector<int32_t> indexes = SelectBatchLocked();
+  int32_t size = indexes.size();
 
   // We first lock the mutex for streams_, take items from it, and then
   // unlock the mutex; in doing so we don't need to lock the mutex to
@@ -66,28 +198,42 @@ void OfflineWebsocketDecoder::Decode() {
   // while we are still using it.
   std::vector<ConnectionDataPtr> connection_data(size);
 
+  for (int32_t i = 0; i != size; ++i) {
+    const auto &item = streams_[indexes[i]];
+    handles[i] = item.hdl;
+    connection_data[i] = item.d;
+  }
+
+  // Remove them from the back so that the indexes remain valid
+  for (int32_t i = size - 1; i >= 0; --i) {
+    streams_.erase(streams_.begin() + indexes[i]);
+  }
+
+  if (!streams_.empty()) {
+    // Let other threads decode the remaining items
+    asio::post(server_->GetWorkContext(), [this]() { Decode(); });
+  }
+
+  lock.unlock();
+
+  // Features are computed without holding the lock so that other threads
+  // can push and select items in the meantime. Features of all streams in
+  // the batch are computed at once.
   std::vector<const float *> samples(size);
   std::vector<int32_t> samples_length(size);
   std::vector<std::unique_ptr<OfflineStream>> ss(size);
   std::vector<OfflineStream *> p_ss(size);
 
   for (int32_t i = 0; i != size; ++i) {
-    auto &p = streams_.front();
-    handles[i] = p.first;
-    connection_data[i] = p.second;
-    streams_.pop_front();
-
-    auto samples =
-        reinterpret_cast<const float *>(&connection_data[i]->data[0]);
-    auto num_samples = connection_data[i]->expected_byte_size / sizeof(float);
-    auto s = recognizer_.CreateStream();
-    s->AcceptSamples(samples, num_samples);
-
-    ss[i] = std::move(s);
+    samples[i] = reinterpret_cast<const float *>(&connection_data[i]->data[0]);
+    samples_length[i] = connection_data[i]->expected_byte_size / sizeof(float);
+
+    ss[i] = recognizer_.CreateStream();
     p_ss[i] = ss[i].get();
   }
 
-  lock.unlock();
+  OfflineStream::AcceptSamples(p_ss.data(), samples.data(),
+                               samples_length.data(), size);
 
   // Note: DecodeStreams is thread-safe
   recognizer_.DecodeStreams(p_ss.data(), size);
@@ -5,6 +5,7 @@
 #ifndef SHERPA_CPP_API_WEBSOCKET_OFFLINE_WEBSOCKET_SERVER_IMPL_H_
 #define SHERPA_CPP_API_WEBSOCKET_OFFLINE_WEBSOCKET_SERVER_IMPL_H_
 
+#include <chrono>  // NOLINT
 #include <deque>
 #include <map>
 #include <memory>
@@ -50,6 +51,20 @@ struct OfflineWebsocketDecoderConfig {
 
   float max_utterance_length = 300;  // seconds
 
+  // If positive, the number of frames of a batch after padding, i.e.,
+  // batch_size * (number of frames of the longest utterance in the batch),
+  // does not exceed it unless the batch contains a single utterance.
+  int32_t max_batch_frames = 0;
+
+  // Max ratio of padding frames to the total number of frames of a batch.
+  // 1 means no limit.
+  float max_padding_ratio = 1;
+
+  // If positive, a batch that is not full is decoded only after its
+  // oldest utterance has waited for this number of milliseconds, so that
+  // more utterances of similar lengths can be batched together.
+  int32_t max_wait_ms = 0;
+
   void Register(ParseOptions *po);
   void Validate() const;
 };
@@ -79,6 +94,35 @@ class OfflineWebsocketDecoder {
 
   const OfflineWebsocketDecoderConfig &GetConfig() const { return config_; }
 
+ private:
+  struct Item {
+    connection_hdl hdl;
+    ConnectionDataPtr d;
+
+    // Number of feature frames of the utterance
+    int32_t num_frames;
+
+    // When it is put into the queue
+    std::chrono::steady_clock::time_point enqueue_time;
+  };
+
+  // Return true if the items in the queue are not enough for a full
+  // batch and we should wait for more.
+  // Must be called with mutex_ locked.
+  bool ShouldWaitLocked() const;
+
+  // Select items for the next batch and return their indexes in streams_
+  // in ascending order. The oldest item is always selected. Other items are
+  // selected in the order of how close their lengths are to the oldest one
+  // while the batch satisfies --max-batch-size, --max-batch-frames, and
+  // --max-padding-ratio.
+  // Must be called with mutex_ locked.
+  std::vector<int32_t> SelectBatchLocked() const;
+
+  // Schedule a call to Decode() after the given delay.
+  // Must be called with mutex_ locked.
+  void ScheduleDecodeLocked(std::chrono::steady_clock::duration delay);
+
  private:
   OfflineWebsocketDecoderConfig config_;
 
@@ -86,12 +130,17 @@ class OfflineWebsocketDecoder {
    * this queue, the worker threads will get items from this queue for
    * decoding.
    *
-   * Number of items to take from this queue is determined by
-   * `--max-batch-size`. If there are not enough items in the queue, we won't
-   * wait and take whatever we have for decoding.
+   * Items of a batch are selected by SelectBatchLocked(), so that
+   * utterances of similar lengths are decoded together. If there are not
+   * enough items in the queue, we wait at most `--max-wait-ms` before
+   * taking whatever we have for decoding.
    */
   std::mutex mutex_;
-  std::deque<std::pair<connection_hdl, ConnectionDataPtr>> streams_;
+  std::deque<Item> streams_;
+  asio::steady_timer timer_;
+
+  // Number of samples per feature frame
+  int32_t frame_shift_samples_;
 
   OfflineWebsocketServer *server_;  // Not owned
   OfflineRecognizer recognizer_;
@@ -114,6 +163,7 @@ class OfflineWebsocketServer {
                          const OfflineWebsocketDecoderConfig &decoder_config);
 
   asio::io_context &GetConnectionContext() { return io_conn_; }
+  asio::io_context &GetWorkContext() { return io_work_; }
   server &GetServer() { return server_; }
 
   void Run(uint16_t port);
@@ -29,6 +29,17 @@ sherpa-offline-websocket-server \
   --max-utterance-length=300 \
   --doc-root=../sherpa/bin/web \
   --log-file=./log.txt
+
+To batch utterances of similar lengths under a budget of feature frames:
+
+sherpa-offline-websocket-server \
+  --port=6006 \
+  --max-batch-size=32 \
+  --max-batch-frames=30000 \
+  --max-padding-ratio=0.3 \
+  --max-wait-ms=10 \
+  --nn-model=/path/to/cpu.jit \
+  --tokens=/path/to/tokens.txt
 )";
 
 int32_t main(int32_t argc, char *argv[]) {
@@ -4,6 +4,8 @@
 
 #include "sherpa/cpp_api/websocket/online-websocket-server-impl.h"
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "sherpa/csrc/file-utils.h"
@@ -52,11 +54,17 @@ void OnlineWebsocketServerConfig::Validate() const {
   }
 }
 
-OnlineWebsocketDecoder::OnlineWebsocketDecoder(OnlineWebsocketServer *server)
+OnlineWebsocketDecoder::OnlineWebsocketDecoder(
+    OnlineWebsocketServer *server,
+    std::unique_ptr<OnlineRecognizer> recognizer)
     : server_(server),
+      recognizer_(std::move(recognizer)),
       config_(server->GetConfig().decoder_config),
       timer_(server->GetWorkContext()) {
-  recognizer_ = std::make_unique<OnlineRecognizer>(config_.recognizer_config);
+  if (!recognizer_) {
+    recognizer_ =
+        std::make_unique<OnlineRecognizer>(config_.recognizer_config);
+  }
 }
 
 std::shared_ptr<Connection> OnlineWebsocketDecoder::GetOrCreateConnection(
@@ -208,14 +216,15 @@ void OnlineWebsocketDecoder::Decode() {
 
 OnlineWebsocketServer::OnlineWebsocketServer(
     asio::io_context &io_conn, asio::io_context &io_work,
-    const OnlineWebsocketServerConfig &config)
+    const OnlineWebsocketServerConfig &config,
+    std::unique_ptr<OnlineRecognizer> recognizer /*= nullptr*/)
     : config_(config),
       io_conn_(io_conn),
       io_work_(io_work),
       http_server_(config.doc_root),
       log_(config.log_file, std::ios::app),
       tee_(std::cout, log_),
-      decoder_(this) {
+      decoder_(this, std::move(recognizer)) {
   SetupLog();
 
   server_.init_asio(&io_conn_);
@@ -232,8 +241,23 @@ OnlineWebsocketServer::OnlineWebsocketServer(
       });
 }
 
-void OnlineWebsocketServer::Run(uint16_t port) {
+void OnlineWebsocketServer::Run(uint16_t port, bool reuse_port /*= false*/) {
   server_.set_reuse_addr(true);
+  if (reuse_port) {
+#ifdef SO_REUSEPORT
+    server_.set_tcp_pre_bind_handler(
+        [](std::shared_ptr<asio::ip::tcp::acceptor> acceptor) {
+          asio::error_code ec;
+          acceptor->set_option(
+              asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(
+                  true),
+              ec);
+          return ec;
+        });
+#else
+    SHERPA_LOG(FATAL) << "SO_REUSEPORT is not supported on this platform";
+#endif
+  }
   server_.listen(asio::ip::tcp::v4(), port);
   server_.start_accept();
   decoder_.Run();
@@ -69,8 +69,11 @@ class OnlineWebsocketDecoder {
  public:
   /**
    * @param server  Not owned.
+   * @param recognizer If not null, it is used for decoding. Otherwise, a
+   *                   recognizer is created from the config of the server.
    */
-  explicit OnlineWebsocketDecoder(OnlineWebsocketServer *server);
+  OnlineWebsocketDecoder(OnlineWebsocketServer *server,
+                         std::unique_ptr<OnlineRecognizer> recognizer);
 
   std::shared_ptr<Connection> GetOrCreateConnection(connection_hdl hdl);
 
@@ -124,11 +127,23 @@ struct OnlineWebsocketServerConfig {
 
 class OnlineWebsocketServer {
  public:
-  explicit OnlineWebsocketServer(asio::io_context &io_conn,  // NOLINT
-                                 asio::io_context &io_work,  // NOLINT
-                                 const OnlineWebsocketServerConfig &config);
+  /**
+   * @param recognizer If not null, it is used for decoding, e.g., a
+   *                   recognizer created before forking workers.
+   *                   Otherwise, one is created from the given config.
+   */
+  OnlineWebsocketServer(asio::io_context &io_conn,  // NOLINT
+                        asio::io_context &io_work,  // NOLINT
+                        const OnlineWebsocketServerConfig &config,
+                        std::unique_ptr<OnlineRecognizer> recognizer = nullptr);
 
-  void Run(uint16_t port);
+  /**
+   * @param port The port to listen on.
+   * @param reuse_port true to set SO_REUSEPORT so that several processes
+   *                   can listen on the same port. The kernel distributes
+   *                   new connections among them.
+   */
+  void Run(uint16_t port, bool reuse_port = false);
 
   const OnlineWebsocketServerConfig &GetConfig() const { return config_; }
   asio::io_context &GetConnectionContext() { return io_conn_; }
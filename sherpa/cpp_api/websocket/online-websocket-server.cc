@@ -2,8 +2,15 @@
 //
 // Copyright (c)  2022  Xiaomi Corporation
 
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
 #include "asio.hpp"
 #include "sherpa/cpp_api/websocket/online-websocket-server-impl.h"
+#include "sherpa/cpp_api/websocket/prefork.h"
 #include "sherpa/csrc/log.h"
 #include "torch/all.h"
 
@@ -22,61 +29,33 @@ sherpa-online-websocket-server \
   --tokens=/path/to/tokens.txt \
   --decoding-method=greedy_search \
   --log-file=./log.txt
-)";
-
-int32_t main(int32_t argc, char *argv[]) {
-  torch::set_num_threads(1);
-  torch::set_num_interop_threads(1);
-  sherpa::InferenceMode no_grad;
-
-  torch::jit::getExecutorMode() = false;
-  torch::jit::getProfilingMode() = false;
-  torch::jit::setGraphExecutorOptimize(false);
-
-  sherpa::ParseOptions po(kUsageMessage);
-
-  sherpa::OnlineWebsocketServerConfig config;
-
-  // the server will listen on this port, for both websocket and http
-  int32_t port = 6006;
-
-  // size of the thread pool for handling network connections
-  int32_t num_io_threads = 1;
-
-  // size of the thread pool for neural network computation and decoding
-  int32_t num_work_threads = 5;
-
-  po.Register("num-io-threads", &num_io_threads,
-              "Number of threads to use for network connections.");
-
-  po.Register("num-work-threads", &num_work_threads,
-              "Number of threads to use for neural network "
-              "computation and decoding.");
-
-  po.Register("port", &port, "The port on which the server will listen.");
-
-  config.Register(&po);
-
-  if (argc == 1) {
-    po.PrintUsage();
-    exit(EXIT_FAILURE);
-  }
-
-  po.Read(argc, argv);
 
-  if (po.NumArgs() != 0) {
-    SHERPA_LOG(ERROR) << "Unrecognized positional arguments!";
-    po.PrintUsage();
-    exit(EXIT_FAILURE);
-  }
+To load the model once and serve with 4 worker processes:
 
-  config.Validate();
+sherpa-online-websocket-server \
+  --port=6006 \
+  --num-workers=4 \
+  --num-work-threads=2 \
+  --nn-model=/path/to/cpu.jit \
+  --tokens=/path/to/tokens.txt
+)";
 
+// Run the server in the calling process until it is stopped.
+//
+// @param recognizer If not null, it is used by the server. Otherwise, the
+//                   server creates one from the config.
+// @param reuse_port true to listen with SO_REUSEPORT.
+static int32_t RunServer(const sherpa::OnlineWebsocketServerConfig &config,
+                         int32_t port, int32_t num_io_threads,
+                         int32_t num_work_threads,
+                         std::unique_ptr<sherpa::OnlineRecognizer> recognizer,
+                         bool reuse_port) {
   asio::io_context io_conn;  // for network connections
   asio::io_context io_work;  // for neural network and decoding
 
-  sherpa::OnlineWebsocketServer server(io_conn, io_work, config);
-  server.Run(port);
+  sherpa::OnlineWebsocketServer server(io_conn, io_work, config,
+                                      std::move(recognizer));
+  server.Run(port, reuse_port);
 
   SHERPA_LOG(INFO) << "Listening on: " << port << "\n";
   // SHERPA_LOG(INFO) << "Number of I/O threads: " << num_io_threads << "\n";
@@ -130,3 +109,90 @@ int32_t main(int32_t argc, char *argv[]) {
 
   return 0;
 }
+
+int32_t main(int32_t argc, char *argv[]) {
+  torch::set_num_threads(1);
+  torch::set_num_interop_threads(1);
+  sherpa::InferenceMode no_grad;
+
+  torch::jit::getExecutorMode() = false;
+  torch::jit::getProfilingMode() = false;
+  torch::jit::setGraphExecutorOptimize(false);
+
+  sherpa::ParseOptions po(kUsageMessage);
+
+  sherpa::OnlineWebsocketServerConfig config;
+
+  // the server will listen on this port, for both websocket and http
+  int32_t port = 6006;
+
+  // size of the thread pool for handling network connections
+  int32_t num_io_threads = 1;
+
+  // size of the thread pool for neural network computation and decoding
+  int32_t num_work_threads = 5;
+
+  // number of worker processes. 0 means to serve in the current process
+  int32_t num_workers = 0;
+
+  po.Register("num-io-threads", &num_io_threads,
+              "Number of threads to use for network connections.");
+
+  po.Register("num-work-threads", &num_work_threads,
+              "Number of threads to use for neural network "
+              "computation and decoding.");
+
+  po.Register("port", &port, "The port on which the server will listen.");
+
+  po.Register("num-workers", &num_workers,
+              "If positive, models are loaded once and this number of "
+              "worker processes are forked to serve requests on the same "
+              "port with SO_REUSEPORT. Workers share the model weights via "
+              "copy-on-write memory and are restarted if they exit. "
+              "Each worker uses --num-io-threads and --num-work-threads "
+              "threads. Supported only on CPU and not on Windows.");
+
+  config.Register(&po);
+
+  if (argc == 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() != 0) {
+    SHERPA_LOG(ERROR) << "Unrecognized positional arguments!";
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  config.Validate();
+  SHERPA_CHECK_GE(num_workers, 0);
+
+  if (num_workers == 0) {
+    return RunServer(config, port, num_io_threads, num_work_threads,
+                     /*recognizer*/ nullptr, /*reuse_port*/ false);
+  }
+
+  // Prefork mode: Models are loaded and warmed up only once here and
+  // workers share them via copy-on-write memory.
+  if (config.decoder_config.recognizer_config.use_gpu) {
+    // CUDA cannot be used in a child process once it is initialized
+    // in the parent process
+    SHERPA_LOG(FATAL) << "--num-workers supports only CPU";
+  }
+
+  auto recognizer = std::make_unique<sherpa::OnlineRecognizer>(
+      config.decoder_config.recognizer_config);
+
+  SHERPA_LOG(INFO) << "Number of worker processes: " << num_workers;
+
+  return sherpa::RunPreforkWorkers(
+      num_workers, [&](int32_t worker_id) -> int32_t {
+        SHERPA_LOG(INFO) << "Worker " << worker_id << " started";
+        // Each worker has its own copy of `recognizer` after fork()
+        return RunServer(config, port, num_io_threads, num_work_threads,
+                         std::move(recognizer), /*reuse_port*/ true);
+      });
+}
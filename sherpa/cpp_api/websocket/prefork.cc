@@ -0,0 +1,160 @@
+// sherpa/cpp_api/websocket/prefork.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/cpp_api/websocket/prefork.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <thread>  // NOLINT
+
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+#ifndef _WIN32
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnStopSignal(int32_t /*sig*/) { g_stop = 1; }
+
+// Return the pid of the worker. It returns only in the calling process.
+static pid_t ForkWorker(int32_t worker_id,
+                        const std::function<int32_t(int32_t)> &worker) {
+  // Flush buffered output so that it is not written again by the worker
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    SHERPA_LOG(FATAL) << "Failed to fork worker " << worker_id << ": "
+                      << strerror(errno);
+  }
+
+  if (pid > 0) {
+    return pid;
+  }
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+
+#ifdef __linux__
+  // So that the worker does not outlive the supervisor
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+
+  int32_t status = worker(worker_id);
+
+  std::cout.flush();
+  std::cerr.flush();
+  _exit(status);
+}
+
+int32_t RunPreforkWorkers(int32_t num_workers,
+                          const std::function<int32_t(int32_t)> &worker) {
+  SHERPA_CHECK_GT(num_workers, 0);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = OnStopSignal;
+  sigemptyset(&sa.sa_mask);
+  // No SA_RESTART so that waitpid() below is interrupted by the signal
+  sa.sa_flags = 0;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  struct WorkerInfo {
+    int32_t id;
+    std::chrono::steady_clock::time_point start_time;
+  };
+
+  // pid -> worker info
+  std::map<pid_t, WorkerInfo> workers;
+  for (int32_t i = 0; i != num_workers; ++i) {
+    pid_t pid = ForkWorker(i, worker);
+    workers[pid] = {i, std::chrono::steady_clock::now()};
+  }
+  SHERPA_LOG(INFO) << "Started " << num_workers << " workers";
+
+  while (!g_stop) {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      SHERPA_LOG(FATAL) << "waitpid() failed: " << strerror(errno);
+    }
+
+    auto it = workers.find(pid);
+    if (it == workers.end()) {
+      continue;
+    }
+
+    WorkerInfo info = it->second;
+    workers.erase(it);
+
+    if (WIFSIGNALED(status)) {
+      SHERPA_LOG(WARNING) << "Worker " << info.id << " (pid " << pid
+                          << ") was killed by signal " << WTERMSIG(status);
+    } else {
+      SHERPA_LOG(WARNING) << "Worker " << info.id << " (pid " << pid
+                          << ") exited with status " << WEXITSTATUS(status);
+    }
+
+    if (g_stop) {
+      break;
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - info.start_time;
+    if (elapsed < std::chrono::seconds(1)) {
+      // Don't restart a worker that fails at startup in a busy loop
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    pid_t new_pid = ForkWorker(info.id, worker);
+    workers[new_pid] = {info.id, std::chrono::steady_clock::now()};
+    SHERPA_LOG(INFO) << "Restarted worker " << info.id << " (pid " << new_pid
+                     << ")";
+  }
+
+  SHERPA_LOG(INFO) << "Stopping " << workers.size() << " workers";
+  for (const auto &p : workers) {
+    kill(p.first, SIGTERM);
+  }
+
+  for (const auto &p : workers) {
+    while (waitpid(p.first, nullptr, 0) < 0 && errno == EINTR) {
+    }
+  }
+
+  return 0;
+}
+
+#else
+
+int32_t RunPreforkWorkers(int32_t /*num_workers*/,
+                          const std::function<int32_t(int32_t)> & /*worker*/) {
+  SHERPA_LOG(FATAL) << "Prefork workers are not supported on Windows";
+  return -1;
+}
+
+#endif
+
+}  // namespace sherpa
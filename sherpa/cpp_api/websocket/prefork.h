@@ -0,0 +1,41 @@
+// sherpa/cpp_api/websocket/prefork.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#ifndef SHERPA_CPP_API_WEBSOCKET_PREFORK_H_
+#define SHERPA_CPP_API_WEBSOCKET_PREFORK_H_
+
+#include <cstdint>
+#include <functional>
+
+namespace sherpa {
+
+/** Run `worker` in `num_workers` processes forked from the calling process
+ * and supervise them.
+ *
+ * Workers inherit the memory of the calling process copy-on-write, so
+ * read-only data created before calling this function, e.g., model weights,
+ * is stored only once no matter how many workers there are.
+ *
+ * Only the calling thread exists in a worker after fork(), so workers have
+ * to start their own threads. Do not initialize CUDA before calling it.
+ *
+ * A worker that exits, e.g., because it crashes, is restarted. When the
+ * calling process receives SIGINT or SIGTERM, it sends SIGTERM to all
+ * workers and returns after all of them have exited.
+ *
+ * Not supported on Windows.
+ *
+ * @param num_workers Number of worker processes. Must be positive.
+ * @param worker It is run in each worker with the worker index in the
+ *               range [0, num_workers). Its return value is used as
+ *               the exit status of the worker.
+ *
+ * @return Return 0.
+ */
+int32_t RunPreforkWorkers(int32_t num_workers,
+                          const std::function<int32_t(int32_t)> &worker);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CPP_API_WEBSOCKET_PREFORK_H_
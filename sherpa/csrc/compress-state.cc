@@ -0,0 +1,104 @@
+// sherpa/csrc/compress-state.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/compress-state.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+// Apply the given function to each tensor in the state, keeping
+// its structure.
+static torch::IValue Map(
+    const torch::IValue &state,
+    const std::function<torch::Tensor(const torch::Tensor &)> &f) {
+  if (state.isTensor()) {
+    return f(state.toTensor());
+  }
+
+  if (state.isTuple()) {
+    const auto &elements = state.toTuple()->elements();
+    std::vector<torch::IValue> ans;
+    ans.reserve(elements.size());
+    for (const auto &e : elements) {
+      ans.push_back(Map(e, f));
+    }
+    return torch::ivalue::Tuple::create(std::move(ans));
+  }
+
+  if (state.isList()) {
+    // copy() keeps the element type of the list, which is checked
+    // by c10::impl::toTypedList() in StackStates()
+    torch::List<torch::IValue> list = state.toList().copy();
+    for (size_t i = 0; i != list.size(); ++i) {
+      list.set(i, Map(list.get(i), f));
+    }
+    return list;
+  }
+
+  return state;
+}
+
+static torch::Tensor QuantizeInt8(const torch::Tensor &t) {
+  float max_abs = t.abs().max().item<float>();
+  double scale = max_abs > 0 ? max_abs / 127 : 1;
+  return torch::quantize_per_tensor(t, scale, /*zero_point*/ 0, torch::kQInt8);
+}
+
+bool IsValidStateDtype(const std::string &dtype) {
+  return dtype == "float32" || dtype == "float16" || dtype == "bfloat16" ||
+         dtype == "int8";
+}
+
+torch::IValue CompressState(const torch::IValue &state,
+                            const std::string &dtype) {
+  if (dtype == "float32") {
+    return state;
+  }
+
+  std::function<torch::Tensor(const torch::Tensor &)> f;
+  if (dtype == "float16") {
+    f = [](const torch::Tensor &t) { return t.to(torch::kHalf); };
+  } else if (dtype == "bfloat16") {
+    f = [](const torch::Tensor &t) { return t.to(torch::kBFloat16); };
+  } else if (dtype == "int8") {
+    f = QuantizeInt8;
+  } else {
+    SHERPA_LOG(FATAL) << "Unsupported dtype for encoder states: " << dtype
+                      << ". Supported values are: float32, float16, "
+                      << "bfloat16, int8";
+  }
+
+  return Map(state, [&f](const torch::Tensor &t) {
+    if (!t.defined() || t.scalar_type() != torch::kFloat || t.numel() == 0) {
+      return t;
+    }
+    return f(t);
+  });
+}
+
+torch::IValue DecompressState(const torch::IValue &state) {
+  return Map(state, [](const torch::Tensor &t) {
+    if (!t.defined()) {
+      return t;
+    }
+
+    if (t.is_quantized()) {
+      return t.dequantize();
+    }
+
+    if (t.scalar_type() == torch::kHalf ||
+        t.scalar_type() == torch::kBFloat16) {
+      return t.to(torch::kFloat);
+    }
+
+    return t;
+  });
+}
+
+}  // namespace sherpa
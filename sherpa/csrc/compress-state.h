@@ -0,0 +1,44 @@
+// sherpa/csrc/compress-state.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_COMPRESS_STATE_H_
+#define SHERPA_CSRC_COMPRESS_STATE_H_
+
+#include <string>
+
+#include "torch/script.h"
+
+namespace sherpa {
+
+/** Return true if the given dtype is supported by CompressState().
+ *
+ * Supported values are: float32, float16, bfloat16, int8.
+ */
+bool IsValidStateDtype(const std::string &dtype);
+
+/** Convert float32 tensors in the given encoder state to a lower precision.
+ *
+ * It is used to reduce the memory of a stream while it is not being decoded.
+ * Tensors of other dtypes, e.g., int64 for cached lengths, are not changed.
+ *
+ * @param state  The encoder state of a single stream. It can be a tensor,
+ *               or a tuple/list containing tensors, tuples, and lists.
+ * @param dtype  float32, float16, bfloat16, or int8. For int8, each tensor
+ *               is quantized with a per-tensor scale. For float32, the
+ *               input state is returned unchanged.
+ *
+ * @return Return a state with the same structure as the input state.
+ */
+torch::IValue CompressState(const torch::IValue &state,
+                            const std::string &dtype);
+
+/** Convert tensors compressed by CompressState() back to float32.
+ *
+ * @param state  A state returned by CompressState().
+ * @return Return a state that can be passed to StackStates() of a model.
+ */
+torch::IValue DecompressState(const torch::IValue &state);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_COMPRESS_STATE_H_
@@ -0,0 +1,197 @@
+// sherpa/csrc/context-graph-cache.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/context-graph-cache.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace sherpa {
+
+// Return the sorted and unique non-empty phrases of the given lists
+static std::vector<std::vector<int32_t>> Normalize(
+    const std::vector<std::vector<int32_t>> &a,
+    const std::vector<std::vector<int32_t>> &b) {
+  std::vector<std::vector<int32_t>> ans;
+  ans.reserve(a.size() + b.size());
+  for (const auto *list : {&a, &b}) {
+    for (const auto &phrase : *list) {
+      if (!phrase.empty()) {
+        ans.push_back(phrase);
+      }
+    }
+  }
+
+  std::sort(ans.begin(), ans.end());
+  ans.erase(std::unique(ans.begin(), ans.end()), ans.end());
+  return ans;
+}
+
+// FNV-1a hash. The length of each phrase is included so that, e.g.,
+// [[1, 2]] and [[1], [2]] have different hashes.
+static uint64_t Hash(const std::vector<std::vector<int32_t>> &phrases) {
+  uint64_t h = 14695981039346656037ULL;
+  auto update = [&h](uint64_t v) {
+    h ^= v;
+    h *= 1099511628211ULL;
+  };
+
+  for (const auto &phrase : phrases) {
+    update(phrase.size());
+    for (auto token : phrase) {
+      update(static_cast<uint32_t>(token));
+    }
+  }
+  return h;
+}
+
+void ContextGraphCache::SetDefault(
+    const std::vector<std::vector<int32_t>> &context_list) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+
+  auto phrases = Normalize(context_list, {});
+  ContextGraphPtr graph;
+  if (!phrases.empty()) {
+    graph = std::make_shared<ContextGraph>(phrases, context_score_);
+  }
+
+  ReplaceDefault(std::move(phrases), std::move(graph));
+}
+
+void ContextGraphCache::UpdateDefault(
+    const std::vector<std::vector<int32_t>> &add,
+    const std::vector<std::vector<int32_t>> &remove) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+
+  std::vector<std::vector<int32_t>> phrases;
+  ContextGraphPtr graph;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phrases = default_phrases_;
+    graph = default_graph_;
+  }
+
+  auto to_remove = Normalize(remove, {});
+  phrases.erase(std::remove_if(phrases.begin(), phrases.end(),
+                               [&to_remove](const std::vector<int32_t> &p) {
+                                 return std::binary_search(to_remove.begin(),
+                                                           to_remove.end(), p);
+                               }),
+                phrases.end());
+  phrases = Normalize(phrases, add);
+
+  if (phrases.empty()) {
+    graph = nullptr;
+  } else if (graph) {
+    graph = graph->Update(add, remove);
+  } else {
+    graph = std::make_shared<ContextGraph>(phrases, context_score_);
+  }
+
+  ReplaceDefault(std::move(phrases), std::move(graph));
+}
+
+void ContextGraphCache::ReplaceDefault(
+    std::vector<std::vector<int32_t>> phrases, ContextGraphPtr graph) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (graph) {
+    graph = Insert(Hash(phrases), phrases, std::move(graph));
+  }
+
+  default_phrases_ = std::move(phrases);
+  default_graph_ = std::move(graph);
+}
+
+ContextGraphPtr ContextGraphCache::Get(
+    const std::vector<std::vector<int32_t>> &context_list) {
+  std::vector<std::vector<int32_t>> phrases;
+  ContextGraphPtr default_graph;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phrases = Normalize(default_phrases_, context_list);
+    default_graph = default_graph_;
+  }
+
+  if (phrases.empty()) {
+    return nullptr;
+  }
+
+  uint64_t h = Hash(phrases);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(h);
+    if (it != entries_.end()) {
+      for (const auto &e : it->second) {
+        if (e.phrases == phrases) {
+          if (auto graph = e.graph.lock()) {
+            return graph;
+          }
+        }
+      }
+    }
+  }
+
+  // Build it without holding the lock since it may take a while for a
+  // large list. The phrases of the stream are added to a copy of the
+  // default graph, which is usually much cheaper than building the graph
+  // from scratch.
+  ContextGraphPtr graph;
+  if (default_graph) {
+    graph = default_graph->Update(context_list, {});
+  } else {
+    graph = std::make_shared<ContextGraph>(phrases, context_score_);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Insert(h, std::move(phrases), std::move(graph));
+}
+
+ContextGraphPtr ContextGraphCache::Insert(
+    uint64_t h, std::vector<std::vector<int32_t>> phrases,
+    ContextGraphPtr graph) {
+  auto &bucket = entries_[h];
+  for (auto &e : bucket) {
+    if (e.phrases == phrases) {
+      if (auto existing = e.graph.lock()) {
+        // Another thread has built it in the meantime
+        return existing;
+      }
+      e.graph = graph;
+      return graph;
+    }
+  }
+
+  bucket.push_back({std::move(phrases), graph});
+  ++num_entries_;
+  if (num_entries_ >= next_cleanup_) {
+    RemoveExpired();
+    next_cleanup_ = std::max(16, 2 * num_entries_);
+  }
+
+  return graph;
+}
+
+int32_t ContextGraphCache::NumGraphs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RemoveExpired();
+  return num_entries_;
+}
+
+void ContextGraphCache::RemoveExpired() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto &bucket = it->second;
+    auto end = std::remove_if(bucket.begin(), bucket.end(),
+                              [](const Entry &e) { return e.graph.expired(); });
+    num_entries_ -= bucket.end() - end;
+    bucket.erase(end, bucket.end());
+
+    if (bucket.empty()) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace sherpa
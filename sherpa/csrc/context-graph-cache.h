@@ -0,0 +1,109 @@
+// sherpa/csrc/context-graph-cache.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_CONTEXT_GRAPH_CACHE_H_
+#define SHERPA_CSRC_CONTEXT_GRAPH_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "sherpa/csrc/context-graph.h"
+
+namespace sherpa {
+
+/** It returns the ContextGraph of a stream and shares graphs among
+ * streams with the same phrases.
+ *
+ * A graph is kept only as long as some stream uses it, so that thousands
+ * of streams with the same phrase list use a single copy of it, and the
+ * graph is built only once.
+ *
+ * It also holds a default list of phrases that is added to the phrases
+ * of every stream.
+ *
+ * It is thread-safe.
+ */
+class ContextGraphCache {
+ public:
+  explicit ContextGraphCache(float context_score)
+      : context_score_(context_score) {}
+
+  /** Set the phrases that are used by all streams created afterwards.
+   * Streams created before are not affected.
+   *
+   * @param context_list  Token IDs of the phrases. Empty to remove the
+   *                      default phrases.
+   */
+  void SetDefault(const std::vector<std::vector<int32_t>> &context_list);
+
+  /** Add and remove default phrases. Streams created before are not
+   * affected.
+   *
+   * The new default graph is obtained by patching the current one with
+   * ContextGraph::Update() instead of building it from scratch.
+   *
+   * @param add  Phrases to add.
+   * @param remove  Phrases to remove. A phrase in both lists is kept.
+   */
+  void UpdateDefault(const std::vector<std::vector<int32_t>> &add,
+                     const std::vector<std::vector<int32_t>> &remove);
+
+  /** Return the graph containing the default phrases and the given
+   * phrases. The order of the phrases and duplicates do not matter.
+   *
+   * Return nullptr if there are no phrases.
+   */
+  ContextGraphPtr Get(const std::vector<std::vector<int32_t>> &context_list);
+
+  /** Return the number of graphs that are in use */
+  int32_t NumGraphs();
+
+ private:
+  struct Entry {
+    // Sorted and unique phrases of the graph
+    std::vector<std::vector<int32_t>> phrases;
+    std::weak_ptr<ContextGraph> graph;
+  };
+
+  // Set the default phrases and their graph, which can be null
+  void ReplaceDefault(std::vector<std::vector<int32_t>> phrases,
+                      ContextGraphPtr graph);
+
+  // Add a graph for the given phrases and return it. If there is already
+  // one, it is returned instead. Must be called with mutex_ held.
+  ContextGraphPtr Insert(uint64_t h, std::vector<std::vector<int32_t>> phrases,
+                         ContextGraphPtr graph);
+
+  // Remove entries whose graphs have been freed. Must be called with
+  // mutex_ held.
+  void RemoveExpired();
+
+ private:
+  float context_score_;
+
+  std::mutex mutex_;
+
+  // It serializes changes to the default phrases
+  std::mutex update_mutex_;
+
+  // Sorted and unique default phrases
+  std::vector<std::vector<int32_t>> default_phrases_;
+
+  // Graph of the default phrases. It is kept even if no stream uses it,
+  // since streams without phrases of their own use it.
+  ContextGraphPtr default_graph_;
+
+  // Map the hash of the phrases to the entries with that hash
+  std::unordered_map<uint64_t, std::vector<Entry>> entries_;
+  int32_t num_entries_ = 0;
+
+  // RemoveExpired() is called when num_entries_ reaches it
+  int32_t next_cleanup_ = 16;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_CONTEXT_GRAPH_CACHE_H_
@@ -18,93 +18,459 @@
 
 #include "sherpa/csrc/context-graph.h"
 
-#include <cassert>
-#include <queue>
+#include <algorithm>
+#include <limits>
 #include <utility>
+#include <vector>
+
+#include "sherpa/csrc/log.h"
 
 namespace sherpa {
-void ContextGraph::Build(
-    const std::vector<std::vector<int32_t>> &token_ids) const {
-  for (size_t i = 0; i < token_ids.size(); ++i) {
-    auto node = root_.get();
-    for (size_t j = 0; j < token_ids[i].size(); ++j) {
-      int32_t token = token_ids[i][j];
-      if (0 == node->next.count(token)) {
-        bool is_end = j == (token_ids[i].size() - 1);
-        node->next[token] = std::make_unique<ContextState>(
-            token, context_score_, node->node_score + context_score_,
-            is_end ? node->node_score + context_score_ : 0, is_end);
+
+void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids) {
+  // After sorting, phrases sharing a prefix are contiguous, and a phrase
+  // comes before all phrases that it is a prefix of.
+  std::vector<const std::vector<int32_t> *> phrases;
+  phrases.reserve(token_ids.size());
+  for (const auto &ids : token_ids) {
+    if (!ids.empty()) {
+      phrases.push_back(&ids);
+    }
+  }
+  std::sort(phrases.begin(), phrases.end(),
+            [](const std::vector<int32_t> *a, const std::vector<int32_t> *b) {
+              return *a < *b;
+            });
+
+  states_.clear();
+  states_.emplace_back(-1, 0, 0, 0, false);
+  child_tokens_.clear();
+  child_states_.clear();
+  num_removed_ = 0;
+  num_unused_children_ = 0;
+
+  // State i contains phrases [ranges[i].first, ranges[i].second), which
+  // share its first states_[i].depth tokens.
+  std::vector<std::pair<int32_t, int32_t>> ranges = {
+      {0, static_cast<int32_t>(phrases.size())}};
+
+  // Create states in breadth-first order so that FillFailOutput() can
+  // process them in the order they are stored.
+  for (int32_t i = 0; i < static_cast<int32_t>(states_.size()); ++i) {
+    int32_t begin = ranges[i].first;
+    int32_t end = ranges[i].second;
+    int32_t depth = states_[i].depth;
+
+    // Skip phrases ending at this state
+    while (begin < end &&
+           static_cast<int32_t>(phrases[begin]->size()) == depth) {
+      ++begin;
+    }
+
+    states_[i].children_begin = child_tokens_.size();
+    while (begin < end) {
+      int32_t token = (*phrases[begin])[depth];
+      SHERPA_CHECK_GE(token, 0);
+
+      int32_t next = begin + 1;
+      while (next < end && (*phrases[next])[depth] == token) {
+        ++next;
       }
-      node = node->next[token].get();
+
+      bool is_end = static_cast<int32_t>(phrases[begin]->size()) == depth + 1;
+      float node_score = states_[i].node_score + context_score_;
+      child_tokens_.push_back(token);
+      child_states_.push_back(states_.size());
+
+      states_.emplace_back(token, context_score_, node_score,
+                           is_end ? node_score : 0, is_end);
+      states_.back().depth = depth + 1;
+      states_.back().parent = i;
+
+      ranges.emplace_back(begin, next);
+      begin = next;
     }
+    states_[i].children_end = child_tokens_.size();
+  }
+
+  const ContextState &root = states_[0];
+  int32_t max_token = -1;
+  for (int32_t i = root.children_begin; i != root.children_end; ++i) {
+    max_token = std::max(max_token, child_tokens_[i]);
   }
+  root_children_.assign(max_token + 1, 0);
+  for (int32_t i = root.children_begin; i != root.children_end; ++i) {
+    root_children_[child_tokens_[i]] = child_states_[i];
+  }
+
   FillFailOutput();
 }
 
+int32_t ContextGraph::GetChild(int32_t state, int32_t token) const {
+  if (state == 0) {
+    if (token < 0 || token >= static_cast<int32_t>(root_children_.size())) {
+      return -1;
+    }
+    int32_t child = root_children_[token];
+    return child != 0 ? child : -1;
+  }
+
+  const ContextState &s = states_[state];
+  auto begin = child_tokens_.begin() + s.children_begin;
+  auto end = child_tokens_.begin() + s.children_end;
+  auto it = std::lower_bound(begin, end, token);
+  if (it == end || *it != token) {
+    return -1;
+  }
+  return child_states_[it - child_tokens_.begin()];
+}
+
 std::pair<float, const ContextState *> ContextGraph::ForwardOneStep(
-    const ContextState *state, int32_t token) const {
-  const ContextState *node;
+    const ContextState *state, int32_t token_id) const {
+  int32_t cur = state - states_.data();
+  SHERPA_DCHECK(cur >= 0 && cur < static_cast<int32_t>(states_.size()));
+
+  int32_t node = GetChild(cur, token_id);
   float score;
-  if (1 == state->next.count(token)) {
-    node = state->next.at(token).get();
-    score = node->token_score;
+  if (node != -1) {
+    score = states_[node].token_score;
   } else {
-    node = state->fail;
-    while (0 == node->next.count(token)) {
-      node = node->fail;
-      if (-1 == node->token) break;  // root
+    // Follow the fail links until a state has the token or we reach the
+    // root
+    for (int32_t f = states_[cur].fail; node == -1; f = states_[f].fail) {
+      node = GetChild(f, token_id);
+      if (f == 0) break;
+    }
+    if (node == -1) {
+      node = 0;
     }
-    if (1 == node->next.count(token)) {
-      node = node->next.at(token).get();
+    score = states_[node].node_score - states_[cur].node_score;
+  }
+  return std::make_pair(score + states_[node].output_score, &states_[node]);
+}
+
+std::vector<int32_t> ContextGraph::GetPath(const ContextState *state) const {
+  int32_t cur = state - states_.data();
+  if (cur < 0 || cur >= static_cast<int32_t>(states_.size()) ||
+      states_[cur].is_removed) {
+    SHERPA_LOG(FATAL) << "The given state does not belong to this graph";
+  }
+
+  std::vector<int32_t> path;
+  for (; cur != 0; cur = states_[cur].parent) {
+    path.push_back(states_[cur].token);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+const ContextState *ContextGraph::GetState(
+    const std::vector<int32_t> &path) const {
+  int32_t node = 0;
+  for (auto token : path) {
+    node = GetChild(node, token);
+    if (node == -1) {
+      return nullptr;
     }
-    score = node->node_score - state->node_score;
   }
-  SHERPA_CHECK(nullptr != node);
-  return std::make_pair(score + node->output_score, node);
+  return &states_[node];
 }
 
 std::pair<float, const ContextState *> ContextGraph::Finalize(
     const ContextState *state) const {
   float score = -state->node_score;
-  return std::make_pair(score, root_.get());
+  return std::make_pair(score, Root());
 }
 
-void ContextGraph::FillFailOutput() const {
-  std::queue<const ContextState *> node_queue;
-  for (auto &kv : root_->next) {
-    kv.second->fail = root_.get();
-    node_queue.push(kv.second.get());
-  }
-  while (!node_queue.empty()) {
-    auto current_node = node_queue.front();
-    node_queue.pop();
-    for (auto &kv : current_node->next) {
-      auto fail = current_node->fail;
-      if (1 == fail->next.count(kv.first)) {
-        fail = fail->next.at(kv.first).get();
-      } else {
-        fail = fail->fail;
-        while (0 == fail->next.count(kv.first)) {
-          fail = fail->fail;
-          if (-1 == fail->token) break;
-        }
-        if (1 == fail->next.count(kv.first))
-          fail = fail->next.at(kv.first).get();
-      }
-      kv.second->fail = fail;
-      // fill the output arc
-      auto output = fail;
-      while (!output->is_end) {
-        output = output->fail;
-        if (-1 == output->token) {
-          output = nullptr;
-          break;
-        }
-      }
-      kv.second->output = output;
-      kv.second->output_score += output == nullptr ? 0 : output->output_score;
-      node_queue.push(kv.second.get());
+std::vector<std::vector<int32_t>> ContextGraph::GetPhrases() const {
+  std::vector<std::vector<int32_t>> ans;
+  for (const auto &s : states_) {
+    if (s.is_end && !s.is_removed) {
+      ans.push_back(GetPath(&s));
+    }
+  }
+  std::sort(ans.begin(), ans.end());
+  return ans;
+}
+
+int32_t ContextGraph::ComputeFail(int32_t state) const {
+  const ContextState &s = states_[state];
+  if (s.parent == 0) {
+    return 0;
+  }
+
+  for (int32_t f = states_[s.parent].fail;; f = states_[f].fail) {
+    int32_t child = GetChild(f, s.token);
+    if (child != -1) {
+      return child;
+    }
+    if (f == 0) {
+      return 0;
+    }
+  }
+}
+
+void ContextGraph::ComputeOutput(int32_t state) {
+  ContextState &s = states_[state];
+
+  // The fail state is processed before this state, so its output link
+  // is up to date
+  int32_t fail = s.fail;
+  int32_t output = -1;
+  if (fail != 0) {
+    output = states_[fail].is_end ? fail : states_[fail].output;
+  }
+
+  s.output = output;
+  s.output_score = (s.is_end ? s.node_score : 0) +
+                   (output != -1 ? states_[output].output_score : 0);
+}
+
+void ContextGraph::FillFailOutput() {
+  // States are in breadth-first order, so the fail and output links of a
+  // state point to states that have been processed before it.
+  int32_t num_states = states_.size();
+  for (int32_t i = 1; i != num_states; ++i) {
+    states_[i].fail = ComputeFail(i);
+    ComputeOutput(i);
+  }
+}
+
+void ContextGraph::InsertChild(int32_t state, int32_t child) {
+  ContextState &s = states_[state];
+  int32_t token = states_[child].token;
+
+  if (s.children_end != static_cast<int32_t>(child_tokens_.size())) {
+    // Move the children to the end of the child arrays so that there is
+    // room for one more
+    int32_t begin = child_tokens_.size();
+    for (int32_t i = s.children_begin; i != s.children_end; ++i) {
+      int32_t t = child_tokens_[i];
+      int32_t c = child_states_[i];
+      child_tokens_.push_back(t);
+      child_states_.push_back(c);
     }
+    num_unused_children_ += s.children_end - s.children_begin;
+    s.children_end = child_tokens_.size();
+    s.children_begin = begin;
+  }
+
+  child_tokens_.push_back(token);
+  child_states_.push_back(child);
+  ++s.children_end;
+
+  // Keep the children sorted by token
+  for (int32_t i = s.children_end - 1;
+       i > s.children_begin && child_tokens_[i - 1] > child_tokens_[i]; --i) {
+    std::swap(child_tokens_[i - 1], child_tokens_[i]);
+    std::swap(child_states_[i - 1], child_states_[i]);
+  }
+
+  if (state == 0) {
+    if (token >= static_cast<int32_t>(root_children_.size())) {
+      root_children_.resize(token + 1, 0);
+    }
+    root_children_[token] = child;
   }
 }
+
+void ContextGraph::RemoveChild(int32_t state, int32_t child) {
+  ContextState &s = states_[state];
+  int32_t token = states_[child].token;
+
+  auto begin = child_tokens_.begin() + s.children_begin;
+  auto end = child_tokens_.begin() + s.children_end;
+  int32_t i = std::lower_bound(begin, end, token) - child_tokens_.begin();
+  SHERPA_CHECK_EQ(child_states_[i], child);
+
+  for (; i + 1 < s.children_end; ++i) {
+    child_tokens_[i] = child_tokens_[i + 1];
+    child_states_[i] = child_states_[i + 1];
+  }
+  --s.children_end;
+  ++num_unused_children_;
+
+  if (state == 0) {
+    root_children_[token] = 0;
+  }
+}
+
+int32_t ContextGraph::AddPhrase(const std::vector<int32_t> &phrase,
+                                std::vector<int32_t> *new_states) {
+  int32_t cur = 0;
+  for (auto token : phrase) {
+    SHERPA_CHECK_GE(token, 0);
+
+    int32_t next = GetChild(cur, token);
+    if (next == -1) {
+      next = states_.size();
+      float node_score = states_[cur].node_score + context_score_;
+      int32_t depth = states_[cur].depth + 1;
+
+      states_.emplace_back(token, context_score_, node_score, 0, false);
+      states_.back().depth = depth;
+      states_.back().parent = cur;
+
+      InsertChild(cur, next);
+      new_states->push_back(next);
+    }
+    cur = next;
+  }
+  return cur;
+}
+
+int32_t ContextGraph::RemovePhrase(const std::vector<int32_t> &phrase,
+                                   std::vector<int32_t> *removed_states) {
+  const ContextState *state = GetState(phrase);
+  if (state == nullptr || !state->is_end) {
+    return -1;
+  }
+
+  int32_t last = state - states_.data();
+  states_[last].is_end = false;
+
+  // Remove states that are not on the path of any other phrase
+  int32_t cur = last;
+  while (cur != 0 && !states_[cur].is_end &&
+         states_[cur].children_begin == states_[cur].children_end) {
+    int32_t parent = states_[cur].parent;
+    RemoveChild(parent, cur);
+    states_[cur].is_removed = true;
+    ++num_removed_;
+    removed_states->push_back(cur);
+    cur = parent;
+  }
+
+  return states_[last].is_removed ? -1 : last;
+}
+
+ContextGraphPtr ContextGraph::Update(
+    const std::vector<std::vector<int32_t>> &add,
+    const std::vector<std::vector<int32_t>> &remove) const {
+  auto ans = std::make_shared<ContextGraph>(*this);
+  ans->version_ = version_ + 1;
+
+  // States whose is_end is changed
+  std::vector<int32_t> changed;
+  std::vector<int32_t> removed_states;
+  std::vector<int32_t> new_states;
+
+  for (const auto &phrase : remove) {
+    int32_t s = ans->RemovePhrase(phrase, &removed_states);
+    if (s != -1) {
+      changed.push_back(s);
+    }
+  }
+
+  for (const auto &phrase : add) {
+    if (phrase.empty()) {
+      continue;
+    }
+
+    int32_t s = ans->AddPhrase(phrase, &new_states);
+    if (!ans->states_[s].is_end) {
+      ans->states_[s].is_end = true;
+      changed.push_back(s);
+    }
+  }
+
+  if (ans->num_removed_ + ans->num_unused_children_ > ans->NumStates()) {
+    // Too many unused entries. Build it from scratch to compact it.
+    auto g = std::make_shared<ContextGraph>(ans->GetPhrases(), context_score_);
+    g->version_ = ans->version_;
+    return g;
+  }
+
+  std::vector<ContextState> &states = ans->states_;
+  int32_t num_states = states.size();
+  int32_t num_old_states = states_.size();
+
+  // min_depth[t] is the smallest depth of a new state with token t
+  std::vector<int32_t> min_depth;
+  for (auto s : new_states) {
+    int32_t token = states[s].token;
+    if (token >= static_cast<int32_t>(min_depth.size())) {
+      min_depth.resize(token + 1, std::numeric_limits<int32_t>::max());
+    }
+    min_depth[token] = std::min(min_depth[token], states[s].depth);
+  }
+
+  // The fail link of an existing state changes only if it points to a
+  // removed state, or if a new state is a longer suffix of it. In the
+  // latter case, the new state has the same token and a smaller depth.
+  std::vector<int32_t> candidates = new_states;
+  for (int32_t i = 1; i != num_old_states; ++i) {
+    const ContextState &s = states[i];
+    if (s.is_removed) {
+      continue;
+    }
+
+    if (states[s.fail].is_removed ||
+        (s.token < static_cast<int32_t>(min_depth.size()) &&
+         s.depth > min_depth[s.token])) {
+      candidates.push_back(i);
+    }
+  }
+
+  // The fail link of a state depends on that of its parent
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&states](int32_t a, int32_t b) {
+                     return states[a].depth < states[b].depth;
+                   });
+
+  // dirty[i] is true if state i has a new fail link, is_end, output
+  // link, or output score
+  std::vector<bool> dirty(num_states, false);
+  for (auto s : candidates) {
+    int32_t fail = ans->ComputeFail(s);
+    if (s >= num_old_states || fail != states[s].fail) {
+      states[s].fail = fail;
+      dirty[s] = true;
+    }
+  }
+
+  for (auto s : changed) {
+    dirty[s] = true;
+  }
+
+  // Update the output links in breadth-first order. Only states whose
+  // fail state is dirty are recomputed.
+  int32_t max_depth = 0;
+  for (const auto &s : states) {
+    max_depth = std::max(max_depth, s.depth);
+  }
+
+  std::vector<int32_t> offsets(max_depth + 2, 0);
+  for (int32_t i = 1; i != num_states; ++i) {
+    if (!states[i].is_removed) {
+      ++offsets[states[i].depth + 1];
+    }
+  }
+  for (int32_t d = 1; d <= max_depth + 1; ++d) {
+    offsets[d] += offsets[d - 1];
+  }
+
+  std::vector<int32_t> order(offsets.back());
+  for (int32_t i = 1; i != num_states; ++i) {
+    if (!states[i].is_removed) {
+      order[offsets[states[i].depth]++] = i;
+    }
+  }
+
+  for (auto s : order) {
+    if (!dirty[s] && !dirty[states[s].fail]) {
+      continue;
+    }
+
+    int32_t output = states[s].output;
+    float output_score = states[s].output_score;
+    ans->ComputeOutput(s);
+    if (output != states[s].output || output_score != states[s].output_score) {
+      dirty[s] = true;
+    }
+  }
+
+  return ans;
+}
+
 }  // namespace sherpa
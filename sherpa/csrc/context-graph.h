@@ -20,7 +20,6 @@
 #define SHERPA_CSRC_CONTEXT_GRAPH_H_
 
 #include <memory>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,15 +30,29 @@ namespace sherpa {
 class ContextGraph;
 using ContextGraphPtr = std::shared_ptr<ContextGraph>;
 
+// A state of the Aho-Corasick automaton in ContextGraph.
+//
+// All states of a graph are stored in a single array. Links to other
+// states are indexes into that array.
 struct ContextState {
   int32_t token;
   float token_score;
   float node_score;
   float output_score;
   bool is_end;
-  std::unordered_map<int32_t, std::unique_ptr<ContextState>> next;
-  const ContextState *fail = nullptr;
-  const ContextState *output = nullptr;
+
+  // true if the state has been removed by ContextGraph::Update()
+  bool is_removed = false;
+
+  int32_t depth = 0;
+  int32_t parent = 0;
+  int32_t fail = 0;
+  int32_t output = -1;  // -1 if there is no output link
+
+  // The children are [children_begin, children_end) of the child arrays
+  // of the graph, sorted by token
+  int32_t children_begin = 0;
+  int32_t children_end = 0;
 
   ContextState() = default;
   ContextState(int32_t token, float token_score, float node_score,
@@ -57,8 +70,6 @@ class ContextGraph {
   ContextGraph(const std::vector<std::vector<int32_t>> &token_ids,
                float context_score)
       : context_score_(context_score) {
-    root_ = std::make_unique<ContextState>(-1, 0, 0, 0, false);
-    root_->fail = root_.get();
     Build(token_ids);
   }
 
@@ -67,13 +78,99 @@ class ContextGraph {
   std::pair<float, const ContextState *> Finalize(
       const ContextState *state) const;
 
-  const ContextState *Root() const { return root_.get(); }
+  const ContextState *Root() const { return states_.data(); }
+
+  /** Return the tokens on the path from the root to the given state.
+   *
+   * It is used to save a state in a form that is independent of memory
+   * addresses, e.g., when serializing a stream. It follows the parent
+   * links, so its cost is linear in the depth of the state instead of the
+   * size of the graph.
+   */
+  std::vector<int32_t> GetPath(const ContextState *state) const;
+
+  /** Return the state reached by following the given tokens from the root.
+   *
+   * It is the inverse of GetPath(). Return nullptr if there is no such path.
+   */
+  const ContextState *GetState(const std::vector<int32_t> &path) const;
+
+  /** Return a new graph with the given phrases added and removed.
+   *
+   * This graph is not changed, so streams using it, and the ContextState
+   * pointers in their hypotheses, stay valid. Instead of building the new
+   * graph from scratch, this graph is copied and the trie is patched.
+   * Only the fail links that may point to added or removed states are
+   * recomputed.
+   *
+   * @param add  Phrases to add. Existing phrases are ignored.
+   * @param remove  Phrases to remove. Unknown phrases are ignored.
+   *                A phrase in both lists is kept.
+   */
+  ContextGraphPtr Update(const std::vector<std::vector<int32_t>> &add,
+                         const std::vector<std::vector<int32_t>> &remove)
+      const;
+
+  /** Return the phrases of this graph in sorted order */
+  std::vector<std::vector<int32_t>> GetPhrases() const;
+
+  /// It is 0 for a graph built from a list of phrases and is increased by
+  /// one in each Update().
+  int32_t Version() const { return version_; }
+
+  /// Number of states, including the root
+  int32_t NumStates() const { return states_.size() - num_removed_; }
+
+ private:
+  void Build(const std::vector<std::vector<int32_t>> &token_ids);
+  void FillFailOutput();
+
+  // Return the index of the child of the given state with the given
+  // token. Return -1 if there is no such child.
+  int32_t GetChild(int32_t state, int32_t token) const;
+
+  // Compute the fail link of a state from the fail link of its parent
+  int32_t ComputeFail(int32_t state) const;
+
+  // Compute the output link and output score of a state from its fail link
+  void ComputeOutput(int32_t state);
+
+  // Add a phrase. Return the index of its last state. New states are
+  // appended to new_states.
+  int32_t AddPhrase(const std::vector<int32_t> &phrase,
+                    std::vector<int32_t> *new_states);
+
+  // Remove a phrase and states that are no longer on the path of any
+  // phrase. Removed states are appended to removed_states.
+  // Return the index of its last state if it is still in the trie, or -1.
+  int32_t RemovePhrase(const std::vector<int32_t> &phrase,
+                       std::vector<int32_t> *removed_states);
+
+  void InsertChild(int32_t state, int32_t child);
+  void RemoveChild(int32_t state, int32_t child);
 
  private:
   float context_score_;
-  std::unique_ptr<ContextState> root_;
-  void Build(const std::vector<std::vector<int32_t>> &token_ids) const;
-  void FillFailOutput() const;
+  int32_t version_ = 0;
+
+  // states_[0] is the root
+  std::vector<ContextState> states_;
+  int32_t num_removed_ = 0;
+
+  // Children of all states. child_tokens_[i] is the token of
+  // child_states_[i]. Tokens are kept in a separate array so that
+  // looking up a child touches only a few cache lines.
+  std::vector<int32_t> child_tokens_;
+  std::vector<int32_t> child_states_;
+
+  // Number of entries of the child arrays that are no longer used by
+  // any state after Update()
+  int32_t num_unused_children_ = 0;
+
+  // root_children_[t] is the child of the root with token t, or 0 if there
+  // is no such child. Every failed lookup ends at the root, so it is
+  // looked up with a direct index instead of a binary search.
+  std::vector<int32_t> root_children_;
 };
 
 }  // namespace sherpa
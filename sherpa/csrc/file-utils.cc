@@ -18,6 +18,10 @@
 
 #include "sherpa/csrc/file-utils.h"
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdint>
 #include <fstream>
 #include <string>
 
@@ -35,4 +39,23 @@ void AssertFileExists(const std::string &filename) {
   }
 }
 
+bool GetFileSizeAndTime(const std::string &filename, int64_t *size,
+                        int64_t *mtime) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#else
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#endif
+
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  return true;
+}
+
 }  // namespace sherpa
@@ -19,6 +19,7 @@
 #ifndef SHERPA_CSRC_FILE_UTILS_H_
 #define SHERPA_CSRC_FILE_UTILS_H_
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 
@@ -37,6 +38,18 @@ bool FileExists(const std::string &filename);
  */
 void AssertFileExists(const std::string &filename);
 
+/** Get the size and the last modification time of a file.
+ *
+ * @param filename The file to query.
+ * @param size On return, it contains the size of the file in bytes.
+ * @param mtime On return, it contains the last modification time of the
+ *              file in seconds since the epoch.
+ * @return Return false if the file cannot be queried, e.g., if it does not
+ *         exist. Return true otherwise.
+ */
+bool GetFileSizeAndTime(const std::string &filename, int64_t *size,
+                        int64_t *mtime);
+
 }  // namespace sherpa
 
 #endif  // SHERPA_CSRC_FILE_UTILS_H_
@@ -0,0 +1,93 @@
+// sherpa/csrc/model-registry.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/model-registry.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "sherpa/csrc/log.h"
+#include "sherpa/csrc/quantize-module.h"
+
+namespace sherpa {
+
+ModelRegistry &ModelRegistry::GetInstance() {
+  static ModelRegistry registry;
+  return registry;
+}
+
+torch::jit::Module ModelRegistry::GetModule(const std::string &filename,
+                                            torch::Device device,
+                                            bool use_int8) {
+  std::string key =
+      filename + "|" + device.str() + (use_int8 ? "|int8" : "");
+  return modules_.Get(key, [&filename, device, use_int8]() {
+    return LoadModule(filename, device, /*shared*/ false, use_int8);
+  });
+}
+
+k2::FsaClassPtr ModelRegistry::GetGraph(const std::string &filename,
+                                        torch::Device device, float scale) {
+  std::ostringstream os;
+  os << filename << "|" << device.str() << "|" << scale;
+  return graphs_.Get(os.str(), [&filename, device, scale]() {
+    return LoadDecodingGraph(filename, device, scale, /*shared*/ false);
+  });
+}
+
+std::shared_ptr<const SymbolTable> ModelRegistry::GetSymbolTable(
+    const std::string &filename) {
+  return symbol_tables_.Get(filename, [&filename]() {
+    return LoadSymbolTable(filename, /*shared*/ false);
+  });
+}
+
+void ModelRegistry::Clear() {
+  modules_.Clear();
+  graphs_.Clear();
+  symbol_tables_.Clear();
+}
+
+torch::jit::Module LoadModule(const std::string &filename,
+                              torch::Device device, bool shared,
+                              bool use_int8) {
+  if (shared) {
+    return ModelRegistry::GetInstance().GetModule(filename, device, use_int8);
+  }
+
+  torch::jit::Module m = torch::jit::load(filename, device);
+  if (use_int8) {
+    int32_t n = QuantizeDynamicInt8(&m);
+    if (n == 0) {
+      SHERPA_LOG(WARNING) << filename << " has no Linear layers to quantize";
+    } else {
+      SHERPA_LOG(INFO) << "Quantized " << n << " Linear layers of "
+                       << filename << " to int8";
+    }
+  }
+  return m;
+}
+
+k2::FsaClassPtr LoadDecodingGraph(const std::string &filename,
+                                  torch::Device device, float scale,
+                                  bool shared) {
+  if (shared) {
+    return ModelRegistry::GetInstance().GetGraph(filename, device, scale);
+  }
+
+  auto graph = k2::LoadFsaClass(filename, device);
+  k2::ScaleTensorAttribute(graph, scale, "scores");
+  return graph;
+}
+
+std::shared_ptr<const SymbolTable> LoadSymbolTable(
+    const std::string &filename, bool shared) {
+  if (shared) {
+    return ModelRegistry::GetInstance().GetSymbolTable(filename);
+  }
+
+  return std::make_shared<const SymbolTable>(filename);
+}
+
+}  // namespace sherpa
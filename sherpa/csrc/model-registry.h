@@ -0,0 +1,137 @@
+// sherpa/csrc/model-registry.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_MODEL_REGISTRY_H_
+#define SHERPA_CSRC_MODEL_REGISTRY_H_
+
+#include <exception>
+#include <functional>
+#include <future>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+
+#include "k2/torch_api.h"
+#include "sherpa/csrc/symbol-table.h"
+#include "torch/script.h"
+
+namespace sherpa {
+
+/** A process-wide registry of TorchScript modules, decoding graphs, and
+ * symbol tables.
+ *
+ * Recognizers created with --share-models get them from here, so any
+ * number of recognizers that use the same files, e.g., one for
+ * greedy_search and another for modified_beam_search, or an online and an
+ * offline one, share a single copy in memory.
+ *
+ * Everything returned is shared and must be treated as read-only.
+ * Items are kept until Clear() is called. It is thread-safe.
+ */
+class ModelRegistry {
+ public:
+  static ModelRegistry &GetInstance();
+
+  /** Return the module loaded from the given file on the given device.
+   *  It is loaded only on the first call. Modules with and without int8
+   *  quantization are different items.
+   */
+  torch::jit::Module GetModule(const std::string &filename,
+                               torch::Device device, bool use_int8);
+
+  /** Return the decoding graph, e.g., LG.pt or HLG.pt, loaded from the
+   *  given file on the given device with its scores multiplied by `scale`.
+   *  Graphs with different scales are different items.
+   */
+  k2::FsaClassPtr GetGraph(const std::string &filename, torch::Device device,
+                           float scale);
+
+  /** Return the symbol table loaded from the given tokens.txt */
+  std::shared_ptr<const SymbolTable> GetSymbolTable(
+      const std::string &filename);
+
+  /** Remove all items from the registry.
+   *
+   * Recognizers that are using them are not affected. Items are freed
+   * when the last recognizer using them is destroyed.
+   */
+  void Clear();
+
+ private:
+  ModelRegistry() = default;
+
+  // Map a key to an item. Different keys are loaded concurrently, while
+  // concurrent requests for the same key wait for a single load.
+  template <typename T>
+  class Cache {
+   public:
+    T Get(const std::string &key, const std::function<T()> &load) {
+      std::promise<T> promise;
+      std::shared_future<T> future;
+      bool is_loader = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = items_.find(key);
+        if (it == items_.end()) {
+          future = promise.get_future().share();
+          items_.emplace(key, future);
+          is_loader = true;
+        } else {
+          future = it->second;
+        }
+      }
+
+      if (is_loader) {
+        try {
+          promise.set_value(load());
+        } catch (...) {
+          promise.set_exception(std::current_exception());
+
+          // so that the next call can try again
+          std::lock_guard<std::mutex> lock(mutex_);
+          items_.erase(key);
+        }
+      }
+
+      return future.get();
+    }
+
+    void Clear() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      items_.clear();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::map<std::string, std::shared_future<T>> items_;
+  };
+
+  Cache<torch::jit::Module> modules_;
+  Cache<k2::FsaClassPtr> graphs_;
+  Cache<std::shared_ptr<const SymbolTable>> symbol_tables_;
+};
+
+/** Load a TorchScript module. If shared is true, it is taken from
+ *  ModelRegistry. If use_int8 is true, its Linear layers are quantized
+ *  with QuantizeDynamicInt8().
+ */
+torch::jit::Module LoadModule(const std::string &filename,
+                              torch::Device device, bool shared,
+                              bool use_int8);
+
+/** Load a decoding graph and multiply its scores by `scale`.
+ *  If shared is true, it is taken from ModelRegistry.
+ */
+k2::FsaClassPtr LoadDecodingGraph(const std::string &filename,
+                                  torch::Device device, float scale,
+                                  bool shared);
+
+/** Load tokens.txt. If shared is true, it is taken from ModelRegistry. */
+std::shared_ptr<const SymbolTable> LoadSymbolTable(
+    const std::string &filename, bool shared);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_MODEL_REGISTRY_H_
@@ -0,0 +1,271 @@
+// sherpa/csrc/module-optimizer.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/module-optimizer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa/cpp_api/macros.h"
+#include "sherpa/csrc/file-utils.h"
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+
+// Update the 64-bit FNV-1a hash h with the given bytes
+static uint64_t Fnv1a(const char *p, int64_t n, uint64_t h) {
+  for (int64_t i = 0; i != n; ++i) {
+    h ^= static_cast<uint8_t>(p[i]);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// 64-bit FNV-1a hash of the content of the given files
+static uint64_t HashFiles(const std::vector<std::string> &filenames) {
+  uint64_t h = kFnvOffsetBasis;
+  std::vector<char> buf(1 << 20);
+  for (const auto &filename : filenames) {
+    std::ifstream is(filename, std::ios::binary);
+    if (!is) {
+      SHERPA_LOG(FATAL) << "Failed to open " << filename;
+    }
+
+    while (is) {
+      is.read(buf.data(), buf.size());
+      h = Fnv1a(buf.data(), is.gcount(), h);
+    }
+  }
+  return h;
+}
+
+// Describe the given files by their paths, sizes, and modification times
+// without reading them. It changes when a file is modified or replaced.
+static std::string FileStamp(const std::vector<std::string> &filenames) {
+  std::ostringstream os;
+  for (const auto &filename : filenames) {
+    int64_t size = 0;
+    int64_t mtime = 0;
+    if (!GetFileSizeAndTime(filename, &size, &mtime)) {
+      SHERPA_LOG(FATAL) << "Failed to get the size of " << filename;
+    }
+
+    os << filename << "|" << size << "|" << mtime << "\n";
+  }
+  return os.str();
+}
+
+// Frozen graphs are specialized for the instruction set of the CPU
+// (e.g., oneDNN kernels), so the CPU features are part of the cache key.
+static std::string CpuFeatures() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  std::string s = "x86";
+  if (__builtin_cpu_supports("avx2")) {
+    s += "-avx2";
+  }
+
+  if (__builtin_cpu_supports("avx512f")) {
+    s += "-avx512f";
+  }
+  return s;
+#elif defined(__aarch64__)
+  return "arm64";
+#else
+  return "generic";
+#endif
+}
+
+// Call write() with a unique temporary file in the directory of filename
+// and rename it to filename so that other processes sharing the cache
+// directory never read a partially written file.
+template <typename F>
+static void WriteAtomically(const std::string &filename, F write) {
+  std::ostringstream os;
+  os << filename << ".tmp-" << std::hex << std::random_device()()
+     << std::random_device()();
+  std::string tmp = os.str();
+
+  try {
+    write(tmp);
+  } catch (...) {
+    std::remove(tmp.c_str());
+    throw;
+  }
+
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("Failed to rename " + tmp + " to " + filename);
+  }
+}
+
+// Return the hash of the content of the given files.
+//
+// Hashing reads the whole files, which takes a while for large models, so
+// the hash is saved in cache_dir under a name derived from FileStamp().
+// Later runs with unchanged files read it from there.
+static uint64_t GetContentHash(const std::vector<std::string> &filenames,
+                               const std::string &cache_dir) {
+  std::string stamp = FileStamp(filenames);
+
+  std::ostringstream os;
+  os << cache_dir << "/stamp-" << std::hex
+     << Fnv1a(stamp.data(), stamp.size(), kFnvOffsetBasis) << ".txt";
+  std::string stamp_file = os.str();
+
+  // The file contains the hash in the first line followed by the stamp,
+  // which is compared in case two stamps have the same hash
+  {
+    std::ifstream is(stamp_file);
+    uint64_t h = 0;
+    if (is >> std::hex >> h && is.get() == '\n') {
+      std::string saved((std::istreambuf_iterator<char>(is)),
+                        std::istreambuf_iterator<char>());
+      if (saved == stamp) {
+        return h;
+      }
+    }
+  }
+
+  uint64_t h = HashFiles(filenames);
+  try {
+    WriteAtomically(stamp_file, [h, &stamp](const std::string &tmp) {
+      std::ofstream os(tmp);
+      os << std::hex << h << "\n" << stamp;
+      os.close();
+      if (!os) {
+        throw std::runtime_error("Failed to write " + tmp);
+      }
+    });
+  } catch (const std::exception &e) {
+    SHERPA_LOG(WARNING) << "Failed to save " << stamp_file << "\n"
+                        << e.what();
+  }
+  return h;
+}
+
+// Return the names of the methods of m except forward
+static std::vector<std::string> OtherMethods(const torch::jit::Module &m) {
+  std::vector<std::string> ans;
+  for (const auto &method : m.get_methods()) {
+    if (method.name() != "forward") {
+      ans.push_back(method.name());
+    }
+  }
+  return ans;
+}
+
+ModuleOptimizer::ModuleOptimizer(const std::vector<std::string> &filenames,
+                                 const std::string &cache_dir,
+                                 torch::Device device, bool use_int8)
+    : device_(device) {
+  if (cache_dir.empty()) {
+    return;
+  }
+
+  std::ostringstream os;
+  os << cache_dir << "/model-" << std::hex
+     << GetContentHash(filenames, cache_dir) << std::dec << "-torch"
+     << SHERPA_TORCH_VERSION << "-" << CpuFeatures() << "-"
+     << (device.is_cuda() ? "cuda" : "cpu") << (use_int8 ? "-int8" : "")
+     << ".pt";
+  cache_filename_ = os.str();
+}
+
+bool ModuleOptimizer::LoadCache(torch::jit::Module *m) {
+  if (cache_filename_.empty() || !FileExists(cache_filename_)) {
+    return false;
+  }
+
+  try {
+    cache_ = torch::jit::load(cache_filename_, device_);
+  } catch (const std::exception &e) {
+    SHERPA_LOG(WARNING) << "Failed to load " << cache_filename_
+                        << ". Ignore it. Reason:\n"
+                        << e.what();
+    return false;
+  }
+
+  from_cache_ = true;
+  *m = cache_;
+  SHERPA_LOG(INFO) << "Loaded frozen model from " << cache_filename_;
+  return true;
+}
+
+torch::jit::Module ModuleOptimizer::Optimize(
+    const torch::jit::Module &m, const std::string &name,
+    const std::vector<std::string> &attributes /*= {}*/) {
+#if SHERPA_TORCH_VERSION_MAJOR > 1 || \
+    (SHERPA_TORCH_VERSION_MAJOR == 1 && SHERPA_TORCH_VERSION_MINOR >= 10)
+  torch::jit::Module frozen;
+  if (from_cache_) {
+    frozen = cache_.attr(name).toModule();
+  } else {
+    std::vector<std::string> preserved = OtherMethods(m);
+    preserved.insert(preserved.end(), attributes.begin(), attributes.end());
+
+    try {
+      frozen = torch::jit::freeze(m, preserved);
+    } catch (const std::exception &e) {
+      SHERPA_LOG(WARNING) << "Failed to freeze " << name
+                          << ". Use it without optimization. Reason:\n"
+                          << e.what();
+      failed_ = true;
+      return m;
+    }
+
+    // optimize_for_inference() changes the graphs in place, so a copy is
+    // kept for SaveCache()
+    frozen_.emplace_back(name, frozen);
+    frozen = frozen.clone();
+  }
+
+  // We don't cache the output of optimize_for_inference() since it may
+  // contain MKLDNN tensors, which cannot be serialized. It runs only graph
+  // passes on an already frozen module, so it is cheap.
+  return torch::jit::optimize_for_inference(frozen, OtherMethods(frozen));
+#else
+  SHERPA_LOG(WARNING) << "Freezing " << name << " requires torch >= 1.10. "
+                      << "Use it without optimization";
+  failed_ = true;
+  return m;
+#endif
+}
+
+void ModuleOptimizer::SaveCache() const {
+  if (cache_filename_.empty() || from_cache_ || failed_ || frozen_.empty()) {
+    return;
+  }
+
+  // It has no "training" attribute, like the frozen modules it contains
+  torch::jit::Module m("__torch__.sherpa.FrozenModel");
+  for (const auto &p : frozen_) {
+    m.register_module(p.first, p.second);
+  }
+
+  try {
+    WriteAtomically(cache_filename_,
+                    [&m](const std::string &tmp) { m.save(tmp); });
+    SHERPA_LOG(INFO) << "Saved frozen model to " << cache_filename_;
+  } catch (const std::exception &e) {
+    SHERPA_LOG(WARNING) << "Failed to save " << cache_filename_ << "\n"
+                        << e.what();
+  }
+}
+
+void SetEvalMode(torch::jit::Module *m) {
+  if (m->hasattr("training")) {
+    m->eval();
+  }
+}
+
+}  // namespace sherpa
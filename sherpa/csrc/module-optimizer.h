@@ -0,0 +1,124 @@
+// sherpa/csrc/module-optimizer.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_MODULE_OPTIMIZER_H_
+#define SHERPA_CSRC_MODULE_OPTIMIZER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "torch/script.h"
+
+namespace sherpa {
+
+/** It freezes a TorchScript module and optimizes it for inference with
+ * torch::jit::freeze() and torch::jit::optimize_for_inference().
+ *
+ * Freezing inlines parameters and submodules as constants so that constant
+ * folding and op fusion can be applied to the graph.
+ *
+ * If a cache directory is given, the frozen modules of a model are saved
+ * there in a single file. Later processes call LoadCache() before loading
+ * the model files and use the cached file instead, so neither the model
+ * files nor the freezing are needed any more.
+ *
+ * Usage:
+ *
+ *   ModuleOptimizer optimizer(filenames, cache_dir, device, use_int8);
+ *   torch::jit::Module m;
+ *   if (!optimizer.LoadCache(&m)) {
+ *     m = torch::jit::load(filenames[0]);
+ *   }
+ *   // construct the model from m and call Optimize() on its modules
+ *   optimizer.SaveCache();
+ */
+class ModuleOptimizer {
+ public:
+  /**
+   * @param filenames  Model files the modules to optimize are loaded from.
+   *                   Their content is hashed to form the cache key. The
+   *                   hash is saved in cache_dir and reused while the
+   *                   paths, sizes, and modification times of the files
+   *                   stay the same, so files are read only once.
+   * @param cache_dir  An existing directory to save frozen modules. If it
+   *                   is empty, no cache is used.
+   * @param device  The device of the modules.
+   * @param use_int8  true if the modules are quantized with
+   *                  QuantizeDynamicInt8() before they are optimized.
+   */
+  ModuleOptimizer(const std::vector<std::string> &filenames,
+                  const std::string &cache_dir, torch::Device device,
+                  bool use_int8);
+
+  /** Load the frozen modules saved by SaveCache() of an earlier run.
+   *
+   * @param m  On return, it contains a module whose attributes are the
+   *           frozen modules, named as in Optimize(). Models are
+   *           constructed from it in place of the module loaded from the
+   *           model file. For models that are loaded from several files,
+   *           e.g., encoder, decoder, and joiner, use m.attr("encoder"),
+   *           etc.
+   *
+   * @return Return true if the cache exists. Return false otherwise and
+   *         m is not changed.
+   */
+  bool LoadCache(torch::jit::Module *m);
+
+  /** Return an optimized version of the given module.
+   *
+   * All methods of the module are preserved, but attributes that are not
+   * used by any method and not listed in `attributes` are removed. So read
+   * the other attributes you need before calling this function.
+   *
+   * @param m  The module to optimize. It must be in eval mode. It is
+   *           ignored if LoadCache() has returned true.
+   * @param name  A name that is unique among the modules of the same
+   *              model, e.g., encoder. If the model is constructed from
+   *              a module containing m, it must be the name of the
+   *              attribute, so that the model can be constructed from the
+   *              cache.
+   * @param attributes  Attributes of m, including submodules, that are
+   *                    read when the model is constructed. They are kept
+   *                    in the frozen module.
+   *
+   * @return Return the optimized module. If the module cannot be frozen,
+   *         a warning is printed and the given module is returned.
+   */
+  torch::jit::Module Optimize(const torch::jit::Module &m,
+                              const std::string &name,
+                              const std::vector<std::string> &attributes = {});
+
+  /** Save the modules frozen by Optimize() to the cache directory.
+   *
+   * It does nothing if no cache directory is given, if the modules are
+   * from the cache, or if any of them could not be frozen.
+   */
+  void SaveCache() const;
+
+ private:
+  // Path of the cache file. It contains the hash of the model files, the
+  // torch version, the CPU features, the device type, and whether the
+  // modules are quantized. It is empty if no cache directory is given.
+  std::string cache_filename_;
+  torch::Device device_;
+
+  // Loaded by LoadCache()
+  torch::jit::Module cache_;
+  bool from_cache_ = false;
+
+  // Modules frozen by Optimize()
+  std::vector<std::pair<std::string, torch::jit::Module>> frozen_;
+  bool failed_ = false;
+};
+
+/** Put a module into eval mode.
+ *
+ * Frozen modules and the module from ModuleOptimizer::LoadCache() have no
+ * "training" attribute. They are in eval mode already and are not changed.
+ */
+void SetEvalMode(torch::jit::Module *m);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_MODULE_OPTIMIZER_H_
@@ -4,6 +4,7 @@
 #include "sherpa/csrc/offline-conformer-ctc-model.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "sherpa/cpp_api/macros.h"
@@ -12,8 +13,12 @@ namespace sherpa {
 
 OfflineConformerCtcModel::OfflineConformerCtcModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OfflineConformerCtcModel(torch::jit::load(filename, device), device) {}
+
+OfflineConformerCtcModel::OfflineConformerCtcModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
+  model_ = std::move(model);
   model_.eval();
 }
 
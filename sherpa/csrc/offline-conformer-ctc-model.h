@@ -24,6 +24,13 @@ class OfflineConformerCtcModel : public OfflineCtcModel {
   explicit OfflineConformerCtcModel(const std::string &filename,
                                     torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OfflineConformerCtcModel(torch::jit::Module model,
+                                    torch::Device device = torch::kCPU);
+
   torch::Device Device() const override { return device_; }
 
   int32_t SubsamplingFactor() const override { return 4; }
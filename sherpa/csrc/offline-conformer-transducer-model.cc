@@ -13,6 +13,11 @@ namespace sherpa {
 
 OfflineConformerTransducerModel::OfflineConformerTransducerModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OfflineConformerTransducerModel(torch::jit::load(filename, device),
+                                      device) {}
+
+OfflineConformerTransducerModel::OfflineConformerTransducerModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
   // See
   // https://github.com/k2-fsa/icefall/blob/master/egs/librispeech/ASR/pruned_transducer_stateless2/model.py#L29
@@ -22,8 +27,8 @@ OfflineConformerTransducerModel::OfflineConformerTransducerModel(
   // architecture. We use pruned_transducer_stateless2 as an exmaple here, but
   // it applies also to pruned_transducer_stateless3,
   // pruned_transducer_stateless4, etc.
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
@@ -70,4 +75,14 @@ torch::Tensor OfflineConformerTransducerModel::RunJoiner(
       .toTensor();
 }
 
+void OfflineConformerTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(encoder_, "encoder");
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"context_size"});
+  joiner_ =
+      optimizer->Optimize(joiner_, "joiner", {"encoder_proj", "decoder_proj"});
+  encoder_proj_ = optimizer->Optimize(encoder_proj_, "encoder_proj");
+  decoder_proj_ = optimizer->Optimize(decoder_proj_, "decoder_proj");
+}
+
 }  // namespace sherpa
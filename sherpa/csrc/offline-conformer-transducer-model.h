@@ -26,6 +26,13 @@ class OfflineConformerTransducerModel : public OfflineTransducerModel {
   explicit OfflineConformerTransducerModel(const std::string &filename,
                                            torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OfflineConformerTransducerModel(torch::jit::Module model,
+                                           torch::Device device = torch::kCPU);
+
   /**
    * See
    * https://github.com/k2-fsa/icefall/blob/master/egs/librispeech/ASR/pruned_transducer_stateless2/conformer.py#L127
@@ -67,6 +74,8 @@ class OfflineConformerTransducerModel : public OfflineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   /* See
@@ -6,6 +6,7 @@
 
 #include <vector>
 
+#include "sherpa/cpp_api/offline-stream.h"
 #include "sherpa/cpp_api/parse-options.h"
 #include "torch/script.h"
 
@@ -29,12 +30,17 @@ class OfflineCtcDecoder {
    * @param log_prob_len A 1-D tensor of shape (N,) containing number
    *                     of valid frames in encoder_out before padding.
    * @param subsampling_factor Subsampling factor of the model.
+   * @param ss Pointer to an array of streams. If not null, decoders that
+   *           support contextual biasing use the ContextGraph of ss[i]
+   *           for utterance i.
+   * @param n  Size of the input array.
    *
    * @return Return a vector of size `N` containing the decoded results.
    */
   virtual std::vector<OfflineCtcDecoderResult> Decode(
       torch::Tensor log_prob, torch::Tensor log_prob_len,
-      int32_t subsampling_factor = 1) = 0;
+      int32_t subsampling_factor = 1, OfflineStream **ss = nullptr,
+      int32_t n = 0) = 0;
 };
 
 }  // namespace sherpa
@@ -5,6 +5,7 @@
 #include "sherpa/csrc/offline-ctc-one-best-decoder.h"
 
 #include <utility>
+#include <vector>
 
 #include "sherpa/cpp_api/macros.h"
 #include "sherpa/csrc/log.h"
@@ -13,29 +14,80 @@ namespace sherpa {
 
 OfflineCtcOneBestDecoder::OfflineCtcOneBestDecoder(
     const OfflineCtcDecoderConfig &config, torch::Device device,
-    int32_t vocab_size)
+    int32_t vocab_size, k2::FsaClassPtr hlg /*= nullptr*/)
     : config_(config), vocab_size_(vocab_size) {
   if (config.hlg.empty()) {
-    // Use CTC topo since no HLG is provided
+    // The best path in a CTC topo is the same as the one from GreedySearch(),
+    // so we don't need a decoding graph.
     SHERPA_CHECK_GT(vocab_size, 1);
+    return;
+  }
 
-    decoding_graph_ = k2::GetCtcTopo(vocab_size - 1, config.modified, device);
+  if (hlg) {
+    // It is already scaled
+    decoding_graph_ = hlg;
   } else {
     decoding_graph_ = k2::LoadFsaClass(config.hlg, device);
-
     k2::ScaleTensorAttribute(decoding_graph_, config.lm_scale, "scores");
   }
 }
 
+std::vector<OfflineCtcDecoderResult> OfflineCtcOneBestDecoder::GreedySearch(
+    torch::Tensor log_prob, torch::Tensor log_prob_len) const {
+  int32_t batch_size = log_prob.size(0);
+  int32_t num_frames = log_prob.size(1);
+
+  // All of the following are computed for the whole batch on the device
+  // of log_prob.
+  //
+  // ids is of shape (N, T)
+  torch::Tensor ids = log_prob.argmax(/*dim*/ 2);
+
+  // prev[:, t] is ids[:, t-1]. -1 is used for t == 0
+  torch::Tensor prev =
+      torch::constant_pad_nd(ids, {1, 0}, -1).slice(/*dim*/ 1, 0, num_frames);
+
+  torch::Tensor t = torch::arange(num_frames, ids.options()).unsqueeze(0);
+  torch::Tensor valid = t < log_prob_len.to(ids.device()).unsqueeze(1);
+
+  // A token is emitted at frame t if it is not a blank and is not a repeat
+  // of frame t-1
+  torch::Tensor emit = (ids != 0).logical_and(ids != prev).logical_and(valid);
+
+  ids = ids.to(torch::kCPU, torch::kInt).contiguous();
+  emit = emit.cpu().contiguous();
+
+  auto ids_acc = ids.accessor<int32_t, 2>();
+  auto emit_acc = emit.accessor<bool, 2>();
+
+  std::vector<OfflineCtcDecoderResult> results(batch_size);
+  for (int32_t n = 0; n != batch_size; ++n) {
+    auto &r = results[n];
+    for (int32_t i = 0; i != num_frames; ++i) {
+      if (emit_acc[n][i]) {
+        r.tokens.push_back(ids_acc[n][i]);
+        r.timestamps.push_back(i);
+      }
+    }
+  }
+
+  return results;
+}
+
 std::vector<OfflineCtcDecoderResult> OfflineCtcOneBestDecoder::Decode(
     torch::Tensor log_prob, torch::Tensor log_prob_len,
-    int32_t subsampling_factor /*= 1*/) {
+    int32_t subsampling_factor /*= 1*/, OfflineStream ** /*ss = nullptr*/,
+    int32_t /*n = 0*/) {
   if (vocab_size_ > 0) {
     SHERPA_CHECK_EQ(log_prob.size(2), vocab_size_);
   }
 
   InferenceMode no_grad;
 
+  if (!decoding_graph_) {
+    return GreedySearch(log_prob, log_prob_len);
+  }
+
   auto lattice = k2::GetLattice(log_prob, log_prob_len.cpu(), decoding_graph_,
                                 config_.search_beam, config_.output_beam,
                                 config_.min_active_states,
@@ -50,29 +102,28 @@ std::vector<OfflineCtcDecoderResult> OfflineCtcOneBestDecoder::Decode(
 
   OfflineCtcDecoderResult *p = results.data();
 
+  // Label of the previous frame, including blanks. -1 for t == 0.
+  // As in GreedySearch(), a token is emitted only if it differs from
+  // the previous frame, so "a blank a" gives two tokens.
+  int32_t prev = -1;
   for (int32_t i = 0, t = 0; i != labels.numel(); ++i) {
     int32_t token = acc[i];
 
     if (token == -1) {
       // end of this utterance.
       t = 0;
+      prev = -1;
       ++p;
 
       continue;
     }
 
-    if (token == 0) {
-      ++t;
-      continue;
-    }
-    if (t != 0 && !p->tokens.empty() && token == p->tokens.back()) {
-      // This is a repeat, skip it.
-      ++t;
-      continue;
+    if (token != 0 && token != prev) {
+      p->tokens.push_back(token);
+      p->timestamps.push_back(t);
     }
 
-    p->tokens.push_back(token);
-    p->timestamps.push_back(t);
+    prev = token;
     ++t;
   }  // for (int32_t i = 0, t = 0; i != labels.numel(); ++i)
 
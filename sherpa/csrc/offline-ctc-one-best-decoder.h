@@ -12,21 +12,36 @@
 
 namespace sherpa {
 
+// If no HLG is given, i.e., config.hlg is empty, the best path is found by
+// taking the argmax of each frame and removing blanks and repeats, so no
+// k2 lattice is built. Otherwise, it uses the shortest path of the lattice
+// from intersecting the model output with the HLG.
 class OfflineCtcOneBestDecoder : public OfflineCtcDecoder {
  public:
   /**
    * @param vocab_size Output dimension of the model.
+   * @param hlg If not null, it is the graph loaded from config.hlg
+   *            on the given device with its scores already multiplied
+   *            by config.lm_scale so that we don't load it again. It may
+   *            be shared with other decoders and is not modified.
    */
   OfflineCtcOneBestDecoder(const OfflineCtcDecoderConfig &config,
-                           torch::Device device, int32_t vocab_size);
+                           torch::Device device, int32_t vocab_size,
+                           k2::FsaClassPtr hlg = nullptr);
 
   std::vector<OfflineCtcDecoderResult> Decode(
       torch::Tensor log_prob, torch::Tensor log_prob_len,
-      int32_t subsampling_factor = 1) override;
+      int32_t subsampling_factor = 1, OfflineStream **ss = nullptr,
+      int32_t n = 0) override;
+
+ private:
+  // Used when config.hlg is empty
+  std::vector<OfflineCtcDecoderResult> GreedySearch(
+      torch::Tensor log_prob, torch::Tensor log_prob_len) const;
 
  private:
   OfflineCtcDecoderConfig config_;
-  k2::FsaClassPtr decoding_graph_;
+  k2::FsaClassPtr decoding_graph_;  // null if config.hlg is empty
   int32_t vocab_size_;
 };
 
@@ -0,0 +1,285 @@
+// sherpa/csrc/offline-ctc-prefix-beam-search-decoder.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/csrc/offline-ctc-prefix-beam-search-decoder.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ATen/Parallel.h"
+#include "sherpa/cpp_api/macros.h"
+#include "sherpa/csrc/log.h"
+#include "sherpa/csrc/math.h"
+
+namespace sherpa {
+
+namespace {
+
+constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+
+// It stores integer sequences sharing common prefixes. Each node is a
+// sequence and is identified by an integer ID. A node is created only once
+// for each pair of (parent ID, value), so two sequences are equal if and
+// only if their IDs are equal.
+class SequenceTrie {
+ public:
+  // ID of the empty sequence
+  static constexpr int32_t kRoot = 0;
+
+  SequenceTrie() : nodes_{{-1, -1}} {}
+
+  // Return the ID of the sequence parent + [value]
+  int32_t Child(int32_t parent, int32_t value) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) |
+                   static_cast<uint32_t>(value);
+    auto it = children_.find(key);
+    if (it != children_.end()) {
+      return it->second;
+    }
+
+    int32_t id = nodes_.size();
+    nodes_.push_back({parent, value});
+    children_.emplace(key, id);
+    return id;
+  }
+
+  // Return the last value of the sequence. -1 for kRoot.
+  int32_t Back(int32_t id) const { return nodes_[id].value; }
+
+  std::vector<int32_t> Get(int32_t id) const {
+    std::vector<int32_t> ans;
+    for (; id != kRoot; id = nodes_[id].parent) {
+      ans.push_back(nodes_[id].value);
+    }
+    std::reverse(ans.begin(), ans.end());
+    return ans;
+  }
+
+ private:
+  struct Node {
+    int32_t parent;
+    int32_t value;
+  };
+
+  std::vector<Node> nodes_;
+
+  // Map (parent << 32 | value) to the ID of the child
+  std::unordered_map<uint64_t, int32_t> children_;
+};
+
+constexpr int32_t SequenceTrie::kRoot;
+
+struct Prefix {
+  // Log prob of all paths of this prefix ending in a blank
+  float blank = kNegInf;
+
+  // Log prob of all paths of this prefix ending in its last token
+  float non_blank = kNegInf;
+
+  // Accumulated bonus from the context graph
+  float context_score = 0;
+  const ContextState *context_state = nullptr;
+
+  // ID of the timestamps in a SequenceTrie. timestamps[i] is the frame
+  // where the i-th token of the prefix is first decoded
+  int32_t timestamps = SequenceTrie::kRoot;
+
+  float Total() const { return LogAdd<float>()(blank, non_blank); }
+
+  // Score used for pruning
+  float Score() const { return Total() + context_score; }
+};
+
+// Map the ID of a token sequence in a SequenceTrie to its prefix
+using Prefixes = std::unordered_map<int32_t, Prefix>;
+
+}  // namespace
+
+std::vector<OfflineCtcDecoderResult> OfflineCtcPrefixBeamSearchDecoder::Decode(
+    torch::Tensor log_prob, torch::Tensor log_prob_len,
+    int32_t /*subsampling_factor = 1*/, OfflineStream **ss /*= nullptr*/,
+    int32_t n /*= 0*/) {
+  InferenceMode no_grad;
+
+  int32_t batch_size = log_prob.size(0);
+  if (ss != nullptr) {
+    SHERPA_CHECK_EQ(batch_size, n);
+  }
+
+  int32_t top_k = std::min<int32_t>(top_k_, log_prob.size(2));
+
+  // Select the candidates of all frames at once on the device of log_prob
+  // so that only (N, T, top_k) entries are copied to CPU.
+  torch::Tensor values;
+  torch::Tensor indexes;
+  std::tie(values, indexes) = log_prob.topk(top_k, /*dim*/ 2);
+
+  values = values.to(torch::kCPU, torch::kFloat).contiguous();
+  indexes = indexes.to(torch::kCPU, torch::kInt).contiguous();
+  log_prob_len = log_prob_len.to(torch::kCPU, torch::kInt).contiguous();
+
+  const int32_t *p_len = log_prob_len.data_ptr<int32_t>();
+
+  std::vector<OfflineCtcDecoderResult> results(batch_size);
+  at::parallel_for(0, batch_size, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i != end; ++i) {
+      const ContextGraph *context_graph =
+          ss != nullptr ? ss[i]->GetContextGraph().get() : nullptr;
+      results[i] = DecodeOne(values[i], indexes[i], p_len[i], context_graph);
+    }
+  });
+
+  return results;
+}
+
+OfflineCtcDecoderResult OfflineCtcPrefixBeamSearchDecoder::DecodeOne(
+    const torch::Tensor &values, const torch::Tensor &indexes,
+    int32_t num_frames, const ContextGraph *context_graph) const {
+  int32_t top_k = values.size(1);
+  auto values_acc = values.accessor<float, 2>();
+  auto indexes_acc = indexes.accessor<int32_t, 2>();
+
+  LogAdd<float> log_add;
+
+  // Token sequences and timestamps of all prefixes of this utterance
+  SequenceTrie tokens;
+  SequenceTrie timestamps;
+
+  Prefixes cur;
+  {
+    Prefix p;
+    p.blank = 0;
+    if (context_graph) {
+      p.context_state = context_graph->Root();
+    }
+    cur.emplace(SequenceTrie::kRoot, std::move(p));
+  }
+
+  Prefixes next;
+
+  // Return the entry of id in next. A new entry copies the context
+  // state and timestamps of prefix.
+  auto get_same = [&next](int32_t id, const Prefix &prefix) -> Prefix & {
+    auto it = next.find(id);
+    if (it == next.end()) {
+      Prefix p;
+      p.context_score = prefix.context_score;
+      p.context_state = prefix.context_state;
+      p.timestamps = prefix.timestamps;
+      it = next.emplace(id, std::move(p)).first;
+    } else {
+      // It was created by extending a shorter prefix at frame t. Keep the
+      // frame where the last token first appeared.
+      it->second.timestamps = prefix.timestamps;
+    }
+    return it->second;
+  };
+
+  // Return the entry of id + [token] in next
+  auto get_extended = [&next, &tokens, &timestamps, context_graph](
+                          int32_t id, int32_t token, const Prefix &prefix,
+                          int32_t t) -> Prefix & {
+    int32_t new_id = tokens.Child(id, token);
+
+    auto it = next.find(new_id);
+    if (it == next.end()) {
+      Prefix p;
+      p.context_score = prefix.context_score;
+      p.context_state = prefix.context_state;
+      if (context_graph) {
+        auto context_res =
+            context_graph->ForwardOneStep(prefix.context_state, token);
+        p.context_score += context_res.first;
+        p.context_state = context_res.second;
+      }
+      p.timestamps = timestamps.Child(prefix.timestamps, t);
+      it = next.emplace(new_id, std::move(p)).first;
+    }
+    return it->second;
+  };
+
+  std::vector<std::pair<float, Prefixes::iterator>> scores;
+  for (int32_t t = 0; t != num_frames; ++t) {
+    next.clear();
+
+    for (const auto &kv : cur) {
+      int32_t id = kv.first;
+      const Prefix &prefix = kv.second;
+      float total = prefix.Total();
+      int32_t last = tokens.Back(id);
+
+      for (int32_t k = 0; k != top_k; ++k) {
+        float lp = values_acc[t][k];
+        int32_t token = indexes_acc[t][k];
+
+        if (token == blank_id_) {
+          Prefix &p = get_same(id, prefix);
+          p.blank = log_add(p.blank, total + lp);
+        } else if (token == last) {
+          // A repeated token without a blank in between is merged
+          Prefix &p = get_same(id, prefix);
+          p.non_blank = log_add(p.non_blank, prefix.non_blank + lp);
+
+          // A repeated token after a blank is a new token
+          if (prefix.blank != kNegInf) {
+            Prefix &e = get_extended(id, token, prefix, t);
+            e.non_blank = log_add(e.non_blank, prefix.blank + lp);
+          }
+        } else {
+          Prefix &e = get_extended(id, token, prefix, t);
+          e.non_blank = log_add(e.non_blank, total + lp);
+        }
+      }
+    }
+
+    // Keep only the best num_active_paths_ prefixes
+    scores.clear();
+    for (auto it = next.begin(); it != next.end(); ++it) {
+      scores.emplace_back(it->second.Score(), it);
+    }
+
+    int32_t num_kept = std::min<int32_t>(num_active_paths_, scores.size());
+    std::partial_sort(
+        scores.begin(), scores.begin() + num_kept, scores.end(),
+        [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    cur.clear();
+    for (int32_t i = 0; i != num_kept; ++i) {
+      auto it = scores[i].second;
+      cur.emplace(it->first, std::move(it->second));
+    }
+  }
+
+  // Select the best prefix after removing the bonus of partially matched
+  // hotwords
+  int32_t best_id = -1;
+  const Prefix *best = nullptr;
+  float best_score = kNegInf;
+  for (const auto &kv : cur) {
+    float score = kv.second.Score();
+    if (context_graph) {
+      score += context_graph->Finalize(kv.second.context_state).first;
+    }
+
+    if (best == nullptr || score > best_score) {
+      best_id = kv.first;
+      best = &kv.second;
+      best_score = score;
+    }
+  }
+
+  OfflineCtcDecoderResult ans;
+  if (best != nullptr) {
+    ans.tokens = tokens.Get(best_id);
+    ans.timestamps = timestamps.Get(best->timestamps);
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa
@@ -0,0 +1,64 @@
+// sherpa/csrc/offline-ctc-prefix-beam-search-decoder.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
+#define SHERPA_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
+
+#include <vector>
+
+#include "sherpa/cpp_api/offline-stream.h"
+#include "sherpa/csrc/offline-ctc-decoder.h"
+
+namespace sherpa {
+
+// CTC prefix beam search on CPU.
+//
+// If a stream has a ContextGraph, e.g., created by
+// OfflineRecognizer::CreateStream(context_list), its hotwords are boosted
+// when a prefix is extended with a new token.
+class OfflineCtcPrefixBeamSearchDecoder : public OfflineCtcDecoder {
+ public:
+  /**
+   * @param num_active_paths Number of prefixes kept after each frame.
+   * @param top_k  Only the top_k tokens of each frame are used to extend
+   *               the prefixes.
+   * @param blank_id  ID of the blank token.
+   */
+  OfflineCtcPrefixBeamSearchDecoder(int32_t num_active_paths, int32_t top_k,
+                                    int32_t blank_id = 0)
+      : num_active_paths_(num_active_paths),
+        top_k_(top_k),
+        blank_id_(blank_id) {}
+
+  /** Utterances in the batch are decoded in parallel with
+   * at::parallel_for(), so the number of threads is given by
+   * torch::set_num_threads().
+   */
+  std::vector<OfflineCtcDecoderResult> Decode(
+      torch::Tensor log_prob, torch::Tensor log_prob_len,
+      int32_t subsampling_factor = 1, OfflineStream **ss = nullptr,
+      int32_t n = 0) override;
+
+ private:
+  /**
+   * @param values  A 2-D tensor of shape (T, top_k) on CPU containing
+   *                the largest log probs of each frame.
+   * @param indexes A 2-D tensor of shape (T, top_k) on CPU containing
+   *                the token IDs of values.
+   * @param num_frames  Number of valid frames.
+   * @param context_graph  Can be null.
+   */
+  OfflineCtcDecoderResult DecodeOne(const torch::Tensor &values,
+                                    const torch::Tensor &indexes,
+                                    int32_t num_frames,
+                                    const ContextGraph *context_graph) const;
+
+ private:
+  int32_t num_active_paths_;
+  int32_t top_k_;
+  int32_t blank_id_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
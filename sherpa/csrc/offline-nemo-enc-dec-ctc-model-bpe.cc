@@ -4,14 +4,21 @@
 
 #include "sherpa/csrc/offline-nemo-enc-dec-ctc-model-bpe.h"
 
+#include <utility>
+
 #include "sherpa/cpp_api/macros.h"
 
 namespace sherpa {
 
 OfflineNeMoEncDecCTCModelBPE::OfflineNeMoEncDecCTCModelBPE(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OfflineNeMoEncDecCTCModelBPE(torch::jit::load(filename, device),
+                                   device) {}
+
+OfflineNeMoEncDecCTCModelBPE::OfflineNeMoEncDecCTCModelBPE(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
+  model_ = std::move(model);
   model_.eval();
 }
 
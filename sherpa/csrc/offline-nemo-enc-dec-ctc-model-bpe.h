@@ -25,6 +25,13 @@ class OfflineNeMoEncDecCTCModelBPE : public OfflineCtcModel {
   explicit OfflineNeMoEncDecCTCModelBPE(const std::string &filename,
                                         torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OfflineNeMoEncDecCTCModelBPE(torch::jit::Module model,
+                                        torch::Device device = torch::kCPU);
+
   torch::Device Device() const override { return device_; }
 
   int32_t SubsamplingFactor() const override { return subsampling_factor_; }
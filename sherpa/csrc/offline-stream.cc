@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 #include "sherpa/cpp_api/feature-config.h"
@@ -88,8 +89,20 @@ class OfflineStream::OfflineStreamImpl {
                     .clone();
   }
 
+  // Set features computed from audio samples outside of this class
+  void SetFeatures(torch::Tensor features) {
+    features_ = Normalize(features);
+  }
+
+  // Used only when feat_config_.return_waveform is true
+  void SetWaveform(torch::Tensor samples) { features_ = samples; }
+
   const torch::Tensor &GetFeatures() const { return features_; }
 
+  kaldifeat::Fbank *GetFbank() const { return fbank_; }
+
+  const FeatureConfig &GetFeatureConfig() const { return feat_config_; }
+
   void SetResult(const OfflineRecognitionResult &r) { result_ = r; }
 
   const OfflineRecognitionResult &GetResult() const { return result_; }
@@ -138,6 +151,50 @@ void OfflineStream::AcceptSamples(const float *samples, int32_t n) {
   impl_->AcceptSamples(samples, n);
 }
 
+void OfflineStream::AcceptSamples(OfflineStream **ss,
+                                  const float *const *samples,
+                                  const int32_t *n, int32_t num_streams) {
+  if (num_streams == 0) {
+    return;
+  }
+
+  kaldifeat::Fbank *fbank = ss[0]->impl_->GetFbank();
+  const FeatureConfig &feat_config = ss[0]->impl_->GetFeatureConfig();
+
+  std::vector<torch::Tensor> wave_data;
+  wave_data.reserve(num_streams);
+  for (int32_t i = 0; i != num_streams; ++i) {
+    SHERPA_CHECK_EQ(ss[i]->impl_->GetFbank(), fbank)
+        << "Streams should be created by the same recognizer";
+
+    torch::Tensor tensor = torch::from_blob(const_cast<float *>(samples[i]),
+                                            {n[i]}, torch::kFloat);
+
+    // Unlike AcceptSamples() for a single stream, we don't scale the input
+    // in-place
+    if (!feat_config.normalize_samples) {
+      tensor = tensor * 32767;
+    } else if (feat_config.return_waveform) {
+      tensor = tensor.clone();
+    }
+
+    wave_data.push_back(std::move(tensor));
+  }
+
+  if (feat_config.return_waveform) {
+    // We return audio samples directly, e.g., for Wav2Vec2.0
+    for (int32_t i = 0; i != num_streams; ++i) {
+      ss[i]->impl_->SetWaveform(wave_data[i]);
+    }
+    return;
+  }
+
+  std::vector<torch::Tensor> features = ComputeFeatures(*fbank, wave_data);
+  for (int32_t i = 0; i != num_streams; ++i) {
+    ss[i]->impl_->SetFeatures(features[i]);
+  }
+}
+
 void OfflineStream::AcceptFeatures(const float *features, int32_t num_frames,
                                    int32_t num_channels) {
   impl_->AcceptFeatures(features, num_frames, num_channels);
@@ -10,14 +10,21 @@
 namespace sherpa {
 
 OfflineTransducerFastBeamSearchDecoder::OfflineTransducerFastBeamSearchDecoder(
-    OfflineTransducerModel *model, const FastBeamSearchConfig &config)
+    OfflineTransducerModel *model, const FastBeamSearchConfig &config,
+    k2::FsaClassPtr lg /*= nullptr*/)
     : model_(model), config_(config), vocab_size_(model->VocabSize()) {
   if (config.lg.empty()) {
     // Use a trivial graph
     decoding_graph_ = k2::GetTrivialGraph(vocab_size_ - 1, model_->Device());
   } else {
-    decoding_graph_ = k2::LoadFsaClass(config.lg, model_->Device());
-    k2::ScaleTensorAttribute(decoding_graph_, config.ngram_lm_scale, "scores");
+    if (lg) {
+      // It is already scaled
+      decoding_graph_ = lg;
+    } else {
+      decoding_graph_ = k2::LoadFsaClass(config.lg, model_->Device());
+      k2::ScaleTensorAttribute(decoding_graph_, config.ngram_lm_scale,
+                               "scores");
+    }
   }
 }
 
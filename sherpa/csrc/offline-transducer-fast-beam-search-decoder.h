@@ -15,8 +15,15 @@ namespace sherpa {
 
 class OfflineTransducerFastBeamSearchDecoder : public OfflineTransducerDecoder {
  public:
+  /**
+   * @param lg If not null, it is the graph loaded from config.lg
+   *           on the device of the model with its scores already multiplied
+   *           by config.ngram_lm_scale so that we don't load it again.
+   *           It may be shared with other decoders and is not modified.
+   */
   OfflineTransducerFastBeamSearchDecoder(OfflineTransducerModel *model,
-                                         const FastBeamSearchConfig &config);
+                                         const FastBeamSearchConfig &config,
+                                         k2::FsaClassPtr lg = nullptr);
 
   /** Run fast_beam_search given the output from the encoder model.
    *
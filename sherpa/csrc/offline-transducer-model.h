@@ -6,6 +6,7 @@
 
 #include <utility>
 
+#include "sherpa/csrc/module-optimizer.h"
 #include "torch/script.h"
 
 namespace sherpa {
@@ -53,6 +54,16 @@ class OfflineTransducerModel {
   virtual torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                                   const torch::Tensor &decoder_out) = 0;
 
+  /** Replace the encoder, decoder, and joiner with frozen versions that
+   * are optimized for inference. See ModuleOptimizer for details.
+   *
+   * It should be called after construction and before WarmUp().
+   * If the model is constructed from the module of
+   * ModuleOptimizer::LoadCache(), the modules are taken from the cache.
+   * The default implementation does nothing.
+   */
+  virtual void OptimizeForInference(ModuleOptimizer * /*optimizer*/) {}
+
   /** Return the device where computation takes place.
    *
    * Note: We don't support moving the model to a different device
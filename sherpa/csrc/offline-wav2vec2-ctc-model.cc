@@ -4,14 +4,20 @@
 
 #include "sherpa/csrc/offline-wav2vec2-ctc-model.h"
 
+#include <utility>
+
 #include "sherpa/cpp_api/macros.h"
 
 namespace sherpa {
 
 OfflineWav2Vec2CtcModel::OfflineWav2Vec2CtcModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OfflineWav2Vec2CtcModel(torch::jit::load(filename, device), device) {}
+
+OfflineWav2Vec2CtcModel::OfflineWav2Vec2CtcModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
+  model_ = std::move(model);
   model_.eval();
 }
 
@@ -24,6 +24,13 @@ class OfflineWav2Vec2CtcModel : public OfflineCtcModel {
   explicit OfflineWav2Vec2CtcModel(const std::string &filename,
                                    torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OfflineWav2Vec2CtcModel(torch::jit::Module model,
+                                   torch::Device device = torch::kCPU);
+
   torch::Device Device() const override { return device_; }
 
   int32_t SubsamplingFactor() const override {
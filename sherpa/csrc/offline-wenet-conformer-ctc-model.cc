@@ -4,14 +4,21 @@
 
 #include "sherpa/csrc/offline-wenet-conformer-ctc-model.h"
 
+#include <utility>
+
 #include "sherpa/cpp_api/macros.h"
 
 namespace sherpa {
 
 OfflineWenetConformerCtcModel::OfflineWenetConformerCtcModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OfflineWenetConformerCtcModel(torch::jit::load(filename, device),
+                                    device) {}
+
+OfflineWenetConformerCtcModel::OfflineWenetConformerCtcModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
+  model_ = std::move(model);
   model_.eval();
 
   subsampling_factor_ = model_.run_method("subsampling_rate").toInt();
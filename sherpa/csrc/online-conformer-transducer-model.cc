@@ -15,11 +15,18 @@ namespace sherpa {
 OnlineConformerTransducerModel::OnlineConformerTransducerModel(
     const std::string &filename, int32_t left_context, int32_t right_context,
     int32_t decode_chunk_size, torch::Device device /*= torch::kCPU*/)
+    : OnlineConformerTransducerModel(torch::jit::load(filename, device),
+                                     left_context, right_context,
+                                     decode_chunk_size, device) {}
+
+OnlineConformerTransducerModel::OnlineConformerTransducerModel(
+    torch::jit::Module model, int32_t left_context, int32_t right_context,
+    int32_t decode_chunk_size, torch::Device device /*= torch::kCPU*/)
     : device_(device),
       left_context_(left_context),
       right_context_(right_context) {
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
@@ -28,7 +35,7 @@ OnlineConformerTransducerModel::OnlineConformerTransducerModel(
   encoder_proj_ = joiner_.attr("encoder_proj").toModule();
   decoder_proj_ = joiner_.attr("decoder_proj").toModule();
 
-  int32_t subsampling_factor = encoder_.attr("subsampling_factor").toInt();
+  subsampling_factor_ = encoder_.attr("subsampling_factor").toInt();
 
   context_size_ = decoder_.attr("context_size").toInt();
 
@@ -38,7 +45,7 @@ OnlineConformerTransducerModel::OnlineConformerTransducerModel(
   // of encoder_embed output (in conformer.py) to avoid a training
   // and decoding mismatch by seeing padding values.
   int32_t pad_length =
-      2 * subsampling_factor + right_context + (subsampling_factor - 1);
+      2 * subsampling_factor_ + right_context + (subsampling_factor_ - 1);
   chunk_shift_ = decode_chunk_size;
   chunk_size_ = chunk_shift_ + pad_length;
   // Note: Differences from the conv-emformer:
@@ -143,4 +150,14 @@ torch::Tensor OnlineConformerTransducerModel::RunJoiner(
       .toTensor();
 }
 
+void OnlineConformerTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(encoder_, "encoder", {"subsampling_factor"});
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"context_size"});
+  joiner_ =
+      optimizer->Optimize(joiner_, "joiner", {"encoder_proj", "decoder_proj"});
+  encoder_proj_ = optimizer->Optimize(encoder_proj_, "encoder_proj");
+  decoder_proj_ = optimizer->Optimize(decoder_proj_, "decoder_proj");
+}
+
 }  // namespace sherpa
@@ -39,6 +39,14 @@ class OnlineConformerTransducerModel : public OnlineTransducerModel {
                                  int32_t decode_chunk_size,
                                  torch::Device device = torch::kCPU);
 
+  /** Same as the above one except that it takes a model that has been
+   * loaded by torch::jit::load() on the given device.
+   */
+  OnlineConformerTransducerModel(torch::jit::Module model,
+                                 int32_t left_context, int32_t right_context,
+                                 int32_t decode_chunk_size,
+                                 torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -55,6 +63,8 @@ class OnlineConformerTransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -63,6 +73,8 @@ class OnlineConformerTransducerModel : public OnlineTransducerModel {
 
   int32_t ChunkShift() const override { return chunk_shift_; }
 
+  int32_t SubsamplingFactor() const override { return subsampling_factor_; }
+
   // Non virtual methods that used by Python bindings.
 
   // See
@@ -92,6 +104,7 @@ class OnlineConformerTransducerModel : public OnlineTransducerModel {
   int32_t context_size_;
   int32_t chunk_size_;
   int32_t chunk_shift_;
+  int32_t subsampling_factor_;
 
  private:
 };
@@ -15,9 +15,14 @@ namespace sherpa {
 
 OnlineConvEmformerTransducerModel::OnlineConvEmformerTransducerModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OnlineConvEmformerTransducerModel(torch::jit::load(filename, device),
+                                        device) {}
+
+OnlineConvEmformerTransducerModel::OnlineConvEmformerTransducerModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
@@ -33,8 +38,8 @@ OnlineConvEmformerTransducerModel::OnlineConvEmformerTransducerModel(
   auto right_context_length = encoder_.attr("right_context_length").toInt();
   // Add 2 here since we will drop the first and last frame after subsampling;
   // Add 3 here since the subsampling is ((len - 1) // 2 - 1) // 2.
-  auto pad_length = right_context_length +
-                    2 * encoder_.attr("subsampling_factor").toInt() + 3;
+  subsampling_factor_ = encoder_.attr("subsampling_factor").toInt();
+  auto pad_length = right_context_length + 2 * subsampling_factor_ + 3;
 
   chunk_size_ = chunk_length + pad_length;
   chunk_shift_ = chunk_length;
@@ -247,4 +252,16 @@ torch::Tensor OnlineConvEmformerTransducerModel::RunJoiner(
       .toTensor();
 }
 
+void OnlineConvEmformerTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(
+      encoder_, "encoder",
+      {"chunk_length", "right_context_length", "subsampling_factor"});
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"context_size"});
+  joiner_ =
+      optimizer->Optimize(joiner_, "joiner", {"encoder_proj", "decoder_proj"});
+  encoder_proj_ = optimizer->Optimize(encoder_proj_, "encoder_proj");
+  decoder_proj_ = optimizer->Optimize(decoder_proj_, "decoder_proj");
+}
+
 }  // namespace sherpa
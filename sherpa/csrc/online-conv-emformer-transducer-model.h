@@ -35,6 +35,13 @@ class OnlineConvEmformerTransducerModel : public OnlineTransducerModel {
   explicit OnlineConvEmformerTransducerModel(
       const std::string &filename, torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OnlineConvEmformerTransducerModel(
+      torch::jit::Module model, torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -51,6 +58,8 @@ class OnlineConvEmformerTransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -59,6 +68,8 @@ class OnlineConvEmformerTransducerModel : public OnlineTransducerModel {
 
   int32_t ChunkShift() const override { return chunk_shift_; }
 
+  int32_t SubsamplingFactor() const override { return subsampling_factor_; }
+
   // Non virtual methods that used by Python bindings.
 
   // See
@@ -84,6 +95,7 @@ class OnlineConvEmformerTransducerModel : public OnlineTransducerModel {
   int32_t context_size_;
   int32_t chunk_size_;
   int32_t chunk_shift_;
+  int32_t subsampling_factor_;
 };
 
 }  // namespace sherpa
@@ -15,9 +15,14 @@ namespace sherpa {
 
 OnlineEmformerTransducerModel::OnlineEmformerTransducerModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OnlineEmformerTransducerModel(torch::jit::load(filename, device),
+                                    device) {}
+
+OnlineEmformerTransducerModel::OnlineEmformerTransducerModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
@@ -25,10 +30,10 @@ OnlineEmformerTransducerModel::OnlineEmformerTransducerModel(
 
   context_size_ = decoder_.attr("context_size").toInt();
 
-  int32_t subsampling_factor = encoder_.attr("subsampling_factor").toInt();
+  subsampling_factor_ = encoder_.attr("subsampling_factor").toInt();
   int32_t chunk_length = encoder_.attr("segment_length").toInt();
   int32_t right_context_length = encoder_.attr("right_context_length").toInt();
-  int32_t pad_length = right_context_length + subsampling_factor - 1;
+  int32_t pad_length = right_context_length + subsampling_factor_ - 1;
 
   chunk_size_ = chunk_length + pad_length;
   chunk_shift_ = chunk_length;
@@ -176,4 +181,13 @@ torch::Tensor OnlineEmformerTransducerModel::RunJoiner(
   return joiner_.run_method("forward", encoder_out, decoder_out).toTensor();
 }
 
+void OnlineEmformerTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(
+      encoder_, "encoder",
+      {"subsampling_factor", "segment_length", "right_context_length"});
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"context_size"});
+  joiner_ = optimizer->Optimize(joiner_, "joiner");
+}
+
 }  // namespace sherpa
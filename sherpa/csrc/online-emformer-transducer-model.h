@@ -33,6 +33,13 @@ class OnlineEmformerTransducerModel : public OnlineTransducerModel {
   explicit OnlineEmformerTransducerModel(const std::string &filename,
                                          torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OnlineEmformerTransducerModel(torch::jit::Module model,
+                                         torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -49,6 +56,8 @@ class OnlineEmformerTransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -57,6 +66,8 @@ class OnlineEmformerTransducerModel : public OnlineTransducerModel {
 
   int32_t ChunkShift() const override { return chunk_shift_; }
 
+  int32_t SubsamplingFactor() const override { return subsampling_factor_; }
+
   // Non virtual methods that used by Python bindings.
 
   // See
@@ -84,6 +95,7 @@ class OnlineEmformerTransducerModel : public OnlineTransducerModel {
   int32_t context_size_;
   int32_t chunk_size_;
   int32_t chunk_shift_;
+  int32_t subsampling_factor_;
 };
 
 }  // namespace sherpa
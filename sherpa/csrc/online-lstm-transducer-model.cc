@@ -16,15 +16,23 @@ namespace sherpa {
 OnlineLstmTransducerModel::OnlineLstmTransducerModel(
     const std::string &encoder_filename, const std::string &decoder_filename,
     const std::string &joiner_filename, torch::Device device /*=torch::kCPU*/)
+    : OnlineLstmTransducerModel(
+          torch::jit::load(encoder_filename, device),
+          torch::jit::load(decoder_filename, device),
+          torch::jit::load(joiner_filename, device), device) {}
+
+OnlineLstmTransducerModel::OnlineLstmTransducerModel(
+    torch::jit::Module encoder, torch::jit::Module decoder,
+    torch::jit::Module joiner, torch::Device device /*=torch::kCPU*/)
     : device_(device) {
-  encoder_ = torch::jit::load(encoder_filename, device);
-  encoder_.eval();
+  encoder_ = std::move(encoder);
+  SetEvalMode(&encoder_);
 
-  decoder_ = torch::jit::load(decoder_filename, device);
-  encoder_.eval();
+  decoder_ = std::move(decoder);
+  SetEvalMode(&decoder_);
 
-  joiner_ = torch::jit::load(joiner_filename, device);
-  joiner_.eval();
+  joiner_ = std::move(joiner);
+  SetEvalMode(&joiner_);
 
   auto conv = decoder_.attr("conv").toModule();
 
@@ -137,4 +145,11 @@ torch::Tensor OnlineLstmTransducerModel::RunJoiner(
   return joiner_.run_method("forward", encoder_out, decoder_out).toTensor();
 }
 
+void OnlineLstmTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(encoder_, "encoder");
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"conv"});
+  joiner_ = optimizer->Optimize(joiner_, "joiner");
+}
+
 }  // namespace sherpa
@@ -35,6 +35,14 @@ class OnlineLstmTransducerModel : public OnlineTransducerModel {
                                      const std::string &joiner_filename,
                                      torch::Device device = torch::kCPU);
 
+  /** Same as the above one except that it takes models that have been
+   * loaded by torch::jit::load() on the given device.
+   */
+  OnlineLstmTransducerModel(torch::jit::Module encoder,
+                            torch::jit::Module decoder,
+                            torch::jit::Module joiner,
+                            torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -51,6 +59,8 @@ class OnlineLstmTransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -18,8 +18,11 @@
 
 #include "sherpa/cpp_api/online-stream.h"
 
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -33,11 +36,74 @@
 
 namespace sherpa {
 
+// Number of feature frames kept inside kaldifeat::OnlineFbank. Frames are
+// moved to OnlineStreamImpl::frames_ as soon as they are computed, so the
+// fbank computer needs to hold only the frames of a single call to
+// AcceptWaveform(); see kMaxFramesPerCall below.
+static constexpr int32_t kMaxFbankFrames = 100;
+
+// We split the input waveform into pieces so that each call to
+// OnlineFbank::AcceptWaveform() produces at most this number of frames.
+// It must be less than kMaxFbankFrames.
+static constexpr int32_t kMaxFramesPerCall = 50;
+
+// Version of the format used by OnlineStream::Serialize(). Increase it
+// whenever the format is changed.
+static constexpr int64_t kSerializationVersion = 1;
+
+// Return the number of bytes of all tensors contained in the given IValue.
+static int64_t NumBytes(const torch::IValue &v) {
+  if (v.isTensor()) {
+    const auto &t = v.toTensor();
+    return t.defined() ? t.numel() * t.element_size() : 0;
+  }
+
+  int64_t ans = 0;
+  if (v.isTuple()) {
+    for (const auto &e : v.toTuple()->elements()) {
+      ans += NumBytes(e);
+    }
+  } else if (v.isList()) {
+    torch::List<torch::IValue> list = v.toList();
+    for (size_t i = 0; i != list.size(); ++i) {
+      ans += NumBytes(list.get(i));
+    }
+  }
+  return ans;
+}
+
+static torch::List<int64_t> ToList(const std::vector<int32_t> &v) {
+  return torch::List<int64_t>(std::vector<int64_t>(v.begin(), v.end()));
+}
+
+static std::vector<int32_t> ToVector(const torch::IValue &v) {
+  torch::List<int64_t> list = v.toIntList();
+  std::vector<int32_t> ans;
+  ans.reserve(list.size());
+  for (size_t i = 0; i != list.size(); ++i) {
+    ans.push_back(list.get(i));
+  }
+  return ans;
+}
+
+static torch::Tensor ToTensor(const std::vector<float> &v) {
+  return torch::tensor(v, torch::kFloat);
+}
+
+static std::vector<float> ToFloatVector(const torch::Tensor &t) {
+  torch::Tensor c = t.contiguous().to(torch::kFloat);
+  const float *p = c.data_ptr<float>();
+  return std::vector<float>(p, p + c.numel());
+}
+
 class OnlineStream::OnlineStreamImpl {
  public:
   explicit OnlineStreamImpl(const FeatureConfig &feat_config,
                             ContextGraphPtr context_graph /*=nullptr*/)
       : opts_(feat_config.fbank_opts), feat_config_(feat_config), context_graph_(context_graph) {
+    // Processed frames are discarded by GetFrame(), so we don't need
+    // OnlineFbank to keep all frames since the start of the stream.
+    opts_.frame_opts.max_feature_vectors = kMaxFbankFrames;
     fbank_ = std::make_unique<kaldifeat::OnlineFbank>(opts_);
   }
 
@@ -57,7 +123,7 @@ class OnlineStream::OnlineStreamImpl {
       }
 
       waveform = resampler_->Resample(waveform, false);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, waveform);
+      AcceptWaveformImpl(waveform);
       return;
     }
 
@@ -67,41 +133,217 @@ class OnlineStream::OnlineStreamImpl {
                        << "   output_sample_rate: "
                        << static_cast<int32_t>(opts_.frame_opts.samp_freq);
 
-      float min_freq =
-          std::min<int32_t>(sampling_rate, opts_.frame_opts.samp_freq);
-      float lowpass_cutoff = 0.99 * 0.5 * min_freq;
-
-      int32_t lowpass_filter_width = 6;
-      resampler_ = std::make_unique<LinearResample>(
-          sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
-          lowpass_filter_width);
+      CreateResampler(sampling_rate);
 
       waveform = resampler_->Resample(waveform, false);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, waveform);
+      AcceptWaveformImpl(waveform);
       return;
     }
 
-    fbank_->AcceptWaveform(sampling_rate, waveform);
+    AcceptWaveformImpl(waveform);
   }
 
   int32_t NumFramesReady() const {
     std::lock_guard<std::mutex> lock(feat_mutex_);
-    return fbank_->NumFramesReady();
+    return frame_offset_ + static_cast<int32_t>(frames_.size());
   }
 
   bool IsLastFrame(int32_t frame) const {
     std::lock_guard<std::mutex> lock(feat_mutex_);
-    return fbank_->IsLastFrame(frame);
+    return input_finished_ &&
+           frame == frame_offset_ + static_cast<int32_t>(frames_.size()) - 1;
   }
 
   void InputFinished() {
     std::lock_guard<std::mutex> lock(feat_mutex_);
+    input_finished_ = true;
     fbank_->InputFinished();
+    FetchFrames();
+
+    // No more frames will be computed
+    tail_.clear();
   }
 
   torch::Tensor GetFrame(int32_t frame) {
     std::lock_guard<std::mutex> lock(feat_mutex_);
-    return fbank_->GetFrame(frame);
+
+    // Frames before num_processed_frames_ are never accessed again, so
+    // we discard them here to keep the memory usage bounded for
+    // long-lived streams.
+    int32_t num_to_discard =
+        std::min<int32_t>(num_processed_frames_ - frame_offset_,
+                          frames_.size());
+    if (num_to_discard > 0) {
+      frames_.erase(frames_.begin(), frames_.begin() + num_to_discard);
+      frame_offset_ += num_to_discard;
+    }
+
+    if (frame < frame_offset_ ||
+        frame >= frame_offset_ + static_cast<int32_t>(frames_.size())) {
+      SHERPA_LOG(FATAL) << "Frame " << frame << " is not available. "
+                        << "Available frames: [" << frame_offset_ << ", "
+                        << frame_offset_ + frames_.size() << ")";
+    }
+
+    return frames_[frame - frame_offset_];
+  }
+
+  int64_t MemoryFootprint() const {
+    int64_t ans = 0;
+    {
+      std::lock_guard<std::mutex> lock(feat_mutex_);
+      for (const auto &f : frames_) {
+        ans += NumBytes(f);
+      }
+    }
+
+    ans += tail_.size() * sizeof(float);
+    ans += NumBytes(state_);
+    ans += NumBytes(decoder_out_);
+    return ans;
+  }
+
+  std::string Serialize() const {
+    if (r_.rnnt_stream) {
+      SHERPA_LOG(FATAL) << "Serializing a stream is not supported for "
+                        << "fast_beam_search";
+    }
+
+    std::lock_guard<std::mutex> lock(feat_mutex_);
+
+    std::vector<torch::Tensor> frames(frames_.begin(), frames_.end());
+    torch::Tensor features = frames.empty()
+                                 ? torch::empty({0}, torch::kFloat)
+                                 : torch::cat(frames, /*dim*/ 0);
+
+    torch::IValue resampler;  // None if there is no resampler
+    if (resampler_) {
+      int64_t input_sample_offset;
+      int64_t output_sample_offset;
+      std::vector<float> input_remainder;
+      resampler_->GetState(&input_sample_offset, &output_sample_offset,
+                           &input_remainder);
+      resampler = torch::ivalue::Tuple::create(
+          {static_cast<int64_t>(resampler_->GetInputSamplingRate()),
+           input_sample_offset, output_sample_offset,
+           ToTensor(input_remainder)});
+    }
+
+    std::vector<torch::IValue> hyp_list;
+    for (const auto &p : r_.hyps) {
+      const auto &h = p.second;
+      std::vector<int32_t> context_path;
+      if (context_graph_ && h.context_state) {
+        context_path = context_graph_->GetPath(h.context_state);
+      }
+      hyp_list.push_back(torch::ivalue::Tuple::create(
+          {ToList(h.ys), ToList(h.timestamps), h.log_prob,
+           static_cast<int64_t>(h.num_trailing_blanks),
+           ToList(context_path)}));
+    }
+
+    auto result = torch::ivalue::Tuple::create(
+        {static_cast<int64_t>(r_.frame_offset),
+         static_cast<int64_t>(r_.num_trailing_blanks), ToList(r_.tokens),
+         ToList(r_.timestamps), static_cast<int64_t>(r_.num_processed_frames),
+         torch::ivalue::Tuple::create(std::move(hyp_list))});
+
+    auto counters = torch::ivalue::Tuple::create(
+        {static_cast<int64_t>(num_processed_frames_),
+         static_cast<int64_t>(num_trailing_blank_frames_),
+         static_cast<int64_t>(segment_), static_cast<int64_t>(start_frame_),
+         static_cast<int64_t>(num_non_speech_frames_)});
+
+    torch::IValue decoder_out;  // None if it is not computed yet
+    if (decoder_out_.defined()) {
+      decoder_out = decoder_out_;
+    }
+
+    auto blob = torch::ivalue::Tuple::create(
+        {kSerializationVersion, state_, features,
+         static_cast<int64_t>(frame_offset_), ToTensor(tail_), tail_start_,
+         input_finished_, counters, decoder_out, result, resampler});
+
+    std::vector<char> data = torch::pickle_save(blob);
+    return std::string(data.begin(), data.end());
+  }
+
+  void Deserialize(const std::string &s) {
+    std::lock_guard<std::mutex> lock(feat_mutex_);
+
+    torch::IValue v = torch::pickle_load(std::vector<char>(s.begin(), s.end()));
+    const auto &blob = v.toTuple()->elements();
+
+    int64_t version = blob[0].toInt();
+    if (version != kSerializationVersion) {
+      SHERPA_LOG(FATAL) << "Unsupported serialization version: " << version
+                        << ". Expected: " << kSerializationVersion;
+    }
+
+    state_ = blob[1];
+
+    frames_.clear();
+    torch::Tensor features = blob[2].toTensor();
+    if (features.numel() > 0) {
+      for (const auto &f : features.split(1, /*dim*/ 0)) {
+        frames_.push_back(f);
+      }
+    }
+    frame_offset_ = blob[3].toInt();
+
+    const auto &counters = blob[7].toTuple()->elements();
+    num_processed_frames_ = counters[0].toInt();
+    num_trailing_blank_frames_ = counters[1].toInt();
+    segment_ = counters[2].toInt();
+    start_frame_ = counters[3].toInt();
+    num_non_speech_frames_ = counters[4].toInt();
+
+    decoder_out_ = blob[8].isNone() ? torch::Tensor() : blob[8].toTensor();
+
+    const auto &result = blob[9].toTuple()->elements();
+    r_ = {};
+    r_.frame_offset = result[0].toInt();
+    r_.num_trailing_blanks = result[1].toInt();
+    r_.tokens = ToVector(result[2]);
+    r_.timestamps = ToVector(result[3]);
+    r_.num_processed_frames = result[4].toInt();
+    for (const auto &e : result[5].toTuple()->elements()) {
+      const auto &t = e.toTuple()->elements();
+      Hypothesis h;
+      h.ys = ToVector(t[0]);
+      h.timestamps = ToVector(t[1]);
+      h.log_prob = t[2].toDouble();
+      h.num_trailing_blanks = t[3].toInt();
+      h.context_state = nullptr;
+      if (context_graph_) {
+        h.context_state = context_graph_->GetState(ToVector(t[4]));
+        if (!h.context_state) {
+          SHERPA_LOG(FATAL) << "The context graph of this stream does not "
+                            << "match the one used to serialize it";
+        }
+      }
+      r_.hyps.Add(std::move(h));
+    }
+
+    resampler_.reset();
+    if (!blob[10].isNone()) {
+      const auto &t = blob[10].toTuple()->elements();
+      CreateResampler(t[0].toInt());
+      resampler_->SetState(t[1].toInt(), t[2].toInt(),
+                           ToFloatVector(t[3].toTensor()));
+    }
+
+    // Replay the buffered samples into a new fbank computer. The first
+    // NumContextFrames() frames it computes may differ from the original
+    // ones and they are already in frames_, so FetchFrames() skips them.
+    int32_t window_shift = WindowShift();
+    tail_.clear();
+    tail_start_ = blob[5].toInt();
+    fbank_frame_offset_ = tail_start_ / window_shift;
+    fbank_ = std::make_unique<kaldifeat::OnlineFbank>(opts_);
+    AcceptWaveformImpl(blob[4].toTensor());
+
+    input_finished_ = blob[6].toBool();
   }
 
   torch::IValue GetState() const { return state_; }
@@ -124,18 +366,113 @@ class OnlineStream::OnlineStreamImpl {
 
   int32_t &GetStartFrame() { return start_frame_; }
 
+  int32_t &GetNumNonSpeechFrames() { return num_non_speech_frames_; }
+
+ private:
+  void CreateResampler(int32_t sampling_rate) {
+    float min_freq =
+        std::min<int32_t>(sampling_rate, opts_.frame_opts.samp_freq);
+    float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+
+    int32_t lowpass_filter_width = 6;
+    resampler_ = std::make_unique<LinearResample>(
+        sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
+        lowpass_filter_width);
+  }
+
+  int32_t WindowShift() const {
+    return opts_.frame_opts.samp_freq * opts_.frame_opts.frame_shift_ms / 1000;
+  }
+
+  // Number of frames before a given frame that are affected by the samples
+  // preceding the window of that frame. It is non-zero only when
+  // snip_edges is false, in which case the first few frames reflect the
+  // samples at the start of the signal.
+  int32_t NumContextFrames() const {
+    if (opts_.frame_opts.snip_edges) {
+      return 0;
+    }
+
+    int32_t window_shift = WindowShift();
+    int32_t window_size = opts_.frame_opts.WindowSize();
+    int32_t n = std::max<int32_t>(0, window_size - window_shift);
+    return (n + 2 * window_shift - 1) / (2 * window_shift);
+  }
+
+  // Feed samples to the fbank computer and move the computed frames
+  // to frames_.
+  //
+  // The caller should hold feat_mutex_.
+  void AcceptWaveformImpl(const torch::Tensor &waveform) {
+    float sampling_rate = opts_.frame_opts.samp_freq;
+    int32_t window_shift = WindowShift();
+    int32_t max_samples = kMaxFramesPerCall * window_shift;
+    int32_t num_samples = waveform.numel();
+
+    torch::Tensor w = waveform.contiguous().to(torch::kFloat);
+    const float *p = w.data_ptr<float>();
+    tail_.insert(tail_.end(), p, p + num_samples);
+
+    for (int32_t start = 0; start < num_samples; start += max_samples) {
+      int32_t end = std::min(start + max_samples, num_samples);
+      fbank_->AcceptWaveform(
+          sampling_rate, w.index({torch::indexing::Slice(start, end)}));
+      FetchFrames();
+    }
+
+    // Keep only the samples needed to recompute the frames that are not
+    // computed yet, plus the context frames before them. See Serialize().
+    int32_t num_frames = frame_offset_ + frames_.size();
+    int64_t keep_from =
+        static_cast<int64_t>(std::max(0, num_frames - NumContextFrames())) *
+        window_shift;
+    if (keep_from > tail_start_) {
+      int64_t n = std::min<int64_t>(keep_from - tail_start_, tail_.size());
+      tail_.erase(tail_.begin(), tail_.begin() + n);
+      tail_start_ += n;
+    }
+  }
+
+  // Move newly computed frames from fbank_ to frames_.
+  //
+  // The caller should hold feat_mutex_.
+  void FetchFrames() {
+    int32_t num_frames = fbank_frame_offset_ + fbank_->NumFramesReady();
+    for (int32_t i = frame_offset_ + frames_.size(); i < num_frames; ++i) {
+      frames_.push_back(fbank_->GetFrame(i - fbank_frame_offset_));
+    }
+  }
+
  private:
   kaldifeat::FbankOptions opts_;
   std::unique_ptr<kaldifeat::OnlineFbank> fbank_;
   FeatureConfig feat_config_;
   mutable std::mutex feat_mutex_;
 
+  // frames_[i] is the frame with index frame_offset_ + i since the start
+  // of the stream. Frames before frame_offset_ have been discarded.
+  std::deque<torch::Tensor> frames_;
+  int32_t frame_offset_ = 0;
+
+  // Frame i of fbank_ is the frame with index fbank_frame_offset_ + i
+  // since the start of the stream. It is non-zero only for streams
+  // restored by Deserialize().
+  int32_t fbank_frame_offset_ = 0;
+
+  // Samples (after resampling) that are needed to recompute the frames
+  // not computed yet. tail_[0] is the sample with index tail_start_ since
+  // the start of the stream.
+  std::vector<float> tail_;
+  int64_t tail_start_ = 0;
+  bool input_finished_ = false;
+
   torch::IValue state_;
   std::vector<int32_t> hyps_;
   Hypotheses hypotheses_;
   torch::Tensor decoder_out_;
   int32_t num_processed_frames_ = 0;       // before subsampling
   int32_t num_trailing_blank_frames_ = 0;  // after subsampling
+  int32_t num_non_speech_frames_ = 0;      // before subsampling
   /// ID of this segment
   int32_t segment_ = 0;
 
@@ -193,6 +530,20 @@ int32_t &OnlineStream::GetWavSegment() { return impl_->GetWavSegment(); }
 
 int32_t &OnlineStream::GetStartFrame() { return impl_->GetStartFrame(); }
 
+int32_t &OnlineStream::GetNumNonSpeechFrames() {
+  return impl_->GetNumNonSpeechFrames();
+}
+
+std::string OnlineStream::Serialize() const { return impl_->Serialize(); }
+
+void OnlineStream::Deserialize(const std::string &blob) {
+  impl_->Deserialize(blob);
+}
+
+int64_t OnlineStream::MemoryFootprint() const {
+  return impl_->MemoryFootprint();
+}
+
 void OnlineStream::SetResult(const OnlineTransducerDecoderResult &r) {
   impl_->SetResult(r);
 }
@@ -35,6 +35,10 @@ struct OnlineTransducerDecoderResult {
 
   // Before subsampling. Used only for fast_beam_search
   int32_t num_processed_frames = 0;
+
+  // Number of chunks decoded since tokens and timestamps were last
+  // obtained from the lattice. Used only for fast_beam_search
+  int32_t num_pending_chunks = 0;
 };
 
 class OnlineTransducerDecoder {
@@ -55,7 +59,9 @@ class OnlineTransducerDecoder {
   /* Finalize the context graph searching, it will subtract the bonus of
    * partial matching hypothesis.
    *
-   * Used only in modified_beam_search and when context_graph is given.
+   * Used in modified_beam_search when context_graph is given. For
+   * fast_beam_search, it gets the result from the lattice if it is
+   * out of date.
    */
   virtual void FinalizeResult(OnlineStream * /*s*/,
                               OnlineTransducerDecoderResult * /*r*/) {}
@@ -78,6 +84,20 @@ class OnlineTransducerDecoder {
                       std::vector<OnlineTransducerDecoderResult> *result) {
     SHERPA_LOG(FATAL) << "This interface is for ModifiedBeamSearchDecoder.";
   }
+
+  /** Advance the result by the given number of encoder output frames
+   * without running the decoder and the joiner, as if all of them were
+   * decoded to blanks.
+   *
+   * It is used to skip chunks that contain only silence.
+   *
+   * @param num_frames Number of frames after subsampling to skip.
+   * @param r The result to update.
+   */
+  virtual void SkipFrames(int32_t num_frames,
+                          OnlineTransducerDecoderResult *r) {
+    SHERPA_LOG(FATAL) << "Skipping frames is not supported by this decoder.";
+  }
 };
 }  // namespace sherpa
 
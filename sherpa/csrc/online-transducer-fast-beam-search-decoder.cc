@@ -5,6 +5,7 @@
 #include "sherpa/csrc/online-transducer-fast-beam-search-decoder.h"
 
 #include <utility>
+#include <vector>
 
 #include "k2/torch_api.h"
 #include "sherpa/csrc/online-transducer-decoder.h"
@@ -12,14 +13,21 @@
 namespace sherpa {
 
 OnlineTransducerFastBeamSearchDecoder::OnlineTransducerFastBeamSearchDecoder(
-    OnlineTransducerModel *model, const FastBeamSearchConfig &config)
+    OnlineTransducerModel *model, const FastBeamSearchConfig &config,
+    k2::FsaClassPtr lg /*= nullptr*/)
     : model_(model), config_(config), vocab_size_(model->VocabSize()) {
   if (config.lg.empty()) {
     // Use a trivial graph
     decoding_graph_ = k2::GetTrivialGraph(vocab_size_ - 1, model_->Device());
   } else {
-    decoding_graph_ = k2::LoadFsaClass(config.lg, model_->Device());
-    k2::ScaleTensorAttribute(decoding_graph_, config.ngram_lm_scale, "scores");
+    if (lg) {
+      // It is already scaled
+      decoding_graph_ = lg;
+    } else {
+      decoding_graph_ = k2::LoadFsaClass(config.lg, model_->Device());
+      k2::ScaleTensorAttribute(decoding_graph_, config.ngram_lm_scale,
+                               "scores");
+    }
   }
 }
 
@@ -42,21 +50,12 @@ void OnlineTransducerFastBeamSearchDecoder::Decode(
   int32_t context_size = model_->ContextSize();
 
   std::vector<k2::RnntStreamPtr> stream_vec;
-  std::vector<int32_t> num_processed_frames_vec;
-
   stream_vec.reserve(results->size());
-  num_processed_frames_vec.reserve(results->size());
 
   for (auto &r : *results) {
     stream_vec.push_back(r.rnnt_stream);
-
-    // number of frames before subsampling
-    num_processed_frames_vec.push_back(r.num_processed_frames);
   }
 
-  torch::Tensor num_processed_frames =
-      torch::tensor(num_processed_frames_vec, torch::kInt);
-
   k2::RnntStreamsPtr streams =
       k2::CreateRnntStreams(stream_vec, vocab_size_, context_size, config_.beam,
                             config_.max_contexts, config_.max_states);
@@ -89,15 +88,63 @@ void OnlineTransducerFastBeamSearchDecoder::Decode(
 
   k2::TerminateAndFlushRnntStreams(streams);
 
-  // TODO(fangjun): This assumes the subsampling factor is 4
-  num_processed_frames = (num_processed_frames / 4).to(torch::kInt) + T;
+  int32_t subsampling_factor = model_->SubsamplingFactor();
 
-  std::vector<int32_t> processed_frames_vec(
-      num_processed_frames.data_ptr<int32_t>(),
-      num_processed_frames.data_ptr<int32_t>() + num_processed_frames.numel());
+  // Results whose partial results are updated in this chunk
+  std::vector<OnlineTransducerDecoderResult *> due;
+  std::vector<k2::RnntStreamPtr> due_stream_vec;
+  std::vector<int32_t> num_frames_vec;  // after subsampling
+  for (auto &r : *results) {
+    r.num_pending_chunks += 1;
+    if (r.num_pending_chunks < config_.traceback_interval) {
+      continue;
+    }
+
+    due.push_back(&r);
+    due_stream_vec.push_back(r.rnnt_stream);
+
+    // r.num_processed_frames does not include the current chunk yet
+    num_frames_vec.push_back(r.num_processed_frames / subsampling_factor + T);
+  }
+
+  if (due.size() == results->size()) {
+    Traceback(streams, due, num_frames_vec);
+  } else if (!due.empty()) {
+    // The decoded frames are kept in each stream after
+    // TerminateAndFlushRnntStreams(), so we can format the lattices of
+    // a subset of the streams
+    k2::RnntStreamsPtr due_streams = k2::CreateRnntStreams(
+        due_stream_vec, vocab_size_, context_size, config_.beam,
+        config_.max_contexts, config_.max_states);
+    k2::TerminateAndFlushRnntStreams(due_streams);
+
+    Traceback(due_streams, due, num_frames_vec);
+  }
+}
+
+void OnlineTransducerFastBeamSearchDecoder::FinalizeResult(
+    OnlineStream * /*s*/, OnlineTransducerDecoderResult *r) {
+  if (r->num_pending_chunks == 0) {
+    return;
+  }
+
+  k2::RnntStreamsPtr streams = k2::CreateRnntStreams(
+      {r->rnnt_stream}, vocab_size_, model_->ContextSize(), config_.beam,
+      config_.max_contexts, config_.max_states);
+  k2::TerminateAndFlushRnntStreams(streams);
+
+  Traceback(streams, {r},
+            {r->num_processed_frames / model_->SubsamplingFactor()});
+}
+
+void OnlineTransducerFastBeamSearchDecoder::Traceback(
+    k2::RnntStreamsPtr streams,
+    const std::vector<OnlineTransducerDecoderResult *> &results,
+    const std::vector<int32_t> &num_frames_vec) {
+  ++num_tracebacks_;
 
   auto lattice =
-      k2::FormatOutput(streams, processed_frames_vec, config_.allow_partial);
+      k2::FormatOutput(streams, num_frames_vec, config_.allow_partial);
 
   lattice = k2::ShortestPath(lattice);
 
@@ -105,20 +152,22 @@ void OnlineTransducerFastBeamSearchDecoder::Decode(
   auto labels = k2::GetTensorAttr(lattice, "labels").cpu().contiguous();
   auto acc = labels.accessor<int32_t, 1>();
 
-  for (auto &r : *results) {
-    r.tokens.clear();
-    r.timestamps.clear();
-    r.num_trailing_blanks = 0;
+  for (auto *r : results) {
+    r->tokens.clear();
+    r->timestamps.clear();
+    r->num_trailing_blanks = 0;
+    r->num_pending_chunks = 0;
   }
-  OnlineTransducerDecoderResult *p = results->data();
+  auto it = results.begin();
 
   for (int32_t i = 0, t = 0; i != labels.numel(); ++i) {
     int32_t token = acc[i];
+    OnlineTransducerDecoderResult *p = *it;
 
     if (token == -1) {
       // end of this utterance.
       t = 0;
-      ++p;
+      ++it;
 
       continue;
     }
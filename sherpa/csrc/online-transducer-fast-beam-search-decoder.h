@@ -4,6 +4,7 @@
 #ifndef SHERPA_CSRC_ONLINE_TRANSDUCER_FAST_BEAM_SEARCH_DECODER_H_
 #define SHERPA_CSRC_ONLINE_TRANSDUCER_FAST_BEAM_SEARCH_DECODER_H_
 
+#include <atomic>
 #include <vector>
 
 #include "k2/torch_api.h"
@@ -17,22 +18,57 @@ class OnlineTransducerFastBeamSearchDecoder : public OnlineTransducerDecoder {
  public:
   /**
    * @param config
+   * @param lg If not null, it is the graph loaded from config.lg
+   *           on the device of the model with its scores already multiplied
+   *           by config.ngram_lm_scale so that we don't load it again.
+   *           It may be shared with other decoders and is not modified.
    */
   OnlineTransducerFastBeamSearchDecoder(OnlineTransducerModel *model,
-                                        const FastBeamSearchConfig &config);
+                                        const FastBeamSearchConfig &config,
+                                        k2::FsaClassPtr lg = nullptr);
 
   /* Return an empty result. */
   OnlineTransducerDecoderResult GetEmptyResult() override;
 
+  /* Get the result from the lattice if it is out of date, i.e., if
+   * config.traceback_interval is larger than 1 and the last chunks
+   * have not been traced back yet.
+   */
+  void FinalizeResult(OnlineStream *s,
+                      OnlineTransducerDecoderResult *r) override;
+
+  /** Partial results are updated from the lattice only once every
+   * config.traceback_interval chunks. The streams of the other results
+   * are advanced without formatting their lattices.
+   */
   void Decode(torch::Tensor encoder_out,
               std::vector<OnlineTransducerDecoderResult> *result) override;
 
+  /** Return the number of batched tracebacks run so far, including
+   * the ones from FinalizeResult(). It is atomic since DecodeStreams()
+   * may be called from several threads at once.
+   */
+  int32_t NumTracebacks() const { return num_tracebacks_; }
+
  private:
+  /** Get tokens and timestamps from the best path of the lattice.
+   *
+   * @param streams It contains the rnnt_stream of each result in results.
+   *                TerminateAndFlushRnntStreams() has been called on it.
+   * @param results The results to update.
+   * @param num_frames_vec  Number of decoded frames after subsampling of
+   *                        each result.
+   */
+  void Traceback(k2::RnntStreamsPtr streams,
+                 const std::vector<OnlineTransducerDecoderResult *> &results,
+                 const std::vector<int32_t> &num_frames_vec);
+
   OnlineTransducerModel *model_;  // Not owned
   k2::FsaClassPtr decoding_graph_;
 
   FastBeamSearchConfig config_;
   int32_t vocab_size_;
+  std::atomic<int32_t> num_tracebacks_{0};
 };
 
 }  // namespace sherpa
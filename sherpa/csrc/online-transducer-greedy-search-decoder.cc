@@ -67,19 +67,64 @@ void OnlineTransducerGreedySearchDecoder::Decode(
   auto decoder_out = model_->RunDecoder(decoder_input.to(device)).squeeze(1);
   // decoder_out has shape (N, joiner_dim)
 
+  // non_blank[n][t] is true if frame t of utterance n should be sent
+  // to the joiner.
+  torch::Tensor non_blank;
+  if (blank_skip_threshold_ > 0 && model_->HasCtcOutput()) {
+    non_blank = model_->RunCtcOutput(encoder_out)
+                    .select(/*dim*/ -1, /*index*/ blank_id)
+                    .exp()
+                    .le(blank_skip_threshold_)
+                    .cpu();
+  }
+
+  // indexes[i] is the index of the utterance in the batch for the i-th
+  // row sent to the joiner
+  std::vector<int64_t> indexes;
+  indexes.reserve(N);
+
   for (int32_t t = 0; t != T; ++t) {
     auto cur_encoder_out = encoder_out.index({torch::indexing::Slice(), t});
     // cur_encoder_out has shape (N, joiner_dim)
 
-    auto logits = model_->RunJoiner(cur_encoder_out, decoder_out);
-    // logits has shape (N, vocab_size)
+    torch::Tensor cur_decoder_out = decoder_out;
+
+    indexes.clear();
+    if (non_blank.defined()) {
+      auto non_blank_acc = non_blank.accessor<bool, 2>();
+      for (int32_t n = 0; n != N; ++n) {
+        if (non_blank_acc[n][t]) {
+          indexes.push_back(n);
+        } else {
+          // Skipped frames are decoded to blanks
+          ++(*results)[n].num_trailing_blanks;
+        }
+      }
+
+      if (indexes.empty()) {
+        continue;
+      }
+
+      if (static_cast<int32_t>(indexes.size()) != N) {
+        auto index = torch::tensor(indexes, torch::kLong).to(device);
+        cur_encoder_out = cur_encoder_out.index_select(/*dim*/ 0, index);
+        cur_decoder_out = cur_decoder_out.index_select(/*dim*/ 0, index);
+      }
+    } else {
+      for (int32_t n = 0; n != N; ++n) {
+        indexes.push_back(n);
+      }
+    }
+
+    auto logits = model_->RunJoiner(cur_encoder_out, cur_decoder_out);
+    // logits has shape (indexes.size(), vocab_size)
 
     auto max_indices = logits.argmax(/*dim*/ -1).cpu();
     auto max_indices_accessor = max_indices.accessor<int64_t, 1>();
     bool emitted = false;
-    for (int32_t n = 0; n != N; ++n) {
-      auto index = max_indices_accessor[n];
-      auto &r = (*results)[n];
+    for (int32_t i = 0; i != static_cast<int32_t>(indexes.size()); ++i) {
+      auto index = max_indices_accessor[i];
+      auto &r = (*results)[indexes[i]];
       if (index != blank_id) {
         emitted = true;
 
@@ -104,4 +149,10 @@ void OnlineTransducerGreedySearchDecoder::Decode(
   }
 }
 
+void OnlineTransducerGreedySearchDecoder::SkipFrames(
+    int32_t num_frames, OnlineTransducerDecoderResult *r) {
+  r->num_trailing_blanks += num_frames;
+  r->frame_offset += num_frames;
+}
+
 }  // namespace sherpa
@@ -13,8 +13,16 @@ namespace sherpa {
 
 class OnlineTransducerGreedySearchDecoder : public OnlineTransducerDecoder {
  public:
-  explicit OnlineTransducerGreedySearchDecoder(OnlineTransducerModel *model)
-      : model_(model) {}
+  /**
+   * @param model The transducer model.
+   * @param blank_skip_threshold If it is larger than 0 and the model has a
+   *                             CTC head, frames with blank probability
+   *                             larger than this value are not sent to
+   *                             the joiner and are decoded to blanks.
+   */
+  explicit OnlineTransducerGreedySearchDecoder(
+      OnlineTransducerModel *model, float blank_skip_threshold = 0)
+      : model_(model), blank_skip_threshold_(blank_skip_threshold) {}
 
   OnlineTransducerDecoderResult GetEmptyResult() override;
 
@@ -23,8 +31,12 @@ class OnlineTransducerGreedySearchDecoder : public OnlineTransducerDecoder {
   void Decode(torch::Tensor encoder_out,
               std::vector<OnlineTransducerDecoderResult> *result) override;
 
+  void SkipFrames(int32_t num_frames,
+                  OnlineTransducerDecoderResult *r) override;
+
  private:
   OnlineTransducerModel *model_;  // Not owned
+  float blank_skip_threshold_ = 0;
 };
 
 }  // namespace sherpa
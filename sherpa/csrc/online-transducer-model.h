@@ -7,6 +7,7 @@
 #include <tuple>
 #include <vector>
 
+#include "sherpa/csrc/module-optimizer.h"
 #include "torch/script.h"
 
 namespace sherpa {
@@ -86,6 +87,34 @@ class OnlineTransducerModel {
   virtual torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                                   const torch::Tensor &decoder_out) = 0;
 
+  /** Return true if the model contains a CTC head that can be used to
+   * estimate the blank probability of each encoder output frame.
+   */
+  virtual bool HasCtcOutput() const { return false; }
+
+  /** Run the CTC head of the model.
+   *
+   * It is called only if HasCtcOutput() returns true.
+   *
+   * @param encoder_out Output of the encoder network. A tensor of shape
+   *                    (N, T, encoder_dim).
+   * @return Return a tensor of shape (N, T, vocab_size) containing
+   *         log probabilities.
+   */
+  virtual torch::Tensor RunCtcOutput(const torch::Tensor & /*encoder_out*/) {
+    return {};
+  }
+
+  /** Replace the encoder, decoder, and joiner with frozen versions that
+   * are optimized for inference. See ModuleOptimizer for details.
+   *
+   * It should be called after construction and before WarmUp().
+   * If the model is constructed from the module of
+   * ModuleOptimizer::LoadCache(), the modules are taken from the cache.
+   * The default implementation does nothing.
+   */
+  virtual void OptimizeForInference(ModuleOptimizer * /*optimizer*/) {}
+
   /** Return the device where computation takes place.
    *
    * Note: We don't support moving the model to a different device
@@ -118,7 +147,12 @@ class OnlineTransducerModel {
 
   int32_t VocabSize() const { return vocab_size_; }
 
-  int32_t SubsamplingFactor() const { return 4; }
+  /** Return the number of input frames per encoder output frame.
+   *
+   * The default implementation returns 4. Models whose encoder exports
+   * its subsampling factor override it.
+   */
+  virtual int32_t SubsamplingFactor() const { return 4; }
 
   void WarmUp(torch::Tensor features, torch::Tensor features_length) {
     torch::IValue states = GetEncoderInitStates();
@@ -4,7 +4,9 @@
 #include "sherpa/csrc/online-transducer-modified-beam-search-decoder.h"
 
 #include <algorithm>
+#include <numeric>
 #include <utility>
+#include <vector>
 
 #include "k2/torch_api.h"
 
@@ -134,26 +136,88 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
     cur.push_back(std::move(r.hyps));
   }
 
+  // non_blank[n][t] is true if frame t of utterance n should be expanded
+  torch::Tensor non_blank;
+  if (blank_skip_threshold_ > 0 && model_->HasCtcOutput()) {
+    non_blank = model_->RunCtcOutput(encoder_out)
+                    .select(/*dim*/ -1, /*index*/ blank_id)
+                    .exp()
+                    .le(blank_skip_threshold_)
+                    .cpu();
+  }
+
   std::vector<Hypothesis> prev;
 
+  // Indexes of utterances to expand at the current frame
+  std::vector<int32_t> active;
+  active.reserve(N);
+
+  // Hypotheses of utterances in `active`
+  std::vector<Hypotheses> active_hyps;
+  active_hyps.reserve(N);
+
   for (int32_t t = 0; t != T; ++t) {
     auto cur_encoder_out = encoder_out.index({torch::indexing::Slice(), t});
     // cur_encoder_out has shape (N, joiner_dim)
 
+    if (!non_blank.defined()) {
+      active.resize(N);
+      std::iota(active.begin(), active.end(), 0);
+    } else {
+      auto non_blank_acc = non_blank.accessor<bool, 2>();
+      active.clear();
+      for (int32_t n = 0; n != N; ++n) {
+        if (non_blank_acc[n][t]) {
+          active.push_back(n);
+        }
+      }
+    }
+
+    if (static_cast<int32_t>(active.size()) != N) {
+      // Skipped frames are decoded to blanks for all hypotheses. Their
+      // scores are kept unchanged.
+      std::vector<bool> is_active(N, false);
+      for (auto n : active) {
+        is_active[n] = true;
+      }
+
+      for (int32_t n = 0; n != N; ++n) {
+        if (is_active[n]) continue;
+
+        for (auto &h : cur[n]) {
+          h.second.num_trailing_blanks += 1;
+        }
+      }
+
+      if (active.empty()) {
+        continue;
+      }
+
+      auto index = torch::tensor(std::vector<int64_t>(active.begin(),
+                                                      active.end()),
+                                 torch::kLong)
+                       .to(device);
+      cur_encoder_out = cur_encoder_out.index_select(/*dim*/ 0, index);
+      // cur_encoder_out has shape (active.size(), joiner_dim)
+    }
+
+    active_hyps.clear();
+    for (auto n : active) {
+      active_hyps.push_back(std::move(cur[n]));
+    }
+
     // Due to merging paths with identical token sequences,
     // not all utterances have "num_active_paths" paths.
-    auto hyps_shape = GetHypsShape(cur);
+    auto hyps_shape = GetHypsShape(active_hyps);
     int32_t num_hyps = k2::TotSize(hyps_shape, 1);
 
     prev.clear();
     prev.reserve(num_hyps);
-    for (auto &hyps : cur) {
+    for (auto &hyps : active_hyps) {
       for (auto &h : hyps) {
         prev.push_back(std::move(h.second));
       }
     }
-    cur.clear();
-    cur.reserve(N);
 
     auto ys_log_probs = torch::empty({num_hyps, 1}, torch::kFloat);
 
@@ -182,11 +246,12 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
     auto row_splits = k2::RowSplits(hyps_shape, 1);
     auto row_splits_acc = row_splits.accessor<int32_t, 1>();
 
-    for (int32_t k = 0; k != N; ++k) {
+    for (int32_t i = 0; i != static_cast<int32_t>(active.size()); ++i) {
+      int32_t k = active[i];
       int32_t frame_offset = (*results)[k].frame_offset;
 
-      int32_t start = row_splits_acc[k];
-      int32_t end = row_splits_acc[k + 1];
+      int32_t start = row_splits_acc[i];
+      int32_t end = row_splits_acc[i + 1];
 
       torch::Tensor values, indexes;
       std::tie(values, indexes) =
@@ -230,8 +295,8 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
         new_hyp.log_prob = values_acc[j] + context_score;
         hyps.Add(std::move(new_hyp));
       }
-      cur.push_back(std::move(hyps));
-    }  // for (int32_t k = 0; k != N; ++k)
+      cur[k] = std::move(hyps);
+    }  // for (int32_t i = 0; i != active.size(); ++i)
   }    // for (int32_t t = 0; t != T; ++t)
 
   for (int32_t i = 0; i != N; ++i) {
@@ -240,4 +305,14 @@ void OnlineTransducerModifiedBeamSearchDecoder::Decode(
   }
 }
 
+void OnlineTransducerModifiedBeamSearchDecoder::SkipFrames(
+    int32_t num_frames, OnlineTransducerDecoderResult *r) {
+  // The scores of the hypotheses are not changed, i.e., we assume
+  // the probability of blank is 1 for the skipped frames.
+  for (auto &h : r->hyps) {
+    h.second.num_trailing_blanks += num_frames;
+  }
+  r->frame_offset += num_frames;
+}
+
 }  // namespace sherpa
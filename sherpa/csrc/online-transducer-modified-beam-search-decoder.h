@@ -14,9 +14,24 @@ namespace sherpa {
 class OnlineTransducerModifiedBeamSearchDecoder
     : public OnlineTransducerDecoder {
  public:
+  /**
+   * @param model The transducer model.
+   * @param num_active_paths Number of active paths during the search.
+   * @param temperature Softmax temperature for the joiner output.
+   * @param blank_skip_threshold If it is larger than 0 and the model has a
+   *                             CTC head, frames with blank probability
+   *                             larger than this value are not expanded
+   *                             and are decoded to blanks for all
+   *                             hypotheses. It is ignored if the model
+   *                             has no CTC head.
+   */
   explicit OnlineTransducerModifiedBeamSearchDecoder(
-      OnlineTransducerModel *model, int32_t num_active_paths, float temperature)
-      : model_(model), num_active_paths_(num_active_paths), temperature_(temperature) {}
+      OnlineTransducerModel *model, int32_t num_active_paths, float temperature,
+      float blank_skip_threshold = 0)
+      : model_(model),
+        num_active_paths_(num_active_paths),
+        temperature_(temperature),
+        blank_skip_threshold_(blank_skip_threshold) {}
 
   OnlineTransducerDecoderResult GetEmptyResult() override;
 
@@ -31,10 +46,14 @@ class OnlineTransducerModifiedBeamSearchDecoder
   void Decode(torch::Tensor encoder_out, OnlineStream **ss, int32_t num_streams,
               std::vector<OnlineTransducerDecoderResult> *result) override;
 
+  void SkipFrames(int32_t num_frames,
+                  OnlineTransducerDecoderResult *r) override;
+
  private:
   OnlineTransducerModel *model_;  // Not owned
   int32_t num_active_paths_;
   float temperature_ = 1.0;
+  float blank_skip_threshold_ = 0;
 };
 
 }  // namespace sherpa
@@ -16,15 +16,23 @@ namespace sherpa {
 OnlineZipformerTransducerModel::OnlineZipformerTransducerModel(
     const std::string &encoder_filename, const std::string &decoder_filename,
     const std::string &joiner_filename, torch::Device device /*=torch::kCPU*/)
+    : OnlineZipformerTransducerModel(
+          torch::jit::load(encoder_filename, device),
+          torch::jit::load(decoder_filename, device),
+          torch::jit::load(joiner_filename, device), device) {}
+
+OnlineZipformerTransducerModel::OnlineZipformerTransducerModel(
+    torch::jit::Module encoder, torch::jit::Module decoder,
+    torch::jit::Module joiner, torch::Device device /*=torch::kCPU*/)
     : device_(device) {
-  encoder_ = torch::jit::load(encoder_filename, device);
-  encoder_.eval();
+  encoder_ = std::move(encoder);
+  SetEvalMode(&encoder_);
 
-  decoder_ = torch::jit::load(decoder_filename, device);
-  encoder_.eval();
+  decoder_ = std::move(decoder);
+  SetEvalMode(&decoder_);
 
-  joiner_ = torch::jit::load(joiner_filename, device);
-  joiner_.eval();
+  joiner_ = std::move(joiner);
+  SetEvalMode(&joiner_);
 
   auto conv = decoder_.attr("conv").toModule();
 
@@ -41,9 +49,14 @@ OnlineZipformerTransducerModel::OnlineZipformerTransducerModel(
 
 OnlineZipformerTransducerModel::OnlineZipformerTransducerModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OnlineZipformerTransducerModel(torch::jit::load(filename, device),
+                                     device) {}
+
+OnlineZipformerTransducerModel::OnlineZipformerTransducerModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
@@ -273,4 +286,11 @@ torch::Tensor OnlineZipformerTransducerModel::RunJoiner(
   return joiner_.run_method("forward", encoder_out, decoder_out).toTensor();
 }
 
+void OnlineZipformerTransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ = optimizer->Optimize(encoder_, "encoder", {"decode_chunk_size"});
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"conv"});
+  joiner_ = optimizer->Optimize(joiner_, "joiner");
+}
+
 }  // namespace sherpa
@@ -36,9 +36,24 @@ class OnlineZipformerTransducerModel : public OnlineTransducerModel {
                                  const std::string &joiner_filename,
                                  torch::Device device = torch::kCPU);
 
+  /** Same as the above one except that it takes models that have been
+   * loaded by torch::jit::load() on the given device.
+   */
+  OnlineZipformerTransducerModel(torch::jit::Module encoder,
+                                 torch::jit::Module decoder,
+                                 torch::jit::Module joiner,
+                                 torch::Device device = torch::kCPU);
+
   explicit OnlineZipformerTransducerModel(const std::string &filename,
                                           torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OnlineZipformerTransducerModel(torch::jit::Module model,
+                                          torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -55,6 +70,8 @@ class OnlineZipformerTransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -15,14 +15,24 @@ namespace sherpa {
 
 OnlineZipformer2TransducerModel::OnlineZipformer2TransducerModel(
     const std::string &filename, torch::Device device /*= torch::kCPU*/)
+    : OnlineZipformer2TransducerModel(torch::jit::load(filename, device),
+                                      device) {}
+
+OnlineZipformer2TransducerModel::OnlineZipformer2TransducerModel(
+    torch::jit::Module model, torch::Device device /*= torch::kCPU*/)
     : device_(device) {
-  model_ = torch::jit::load(filename, device);
-  model_.eval();
+  model_ = std::move(model);
+  SetEvalMode(&model_);
 
   encoder_ = model_.attr("encoder").toModule();
   decoder_ = model_.attr("decoder").toModule();
   joiner_ = model_.attr("joiner").toModule();
 
+  if (model_.hasattr("ctc_output")) {
+    ctc_output_ = model_.attr("ctc_output").toModule();
+    has_ctc_output_ = true;
+  }
+
   auto conv = decoder_.attr("conv").toModule();
 
   context_size_ =
@@ -203,4 +213,23 @@ torch::Tensor OnlineZipformer2TransducerModel::RunJoiner(
       .toTensor();
 }
 
+torch::Tensor OnlineZipformer2TransducerModel::RunCtcOutput(
+    const torch::Tensor &encoder_out) {
+  InferenceMode no_grad;
+  // ctc_output ends with a log-softmax layer
+  return ctc_output_.run_method("forward", encoder_out).toTensor();
+}
+
+void OnlineZipformer2TransducerModel::OptimizeForInference(
+    ModuleOptimizer *optimizer) {
+  encoder_ =
+      optimizer->Optimize(encoder_, "encoder", {"pad_length", "chunk_size"});
+  decoder_ = optimizer->Optimize(decoder_, "decoder", {"conv"});
+  joiner_ = optimizer->Optimize(joiner_, "joiner");
+
+  if (has_ctc_output_) {
+    ctc_output_ = optimizer->Optimize(ctc_output_, "ctc_output");
+  }
+}
+
 }  // namespace sherpa
@@ -27,6 +27,13 @@ class OnlineZipformer2TransducerModel : public OnlineTransducerModel {
   explicit OnlineZipformer2TransducerModel(const std::string &filename,
                                            torch::Device device = torch::kCPU);
 
+  /**
+   * @param model  The torch script model loaded by torch::jit::load().
+   * @param device  The device of the model.
+   */
+  explicit OnlineZipformer2TransducerModel(torch::jit::Module model,
+                                           torch::Device device = torch::kCPU);
+
   torch::IValue StackStates(
       const std::vector<torch::IValue> &states) const override;
 
@@ -43,6 +50,12 @@ class OnlineZipformer2TransducerModel : public OnlineTransducerModel {
   torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
                           const torch::Tensor &decoder_out) override;
 
+  bool HasCtcOutput() const override { return has_ctc_output_; }
+
+  torch::Tensor RunCtcOutput(const torch::Tensor &encoder_out) override;
+
+  void OptimizeForInference(ModuleOptimizer *optimizer) override;
+
   torch::Device Device() const override { return device_; }
 
   int32_t ContextSize() const override { return context_size_; }
@@ -59,6 +72,11 @@ class OnlineZipformer2TransducerModel : public OnlineTransducerModel {
   torch::jit::Module decoder_;
   torch::jit::Module joiner_;
 
+  // Available only if the model is trained with an auxiliary CTC loss
+  // and exported with it, i.e., has_ctc_output_ is true.
+  torch::jit::Module ctc_output_;
+  bool has_ctc_output_ = false;
+
   torch::Device device_{"cpu"};
 
   int32_t context_size_;
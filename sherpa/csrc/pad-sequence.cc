@@ -0,0 +1,34 @@
+// sherpa/csrc/pad-sequence.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/pad-sequence.h"
+
+#include <vector>
+
+namespace sherpa {
+
+torch::Tensor PadSequence(const std::vector<torch::Tensor> &v,
+                          bool return_waveform,
+                          ShapeBucketizer *bucketizer /*= nullptr*/) {
+  float padding_value = return_waveform ? 0 : -23.025850929940457f;
+
+  torch::Tensor ans = torch::nn::utils::rnn::pad_sequence(
+      v, /*batch_first*/ true, padding_value);
+
+  if (!bucketizer) {
+    return ans;
+  }
+
+  int32_t num_frames = ans.size(1);
+  int32_t padded_num_frames = bucketizer->Bucketize(num_frames);
+  if (padded_num_frames == num_frames) {
+    return ans;
+  }
+
+  // The padding sizes start from the last dimension
+  std::vector<int64_t> pad(2 * (ans.dim() - 1), 0);
+  pad.back() = padded_num_frames - num_frames;
+  return torch::constant_pad_nd(ans, pad, padding_value);
+}
+
+}  // namespace sherpa
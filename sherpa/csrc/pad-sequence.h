@@ -0,0 +1,35 @@
+// sherpa/csrc/pad-sequence.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_PAD_SEQUENCE_H_
+#define SHERPA_CSRC_PAD_SEQUENCE_H_
+
+#include <vector>
+
+#include "sherpa/csrc/shape-bucketizer.h"
+#include "torch/script.h"
+
+namespace sherpa {
+
+/** Pad a list of features or waveforms into a batch.
+ *
+ * Features are padded with log(1e-10), i.e., the log-mel energy of
+ * silence. Waveforms are padded with 0.
+ *
+ * @param v  A list of 2-D tensors of shape (num_frames, feature_dim) or,
+ *           if return_waveform is true, of 1-D tensors of shape
+ *           (num_samples,).
+ * @param return_waveform  true if v contains waveforms.
+ * @param bucketizer  If not null, dim 1 of the result is padded further
+ *                    to the size returned by it.
+ *
+ * @return Return a tensor of shape (N, T, feature_dim) or (N, T), where
+ *         N is v.size().
+ */
+torch::Tensor PadSequence(const std::vector<torch::Tensor> &v,
+                          bool return_waveform,
+                          ShapeBucketizer *bucketizer = nullptr);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_PAD_SEQUENCE_H_
@@ -0,0 +1,202 @@
+// sherpa/csrc/quantize-module.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/quantize-module.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ATen/core/dispatch/Dispatcher.h"
+#include "sherpa/csrc/log.h"
+#include "torch/csrc/jit/passes/dead_code_elimination.h"
+#include "torch/torch.h"
+
+namespace sherpa {
+
+static constexpr const char *kPackedParams = "_packed_params";
+
+// Return true if m is an instance of torch.nn.Linear. Its class name may be
+// mangled, e.g., __torch__.torch.nn.modules.linear.___torch_mangle_1.Linear
+static bool IsLinear(const torch::jit::Module &m) {
+  const auto &name = m.type()->name();
+  return name && name->name() == "Linear" &&
+         name->qualifiedName().find("torch.nn.modules.linear") !=
+             std::string::npos;
+}
+
+// Return true if m is an instance of ScaledLinear from icefall, which
+// is a subclass of torch.nn.Linear whose forward() is
+//
+//   linear(x, self.get_weight(), self.get_bias())
+//
+// See
+// https://github.com/k2-fsa/icefall/blob/master/egs/librispeech/ASR/pruned_transducer_stateless2/scaling.py
+static bool IsScaledLinear(const torch::jit::Module &m) {
+  const auto &name = m.type()->name();
+  return name && name->name() == "ScaledLinear";
+}
+
+// Return true if v is self.<attr> in a method of the module
+static bool IsAttrOfSelf(torch::jit::Value *v, torch::jit::Value *self,
+                         const std::string &attr) {
+  torch::jit::Node *n = v->node();
+  return n->kind() == c10::prim::GetAttr && n->input() == self &&
+         n->s(c10::attr::name) == attr;
+}
+
+// Return true if v is the return value of self.<method>() in a method of
+// the module
+static bool IsMethodOfSelf(torch::jit::Value *v, torch::jit::Value *self,
+                           const std::string &method) {
+  torch::jit::Node *n = v->node();
+  return n->kind() == c10::prim::CallMethod && n->inputs().size() == 1 &&
+         n->input(0) == self && n->s(c10::attr::name) == method;
+}
+
+// Return the aten::linear nodes of the forward() of a Linear class.
+// Return an empty vector if the forward() contains anything we don't know
+// how to rewrite, e.g., a linear with weights that are not its own.
+//
+// @param graph  The graph of forward().
+// @param scaled  true for a ScaledLinear class. Its weight and bias are
+//                from get_weight() and get_bias().
+static std::vector<torch::jit::Node *> FindLinearNodes(torch::jit::Graph *graph,
+                                                       bool scaled) {
+  torch::jit::Value *self = graph->inputs()[0];
+
+  std::vector<torch::jit::Node *> ans;
+  for (torch::jit::Node *n : graph->nodes()) {
+    if (n->kind() != c10::aten::linear) {
+      continue;
+    }
+
+    torch::jit::Value *weight = n->input(1);
+    torch::jit::Value *bias = n->input(2);
+    bool is_own_weight = scaled ? IsMethodOfSelf(weight, self, "get_weight")
+                                : IsAttrOfSelf(weight, self, "weight");
+    bool is_own_bias = (scaled ? IsMethodOfSelf(bias, self, "get_bias")
+                               : IsAttrOfSelf(bias, self, "bias")) ||
+                       bias->type()->kind() == c10::TypeKind::NoneType;
+    if (!is_own_weight || !is_own_bias) {
+      return {};
+    }
+    ans.push_back(n);
+  }
+  return ans;
+}
+
+// Quantize the weight of a Linear layer to int8 with a per-tensor symmetric
+// scale and pack it for quantized::linear_dynamic.
+// It matches default_dynamic_qconfig of PyTorch.
+static torch::IValue PackLinear(torch::jit::Module *linear, bool scaled) {
+  torch::NoGradGuard no_grad;
+  torch::Tensor weight = scaled ? linear->run_method("get_weight").toTensor()
+                                : linear->attr("weight").toTensor();
+  weight = weight.detach();
+  if (!weight.device().is_cpu()) {
+    SHERPA_LOG(FATAL) << "int8 quantization supports only CPU";
+  }
+  weight = weight.to(torch::kFloat);
+
+  // 127.5 = (127 - (-128)) / 2
+  float max_abs = weight.abs().max().item<float>();
+  double scale = std::max(max_abs / 127.5, 1e-8);
+  torch::Tensor qweight =
+      torch::quantize_per_tensor(weight, scale, /*zero_point*/ 0,
+                                 torch::kQInt8);
+
+  torch::IValue bias =
+      scaled ? linear->run_method("get_bias") : linear->attr("bias");
+  if (bias.isTensor()) {
+    bias = bias.toTensor().detach().to(torch::kFloat);
+  }
+
+  static auto prepack = c10::Dispatcher::singleton().findSchemaOrThrow(
+      "quantized::linear_prepack", "");
+  torch::jit::Stack stack{qweight, bias};
+  prepack.callBoxed(&stack);
+  return stack.at(0);
+}
+
+// Replace each linear(x, self.weight, self.bias) with
+// quantized::linear_dynamic(x, self._packed_params, reduce_range).
+// Calls of self.get_weight() and self.get_bias() that are no longer used
+// are removed.
+static void RewriteLinearNodes(const std::vector<torch::jit::Node *> &nodes,
+                               bool reduce_range,
+                               const std::shared_ptr<torch::jit::Graph> &g) {
+  torch::jit::Value *self = g->inputs()[0];
+  for (torch::jit::Node *n : nodes) {
+    torch::jit::WithInsertPoint guard(n);
+    torch::jit::Value *packed = g->insertGetAttr(self, kPackedParams);
+    torch::jit::Value *out =
+        g->insert(c10::Symbol::fromQualString("quantized::linear_dynamic"),
+                  {n->input(0), packed, g->insertConstant(reduce_range)});
+    n->output()->replaceAllUsesWith(out);
+
+    torch::jit::Node *weight = n->input(1)->node();
+    torch::jit::Node *bias = n->input(2)->node();
+    n->destroy();
+
+    // Dead code elimination does not remove method calls since they may
+    // have side effects
+    for (torch::jit::Node *p : {weight, bias}) {
+      if (p->kind() == c10::prim::CallMethod && !p->output()->hasUses()) {
+        p->destroy();
+      }
+    }
+  }
+  torch::jit::EliminateDeadCode(g);
+}
+
+int32_t QuantizeDynamicInt8(torch::jit::Module *m) {
+  at::QEngine engine = at::globalContext().qEngine();
+  if (engine == at::QEngine::NoQEngine) {
+    SHERPA_LOG(FATAL) << "This build of PyTorch does not support quantized "
+                      << "operators";
+  }
+
+  // FBGEMM and x86 kernels may overflow with 8-bit activations, so their
+  // activations use only 7 bits. See torch.ao.quantization.
+  bool reduce_range = engine != at::QEngine::QNNPACK;
+
+  // Instances of the same Linear class share a forward(), which is
+  // rewritten once for all of them.
+  std::map<c10::ClassTypePtr, std::vector<torch::jit::Module>> linears;
+  for (const auto &sub : m->modules()) {
+    if ((IsLinear(sub) || IsScaledLinear(sub)) &&
+        !sub.type()->hasAttribute(kPackedParams)) {
+      linears[sub.type()].push_back(sub);
+    }
+  }
+
+  int32_t num_quantized = 0;
+  for (auto &p : linears) {
+    bool scaled = IsScaledLinear(p.second[0]);
+    std::shared_ptr<torch::jit::Graph> graph =
+        p.second[0].get_method("forward").graph();
+    std::vector<torch::jit::Node *> nodes =
+        FindLinearNodes(graph.get(), scaled);
+    if (nodes.empty()) {
+      SHERPA_LOG(WARNING) << "Skip " << p.second.size() << " instance(s) of "
+                          << p.first->name()->qualifiedName()
+                          << " since its forward() is not supported";
+      continue;
+    }
+
+    for (auto &linear : p.second) {
+      torch::IValue packed = PackLinear(&linear, scaled);
+      linear.register_attribute(kPackedParams, packed.type(), packed);
+      ++num_quantized;
+    }
+
+    RewriteLinearNodes(nodes, reduce_range, graph);
+  }
+
+  return num_quantized;
+}
+
+}  // namespace sherpa
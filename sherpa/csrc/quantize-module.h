@@ -0,0 +1,37 @@
+// sherpa/csrc/quantize-module.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_QUANTIZE_MODULE_H_
+#define SHERPA_CSRC_QUANTIZE_MODULE_H_
+
+#include <cstdint>
+
+#include "torch/script.h"
+
+namespace sherpa {
+
+/** Apply int8 dynamic quantization to all torch.nn.Linear and ScaledLinear
+ * (from icefall) submodules of a TorchScript module in place.
+ *
+ * The forward() of each Linear class is rewritten to call
+ * quantized::linear_dynamic with weights quantized to int8 ahead of time.
+ * For ScaledLinear, the weight and bias returned by get_weight() and
+ * get_bias() are quantized.
+ * Since callers invoke Linear layers through their forward(), every method
+ * of the module uses the int8 layers, including methods used only for
+ * streaming, e.g., streaming_forward().
+ *
+ * Other layers, e.g., torch.nn.LSTM, and Linear layers whose forward() is
+ * not a plain linear of their own weight and bias are left unchanged. A
+ * warning is printed for such Linear layers.
+ *
+ * @param m  The module to quantize. It must be on CPU and must not have
+ *           been run yet.
+ *
+ * @return Return the number of Linear layers that are quantized.
+ */
+int32_t QuantizeDynamicInt8(torch::jit::Module *m);
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_QUANTIZE_MODULE_H_
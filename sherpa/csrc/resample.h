@@ -25,6 +25,7 @@
 #define SHERPA_CSRC_RESAMPLE_H_
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "torch/script.h"
@@ -80,6 +81,23 @@ class LinearResample {
   int32_t GetInputSamplingRate() const { return samp_rate_in_; }
   int32_t GetOutputSamplingRate() const { return samp_rate_out_; }
 
+  /// Return the state for a signal that is being processed piece by piece.
+  /// It can be restored by SetState() on an object constructed with the
+  /// same arguments.
+  void GetState(int64_t *input_sample_offset, int64_t *output_sample_offset,
+                std::vector<float> *input_remainder) const {
+    *input_sample_offset = input_sample_offset_;
+    *output_sample_offset = output_sample_offset_;
+    *input_remainder = input_remainder_;
+  }
+
+  void SetState(int64_t input_sample_offset, int64_t output_sample_offset,
+                std::vector<float> input_remainder) {
+    input_sample_offset_ = input_sample_offset;
+    output_sample_offset_ = output_sample_offset;
+    input_remainder_ = std::move(input_remainder);
+  }
+
  private:
   void SetIndexesAndWeights();
 
@@ -0,0 +1,85 @@
+// sherpa/csrc/shape-bucketizer.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "sherpa/csrc/shape-bucketizer.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+float BucketStats::HitRate() const {
+  return num_calls == 0 ? 0 : static_cast<float>(num_hits) / num_calls;
+}
+
+float BucketStats::Efficiency() const {
+  return num_padded == 0 ? 0 : static_cast<float>(num_real) / num_padded;
+}
+
+std::string BucketStats::ToString() const {
+  std::ostringstream os;
+  os << "BucketStats(";
+  os << "num_calls=" << num_calls << ", ";
+  os << "hit_rate=" << HitRate() << ", ";
+  os << "efficiency=" << Efficiency() << ", ";
+  os << "counts={";
+  std::string sep;
+  for (const auto &p : counts) {
+    os << sep << p.first << ": " << p.second;
+    sep = ", ";
+  }
+  os << "})";
+  return os.str();
+}
+
+ShapeBucketizer::ShapeBucketizer(std::vector<int32_t> buckets)
+    : buckets_(std::move(buckets)) {
+  SHERPA_CHECK(!buckets_.empty());
+  std::sort(buckets_.begin(), buckets_.end());
+  SHERPA_CHECK_GT(buckets_[0], 0);
+}
+
+ShapeBucketizer::ShapeBucketizer(int32_t grid) : grid_(grid) {
+  SHERPA_CHECK_GT(grid, 0);
+}
+
+int32_t ShapeBucketizer::Bucketize(int32_t n) {
+  int32_t ans = n;
+  bool hit = true;
+  if (grid_ > 0) {
+    ans = (n + grid_ - 1) / grid_ * grid_;
+  } else {
+    auto it = std::lower_bound(buckets_.begin(), buckets_.end(), n);
+    if (it != buckets_.end()) {
+      ans = *it;
+    } else {
+      hit = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.num_calls += 1;
+  stats_.num_hits += hit;
+  stats_.num_real += n;
+  stats_.num_padded += ans;
+  stats_.counts[ans] += 1;
+
+  return ans;
+}
+
+BucketStats ShapeBucketizer::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ShapeBucketizer::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_ = BucketStats{};
+}
+
+}  // namespace sherpa
@@ -0,0 +1,81 @@
+// sherpa/csrc/shape-bucketizer.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_SHAPE_BUCKETIZER_H_
+#define SHERPA_CSRC_SHAPE_BUCKETIZER_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace sherpa {
+
+struct BucketStats {
+  /// Number of sizes passed to ShapeBucketizer::Bucketize()
+  int64_t num_calls = 0;
+
+  /// Number of sizes that fit into a bucket. A size larger than the
+  /// largest bucket is not padded and is counted as a miss.
+  int64_t num_hits = 0;
+
+  /// Sum of the sizes before padding
+  int64_t num_real = 0;
+
+  /// Sum of the sizes after padding
+  int64_t num_padded = 0;
+
+  /// Map a size after padding to the number of times it is used
+  std::map<int32_t, int64_t> counts;
+
+  /// Return num_hits / num_calls
+  float HitRate() const;
+
+  /// Return num_real / num_padded, i.e., the fraction of the computation
+  /// that is not wasted on padding.
+  float Efficiency() const;
+
+  std::string ToString() const;
+};
+
+/** It rounds a size, e.g., the batch size or the number of frames,
+ * up to a fixed set of values so that TorchScript graphs see only a few
+ * distinct input shapes and are not re-specialized for each of them.
+ *
+ * It is thread-safe.
+ */
+class ShapeBucketizer {
+ public:
+  /**
+   * @param buckets  Sizes are padded to the smallest bucket that is not
+   *                 less than them. It need not be sorted.
+   */
+  explicit ShapeBucketizer(std::vector<int32_t> buckets);
+
+  /**
+   * @param grid  Sizes are padded to a multiple of it.
+   */
+  explicit ShapeBucketizer(int32_t grid);
+
+  /** Return the size after padding and update the statistics. */
+  int32_t Bucketize(int32_t n);
+
+  BucketStats GetStats() const;
+
+  /** Clear the statistics, e.g., after warm-up so that only real
+   * inputs are counted.
+   */
+  void ResetStats();
+
+ private:
+  std::vector<int32_t> buckets_;  // sorted
+  int32_t grid_ = 0;
+
+  mutable std::mutex mutex_;
+  BucketStats stats_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_SHAPE_BUCKETIZER_H_
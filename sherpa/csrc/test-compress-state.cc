@@ -0,0 +1,68 @@
+// sherpa/csrc/test-compress-state.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "gtest/gtest.h"
+#include "sherpa/csrc/compress-state.h"
+
+namespace sherpa {
+
+static torch::IValue CreateState() {
+  torch::List<torch::Tensor> list;
+  list.push_back(torch::randn({2, 3, 4}));
+  list.push_back(torch::randn({5}));
+
+  return torch::ivalue::Tuple::create(
+      {torch::randn({3, 4}), list, torch::tensor({1, 2, 3}, torch::kLong)});
+}
+
+static void Check(const torch::IValue &expected, const torch::IValue &state,
+                  float tol) {
+  const auto &a = expected.toTuple()->elements();
+  const auto &b = state.toTuple()->elements();
+  ASSERT_EQ(a.size(), b.size());
+
+  auto t0 = b[0].toTensor();
+  EXPECT_EQ(t0.scalar_type(), torch::kFloat);
+  EXPECT_TRUE(t0.allclose(a[0].toTensor(), 0, tol));
+
+  // Element type of the list is kept
+  auto b1 = c10::impl::toTypedList<torch::Tensor>(b[1].toList());
+  auto a1 = c10::impl::toTypedList<torch::Tensor>(a[1].toList());
+  ASSERT_EQ(a1.size(), b1.size());
+  for (size_t i = 0; i != a1.size(); ++i) {
+    EXPECT_EQ(b1.get(i).scalar_type(), torch::kFloat);
+    EXPECT_TRUE(b1.get(i).allclose(a1.get(i), 0, tol));
+  }
+
+  // Integer tensors are not changed
+  EXPECT_TRUE(b[2].toTensor().equal(a[2].toTensor()));
+}
+
+TEST(CompressState, Float32) {
+  auto state = CreateState();
+  Check(state, DecompressState(CompressState(state, "float32")), 0);
+}
+
+TEST(CompressState, Float16) {
+  auto state = CreateState();
+  auto compressed = CompressState(state, "float16");
+  EXPECT_EQ(compressed.toTuple()->elements()[0].toTensor().scalar_type(),
+            torch::kHalf);
+  Check(state, DecompressState(compressed), 1e-2);
+}
+
+TEST(CompressState, BFloat16) {
+  auto state = CreateState();
+  Check(state, DecompressState(CompressState(state, "bfloat16")), 5e-2);
+}
+
+TEST(CompressState, Int8) {
+  auto state = CreateState();
+  auto compressed = CompressState(state, "int8");
+  EXPECT_TRUE(compressed.toTuple()->elements()[0].toTensor().is_quantized());
+
+  // The error is at most half of the scale, which is max_abs / 127
+  Check(state, DecompressState(compressed), 0.05);
+}
+
+}  // namespace sherpa
@@ -0,0 +1,81 @@
+// sherpa/csrc/test-context-graph-cache.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa/csrc/context-graph-cache.h"
+
+namespace sherpa {
+
+TEST(ContextGraphCache, Share) {
+  ContextGraphCache cache(1.5);
+  EXPECT_EQ(cache.Get({}), nullptr);
+
+  auto a = cache.Get({{1, 2}, {3}});
+  auto b = cache.Get({{3}, {1, 2}, {3}});
+  auto c = cache.Get({{1}, {2}, {3}});
+  ASSERT_NE(a, nullptr);
+
+  // The order of the phrases and duplicates do not matter
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(cache.NumGraphs(), 2);
+
+  // A graph is freed when no stream uses it
+  c.reset();
+  EXPECT_EQ(cache.NumGraphs(), 1);
+
+  a.reset();
+  b.reset();
+  EXPECT_EQ(cache.NumGraphs(), 0);
+}
+
+TEST(ContextGraphCache, Default) {
+  ContextGraphCache cache(1.5);
+  cache.SetDefault({{1, 2}});
+
+  // The default graph is kept even if no stream uses it
+  EXPECT_EQ(cache.NumGraphs(), 1);
+
+  auto a = cache.Get({});
+  ASSERT_NE(a, nullptr);
+  EXPECT_NE(a->GetState({1, 2}), nullptr);
+
+  // Phrases of a stream are added to the default phrases
+  auto b = cache.Get({{3}});
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(b->GetState({1, 2}), nullptr);
+  EXPECT_NE(b->GetState({3}), nullptr);
+  EXPECT_EQ(b, cache.Get({{1, 2}, {3}}));
+
+  cache.SetDefault({});
+  EXPECT_EQ(cache.Get({}), nullptr);
+
+  // Streams created before are not affected
+  EXPECT_NE(b->GetState({1, 2}), nullptr);
+}
+
+TEST(ContextGraphCache, UpdateDefault) {
+  ContextGraphCache cache(1.5);
+  cache.UpdateDefault({{1, 2}, {3}}, {});
+
+  auto a = cache.Get({});
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(a->GetPhrases(), (std::vector<std::vector<int32_t>>{{1, 2}, {3}}));
+
+  cache.UpdateDefault({{4}}, {{3}});
+  auto b = cache.Get({});
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(b->GetPhrases(), (std::vector<std::vector<int32_t>>{{1, 2}, {4}}));
+  EXPECT_EQ(b->Version(), a->Version() + 1);
+  EXPECT_EQ(b, cache.Get({{4}, {1, 2}}));
+
+  // Streams created before keep their snapshot
+  EXPECT_EQ(a->GetPhrases(), (std::vector<std::vector<int32_t>>{{1, 2}, {3}}));
+
+  cache.UpdateDefault({}, {{1, 2}, {4}});
+  EXPECT_EQ(cache.Get({}), nullptr);
+}
+
+}  // namespace sherpa
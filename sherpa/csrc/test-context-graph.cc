@@ -16,7 +16,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <map>
+#include <random>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -54,4 +57,242 @@ TEST(ContextGraph, TestBasic) {
   }
 }
 
+// A phrase that is added after a longer phrase starting with it is still
+// matched.
+TEST(ContextGraph, TestPrefixAfterLongerPhrase) {
+  std::vector<std::string> contexts_str({"SHELL", "SHE"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &s : contexts_str) {
+    contexts.emplace_back(s.begin(), s.end());
+  }
+  auto context_graph = ContextGraph(contexts, 1);
+
+  float total_scores = 0;
+  auto state = context_graph.Root();
+  for (auto q : std::string("SHED")) {
+    auto res = context_graph.ForwardOneStep(state, q);
+    total_scores += res.first;
+    state = res.second;
+  }
+  total_scores += context_graph.Finalize(state).first;
+  EXPECT_EQ(total_scores, 3);
+}
+
+TEST(ContextGraph, TestGetPath) {
+  std::vector<std::string> contexts_str({"HE", "SHE", "HERS", "HIS"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &s : contexts_str) {
+    contexts.emplace_back(s.begin(), s.end());
+  }
+  auto context_graph = ContextGraph(contexts, 1);
+  EXPECT_EQ(context_graph.NumStates(), 10);
+
+  std::vector<int32_t> path = {'H', 'E', 'R'};
+  auto state = context_graph.GetState(path);
+  ASSERT_NE(state, nullptr);
+  EXPECT_EQ(state->token, 'R');
+  EXPECT_EQ(context_graph.GetPath(state), path);
+
+  EXPECT_EQ(context_graph.GetState({'H', 'A'}), nullptr);
+  EXPECT_TRUE(context_graph.GetPath(context_graph.Root()).empty());
+
+  // Every prefix of a phrase is a state and GetPath() is the inverse
+  // of GetState() for it
+  for (const auto &c : contexts) {
+    for (size_t i = 1; i <= c.size(); ++i) {
+      std::vector<int32_t> prefix(c.begin(), c.begin() + i);
+      auto s = context_graph.GetState(prefix);
+      ASSERT_NE(s, nullptr);
+      EXPECT_EQ(s->depth, static_cast<int32_t>(i));
+      EXPECT_EQ(context_graph.GetPath(s), prefix);
+    }
+  }
+}
+
+TEST(ContextGraph, TestUpdate) {
+  std::vector<std::string> contexts_str(
+      {"S", "HE", "SHE", "SHELL", "HIS", "HERS", "HELLO", "THIS", "THEM"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &s : contexts_str) {
+    contexts.emplace_back(s.begin(), s.end());
+  }
+
+  // Build the graph in several steps and compare it with a graph built
+  // from all of the phrases at once
+  std::vector<std::vector<int32_t>> first(contexts.begin(),
+                                          contexts.begin() + 4);
+  std::vector<std::vector<int32_t>> second(contexts.begin() + 4,
+                                           contexts.end());
+  std::vector<std::vector<int32_t>> extra = {{'H', 'E', 'N'}, {'T'}};
+
+  auto g0 = std::make_shared<ContextGraph>(first, 1);
+  auto g1 = g0->Update(second, {});
+  auto g2 = g1->Update(extra, {});
+  auto g3 = g2->Update({}, extra);
+  EXPECT_EQ(g3->Version(), 3);
+
+  ContextGraph expected(contexts, 1);
+  EXPECT_EQ(g3->GetPhrases(), expected.GetPhrases());
+  EXPECT_EQ(g3->NumStates(), expected.NumStates());
+
+  // g0 is not changed
+  EXPECT_EQ(g0->GetPhrases().size(), first.size());
+
+  for (const auto &query :
+       {"HEHERSHE", "HERSHE", "HISHE", "SHED", "THEN", "DHRHISQ"}) {
+    float score = 0;
+    float expected_score = 0;
+    auto state = g3->Root();
+    auto expected_state = expected.Root();
+    for (const char *p = query; *p; ++p) {
+      auto res = g3->ForwardOneStep(state, *p);
+      auto expected_res = expected.ForwardOneStep(expected_state, *p);
+      score += res.first;
+      expected_score += expected_res.first;
+      state = res.second;
+      expected_state = expected_res.second;
+    }
+    EXPECT_EQ(score, expected_score) << query;
+  }
+}
+
+// Check that g matches the given phrases and scores every token sequence
+// the same way as a graph built from scratch from them
+static void ExpectSameAsBuiltFromScratch(
+    const ContextGraph &g, const std::set<std::vector<int32_t>> &phrases,
+    float context_score, int32_t num_tokens, std::mt19937 *rng) {
+  std::vector<std::vector<int32_t>> sorted(phrases.begin(), phrases.end());
+  ContextGraph expected(sorted, context_score);
+
+  ASSERT_EQ(g.GetPhrases(), sorted);
+  ASSERT_EQ(g.NumStates(), expected.NumStates());
+
+  std::uniform_int_distribution<int32_t> token(1, num_tokens);
+  for (int32_t n = 0; n != 20; ++n) {
+    auto state = g.Root();
+    auto expected_state = expected.Root();
+    for (int32_t i = 0; i != 30; ++i) {
+      int32_t t = token(*rng);
+      auto res = g.ForwardOneStep(state, t);
+      auto expected_res = expected.ForwardOneStep(expected_state, t);
+      ASSERT_NEAR(res.first, expected_res.first, 1e-4);
+      ASSERT_EQ(g.GetPath(res.second), expected.GetPath(expected_res.second));
+      state = res.second;
+      expected_state = expected_res.second;
+    }
+    ASSERT_NEAR(g.Finalize(state).first,
+                expected.Finalize(expected_state).first, 1e-4);
+  }
+}
+
+// Apply random sequences of Update() and compare the result after each
+// of them with a graph built from scratch
+TEST(ContextGraph, TestRandomUpdate) {
+  std::mt19937 rng(20240101);
+  int32_t num_tokens = 4;  // a small vocabulary gives many shared prefixes
+  float context_score = 1.5;
+
+  auto random_phrase = [&rng, num_tokens]() {
+    int32_t len = std::uniform_int_distribution<int32_t>(1, 5)(rng);
+    std::vector<int32_t> ans(len);
+    for (auto &t : ans) {
+      t = std::uniform_int_distribution<int32_t>(1, num_tokens)(rng);
+    }
+    return ans;
+  };
+
+  // Return a random element of a non-empty set
+  auto pick = [&rng](const std::set<std::vector<int32_t>> &s) {
+    auto it = s.begin();
+    std::advance(it, std::uniform_int_distribution<int32_t>(
+                         0, static_cast<int32_t>(s.size()) - 1)(rng));
+    return *it;
+  };
+
+  std::set<std::vector<int32_t>> phrases;
+  for (int32_t i = 0; i != 10; ++i) {
+    phrases.insert(random_phrase());
+  }
+
+  auto g = std::make_shared<ContextGraph>(
+      std::vector<std::vector<int32_t>>(phrases.begin(), phrases.end()),
+      context_score);
+
+  for (int32_t iter = 0; iter != 200; ++iter) {
+    std::vector<std::vector<int32_t>> add;
+    std::vector<std::vector<int32_t>> remove;
+
+    if (iter % 50 == 49) {
+      // Remove everything, so that most of the entries of the graph are
+      // unused and it has to be compacted
+      remove.assign(phrases.begin(), phrases.end());
+      for (int32_t i = 0; i != 3; ++i) {
+        add.push_back(random_phrase());
+      }
+    } else {
+      int32_t num_ops = std::uniform_int_distribution<int32_t>(1, 6)(rng);
+      for (int32_t i = 0; i != num_ops; ++i) {
+        int32_t op = std::uniform_int_distribution<int32_t>(0, 5)(rng);
+        if (phrases.empty()) {
+          op = 0;
+        }
+
+        switch (op) {
+          case 0:  // add a random phrase, which may exist already
+            add.push_back(random_phrase());
+            break;
+          case 1:  // add a proper prefix of an existing phrase
+          {
+            auto p = pick(phrases);
+            p.resize(std::uniform_int_distribution<int32_t>(
+                1, static_cast<int32_t>(p.size()))(rng));
+            add.push_back(p);
+            break;
+          }
+          case 2:  // remove an existing phrase
+            remove.push_back(pick(phrases));
+            break;
+          case 3:  // remove a phrase that is a prefix of a remaining one
+          {
+            auto p = pick(phrases);
+            for (size_t n = 1; n < p.size(); ++n) {
+              std::vector<int32_t> prefix(p.begin(), p.begin() + n);
+              if (phrases.count(prefix)) {
+                remove.push_back(prefix);
+                break;
+              }
+            }
+            break;
+          }
+          case 4:  // remove and re-add the same phrase in one Update()
+          {
+            auto p = pick(phrases);
+            remove.push_back(p);
+            add.push_back(p);
+            break;
+          }
+          case 5:  // remove a phrase that may not exist
+            remove.push_back(random_phrase());
+            break;
+        }
+      }
+    }
+
+    // A phrase in both lists is kept
+    for (const auto &p : remove) {
+      phrases.erase(p);
+    }
+    for (const auto &p : add) {
+      phrases.insert(p);
+    }
+
+    g = g->Update(add, remove);
+    EXPECT_EQ(g->Version(), iter + 1);
+    ExpectSameAsBuiltFromScratch(*g, phrases, context_score, num_tokens, &rng);
+    if (HasFatalFailure()) {
+      FAIL() << "Mismatch after Update() #" << iter;
+    }
+  }
+}
+
 }  // namespace sherpa
@@ -0,0 +1,42 @@
+// sherpa/csrc/test-model-registry.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "sherpa/csrc/model-registry.h"
+
+namespace sherpa {
+
+TEST(ModelRegistry, SymbolTable) {
+  std::string filename = "test-model-registry-tokens.txt";
+  {
+    std::ofstream os(filename);
+    os << "<blk> 0\n";
+    os << "a 1\n";
+    os << "b 2\n";
+  }
+
+  auto sym1 = LoadSymbolTable(filename, /*shared*/ true);
+  auto sym2 = LoadSymbolTable(filename, /*shared*/ true);
+  EXPECT_EQ(sym1.get(), sym2.get());
+  EXPECT_EQ((*sym1)[2], "b");
+
+  auto sym3 = LoadSymbolTable(filename, /*shared*/ false);
+  EXPECT_NE(sym1.get(), sym3.get());
+  EXPECT_EQ((*sym3)[2], "b");
+
+  ModelRegistry::GetInstance().Clear();
+
+  // It is still valid after Clear()
+  EXPECT_EQ((*sym1)[1], "a");
+
+  auto sym4 = LoadSymbolTable(filename, /*shared*/ true);
+  EXPECT_NE(sym1.get(), sym4.get());
+
+  std::remove(filename.c_str());
+}
+
+}  // namespace sherpa
@@ -0,0 +1,72 @@
+// sherpa/csrc/test-offline-ctc-one-best-decoder.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa/csrc/offline-ctc-one-best-decoder.h"
+
+namespace sherpa {
+
+// Return a tensor of shape (T, vocab_size) whose argmax of row t is ids[t]
+static torch::Tensor ToLogProb(const std::vector<int32_t> &ids,
+                               int32_t vocab_size) {
+  int32_t num_frames = ids.size();
+  torch::Tensor log_prob = torch::full({num_frames, vocab_size}, -10.0f);
+  for (int32_t t = 0; t != num_frames; ++t) {
+    log_prob[t][ids[t]] = 0;
+  }
+  return log_prob;
+}
+
+TEST(OfflineCtcOneBestDecoder, GreedySearch) {
+  int32_t vocab_size = 5;
+  OfflineCtcDecoderConfig config;
+  OfflineCtcOneBestDecoder decoder(config, torch::kCPU, vocab_size);
+
+  // 0 is the blank. Frames after the length of an utterance are padding.
+  std::vector<int32_t> ids1 = {0, 1, 1, 0, 1, 2, 2, 0, 3, 3};
+  std::vector<int32_t> ids2 = {4, 4, 0, 0, 2, 3, 0, 0, 1, 1};
+
+  torch::Tensor log_prob = torch::stack(
+      {ToLogProb(ids1, vocab_size), ToLogProb(ids2, vocab_size)});
+  torch::Tensor log_prob_len = torch::tensor({10, 6}, torch::kInt);
+
+  auto results = decoder.Decode(log_prob, log_prob_len);
+  ASSERT_EQ(results.size(), 2u);
+
+  EXPECT_EQ(results[0].tokens, (std::vector<int32_t>{1, 1, 2, 3}));
+  EXPECT_EQ(results[0].timestamps, (std::vector<int32_t>{1, 4, 5, 8}));
+
+  EXPECT_EQ(results[1].tokens, (std::vector<int32_t>{4, 2, 3}));
+  EXPECT_EQ(results[1].timestamps, (std::vector<int32_t>{0, 4, 5}));
+}
+
+// Decode with a CTC topology as the HLG. A token repeated with a blank
+// in between gives two tokens, as in GreedySearch().
+TEST(OfflineCtcOneBestDecoder, CtcTopoAsHlg) {
+  int32_t vocab_size = 5;
+  OfflineCtcDecoderConfig config;
+  config.hlg = "ctc-topo";  // not loaded since we pass the graph below
+  k2::FsaClassPtr ctc_topo =
+      k2::GetCtcTopo(vocab_size - 1, /*modified*/ false, torch::kCPU);
+  OfflineCtcOneBestDecoder decoder(config, torch::kCPU, vocab_size, ctc_topo);
+
+  std::vector<int32_t> ids1 = {0, 1, 1, 0, 1, 2, 2, 0, 3, 3};
+  std::vector<int32_t> ids2 = {4, 4, 0, 0, 2, 3, 0, 0, 1, 1};
+
+  torch::Tensor log_prob = torch::stack(
+      {ToLogProb(ids1, vocab_size), ToLogProb(ids2, vocab_size)});
+  torch::Tensor log_prob_len = torch::tensor({10, 6}, torch::kInt);
+
+  auto results = decoder.Decode(log_prob, log_prob_len);
+  ASSERT_EQ(results.size(), 2u);
+
+  EXPECT_EQ(results[0].tokens, (std::vector<int32_t>{1, 1, 2, 3}));
+  EXPECT_EQ(results[0].timestamps, (std::vector<int32_t>{1, 4, 5, 8}));
+
+  EXPECT_EQ(results[1].tokens, (std::vector<int32_t>{4, 2, 3}));
+  EXPECT_EQ(results[1].timestamps, (std::vector<int32_t>{0, 4, 5}));
+}
+
+}  // namespace sherpa
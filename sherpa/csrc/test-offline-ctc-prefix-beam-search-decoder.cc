@@ -0,0 +1,86 @@
+// sherpa/csrc/test-offline-ctc-prefix-beam-search-decoder.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa/cpp_api/offline-stream.h"
+#include "sherpa/csrc/context-graph.h"
+#include "sherpa/csrc/offline-ctc-prefix-beam-search-decoder.h"
+
+namespace sherpa {
+
+TEST(OfflineCtcPrefixBeamSearchDecoder, SameAsGreedySearch) {
+  int32_t vocab_size = 5;
+  std::vector<int32_t> ids = {0, 1, 1, 0, 1, 2, 2, 0, 3, 3};
+  int32_t num_frames = ids.size();
+
+  torch::Tensor log_prob = torch::full({1, num_frames, vocab_size}, -10.0f);
+  for (int32_t t = 0; t != num_frames; ++t) {
+    log_prob[0][t][ids[t]] = 0;
+  }
+  log_prob = log_prob.log_softmax(-1);
+  torch::Tensor log_prob_len = torch::tensor({num_frames}, torch::kInt);
+
+  OfflineCtcPrefixBeamSearchDecoder decoder(/*num_active_paths*/ 4,
+                                            /*top_k*/ 3);
+  auto results = decoder.Decode(log_prob, log_prob_len);
+  ASSERT_EQ(results.size(), 1u);
+
+  EXPECT_EQ(results[0].tokens, (std::vector<int32_t>{1, 1, 2, 3}));
+  EXPECT_EQ(results[0].timestamps, (std::vector<int32_t>{1, 4, 5, 8}));
+}
+
+// Greedy search gives an empty result, but the prefix [1] has a larger
+// probability when all of its paths are summed.
+TEST(OfflineCtcPrefixBeamSearchDecoder, MergePaths) {
+  // P(blank) = 0.6, P(1) = 0.4 for both frames
+  torch::Tensor log_prob =
+      torch::tensor({0.6f, 0.4f}).log().repeat({1, 2, 1});
+  torch::Tensor log_prob_len = torch::tensor({2}, torch::kInt);
+
+  OfflineCtcPrefixBeamSearchDecoder decoder(/*num_active_paths*/ 4,
+                                            /*top_k*/ 2);
+  auto results = decoder.Decode(log_prob, log_prob_len);
+  ASSERT_EQ(results.size(), 1u);
+
+  // 0.4 * 0.4 + 0.4 * 0.6 + 0.6 * 0.4 = 0.64 > 0.6 * 0.6
+  EXPECT_EQ(results[0].tokens, (std::vector<int32_t>{1}));
+  EXPECT_EQ(results[0].timestamps, (std::vector<int32_t>{0}));
+}
+
+TEST(OfflineCtcPrefixBeamSearchDecoder, ContextGraph) {
+  // The middle frame prefers 1 over 2 by a small margin
+  torch::Tensor log_prob = torch::tensor({{0.98f, 0.01f, 0.01f},
+                                          {0.10f, 0.50f, 0.40f},
+                                          {0.98f, 0.01f, 0.01f}})
+                               .log()
+                               .unsqueeze(0)
+                               .repeat({2, 1, 1});
+  torch::Tensor log_prob_len = torch::tensor({3, 3}, torch::kInt);
+
+  FeatureConfig feat_config;
+  kaldifeat::Fbank fbank(feat_config.fbank_opts);
+
+  auto context_graph = std::make_shared<ContextGraph>(
+      std::vector<std::vector<int32_t>>{{2}}, /*context_score*/ 1.5);
+
+  // Only the second stream has hotwords
+  OfflineStream s0(&fbank, feat_config);
+  OfflineStream s1(&fbank, feat_config, context_graph);
+  OfflineStream *ss[2] = {&s0, &s1};
+
+  OfflineCtcPrefixBeamSearchDecoder decoder(/*num_active_paths*/ 4,
+                                            /*top_k*/ 3);
+  auto results = decoder.Decode(log_prob, log_prob_len,
+                                /*subsampling_factor*/ 1, ss, 2);
+  ASSERT_EQ(results.size(), 2u);
+
+  EXPECT_EQ(results[0].tokens, (std::vector<int32_t>{1}));
+  EXPECT_EQ(results[1].tokens, (std::vector<int32_t>{2}));
+  EXPECT_EQ(results[1].timestamps, (std::vector<int32_t>{1}));
+}
+
+}  // namespace sherpa
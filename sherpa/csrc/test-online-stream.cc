@@ -50,4 +50,78 @@ TEST(OnlineStream, Test) {
   EXPECT_TRUE(s.IsLastFrame(0));
 }
 
+TEST(OnlineStream, DiscardProcessedFrames) {
+  float sampling_rate = 16000;
+  int32_t feature_dim = 80;
+  FeatureConfig feat_config;
+  feat_config.fbank_opts.mel_opts.num_bins = feature_dim;
+  feat_config.fbank_opts.frame_opts.dither = 0;
+
+  OnlineStream s(feat_config);
+  auto a = torch::rand({3 * 16000}, torch::kFloat);
+  s.AcceptWaveform(sampling_rate, a);
+  s.InputFinished();
+
+  int32_t num_frames = s.NumFramesReady();
+  EXPECT_GT(num_frames, 200);
+
+  auto expected = s.GetFrame(200).clone();
+  int64_t before = s.MemoryFootprint();
+
+  s.GetNumProcessedFrames() = 200;
+  auto frame = s.GetFrame(200);
+  EXPECT_TRUE(frame.allclose(expected));
+
+  // Frame indexes are still counted from the start of the stream
+  EXPECT_EQ(s.NumFramesReady(), num_frames);
+  EXPECT_TRUE(s.IsLastFrame(num_frames - 1));
+  EXPECT_EQ(s.GetFrame(num_frames - 1).size(1), feature_dim);
+
+  int64_t after = s.MemoryFootprint();
+  EXPECT_EQ(after, (num_frames - 200) * feature_dim * sizeof(float));
+  EXPECT_LT(after, before);
+}
+
+TEST(OnlineStream, SerializeDeserialize) {
+  int32_t feature_dim = 80;
+  FeatureConfig feat_config;
+  feat_config.fbank_opts.mel_opts.num_bins = feature_dim;
+  feat_config.fbank_opts.frame_opts.dither = 0;
+
+  auto a = torch::rand({8000}, torch::kFloat);
+  auto b = torch::rand({12345}, torch::kFloat);
+
+  // Use a sampling rate different from the one of the features
+  // so that the state of the resampler is also tested.
+  int32_t sampling_rate = 8000;
+
+  OnlineStream s(feat_config);
+  s.AcceptWaveform(sampling_rate, a);
+  s.GetNumProcessedFrames() = 20;
+  s.GetWavSegment() = 3;
+  s.SetState(torch::ivalue::Tuple::create({torch::rand({2, 3})}));
+
+  OnlineStream t(feat_config);
+  t.Deserialize(s.Serialize());
+
+  EXPECT_EQ(t.NumFramesReady(), s.NumFramesReady());
+  EXPECT_EQ(t.GetNumProcessedFrames(), 20);
+  EXPECT_EQ(t.GetWavSegment(), 3);
+  EXPECT_TRUE(t.GetState().toTuple()->elements()[0].toTensor().allclose(
+      s.GetState().toTuple()->elements()[0].toTensor()));
+
+  s.AcceptWaveform(sampling_rate, b);
+  s.InputFinished();
+
+  t.AcceptWaveform(sampling_rate, b);
+  t.InputFinished();
+
+  int32_t num_frames = s.NumFramesReady();
+  EXPECT_EQ(t.NumFramesReady(), num_frames);
+  for (int32_t i = 20; i != num_frames; ++i) {
+    EXPECT_TRUE(t.GetFrame(i).allclose(s.GetFrame(i), 1e-4, 1e-4)) << i;
+  }
+  EXPECT_TRUE(t.IsLastFrame(num_frames - 1));
+}
+
 }  // namespace sherpa
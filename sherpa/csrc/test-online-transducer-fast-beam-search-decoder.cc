@@ -0,0 +1,241 @@
+// sherpa/csrc/test-online-transducer-fast-beam-search-decoder.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa/csrc/online-transducer-fast-beam-search-decoder.h"
+#include "torch/torch.h"
+
+namespace sherpa {
+
+namespace {
+
+constexpr int32_t kVocabSize = 6;
+
+// Its encoder output is its input. Its joiner adds the encoder output to
+// a penalty for repeating the last token, so the result depends on the
+// decoding history.
+class FakeModel : public OnlineTransducerModel {
+ public:
+  FakeModel() {
+    // To set the vocabulary size
+    WarmUp(torch::zeros({1, 4, kVocabSize}),
+           torch::full({1}, 4, torch::kLong));
+  }
+
+  torch::IValue StackStates(
+      const std::vector<torch::IValue> &states) const override {
+    return states[0];
+  }
+
+  std::vector<torch::IValue> UnStackStates(
+      torch::IValue states) const override {
+    return {states};
+  }
+
+  torch::IValue GetEncoderInitStates(int32_t /*unused*/ = 1) override {
+    return torch::zeros({1});
+  }
+
+  std::tuple<torch::Tensor, torch::Tensor, torch::IValue> RunEncoder(
+      const torch::Tensor &features, const torch::Tensor &features_length,
+      const torch::Tensor & /*num_processed_frames*/,
+      torch::IValue states) override {
+    return {features, features_length, states};
+  }
+
+  torch::Tensor RunDecoder(const torch::Tensor &decoder_input) override {
+    torch::Tensor last = decoder_input.select(1, -1);
+    return torch::one_hot(last, kVocabSize)
+        .to(torch::kFloat)
+        .mul(-2)
+        .unsqueeze(1);
+  }
+
+  torch::Tensor RunJoiner(const torch::Tensor &encoder_out,
+                          const torch::Tensor &decoder_out) override {
+    return encoder_out + decoder_out;
+  }
+
+  torch::Device Device() const override { return torch::kCPU; }
+
+  int32_t ContextSize() const override { return 2; }
+
+  int32_t ChunkSize() const override { return 12; }
+
+  int32_t ChunkShift() const override { return 12; }
+};
+
+}  // namespace
+
+// Decode two utterances chunk by chunk with traceback_interval=1 and with
+// the given interval. Partial results that are up to date and the final
+// results must be the same.
+static void CompareWithIntervalOne(int32_t interval) {
+  torch::manual_seed(20240101);
+
+  FakeModel model;
+
+  FastBeamSearchConfig config;
+  OnlineTransducerFastBeamSearchDecoder ref_decoder(&model, config);
+
+  config.traceback_interval = interval;
+  OnlineTransducerFastBeamSearchDecoder decoder(&model, config);
+
+  int32_t num_chunks = 5;
+  int32_t T = 3;  // number of encoder output frames per chunk
+  std::vector<torch::Tensor> encoder_out = {
+      torch::randn({num_chunks, T, kVocabSize}) * 3,
+      torch::randn({num_chunks, T, kVocabSize}) * 3,
+  };
+
+  // Utterance 0 starts one batch earlier than utterance 1, so a batch may
+  // contain both results that are due for a traceback and results that
+  // are not.
+  std::vector<std::vector<int32_t>> schedule = {{0},    {0, 1}, {0, 1},
+                                                {0, 1}, {0, 1}, {1}};
+
+  std::vector<OnlineTransducerDecoderResult> ref = {
+      ref_decoder.GetEmptyResult(), ref_decoder.GetEmptyResult()};
+  std::vector<OnlineTransducerDecoderResult> hyp = {decoder.GetEmptyResult(),
+                                                    decoder.GetEmptyResult()};
+  std::vector<int32_t> next_chunk = {0, 0};
+
+  for (const auto &batch : schedule) {
+    std::vector<torch::Tensor> chunks;
+    std::vector<OnlineTransducerDecoderResult> ref_batch;
+    std::vector<OnlineTransducerDecoderResult> hyp_batch;
+    for (int32_t u : batch) {
+      chunks.push_back(encoder_out[u][next_chunk[u]]);
+      ++next_chunk[u];
+
+      ref_batch.push_back(ref[u]);
+      hyp_batch.push_back(hyp[u]);
+    }
+
+    torch::Tensor x = torch::stack(chunks);
+    ref_decoder.Decode(x, &ref_batch);
+    decoder.Decode(x, &hyp_batch);
+
+    for (size_t i = 0; i != batch.size(); ++i) {
+      int32_t u = batch[i];
+      ref[u] = ref_batch[i];
+      hyp[u] = hyp_batch[i];
+
+      ref[u].num_processed_frames += T * model.SubsamplingFactor();
+      hyp[u].num_processed_frames += T * model.SubsamplingFactor();
+
+      EXPECT_EQ(ref[u].num_pending_chunks, 0);
+      if (hyp[u].num_pending_chunks == 0) {
+        EXPECT_EQ(hyp[u].tokens, ref[u].tokens);
+        EXPECT_EQ(hyp[u].timestamps, ref[u].timestamps);
+        EXPECT_EQ(hyp[u].num_trailing_blanks, ref[u].num_trailing_blanks);
+      }
+    }
+  }
+
+  for (int32_t u = 0; u != 2; ++u) {
+    ref_decoder.FinalizeResult(nullptr, &ref[u]);
+    decoder.FinalizeResult(nullptr, &hyp[u]);
+
+    EXPECT_FALSE(ref[u].tokens.empty());
+    EXPECT_EQ(hyp[u].num_pending_chunks, 0);
+    EXPECT_EQ(hyp[u].tokens, ref[u].tokens);
+    EXPECT_EQ(hyp[u].timestamps, ref[u].timestamps);
+    EXPECT_EQ(hyp[u].num_trailing_blanks, ref[u].num_trailing_blanks);
+
+    // Calling it again is a no-op
+    auto tokens = hyp[u].tokens;
+    decoder.FinalizeResult(nullptr, &hyp[u]);
+    EXPECT_EQ(hyp[u].tokens, tokens);
+  }
+}
+
+TEST(OnlineTransducerFastBeamSearchDecoder, TracebackInterval2) {
+  CompareWithIntervalOne(2);
+}
+
+TEST(OnlineTransducerFastBeamSearchDecoder, TracebackInterval3) {
+  CompareWithIntervalOne(3);
+}
+
+// Only FinalizeResult() traces back the lattice
+TEST(OnlineTransducerFastBeamSearchDecoder, TracebackOnlyAtTheEnd) {
+  CompareWithIntervalOne(100);
+}
+
+// With endpointing enabled, OnlineRecognizer checks endpoints only on
+// results whose num_pending_chunks is 0 and calls FinalizeResult() only at
+// endpoints. The lattice must not be traced back more often than once
+// every traceback_interval chunks.
+TEST(OnlineTransducerFastBeamSearchDecoder, TracebacksWithEndpointing) {
+  torch::manual_seed(20240102);
+
+  FakeModel model;
+
+  FastBeamSearchConfig config;
+  OnlineTransducerFastBeamSearchDecoder ref_decoder(&model, config);
+
+  int32_t interval = 3;
+  config.traceback_interval = interval;
+  OnlineTransducerFastBeamSearchDecoder decoder(&model, config);
+
+  int32_t num_chunks = 7;
+  int32_t T = 3;  // number of encoder output frames per chunk
+  torch::Tensor encoder_out = torch::randn({num_chunks, T, kVocabSize}) * 3;
+
+  // The last chunks contain only blanks
+  encoder_out.narrow(0, 4, 3).select(2, 0).fill_(100);
+
+  std::vector<OnlineTransducerDecoderResult> ref = {
+      ref_decoder.GetEmptyResult()};
+  std::vector<OnlineTransducerDecoderResult> hyp = {decoder.GetEmptyResult()};
+
+  int32_t num_endpoint_checks = 0;
+  for (int32_t c = 0; c != num_chunks; ++c) {
+    torch::Tensor x = encoder_out[c].unsqueeze(0);
+    ref_decoder.Decode(x, &ref);
+    decoder.Decode(x, &hyp);
+
+    ref[0].num_processed_frames += T * model.SubsamplingFactor();
+    hyp[0].num_processed_frames += T * model.SubsamplingFactor();
+
+    EXPECT_EQ(decoder.NumTracebacks(), (c + 1) / interval);
+
+    if (hyp[0].num_pending_chunks == 0) {
+      // An endpoint would be checked here
+      ++num_endpoint_checks;
+      EXPECT_EQ(hyp[0].num_trailing_blanks, ref[0].num_trailing_blanks);
+    }
+  }
+
+  EXPECT_EQ(num_endpoint_checks, num_chunks / interval);
+  EXPECT_EQ(ref_decoder.NumTracebacks(), num_chunks);
+
+  // The last 3 chunks are decoded to blanks
+  EXPECT_GE(ref[0].num_trailing_blanks, 3 * T);
+
+  // At the end of the input
+  decoder.FinalizeResult(nullptr, &hyp[0]);
+  EXPECT_EQ(decoder.NumTracebacks(), num_chunks / interval + 1);
+  EXPECT_EQ(hyp[0].tokens, ref[0].tokens);
+  EXPECT_EQ(hyp[0].num_trailing_blanks, ref[0].num_trailing_blanks);
+}
+
+TEST(OnlineTransducerFastBeamSearchDecoder, FinalizeEmptyResult) {
+  FakeModel model;
+
+  FastBeamSearchConfig config;
+  config.traceback_interval = 2;
+  OnlineTransducerFastBeamSearchDecoder decoder(&model, config);
+
+  auto r = decoder.GetEmptyResult();
+  decoder.FinalizeResult(nullptr, &r);
+  EXPECT_TRUE(r.tokens.empty());
+  EXPECT_TRUE(r.timestamps.empty());
+  EXPECT_EQ(r.num_trailing_blanks, 0);
+}
+
+}  // namespace sherpa
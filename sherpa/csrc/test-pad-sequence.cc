@@ -0,0 +1,35 @@
+// sherpa/csrc/test-pad-sequence.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sherpa/csrc/pad-sequence.h"
+
+namespace sherpa {
+
+TEST(PadSequence, Features) {
+  std::vector<torch::Tensor> v = {torch::ones({3, 2}), torch::ones({1, 2})};
+
+  torch::Tensor ans = PadSequence(v, /*return_waveform*/ false);
+  EXPECT_EQ(ans.sizes(), (std::vector<int64_t>{2, 3, 2}));
+  EXPECT_FLOAT_EQ(ans[1][2][0].item<float>(), -23.025850929940457f);
+}
+
+TEST(PadSequence, Waveforms) {
+  std::vector<torch::Tensor> v = {torch::ones({5}), torch::ones({2})};
+
+  ShapeBucketizer bucketizer(4);
+  torch::Tensor ans = PadSequence(v, /*return_waveform*/ true, &bucketizer);
+  EXPECT_EQ(ans.sizes(), (std::vector<int64_t>{2, 8}));
+
+  // Padded by pad_sequence
+  EXPECT_TRUE(ans[1].slice(0, 2, 5).eq(0).all().item<bool>());
+
+  // Padded to the bucket
+  EXPECT_TRUE(ans.slice(1, 5, 8).eq(0).all().item<bool>());
+
+  EXPECT_TRUE(ans[0].slice(0, 0, 5).eq(1).all().item<bool>());
+}
+
+}  // namespace sherpa
@@ -0,0 +1,59 @@
+// sherpa/csrc/test-shape-bucketizer.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#include "gtest/gtest.h"
+#include "sherpa/csrc/shape-bucketizer.h"
+
+namespace sherpa {
+
+TEST(ShapeBucketizer, Buckets) {
+  ShapeBucketizer bucketizer({8, 1, 4, 2});
+
+  EXPECT_EQ(bucketizer.Bucketize(1), 1);
+  EXPECT_EQ(bucketizer.Bucketize(3), 4);
+  EXPECT_EQ(bucketizer.Bucketize(4), 4);
+  EXPECT_EQ(bucketizer.Bucketize(5), 8);
+
+  // larger than all buckets, so it is not padded
+  EXPECT_EQ(bucketizer.Bucketize(10), 10);
+
+  BucketStats stats = bucketizer.GetStats();
+  EXPECT_EQ(stats.num_calls, 5);
+  EXPECT_EQ(stats.num_hits, 4);
+  EXPECT_EQ(stats.num_real, 1 + 3 + 4 + 5 + 10);
+  EXPECT_EQ(stats.num_padded, 1 + 4 + 4 + 8 + 10);
+  EXPECT_FLOAT_EQ(stats.HitRate(), 0.8);
+
+  EXPECT_EQ(stats.counts.size(), 4u);
+  EXPECT_EQ(stats.counts[4], 2);
+  EXPECT_EQ(stats.counts[10], 1);
+}
+
+TEST(ShapeBucketizer, Grid) {
+  ShapeBucketizer bucketizer(50);
+
+  EXPECT_EQ(bucketizer.Bucketize(1), 50);
+  EXPECT_EQ(bucketizer.Bucketize(50), 50);
+  EXPECT_EQ(bucketizer.Bucketize(51), 100);
+
+  BucketStats stats = bucketizer.GetStats();
+  EXPECT_EQ(stats.num_calls, 3);
+  EXPECT_EQ(stats.num_hits, 3);
+  EXPECT_FLOAT_EQ(stats.Efficiency(), 102.0 / 200);
+}
+
+TEST(ShapeBucketizer, ResetStats) {
+  ShapeBucketizer bucketizer({2, 4});
+  bucketizer.Bucketize(1);
+  bucketizer.ResetStats();
+
+  EXPECT_EQ(bucketizer.Bucketize(3), 4);
+
+  BucketStats stats = bucketizer.GetStats();
+  EXPECT_EQ(stats.num_calls, 1);
+  EXPECT_EQ(stats.num_real, 3);
+  EXPECT_EQ(stats.counts.size(), 1u);
+  EXPECT_EQ(stats.counts.count(2), 0u);
+}
+
+}  // namespace sherpa
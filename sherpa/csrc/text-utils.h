@@ -0,0 +1,48 @@
+// sherpa/csrc/text-utils.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_TEXT_UTILS_H_
+#define SHERPA_CSRC_TEXT_UTILS_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sherpa/csrc/log.h"
+
+namespace sherpa {
+
+/** Split a comma separated list of positive numbers, e.g., "1,2,4".
+ *
+ * It aborts if any of them is not a positive number.
+ *
+ * @param s  The string to split. Empty fields are ignored.
+ * @param name  Name of the option that s comes from. Used in error messages.
+ */
+template <typename T>
+std::vector<T> SplitToPositiveNumbers(const std::string &s,
+                                      const std::string &name) {
+  std::vector<T> ans;
+  std::istringstream is(s);
+  std::string field;
+  while (std::getline(is, field, ',')) {
+    if (field.empty()) {
+      continue;
+    }
+
+    std::istringstream fs(field);
+    T value;
+    fs >> value;
+    if (fs.fail() || !fs.eof() || value <= 0) {
+      SHERPA_LOG(FATAL) << "Invalid value '" << field << "' in --" << name
+                        << "=" << s << ". Expect a comma separated list of "
+                        << "positive numbers";
+    }
+    ans.push_back(value);
+  }
+  return ans;
+}
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_TEXT_UTILS_H_
@@ -0,0 +1,32 @@
+// sherpa/csrc/timer.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_CSRC_TIMER_H_
+#define SHERPA_CSRC_TIMER_H_
+
+#include <chrono>  // NOLINT
+
+namespace sherpa {
+
+// A simple wall-clock timer, e.g., for logging the time spent on each
+// step when creating a recognizer.
+class Timer {
+ public:
+  Timer() { Reset(); }
+
+  void Reset() { begin_ = std::chrono::steady_clock::now(); }
+
+  // Return the number of seconds since the construction or the last call
+  // of Reset().
+  double Elapsed() const {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point begin_;
+};
+
+}  // namespace sherpa
+
+#endif  // SHERPA_CSRC_TIMER_H_
@@ -0,0 +1,76 @@
+// sherpa/python/csrc/audio-segmenter.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/cpp_api/audio-segmenter.h"
+
+#include <memory>
+#include <string>
+
+#include "sherpa/python/csrc/audio-segmenter.h"
+
+namespace sherpa {
+
+static constexpr const char *kLongFormConfigInitDoc = R"doc(
+Constructor for the configuration of long-form decoding, which is used by
+:meth:`OfflineRecognizer.decode_long_form`.
+
+Args:
+  max_segment_duration:
+    Maximum duration in seconds of a segment, excluding padding. Longer
+    speech is split at the longest pause in it.
+  min_silence_duration:
+    Speech separated by non-speech shorter than this number of seconds is
+    kept in the same segment.
+  max_merge_silence_duration:
+    Adjacent segments are merged if the non-speech between them is not
+    longer than this number of seconds and the result is not longer than
+    max_segment_duration. Use 0 to disable it.
+  energy_threshold:
+    A frame is considered as speech if the average of its log mel
+    filterbank energies is larger than this value. It is for samples
+    normalized to the range [-1, 1].
+  padding:
+    Number of seconds of audio added to both sides of a segment.
+  batch_size:
+    Number of segments to decode at a time.
+)doc";
+
+void PybindAudioSegmenter(py::module &m) {  // NOLINT
+  using PyClass = LongFormConfig;
+  py::class_<PyClass>(m, "LongFormConfig")
+      .def(py::init([](float max_segment_duration = 30,
+                       float min_silence_duration = 0.3,
+                       float max_merge_silence_duration = 1,
+                       float energy_threshold = -10, float padding = 0.1,
+                       int32_t batch_size = 16)
+                        -> std::unique_ptr<LongFormConfig> {
+             auto config = std::make_unique<LongFormConfig>();
+
+             config->max_segment_duration = max_segment_duration;
+             config->min_silence_duration = min_silence_duration;
+             config->max_merge_silence_duration = max_merge_silence_duration;
+             config->energy_threshold = energy_threshold;
+             config->padding = padding;
+             config->batch_size = batch_size;
+
+             return config;
+           }),
+           py::arg("max_segment_duration") = 30,
+           py::arg("min_silence_duration") = 0.3,
+           py::arg("max_merge_silence_duration") = 1,
+           py::arg("energy_threshold") = -10, py::arg("padding") = 0.1,
+           py::arg("batch_size") = 16, kLongFormConfigInitDoc)
+      .def_readwrite("max_segment_duration", &PyClass::max_segment_duration)
+      .def_readwrite("min_silence_duration", &PyClass::min_silence_duration)
+      .def_readwrite("max_merge_silence_duration",
+                     &PyClass::max_merge_silence_duration)
+      .def_readwrite("energy_threshold", &PyClass::energy_threshold)
+      .def_readwrite("padding", &PyClass::padding)
+      .def_readwrite("batch_size", &PyClass::batch_size)
+      .def("validate", &PyClass::Validate)
+      .def("__str__",
+           [](const PyClass &self) -> std::string { return self.ToString(); });
+}
+
+}  // namespace sherpa
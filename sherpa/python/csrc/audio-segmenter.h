@@ -0,0 +1,15 @@
+// sherpa/python/csrc/audio-segmenter.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_PYTHON_CSRC_AUDIO_SEGMENTER_H_
+#define SHERPA_PYTHON_CSRC_AUDIO_SEGMENTER_H_
+
+#include "sherpa/python/csrc/sherpa.h"
+
+namespace sherpa {
+
+void PybindAudioSegmenter(py::module &m);  // NOLINT
+
+}
+
+#endif  // SHERPA_PYTHON_CSRC_AUDIO_SEGMENTER_H_
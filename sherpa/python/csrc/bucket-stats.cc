@@ -0,0 +1,27 @@
+// sherpa/python/csrc/bucket-stats.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/python/csrc/bucket-stats.h"
+
+#include <string>
+
+#include "sherpa/csrc/shape-bucketizer.h"
+
+namespace sherpa {
+
+void PybindBucketStats(py::module &m) {  // NOLINT
+  using PyClass = BucketStats;
+  py::class_<PyClass>(m, "BucketStats")
+      .def_readonly("num_calls", &PyClass::num_calls)
+      .def_readonly("num_hits", &PyClass::num_hits)
+      .def_readonly("num_real", &PyClass::num_real)
+      .def_readonly("num_padded", &PyClass::num_padded)
+      .def_readonly("counts", &PyClass::counts)
+      .def_property_readonly("hit_rate", &PyClass::HitRate)
+      .def_property_readonly("efficiency", &PyClass::Efficiency)
+      .def("__str__",
+           [](const PyClass &self) -> std::string { return self.ToString(); });
+}
+
+}  // namespace sherpa
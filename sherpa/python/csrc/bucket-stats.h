@@ -0,0 +1,15 @@
+// sherpa/python/csrc/bucket-stats.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_PYTHON_CSRC_BUCKET_STATS_H_
+#define SHERPA_PYTHON_CSRC_BUCKET_STATS_H_
+
+#include "sherpa/python/csrc/sherpa.h"
+
+namespace sherpa {
+
+void PybindBucketStats(py::module &m);  // NOLINT
+
+}
+
+#endif  // SHERPA_PYTHON_CSRC_BUCKET_STATS_H_
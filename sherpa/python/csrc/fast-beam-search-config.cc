@@ -20,9 +20,9 @@ void PybindFastBeamSearch(py::module &m) {  // NOLINT
   py::class_<PyClass>(m, "FastBeamSearchConfig")
       .def(py::init([](const std::string &lg = "", float ngram_lm_scale = 0.01,
                        float beam = 20.0, int32_t max_states = 64,
-                       int32_t max_contexts = 8,
-                       bool allow_partial =
-                           false) -> std::unique_ptr<FastBeamSearchConfig> {
+                       int32_t max_contexts = 8, bool allow_partial = false,
+                       int32_t traceback_interval =
+                           1) -> std::unique_ptr<FastBeamSearchConfig> {
              auto config = std::make_unique<FastBeamSearchConfig>();
 
              config->lg = lg;
@@ -31,12 +31,14 @@ void PybindFastBeamSearch(py::module &m) {  // NOLINT
              config->max_states = max_states;
              config->max_contexts = max_contexts;
              config->allow_partial = allow_partial;
+             config->traceback_interval = traceback_interval;
 
              return config;
            }),
            py::arg("lg") = "", py::arg("ngram_lm_scale") = 0.01,
            py::arg("beam") = 20.0, py::arg("max_states") = 64,
            py::arg("max_contexts") = 8, py::arg("allow_partial") = false,
+           py::arg("traceback_interval") = 1,
            kFastBeamSearchConfigInitDoc)
       .def_readwrite("lg", &PyClass::lg)
       .def_readwrite("ngram_lm_scale", &PyClass::ngram_lm_scale)
@@ -44,6 +46,7 @@ void PybindFastBeamSearch(py::module &m) {  // NOLINT
       .def_readwrite("max_states", &PyClass::max_states)
       .def_readwrite("max_contexts", &PyClass::max_contexts)
       .def_readwrite("allow_partial", &PyClass::allow_partial)
+      .def_readwrite("traceback_interval", &PyClass::traceback_interval)
       .def("validate", &PyClass::Validate)
       .def("__str__",
            [](const PyClass &self) -> std::string { return self.ToString(); });
@@ -47,6 +47,9 @@ Args:
     a very large number if no constraint is needed.
   lm_scale:
     Used only when HLG is not empty. It specifies the scale for HLG.scores.
+  top_k:
+    Used only when decoding_method is ``prefix_beam_search``. Only the
+    ``top_k`` tokens of each frame are used to extend the prefixes.
 )doc";
 
 static constexpr const char *kOfflineRecognizerConfigInitDoc = R"doc(
@@ -90,11 +93,12 @@ Args:
        the environment variable ``CUDA_VISIBLE_DEVICES`` to control which
        GPU is mapped to ``GPU 0``.
   num_active_paths:
-    Used only for modified_beam_search in transducer decoding. It is ignored
-    if the passed ``nn_model`` is a CTC model.
+    Used only for modified_beam_search in transducer decoding and
+    prefix_beam_search in CTC decoding.
   context_score:
     The bonus score for each token in context word/phrase.
-    Used only when decoding_method is modified_beam_search.
+    Used only when decoding_method is modified_beam_search or
+    prefix_beam_search.
   ctc_decoder_config:
     Used only when the passed ``nn_model`` is a CTC model. It is ignored if
     the passed ``nn_model`` is a transducer model.
@@ -105,9 +109,11 @@ Args:
     the passed ``nn_model`` is a CTC model. Also, if the decoding_method is
     not ``fast_beam_search``, it is ignored.
   decoding_method:
-    Used only when the passed ``nn_model`` is a transducer model.
-    Valid values are: ``greedy_search``, ``modified_beam_search``, and
-    ``fast_beam_search``.
+    Valid values for transducer models are: ``greedy_search``,
+    ``modified_beam_search``, and ``fast_beam_search``.
+    Valid values for CTC models are: ``greedy_search`` and
+    ``prefix_beam_search``. ``greedy_search`` uses HLG decoding if
+    ``ctc_decoder_config.hlg`` is not empty.
 )doc";
 
 static void PybindOfflineCtcDecoderConfig(py::module &m) {  // NOLINT
@@ -117,8 +123,8 @@ static void PybindOfflineCtcDecoderConfig(py::module &m) {  // NOLINT
                        float search_beam = 20, float output_beam = 8,
                        int32_t min_active_states = 20,
                        int32_t max_active_states = 10000,
-                       float lm_scale =
-                           1.0f) -> std::unique_ptr<OfflineCtcDecoderConfig> {
+                       float lm_scale = 1.0f, int32_t top_k = 10)
+                        -> std::unique_ptr<OfflineCtcDecoderConfig> {
              auto ans = std::make_unique<OfflineCtcDecoderConfig>();
 
              ans->modified = modified;
@@ -129,6 +135,7 @@ static void PybindOfflineCtcDecoderConfig(py::module &m) {  // NOLINT
              ans->output_beam = output_beam;
              ans->min_active_states = min_active_states;
              ans->max_active_states = max_active_states;
+             ans->top_k = top_k;
 
              return ans;
            }),
@@ -136,7 +143,7 @@ static void PybindOfflineCtcDecoderConfig(py::module &m) {  // NOLINT
            py::arg("search_beam") = 20.0, py::arg("output_beam") = 8.0,
            py::arg("min_active_states") = 20,
            py::arg("max_active_states") = 10000, py::arg("lm_scale") = 1.0,
-           kOfflineCtcDecoderConfigInitDoc)
+           py::arg("top_k") = 10, kOfflineCtcDecoderConfigInitDoc)
       .def_readwrite("modified", &PyClass::modified)
       .def_readwrite("hlg", &PyClass::hlg)
       .def_readwrite("search_beam", &PyClass::search_beam)
@@ -144,6 +151,7 @@ static void PybindOfflineCtcDecoderConfig(py::module &m) {  // NOLINT
       .def_readwrite("min_active_states", &PyClass::min_active_states)
       .def_readwrite("max_active_states", &PyClass::max_active_states)
       .def_readwrite("lm_scale", &PyClass::lm_scale)
+      .def_readwrite("top_k", &PyClass::top_k)
       .def("__str__",
            [](const PyClass &self) -> std::string { return self.ToString(); })
       .def("validate", &PyClass::Validate);
@@ -191,6 +199,8 @@ static void PybindOfflineRecognizerConfig(py::module &m) {  // NOLINT
       .def_readwrite("feat_config", &PyClass::feat_config)
       .def_readwrite("fast_beam_search_config",
                      &PyClass::fast_beam_search_config)
+      .def_readwrite("warmup_config", &PyClass::warmup_config)
+      .def_readwrite("long_form_config", &PyClass::long_form_config)
       .def_readwrite("nn_model", &PyClass::nn_model)
       .def_readwrite("tokens", &PyClass::tokens)
       .def_readwrite("use_gpu", &PyClass::use_gpu)
@@ -199,9 +209,32 @@ static void PybindOfflineRecognizerConfig(py::module &m) {  // NOLINT
       .def_readwrite("context_score", &PyClass::context_score)
       .def_readwrite("use_bbpe", &PyClass::use_bbpe)
       .def_readwrite("temperature", &PyClass::temperature)
+      .def_readwrite("use_bf16", &PyClass::use_bf16)
+      .def_readwrite("use_int8", &PyClass::use_int8)
+      .def_readwrite("freeze_model", &PyClass::freeze_model)
+      .def_readwrite("model_cache_dir", &PyClass::model_cache_dir)
+      .def_readwrite("frame_bucket_size", &PyClass::frame_bucket_size)
+      .def_readwrite("share_models", &PyClass::share_models)
       .def("validate", &PyClass::Validate);
 }
 
+static constexpr const char *kDecodeLongFormDoc = R"doc(
+Decode long-form audio, e.g., recordings that are hours long.
+
+Each recording is split at silences into segments according to
+``config.long_form_config``. Segments from all recordings are sorted by
+length and decoded in batches. Results of the segments of a recording are
+concatenated in time order.
+
+Args:
+  samples:
+    A list of 1-D float tensors. Each contains audio samples of a recording
+    normalized to the range [-1, 1].
+Returns:
+  Return a list of :class:`OfflineRecognitionResult`, one per recording.
+  Timestamps are relative to the start of each recording.
+)doc";
+
 void PybindOfflineRecognizer(py::module &m) {  // NOLINT
   PybindOfflineCtcDecoderConfig(m);
   PybindOfflineRecognizerConfig(m);
@@ -219,6 +252,11 @@ void PybindOfflineRecognizer(py::module &m) {  // NOLINT
             return self.CreateStream(contexts_list);
           },
           py::arg("contexts_list"), py::call_guard<py::gil_scoped_release>())
+      .def("set_default_context_list", &PyClass::SetDefaultContextList,
+           py::arg("contexts_list"), py::call_guard<py::gil_scoped_release>())
+      .def("update_default_context_list",
+           &PyClass::UpdateDefaultContextList, py::arg("add"),
+           py::arg("remove"), py::call_guard<py::gil_scoped_release>())
       .def("decode_stream", &PyClass::DecodeStream, py::arg("s"),
            py::call_guard<py::gil_scoped_release>())
       .def(
@@ -226,7 +264,16 @@ void PybindOfflineRecognizer(py::module &m) {  // NOLINT
           [](PyClass &self, std::vector<OfflineStream *> &ss) {
             self.DecodeStreams(ss.data(), ss.size());
           },
-          py::arg("ss"), py::call_guard<py::gil_scoped_release>());
+          py::arg("ss"), py::call_guard<py::gil_scoped_release>())
+      .def(
+          "decode_long_form",
+          [](PyClass &self, const std::vector<torch::Tensor> &samples) {
+            return self.DecodeLongForm(samples);
+          },
+          py::arg("samples"), py::call_guard<py::gil_scoped_release>(),
+          kDecodeLongFormDoc)
+      .def_property_readonly("bucket_stats", &PyClass::GetBucketStats,
+                             py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace sherpa
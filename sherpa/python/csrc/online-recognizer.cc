@@ -67,6 +67,7 @@ static void PybindOnlineRecognizerConfig(py::module &m) {  // NOLINT
       .def_readwrite("endpoint_config", &PyClass::endpoint_config)
       .def_readwrite("fast_beam_search_config",
                      &PyClass::fast_beam_search_config)
+      .def_readwrite("warmup_config", &PyClass::warmup_config)
       .def_readwrite("nn_model", &PyClass::nn_model)
       .def_readwrite("tokens", &PyClass::tokens)
       .def_readwrite("encoder_model", &PyClass::encoder_model)
@@ -82,6 +83,13 @@ static void PybindOnlineRecognizerConfig(py::module &m) {  // NOLINT
       .def_readwrite("chunk_size", &PyClass::chunk_size)
       .def_readwrite("use_bbpe", &PyClass::use_bbpe)
       .def_readwrite("temperature", &PyClass::temperature)
+      .def_readwrite("encoder_state_dtype", &PyClass::encoder_state_dtype)
+      .def_readwrite("use_bf16", &PyClass::use_bf16)
+      .def_readwrite("use_int8", &PyClass::use_int8)
+      .def_readwrite("freeze_model", &PyClass::freeze_model)
+      .def_readwrite("model_cache_dir", &PyClass::model_cache_dir)
+      .def_readwrite("batch_buckets", &PyClass::batch_buckets)
+      .def_readwrite("share_models", &PyClass::share_models)
       .def("validate", &PyClass::Validate)
       .def("__str__",
            [](const PyClass &self) -> std::string { return self.ToString(); });
@@ -102,6 +110,11 @@ void PybindOnlineRecognizer(py::module &m) {  // NOLINT
             return self.CreateStream(contexts_list);
           },
           py::arg("contexts_list"), py::call_guard<py::gil_scoped_release>())
+      .def("set_default_context_list", &PyClass::SetDefaultContextList,
+           py::arg("contexts_list"), py::call_guard<py::gil_scoped_release>())
+      .def("update_default_context_list",
+           &PyClass::UpdateDefaultContextList, py::arg("add"),
+           py::arg("remove"), py::call_guard<py::gil_scoped_release>())
       .def("is_ready", &PyClass::IsReady, py::arg("s"),
            py::call_guard<py::gil_scoped_release>())
       .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"),
@@ -116,6 +129,8 @@ void PybindOnlineRecognizer(py::module &m) {  // NOLINT
           py::arg("ss"), py::call_guard<py::gil_scoped_release>())
       .def("get_result", &PyClass::GetResult, py::arg("s"),
            py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("bucket_stats", &PyClass::GetBucketStats,
+                             py::call_guard<py::gil_scoped_release>())
       .def_property_readonly("config", &PyClass::GetConfig,
                              py::call_guard<py::gil_scoped_release>());
 }
@@ -3,6 +3,7 @@
 // Copyright (c)  2022  Xiaomi Corporation
 #include "sherpa/cpp_api/online-stream.h"
 
+#include <string>
 #include <vector>
 
 #include "sherpa/python/csrc/online-stream.h"
@@ -45,7 +46,15 @@ void PybindOnlineStream(py::module &m) {  // NOLINT
            py::arg("sampling_rate"), py::arg("waveform"),
            py::call_guard<py::gil_scoped_release>())
       .def("input_finished", &PyClass::InputFinished,
-           py::call_guard<py::gil_scoped_release>());
+           py::call_guard<py::gil_scoped_release>())
+      .def("serialize",
+           [](const PyClass &self) { return py::bytes(self.Serialize()); })
+      .def(
+          "deserialize",
+          [](PyClass &self, const std::string &blob) {
+            self.Deserialize(blob);
+          },
+          py::arg("blob"), py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace sherpa
@@ -0,0 +1,27 @@
+// sherpa/python/csrc/quantize-module.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/csrc/quantize-module.h"
+
+#include <string>
+
+#include "sherpa/python/csrc/quantize-module.h"
+#include "torch/script.h"
+
+namespace sherpa {
+
+void PybindQuantizeModule(py::module &m) {  // NOLINT
+  m.def(
+      "quantize_dynamic_int8",
+      [](const std::string &nn_model, const std::string &output) -> int32_t {
+        torch::jit::Module model = torch::jit::load(nn_model, torch::kCPU);
+        int32_t n = QuantizeDynamicInt8(&model);
+        model.save(output);
+        return n;
+      },
+      py::arg("nn_model"), py::arg("output"),
+      py::call_guard<py::gil_scoped_release>());
+}
+
+}  // namespace sherpa
@@ -0,0 +1,15 @@
+// sherpa/python/csrc/quantize-module.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_PYTHON_CSRC_QUANTIZE_MODULE_H_
+#define SHERPA_PYTHON_CSRC_QUANTIZE_MODULE_H_
+
+#include "sherpa/python/csrc/sherpa.h"
+
+namespace sherpa {
+
+void PybindQuantizeModule(py::module &m);  // NOLINT
+
+}
+
+#endif  // SHERPA_PYTHON_CSRC_QUANTIZE_MODULE_H_
@@ -21,6 +21,8 @@
 #include <string>
 
 #include "sherpa/csrc/version.h"
+#include "sherpa/python/csrc/audio-segmenter.h"
+#include "sherpa/python/csrc/bucket-stats.h"
 #include "sherpa/python/csrc/endpoint.h"
 #include "sherpa/python/csrc/fast-beam-search-config.h"
 #include "sherpa/python/csrc/feature-config.h"
@@ -29,7 +31,9 @@
 #include "sherpa/python/csrc/offline-stream.h"
 #include "sherpa/python/csrc/online-recognizer.h"
 #include "sherpa/python/csrc/online-stream.h"
+#include "sherpa/python/csrc/quantize-module.h"
 #include "sherpa/python/csrc/resample.h"
+#include "sherpa/python/csrc/warm-up-config.h"
 
 namespace sherpa {
 
@@ -41,9 +45,13 @@ PYBIND11_MODULE(_sherpa, m) {
   (void)kaldifeat.attr("FbankOptions");
 
   PybindResample(m);
+  PybindBucketStats(m);
+  PybindQuantizeModule(m);
 
   PybindFeatureConfig(m);
   PybindFastBeamSearch(m);
+  PybindWarmUpConfig(m);
+  PybindAudioSegmenter(m);
   PybindOfflineCtcModel(m);
   PybindOfflineStream(m);
   PybindOfflineRecognizer(m);
@@ -0,0 +1,56 @@
+// sherpa/python/csrc/warm-up-config.cc
+//
+// Copyright (c)  2024  Xiaomi Corporation
+
+#include "sherpa/cpp_api/warm-up-config.h"
+
+#include <memory>
+#include <string>
+
+#include "sherpa/python/csrc/warm-up-config.h"
+
+namespace sherpa {
+
+static constexpr const char *kWarmUpConfigInitDoc = R"doc(
+Constructor for the warm-up profile of a recognizer.
+
+Args:
+  batch_sizes:
+    Comma separated batch sizes, e.g., ``"1,8,16,32"``. Each of them is
+    combined with each value of ``durations`` and run through the full
+    decoding path when the recognizer is created. If empty, only a single
+    chunk or utterance is used for warm-up.
+  durations:
+    Comma separated utterance durations in seconds, e.g., ``"2,10,20"``.
+  num_active_paths:
+    Used only for ``modified_beam_search``. Comma separated values of
+    ``num_active_paths``, e.g., ``"1,4"``. If empty, the value from the
+    recognizer config is used.
+)doc";
+
+void PybindWarmUpConfig(py::module &m) {  // NOLINT
+  using PyClass = WarmUpConfig;
+  py::class_<PyClass>(m, "WarmUpConfig")
+      .def(py::init([](const std::string &batch_sizes = "",
+                       const std::string &durations = "2",
+                       const std::string &num_active_paths = "")
+                        -> std::unique_ptr<WarmUpConfig> {
+             auto config = std::make_unique<WarmUpConfig>();
+
+             config->batch_sizes = batch_sizes;
+             config->durations = durations;
+             config->num_active_paths = num_active_paths;
+
+             return config;
+           }),
+           py::arg("batch_sizes") = "", py::arg("durations") = "2",
+           py::arg("num_active_paths") = "", kWarmUpConfigInitDoc)
+      .def_readwrite("batch_sizes", &PyClass::batch_sizes)
+      .def_readwrite("durations", &PyClass::durations)
+      .def_readwrite("num_active_paths", &PyClass::num_active_paths)
+      .def("validate", &PyClass::Validate)
+      .def("__str__",
+           [](const PyClass &self) -> std::string { return self.ToString(); });
+}
+
+}  // namespace sherpa
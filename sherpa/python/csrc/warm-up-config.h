@@ -0,0 +1,15 @@
+// sherpa/python/csrc/warm-up-config.h
+//
+// Copyright (c)  2024  Xiaomi Corporation
+#ifndef SHERPA_PYTHON_CSRC_WARM_UP_CONFIG_H_
+#define SHERPA_PYTHON_CSRC_WARM_UP_CONFIG_H_
+
+#include "sherpa/python/csrc/sherpa.h"
+
+namespace sherpa {
+
+void PybindWarmUpConfig(py::module &m);  // NOLINT
+
+}
+
+#endif  // SHERPA_PYTHON_CSRC_WARM_UP_CONFIG_H_
@@ -10,11 +10,13 @@ if torch.__version__.split("+")[0] != sherpa_torch_version.split("+")[0]:
     )
 
 from _sherpa import (
+    BucketStats,
     EndpointConfig,
     EndpointRule,
     FastBeamSearchConfig,
     FeatureConfig,
     LinearResample,
+    LongFormConfig,
     OfflineCtcDecoderConfig,
     OfflineRecognizer,
     OfflineRecognizerConfig,
@@ -23,12 +25,14 @@ from _sherpa import (
     OnlineRecognizer,
     OnlineRecognizerConfig,
     OnlineStream,
+    WarmUpConfig,
     cxx_flags,
 )
 
 from .http_server import HttpServer
 from .utils import (
     encode_contexts,
+    quantize_dynamic,
     setup_logger,
     str2bool,
 )
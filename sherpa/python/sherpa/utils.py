@@ -169,3 +169,37 @@ def encode_contexts(
                         )
             contexts_list.append(ids)
     return contexts_list
+
+
+def quantize_dynamic(nn_model: Pathlike, output: Pathlike) -> int:
+    """Apply int8 dynamic quantization to the Linear layers of a torchscript
+    model and save the result.
+
+    The ``forward`` of each ``torch.nn.Linear`` and each ``ScaledLinear``
+    from icefall is rewritten to use int8 weights, so all methods of the
+    model use them, including the methods
+    used only by :class:`sherpa.OnlineRecognizer`, e.g.,
+    ``streaming_forward``. Other layers, e.g., ``torch.nn.LSTM``, are kept
+    in float32.
+
+    The saved model can be used in place of the original one, e.g., with
+    ``--nn-model``. Weights are quantized to int8 ahead of time, while
+    activations are quantized on the fly. It is intended for CPU inference.
+    To quantize a model when it is loaded instead, set ``use_int8`` in
+    :class:`sherpa.OfflineRecognizerConfig` or
+    :class:`sherpa.OnlineRecognizerConfig`.
+
+    Args:
+      nn_model:
+        Path to the torchscript model, e.g., cpu_jit.pt from icefall.
+      output:
+        Path to save the quantized model.
+    Returns:
+      Return the number of quantized Linear layers.
+    """
+    from _sherpa import quantize_dynamic_int8
+
+    n = quantize_dynamic_int8(str(nn_model), str(output))
+    if n == 0:
+        raise RuntimeError(f"{nn_model} has no Linear layers to quantize")
+    return n
@@ -4,6 +4,7 @@
 #
 #  ctest --verbose -R  test_offline_recognizer_py
 
+import tempfile
 import unittest
 from pathlib import Path
 
@@ -315,6 +316,58 @@ class TestOfflineRecognizer(unittest.TestCase):
         print(s1.result)
         print(s2.result)
 
+    def test_icefall_transducer_model_freeze(self):
+        nn_model = f"{d}/icefall-asr-librispeech-pruned-transducer-stateless8-2022-11-14/exp/cpu_jit.pt"
+        tokens = f"{d}/icefall-asr-librispeech-pruned-transducer-stateless8-2022-11-14/data/lang_bpe_500/tokens.txt"
+        wave1 = f"{d}/icefall-asr-librispeech-pruned-transducer-stateless8-2022-11-14/test_wavs/1089-134686-0001.wav"
+        wave2 = f"{d}/icefall-asr-librispeech-pruned-transducer-stateless8-2022-11-14/test_wavs/1221-135766-0001.wav"
+
+        if not Path(nn_model).is_file():
+            print("skipping test_icefall_transducer_model_freeze()")
+            return
+
+        print()
+        print("test_icefall_transducer_model_freeze()")
+
+        feat_config = sherpa.FeatureConfig()
+
+        feat_config.fbank_opts.frame_opts.samp_freq = 16000
+        feat_config.fbank_opts.mel_opts.num_bins = 80
+        feat_config.fbank_opts.mel_opts.high_freq = -400
+        feat_config.fbank_opts.frame_opts.dither = 0
+
+        def decode(freeze_model: bool, model_cache_dir: str = ""):
+            config = sherpa.OfflineRecognizerConfig(
+                nn_model=nn_model,
+                tokens=tokens,
+                use_gpu=False,
+                feat_config=feat_config,
+            )
+            config.freeze_model = freeze_model
+            config.model_cache_dir = model_cache_dir
+
+            recognizer = sherpa.OfflineRecognizer(config)
+
+            s1 = recognizer.create_stream()
+            s2 = recognizer.create_stream()
+
+            s1.accept_wave_file(wave1)
+            s2.accept_wave_file(wave2)
+
+            recognizer.decode_streams([s1, s2])
+            return [s1.result.text, s2.result.text]
+
+        expected = decode(freeze_model=False)
+
+        with tempfile.TemporaryDirectory() as cache_dir:
+            # The first run freezes the model and saves it to cache_dir
+            self.assertEqual(decode(True, cache_dir), expected)
+            self.assertEqual(len(list(Path(cache_dir).glob("model-*.pt"))), 1)
+
+            # The second run loads the frozen model from cache_dir instead
+            # of nn_model
+            self.assertEqual(decode(True, cache_dir), expected)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -922,6 +922,195 @@ class TestOnlineRecognizer(unittest.TestCase):
 
         decode(recognizer=recognizer, s=s, samples=samples)
 
+    def test_encoder_state_dtype(self):
+        """Check that storing encoder states in a lower precision between
+        chunks does not change the transcripts of the test waves.
+        """
+        model_dir = f"{d}/icefall-asr-librispeech-conv-emformer-transducer-stateless2-2022-07-05"
+        nn_model = f"{model_dir}/exp/cpu-jit-epoch-30-avg-10-torch-1.10.0.pt"
+        tokens = f"{model_dir}/data/lang_bpe_500/tokens.txt"
+
+        if not Path(nn_model).is_file():
+            print(f"{nn_model} does not exist")
+            print("skipping test_encoder_state_dtype()")
+            return
+
+        feat_config = sherpa.FeatureConfig()
+        feat_config.fbank_opts.frame_opts.samp_freq = 16000
+        feat_config.fbank_opts.mel_opts.num_bins = 80
+        feat_config.fbank_opts.mel_opts.high_freq = -400
+        feat_config.fbank_opts.frame_opts.dither = 0
+
+        waves = sorted(Path(f"{model_dir}/test_wavs").glob("*.wav"))
+        all_samples = []
+        for w in waves:
+            samples, sample_rate = torchaudio.load(str(w))
+            assert sample_rate == 16000, (w, sample_rate)
+            all_samples.append(samples.squeeze(0))
+
+        transcripts = dict()
+        for dtype in ["float32", "float16", "bfloat16", "int8"]:
+            config = sherpa.OnlineRecognizerConfig(
+                nn_model=nn_model,
+                tokens=tokens,
+                use_gpu=False,
+                feat_config=feat_config,
+                decoding_method="modified_beam_search",
+            )
+            config.encoder_state_dtype = dtype
+            recognizer = sherpa.OnlineRecognizer(config)
+
+            transcripts[dtype] = []
+            for samples in all_samples:
+                s = recognizer.create_stream()
+                decode(recognizer=recognizer, s=s, samples=samples)
+                transcripts[dtype].append(recognizer.get_result(s).text)
+
+        for dtype in ["float16", "bfloat16", "int8"]:
+            for w, ref, hyp in zip(
+                waves, transcripts["float32"], transcripts[dtype]
+            ):
+                if ref != hyp:
+                    print(f"{dtype}, {w.name}:\n  float32: {ref}\n  {dtype}: {hyp}")
+
+        self.assertEqual(transcripts["float16"], transcripts["float32"])
+        self.assertEqual(transcripts["bfloat16"], transcripts["float32"])
+
+        # int8 is lossier. Allow at most one utterance to differ.
+        num_diff = sum(
+            ref != hyp
+            for ref, hyp in zip(transcripts["float32"], transcripts["int8"])
+        )
+        self.assertLessEqual(num_diff, 1)
+
+    def test_endpoint_modified_beam_search(self):
+        """Check that trailing silence after speech triggers an endpoint
+        with modified_beam_search.
+        """
+        model_dir = f"{d}/icefall-asr-librispeech-conv-emformer-transducer-stateless2-2022-07-05"
+        nn_model = f"{model_dir}/exp/cpu-jit-epoch-30-avg-10-torch-1.10.0.pt"
+        tokens = f"{model_dir}/data/lang_bpe_500/tokens.txt"
+        wave = f"{model_dir}/test_wavs/1089-134686-0001.wav"
+
+        if not Path(nn_model).is_file():
+            print(f"{nn_model} does not exist")
+            print("skipping test_endpoint_modified_beam_search()")
+            return
+
+        feat_config = sherpa.FeatureConfig()
+        feat_config.fbank_opts.frame_opts.samp_freq = 16000
+        feat_config.fbank_opts.mel_opts.num_bins = 80
+        feat_config.fbank_opts.mel_opts.high_freq = -400
+        feat_config.fbank_opts.frame_opts.dither = 0
+
+        # Only rule2, i.e., trailing silence after decoding something,
+        # can be activated
+        endpoint_config = sherpa.EndpointConfig()
+        endpoint_config.rule1.min_trailing_silence = 1000
+        endpoint_config.rule2.min_trailing_silence = 0.8
+        endpoint_config.rule3.min_utterance_length = 1000
+
+        config = sherpa.OnlineRecognizerConfig(
+            nn_model=nn_model,
+            tokens=tokens,
+            use_gpu=False,
+            use_endpoint=True,
+            endpoint_config=endpoint_config,
+            feat_config=feat_config,
+            decoding_method="modified_beam_search",
+        )
+        recognizer = sherpa.OnlineRecognizer(config)
+
+        samples, sample_rate = torchaudio.load(wave)
+        assert sample_rate == 16000, sample_rate
+        silence = torch.zeros(3 * 16000, dtype=torch.float32)
+        samples = torch.cat([samples.squeeze(0), silence])
+
+        s = recognizer.create_stream()
+        chunk = int(0.2 * 16000)
+        texts = []
+        for start in range(0, samples.numel(), chunk):
+            s.accept_waveform(16000, samples[start : start + chunk])
+            while recognizer.is_ready(s):
+                recognizer.decode_stream(s)
+                result = recognizer.get_result(s)
+                if result.is_final:
+                    texts.append(result.text)
+
+        # The endpoint is detected before the input is finished
+        self.assertEqual(len(texts), 1, texts)
+        self.assertNotEqual(texts[0], "")
+        self.assertEqual(recognizer.get_result(s).segment, 1)
+
+    def test_batch_buckets(self):
+        """Check that padding batches with dummy streams does not change
+        the transcripts of the test waves.
+        """
+        model_dir = f"{d}/icefall-asr-librispeech-conv-emformer-transducer-stateless2-2022-07-05"
+        nn_model = f"{model_dir}/exp/cpu-jit-epoch-30-avg-10-torch-1.10.0.pt"
+        tokens = f"{model_dir}/data/lang_bpe_500/tokens.txt"
+
+        if not Path(nn_model).is_file():
+            print(f"{nn_model} does not exist")
+            print("skipping test_batch_buckets()")
+            return
+
+        feat_config = sherpa.FeatureConfig()
+        feat_config.fbank_opts.frame_opts.samp_freq = 16000
+        feat_config.fbank_opts.mel_opts.num_bins = 80
+        feat_config.fbank_opts.mel_opts.high_freq = -400
+        feat_config.fbank_opts.frame_opts.dither = 0
+
+        waves = sorted(Path(f"{model_dir}/test_wavs").glob("*.wav"))
+        all_samples = []
+        for w in waves:
+            samples, sample_rate = torchaudio.load(str(w))
+            assert sample_rate == 16000, (w, sample_rate)
+            all_samples.append(samples.squeeze(0))
+
+        tail_padding = torch.zeros(int(16000 * 0.3), dtype=torch.float32)
+
+        transcripts = dict()
+        stats = dict()
+        for batch_buckets in ["", "4,8"]:
+            config = sherpa.OnlineRecognizerConfig(
+                nn_model=nn_model,
+                tokens=tokens,
+                use_gpu=False,
+                feat_config=feat_config,
+                decoding_method="greedy_search",
+            )
+            config.batch_buckets = batch_buckets
+            recognizer = sherpa.OnlineRecognizer(config)
+
+            # Decode all waves in a single batch so that streams
+            # finish at different chunks
+            streams = []
+            for samples in all_samples:
+                s = recognizer.create_stream()
+                s.accept_waveform(16000, samples)
+                s.accept_waveform(16000, tail_padding)
+                s.input_finished()
+                streams.append(s)
+
+            while True:
+                ready = [s for s in streams if recognizer.is_ready(s)]
+                if not ready:
+                    break
+                recognizer.decode_streams(ready)
+
+            transcripts[batch_buckets] = [
+                recognizer.get_result(s).text for s in streams
+            ]
+            stats[batch_buckets] = recognizer.bucket_stats
+
+        self.assertEqual(transcripts["4,8"], transcripts[""])
+
+        self.assertEqual(stats[""].num_calls, 0)
+        self.assertGreater(stats["4,8"].num_calls, 0)
+        self.assertEqual(stats["4,8"].hit_rate, 1.0)
+        print(stats["4,8"])
+
 
 torch.set_num_threads(1)
 torch.set_num_interop_threads(1)
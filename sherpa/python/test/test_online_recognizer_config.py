@@ -14,6 +14,22 @@ class TestOnlineRecognizerConfig(unittest.TestCase):
         print()
         print(config)
 
+    def test_warmup_config(self):
+        warmup_config = sherpa.WarmUpConfig(
+            batch_sizes="1,8,16",
+            durations="2,10",
+            num_active_paths="1,4",
+        )
+        warmup_config.validate()
+
+        config = sherpa.OnlineRecognizerConfig(nn_model="a.pt", tokens="b.txt")
+        config.warmup_config = warmup_config
+        assert config.warmup_config.batch_sizes == "1,8,16"
+        assert config.warmup_config.durations == "2,10"
+        assert config.warmup_config.num_active_paths == "1,4"
+        print()
+        print(config)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+# To run this single test, use
+#
+#  ctest --verbose -R  test_quantize_dynamic_py
+
+import tempfile
+import unittest
+from pathlib import Path
+
+import torch
+
+import sherpa
+
+
+class Encoder(torch.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.linear = torch.nn.Linear(4, 4)
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        return self.linear(x)
+
+
+class StreamingEncoder(Encoder):
+    @torch.jit.export
+    def streaming_forward(self, x: torch.Tensor) -> torch.Tensor:
+        return self.linear(x)
+
+
+# Similar to ScaledLinear from icefall
+class ScaledLinear(torch.nn.Linear):
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.weight_scale = torch.nn.Parameter(torch.tensor(0.5))
+        self.bias_scale = torch.nn.Parameter(torch.tensor(-0.5))
+
+    def get_weight(self):
+        return self.weight * self.weight_scale.exp()
+
+    def get_bias(self):
+        return None if self.bias is None else self.bias * self.bias_scale.exp()
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        return torch.nn.functional.linear(x, self.get_weight(), self.get_bias())
+
+
+class ScaledEncoder(torch.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.linear = ScaledLinear(4, 4)
+        self.linear_no_bias = ScaledLinear(4, 4, bias=False)
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        return self.linear_no_bias(self.linear(x))
+
+
+class Joiner(torch.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.encoder_proj = torch.nn.Linear(4, 4)
+        self.decoder_proj = torch.nn.Linear(4, 4)
+        self.output_linear = torch.nn.Linear(4, 3)
+
+    def forward(
+        self, x: torch.Tensor, y: torch.Tensor, project_input: bool = True
+    ) -> torch.Tensor:
+        if project_input:
+            x = self.encoder_proj(x)
+            y = self.decoder_proj(y)
+        return self.output_linear(torch.tanh(x + y))
+
+
+class Model(torch.nn.Module):
+    def __init__(self, encoder: torch.nn.Module):
+        super().__init__()
+        self.encoder = encoder
+        self.joiner = Joiner()
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        return self.joiner(self.encoder(x), x)
+
+
+class TestQuantizeDynamic(unittest.TestCase):
+    def test_offline_model(self):
+        with tempfile.TemporaryDirectory() as d:
+            nn_model = Path(d) / "model.pt"
+            output = Path(d) / "model.int8.pt"
+            torch.jit.script(Model(Encoder())).save(str(nn_model))
+
+            n = sherpa.quantize_dynamic(nn_model, output)
+            assert n == 4, n
+
+            model = torch.jit.load(str(output))
+            for m in [
+                model.encoder,
+                model.joiner,
+                model.joiner.encoder_proj,
+                model.joiner.decoder_proj,
+            ]:
+                graph = str(m.forward.inlined_graph)
+                assert "quantized::linear_dynamic" in graph, graph
+                assert "aten::linear" not in graph, graph
+
+    def test_streaming_model(self):
+        with tempfile.TemporaryDirectory() as d:
+            nn_model = Path(d) / "model.pt"
+            output = Path(d) / "model.int8.pt"
+            torch.jit.script(Model(StreamingEncoder())).save(str(nn_model))
+
+            sherpa.quantize_dynamic(nn_model, output)
+
+            model = torch.jit.load(str(output))
+            graph = str(model.encoder.streaming_forward.inlined_graph)
+            assert "quantized::linear_dynamic" in graph, graph
+
+            x = torch.rand(2, 4)
+            expected = torch.jit.load(str(nn_model)).encoder.streaming_forward(
+                x
+            )
+            y = model.encoder.streaming_forward(x)
+            assert torch.allclose(y, expected, atol=0.1), (y - expected).abs()
+
+    def test_scaled_linear(self):
+        with tempfile.TemporaryDirectory() as d:
+            nn_model = Path(d) / "model.pt"
+            output = Path(d) / "model.int8.pt"
+            torch.jit.script(Model(ScaledEncoder())).save(str(nn_model))
+
+            n = sherpa.quantize_dynamic(nn_model, output)
+            assert n == 5, n
+
+            model = torch.jit.load(str(output))
+            for m in [model.encoder.linear, model.encoder.linear_no_bias]:
+                graph = str(m.forward.graph)
+                assert "quantized::linear_dynamic" in graph, graph
+                assert "aten::linear" not in graph, graph
+                assert "get_weight" not in graph, graph
+
+            x = torch.rand(2, 4)
+            expected = torch.jit.load(str(nn_model))(x)
+            y = model(x)
+            assert torch.allclose(y, expected, atol=0.1), (y - expected).abs()
+
+
+if __name__ == "__main__":
+    unittest.main()